@@ -4,36 +4,115 @@
 
 #include "bench.h"
 
+#include "random.h"
+#include "util.h"
+
+#include <univalue.h>
+
 #include <iostream>
+#include <regex>
 #include <sys/time.h>
 
+#include <boost/filesystem/operations.hpp>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
 using namespace benchmark;
 
 std::map<std::string, BenchFunction> BenchRunner::benchmarks;
 
+TempDatadirSetup::TempDatadirSetup()
+{
+    pathTemp = GetTempPath() / strprintf("bench_binarium_%lu_%i", (unsigned long)GetTime(), (int)GetRand(100000));
+    boost::filesystem::create_directories(pathTemp / "blocks");
+    mapArgs["-datadir"] = pathTemp.string();
+    ClearDatadirCache();
+}
+
+TempDatadirSetup::~TempDatadirSetup()
+{
+    mapArgs.erase("-datadir");
+    ClearDatadirCache();
+    boost::filesystem::remove_all(pathTemp);
+}
+
 static double gettimedouble(void) {
     struct timeval tv;
     gettimeofday(&tv, NULL);
     return tv.tv_usec * 0.000001 + tv.tv_sec;
 }
 
+static uint64_t getcycles(void) {
+#if defined(__i386__) || defined(__x86_64__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void PrintCSV(const std::vector<Result>& results)
+{
+    std::cout << "Benchmark" << "," << "count" << "," << "min" << "," << "max" << "," << "average" << ","
+              << "cycles" << "," << "bytes" << "," << "items" << "," << "items/s" << "," << "cycles/byte" << "\n";
+    for (const Result& result : results) {
+        std::cout << result.name << "," << result.count << "," << result.minTime << "," << result.maxTime << "," << result.averageTime << ","
+                  << result.averageCycles << "," << result.bytesPerIteration << "," << result.itemsPerIteration << ","
+                  << result.itemsPerIteration / result.averageTime << ",";
+        if (result.bytesPerIteration > 0)
+            std::cout << result.averageCycles / result.bytesPerIteration;
+        std::cout << "\n";
+    }
+}
+
+static void PrintJSON(const std::vector<Result>& results)
+{
+    UniValue benchmarks(UniValue::VARR);
+    for (const Result& result : results) {
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("name", result.name));
+        entry.push_back(Pair("count", result.count));
+        entry.push_back(Pair("min", result.minTime));
+        entry.push_back(Pair("max", result.maxTime));
+        entry.push_back(Pair("average", result.averageTime));
+        entry.push_back(Pair("cycles", result.averageCycles));
+        entry.push_back(Pair("bytes", result.bytesPerIteration));
+        entry.push_back(Pair("items", result.itemsPerIteration));
+        entry.push_back(Pair("items_per_second", result.itemsPerIteration / result.averageTime));
+        if (result.bytesPerIteration > 0)
+            entry.push_back(Pair("cycles_per_byte", result.averageCycles / result.bytesPerIteration));
+        benchmarks.push_back(entry);
+    }
+    std::cout << benchmarks.write(2) << "\n";
+}
+
 BenchRunner::BenchRunner(std::string name, BenchFunction func)
 {
     benchmarks.insert(std::make_pair(name, func));
 }
 
 void
-BenchRunner::RunAll(double elapsedTimeForOne)
+BenchRunner::RunAll(double elapsedTimeForOne, const std::string& format, const std::string& filter)
 {
-    std::cout << "Benchmark" << "," << "count" << "," << "min" << "," << "max" << "," << "average" << "\n";
+    std::regex reFilter(filter);
+    std::vector<Result> results;
 
     for (std::map<std::string,BenchFunction>::iterator it = benchmarks.begin();
          it != benchmarks.end(); ++it) {
 
-        State state(it->first, elapsedTimeForOne);
+        if (!std::regex_search(it->first, reFilter))
+            continue;
+
+        State state(it->first, elapsedTimeForOne, results);
         BenchFunction& func = it->second;
         func(state);
     }
+
+    if (format == "json")
+        PrintJSON(results);
+    else
+        PrintCSV(results);
 }
 
 bool State::KeepRunning()
@@ -41,6 +120,7 @@ bool State::KeepRunning()
     double now;
     if (count == 0) {
         beginTime = now = gettimedouble();
+        beginCycles = getcycles();
     }
     else {
         // timeCheckCount is used to avoid calling gettime most of the time,
@@ -62,9 +142,16 @@ bool State::KeepRunning()
 
     --count;
 
-    // Output results
-    double average = (now-beginTime)/count;
-    std::cout << name << "," << count << "," << minTime << "," << maxTime << "," << average << "\n";
+    Result result;
+    result.name = name;
+    result.count = count;
+    result.minTime = minTime;
+    result.maxTime = maxTime;
+    result.averageTime = (now-beginTime)/count;
+    result.averageCycles = double(getcycles() - beginCycles)/count;
+    result.bytesPerIteration = bytesPerIteration;
+    result.itemsPerIteration = itemsPerIteration;
+    results.push_back(result);
 
     return false;
 }
@@ -5,9 +5,13 @@
 #ifndef BITCOIN_BENCH_BENCH_H
 #define BITCOIN_BENCH_BENCH_H
 
+#include <limits>
 #include <map>
+#include <stdint.h>
 #include <string>
+#include <vector>
 
+#include <boost/filesystem/path.hpp>
 #include <boost/function.hpp>
 #include <boost/preprocessor/cat.hpp>
 #include <boost/preprocessor/stringize.hpp>
@@ -36,24 +40,52 @@ BENCHMARK(CODE_TO_TIME);
  
 namespace benchmark {
 
+    struct Result {
+        std::string name;
+        int64_t count;
+        double minTime, maxTime, averageTime;
+        // Per iteration; 0 where no cycle counter is available.
+        double averageCycles;
+        uint64_t bytesPerIteration;
+        uint64_t itemsPerIteration;
+    };
+
     class State {
         std::string name;
         double maxElapsed;
         double beginTime;
         double lastTime, minTime, maxTime;
+        uint64_t beginCycles;
         int64_t count;
         int64_t timeCheckCount;
+        uint64_t bytesPerIteration;
+        uint64_t itemsPerIteration;
+        std::vector<Result>& results;
     public:
-        State(std::string _name, double _maxElapsed) : name(_name), maxElapsed(_maxElapsed), count(0) {
+        State(std::string _name, double _maxElapsed, std::vector<Result>& _results) : name(_name), maxElapsed(_maxElapsed), count(0),
+            bytesPerIteration(0), itemsPerIteration(1), results(_results) {
             minTime = std::numeric_limits<double>::max();
             maxTime = std::numeric_limits<double>::min();
             timeCheckCount = 1;
         }
         bool KeepRunning();
+
+        // Input bytes processed by one iteration, reported as cycles/byte.
+        void SetBytesPerIteration(uint64_t n) { bytesPerIteration = n; }
+        // Hashes (or other items) produced by one iteration, reported as items/s.
+        void SetItemsPerIteration(uint64_t n) { itemsPerIteration = n; }
     };
 
     typedef boost::function<void(State&)> BenchFunction;
 
+    /** A temporary -datadir with a blocks directory, for benchmarks that write files,
+     *  removed again when it goes out of scope */
+    struct TempDatadirSetup {
+        boost::filesystem::path pathTemp;
+        TempDatadirSetup();
+        ~TempDatadirSetup();
+    };
+
     class BenchRunner
     {
         static std::map<std::string, BenchFunction> benchmarks;
@@ -61,7 +93,8 @@ namespace benchmark {
     public:
         BenchRunner(std::string name, BenchFunction func);
 
-        static void RunAll(double elapsedTimeForOne=1.0);
+        // format is "csv" or "json"; only benchmarks whose name matches the regular expression filter run.
+        static void RunAll(double elapsedTimeForOne=1.0, const std::string& format="csv", const std::string& filter="");
     };
 }
 
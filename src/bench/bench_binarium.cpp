@@ -4,18 +4,32 @@
 
 #include "bench.h"
 
+#include "chainparams.h"
 #include "key.h"
 #include "validation.h"
 #include "util.h"
 
+#include <iostream>
+
 int
 main(int argc, char** argv)
 {
+    ParseParameters(argc, argv);
+
+    if (mapArgs.count("-?") || mapArgs.count("-h") || mapArgs.count("-help")) {
+        std::cout << "Usage: bench_binarium [options]\n\n"
+                  << "  -format=<csv|json>  Output format (default: csv)\n"
+                  << "  -filter=<regex>     Run only the benchmarks whose name matches (default: all)\n"
+                  << "  -time=<seconds>     Time spent on each benchmark (default: 1)\n";
+        return 0;
+    }
+
     ECC_Start();
     SetupEnvironment();
     fPrintToDebugLog = false; // don't want to write to debug.log file
+    SelectParams(CBaseChainParams::MAIN); // block hashing depends on the genesis block time
 
-    benchmark::BenchRunner::RunAll();
+    benchmark::BenchRunner::RunAll(atof(GetArg("-time", "1").c_str()), GetArg("-format", "csv"), GetArg("-filter", ""));
 
     ECC_Stop();
 }
@@ -0,0 +1,98 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "arith_uint256.h"
+#include "consensus/merkle.h"
+#include "key.h"
+#include "primitives/block.h"
+#include "pubkey.h"
+#include "script/sigcache.h"
+#include "script/standard.h"
+#include "streams.h"
+#include "version.h"
+
+// A block of nTransactions one input, two output transactions, about the size of a busy mainnet block.
+static CBlock SyntheticBlock(unsigned int nTransactions)
+{
+    CBlock block;
+    for (unsigned int i = 0; i < nTransactions; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(ArithToUint256(arith_uint256(i + 1)), i % 4);
+        tx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(72, i) << std::vector<unsigned char>(33, i);
+        tx.vout.resize(2);
+        for (unsigned int j = 0; j < 2; j++) {
+            tx.vout[j].nValue = (i + 1) * 1000 + j;
+            tx.vout[j].scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, i + j) << OP_EQUALVERIFY << OP_CHECKSIG;
+        }
+        block.vtx.push_back(tx);
+    }
+    return block;
+}
+
+static void MerkleRoot(benchmark::State& state)
+{
+    CBlock block = SyntheticBlock(2000);
+    state.SetBytesPerIteration(block.vtx.size() * 32);
+    while (state.KeepRunning()) {
+        bool mutated;
+        BlockMerkleRoot(block, &mutated);
+    }
+}
+
+static void BlockSerialize(benchmark::State& state)
+{
+    CBlock block = SyntheticBlock(2000);
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << block;
+    state.SetBytesPerIteration(stream.size());
+    while (state.KeepRunning()) {
+        stream.clear();
+        stream << block;
+    }
+}
+
+static void BlockDeserialize(benchmark::State& state)
+{
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << SyntheticBlock(2000);
+    state.SetBytesPerIteration(stream.size());
+    while (state.KeepRunning()) {
+        CDataStream copy(stream);
+        CBlock block;
+        copy >> block;
+    }
+}
+
+// Checks a signature with or without it being in the signature cache. A hit is the case of a transaction
+// accepted to the mempool and then seen again in a block.
+static void SigCacheVerify(benchmark::State& state, bool fCached)
+{
+    ECCVerifyHandle verifyHandle;
+    CKey key;
+    key.MakeNewKey(true);
+    CPubKey pubkey = key.GetPubKey();
+    uint256 hash = ArithToUint256(arith_uint256(12345));
+    std::vector<unsigned char> vchSig;
+    key.Sign(hash, vchSig);
+
+    CMutableTransaction txMutable;
+    txMutable.vin.resize(1);
+    CTransaction tx(txMutable);
+    // Without store, a cache hit evicts the entry and every check verifies the signature.
+    CachingTransactionSignatureChecker(&tx, 0, fCached).VerifySignature(vchSig, pubkey, hash);
+    while (state.KeepRunning())
+        CachingTransactionSignatureChecker(&tx, 0, fCached).VerifySignature(vchSig, pubkey, hash);
+}
+
+static void SigCacheHit(benchmark::State& state) { SigCacheVerify(state, true); }
+static void SigCacheMiss(benchmark::State& state) { SigCacheVerify(state, false); }
+
+BENCHMARK(MerkleRoot);
+BENCHMARK(BlockSerialize);
+BENCHMARK(BlockDeserialize);
+BENCHMARK(SigCacheHit);
+BENCHMARK(SigCacheMiss);
@@ -0,0 +1,79 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "arith_uint256.h"
+#include "blockimport.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "consensus/consensus.h"
+#include "random.h"
+#include "util.h"
+#include "validation.h"
+
+static const int IMPORT_BLOCKS = 50;
+static const int IMPORT_BLOCK_TXES = 20;
+
+// Blocks of IMPORT_BLOCK_TXES two-input transactions far enough from genesis for the memory-hard
+// pipeline; the proof of work is not checked, only hashed
+static CBlock CreateImportBlock(int nHeight)
+{
+    const CBlock& genesis = Params().GenesisBlock();
+    CBlock block;
+    block.nVersion = 0x20000000;
+    block.hashPrevBlock = ArithToUint256(arith_uint256(nHeight));
+    block.nTime = genesis.nTime + 3528000 + 60 * nHeight;
+    block.nBits = 0x2100ffff;
+    for (int i = 0; i < IMPORT_BLOCK_TXES; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(2);
+        for (int j = 0; j < 2; j++) {
+            tx.vin[j].prevout = COutPoint(ArithToUint256(arith_uint256(nHeight * 1000 + i * 2 + j + 1)), 0);
+            tx.vin[j].scriptSig = CScript() << std::vector<unsigned char>(72, 1) << std::vector<unsigned char>(33, 2);
+        }
+        tx.vout.resize(2);
+        tx.vout[0].nValue = COIN;
+        tx.vout[0].scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 3) << OP_EQUALVERIFY << OP_CHECKSIG;
+        tx.vout[1] = tx.vout[0];
+        block.vtx.push_back(CTransaction(tx));
+    }
+    return block;
+}
+
+// Framing, deserializing and hashing the blocks of a blk?????.dat file as -reindex does, with the
+// records decoded by the caller of CBlockImporter::Next() or by worker threads
+static void BlockImport(benchmark::State& state, bool fParallel)
+{
+    benchmark::TempDatadirSetup datadir;
+
+    CDiskBlockPos pos(0, 0);
+    for (int i = 0; i < IMPORT_BLOCKS; i++) {
+        CBlock block = CreateImportBlock(i + 1);
+        bool fWritten = WriteBlockToDisk(block, pos, Params().MessageStart());
+        assert(fWritten);
+        // WriteBlockToDisk returns the position of the block, after its index header
+        pos.nPos += ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION) + BLOCK_CHECKSUM_SIZE;
+    }
+
+    int nWorkers = fParallel ? std::max(2, std::min(GetNumCores(), MAX_POWCHECK_THREADS)) : 0;
+    state.SetItemsPerIteration(IMPORT_BLOCKS);
+    while (state.KeepRunning()) {
+        CBlockImporter importer(OpenBlockFile(CDiskBlockPos(0, 0), true), Params().MessageStart(), MaxBlockSize(true), nWorkers);
+        std::shared_ptr<CImportedBlock> pimported;
+        int nBlocks = 0;
+        while (importer.Next(pimported)) {
+            assert(pimported->fDecoded && pimported->fChecksum);
+            nBlocks++;
+        }
+        assert(nBlocks == IMPORT_BLOCKS);
+    }
+
+}
+
+static void BlockImportSerial(benchmark::State& state) { BlockImport(state, false); }
+static void BlockImportParallel(benchmark::State& state) { BlockImport(state, true); }
+
+BENCHMARK(BlockImportSerial);
+BENCHMARK(BlockImportParallel);
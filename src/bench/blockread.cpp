@@ -0,0 +1,99 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "arith_uint256.h"
+#include "blockfilemap.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "random.h"
+#include "streams.h"
+#include "util.h"
+#include "validation.h"
+
+static const int BLOCK_READ_TXES = 20;
+
+// A block of BLOCK_READ_TXES two-input transactions far enough from genesis for the memory-hard
+// pipeline, with the largest target so that any hash passes the proof of work check
+static CBlock CreateReadBlock()
+{
+    const CBlock& genesis = Params().GenesisBlock();
+    CBlock block;
+    block.nVersion = 0x20000000;
+    block.hashPrevBlock = genesis.GetHash();
+    block.nTime = genesis.nTime + 3528000 + 60;
+    block.nBits = 0x2100ffff;
+    for (int i = 0; i < BLOCK_READ_TXES; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(2);
+        for (int j = 0; j < 2; j++) {
+            tx.vin[j].prevout = COutPoint(ArithToUint256(arith_uint256(i * 2 + j + 1)), 0);
+            tx.vin[j].scriptSig = CScript() << std::vector<unsigned char>(72, 1) << std::vector<unsigned char>(33, 2);
+        }
+        tx.vout.resize(2);
+        tx.vout[0].nValue = COIN;
+        tx.vout[0].scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 3) << OP_EQUALVERIFY << OP_CHECKSIG;
+        tx.vout[1] = tx.vout[0];
+        block.vtx.push_back(CTransaction(tx));
+    }
+    return block;
+}
+
+enum BlockReadMode
+{
+    READ_CHECKSUM,
+    READ_POW,
+    SERVE_DESERIALIZED,
+    SERVE_RAW,
+};
+
+// ReadBlockFromDisk() of a block in the index, as done for every block connected or rescanned, with
+// the checksum written along with the block or with the proof of work check. Serving a block to a
+// peer or to getblock reads it, and serializes it again unless it is sent as it is on disk.
+static void BlockRead(benchmark::State& state, BlockReadMode mode)
+{
+    benchmark::TempDatadirSetup datadir;
+
+    Consensus::Params consensusParams = Params().GetConsensus();
+    consensusParams.powLimit = uint256S("ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+
+    CBlock blockWritten = CreateReadBlock();
+    uint256 hash = blockWritten.GetHash();
+    CDiskBlockPos pos(0, 0);
+    bool fWritten = WriteBlockToDisk(blockWritten, pos, Params().MessageStart());
+    assert(fWritten);
+
+    CBlockIndex index;
+    index.phashBlock = &hash;
+    index.nFile = pos.nFile;
+    index.nDataPos = pos.nPos;
+    index.nStatus = BLOCK_HAVE_DATA | (mode == READ_POW ? 0 : BLOCK_HAVE_CHECKSUM);
+
+    while (state.KeepRunning()) {
+        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+        if (mode == SERVE_RAW) {
+            bool fRead = ReadRawBlockFromDisk(ssBlock, &index, Params().MessageStart());
+            assert(fRead);
+        } else {
+            CBlock block;
+            bool fRead = ReadBlockFromDisk(block, &index, consensusParams);
+            assert(fRead && block.vtx.size() == BLOCK_READ_TXES);
+            if (mode == SERVE_DESERIALIZED)
+                ssBlock << block;
+        }
+    }
+
+    blockFileMapCache.Clear();
+}
+
+static void BlockReadChecksum(benchmark::State& state) { BlockRead(state, READ_CHECKSUM); }
+static void BlockReadPoW(benchmark::State& state) { BlockRead(state, READ_POW); }
+static void BlockServeDeserialized(benchmark::State& state) { BlockRead(state, SERVE_DESERIALIZED); }
+static void BlockServeRaw(benchmark::State& state) { BlockRead(state, SERVE_RAW); }
+
+BENCHMARK(BlockReadChecksum);
+BENCHMARK(BlockReadPoW);
+BENCHMARK(BlockServeDeserialized);
+BENCHMARK(BlockServeRaw);
@@ -0,0 +1,103 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "arith_uint256.h"
+#include "coins.h"
+#include "hash.h"
+#include "random.h"
+#include "txdb.h"
+#include "utilstrencodings.h"
+
+#include <vector>
+
+//! Coins in the cache, about 100MB of -dbcache
+static const int CACHE_COINS = 600000;
+//! Transactions of a block, each spending two coins and creating two
+static const int BLOCK_TXES = 1000;
+
+static COutPoint MakeOutPoint(uint32_t nTx, uint32_t n)
+{
+    return COutPoint(Hash(BEGIN(nTx), END(nTx)), n);
+}
+
+static Coin MakeCoin(uint32_t nTx, int nHeight)
+{
+    CTxOut out;
+    out.nValue = (nTx % 1000 + 1) * COIN;
+    out.scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, nTx & 0xff) << OP_EQUALVERIFY << OP_CHECKSIG;
+    return Coin(std::move(out), nHeight, false);
+}
+
+// Connecting a block to the coins of pcoinsTip, with the coins of the cache as a -dbcache sized
+// cache holds them between flushes: the block spends coins of the cache and adds new ones in a
+// view of its own, which is then flushed into the cache, as ConnectTip() does.
+// Run alone for the peak RSS of the process.
+static void CoinsCacheConnectBlock(benchmark::State& state)
+{
+    CCoinsView viewBase;
+    CCoinsViewCache cache(&viewBase);
+    std::vector<COutPoint> vOutPoints;
+    vOutPoints.reserve(CACHE_COINS);
+    uint32_t nTx = 0;
+    for (; vOutPoints.size() < CACHE_COINS; nTx++) {
+        for (uint32_t n = 0; n < 2; n++) {
+            cache.AddCoin(MakeOutPoint(nTx, n), MakeCoin(nTx, 1), false);
+            vOutPoints.push_back(MakeOutPoint(nTx, n));
+        }
+    }
+
+    int nHeight = 2;
+    state.SetItemsPerIteration(BLOCK_TXES);
+    while (state.KeepRunning()) {
+        CCoinsViewCache view(&cache);
+        for (int i = 0; i < BLOCK_TXES; i++, nTx++) {
+            for (uint32_t n = 0; n < 2; n++) {
+                size_t nSpend = insecure_rand() % vOutPoints.size();
+                bool fSpent = view.SpendCoin(vOutPoints[nSpend]);
+                assert(fSpent);
+                vOutPoints[nSpend] = vOutPoints.back();
+                vOutPoints.pop_back();
+            }
+            for (uint32_t n = 0; n < 2; n++) {
+                view.AddCoin(MakeOutPoint(nTx, n), MakeCoin(nTx, nHeight), false);
+                vOutPoints.push_back(MakeOutPoint(nTx, n));
+            }
+        }
+        view.SetBestBlock(uint256());
+        view.Flush();
+        nHeight++;
+    }
+    assert(cache.GetCacheSize() == CACHE_COINS);
+}
+
+// Flushing a -dbcache sized cache to the coins database, as FlushStateToDisk() does once the
+// cache is full: every coin of the cache is dirty, a tenth of them spent. The database is held in
+// memory and every round fills the cache with the same coins again, so that it does not grow.
+// Run alone for the peak RSS of the process.
+static void CoinsCacheFlush(benchmark::State& state)
+{
+    benchmark::TempDatadirSetup datadir;
+    CCoinsViewDB viewDB(1 << 23, true);
+
+    int nHeight = 1;
+    state.SetItemsPerIteration(CACHE_COINS);
+    while (state.KeepRunning()) {
+        CCoinsViewCache cache(&viewDB);
+        for (uint32_t nTx = 0; nTx < CACHE_COINS / 2; nTx++) {
+            for (uint32_t n = 0; n < 2; n++)
+                cache.AddCoin(MakeOutPoint(nTx, n), MakeCoin(nTx, nHeight), true);
+            if (nTx % 5 == 0)
+                cache.SpendCoin(MakeOutPoint(nTx, 0));
+        }
+        cache.SetBestBlock(ArithToUint256(arith_uint256(nHeight)));
+        bool fFlushed = cache.Flush();
+        assert(fFlushed && cache.GetCacheSize() == 0);
+        nHeight++;
+    }
+}
+
+BENCHMARK(CoinsCacheConnectBlock);
+BENCHMARK(CoinsCacheFlush);
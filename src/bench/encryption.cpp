@@ -0,0 +1,109 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "hash.h"
+#include "uint256.h"
+
+// Key and data laid out like TPoWHashLane::aHashes, the encryption functions read past 64 bytes.
+struct EncryptionInput {
+    uint512 hashes[11];
+
+    EncryptionInput()
+    {
+        for (int i = 0; i < 11; i++)
+            for (int j = 0; j < 64; j++)
+                hashes[i].begin()[j] = i * 64 + j * 7;
+    }
+};
+
+static void KuznechikEncryptBlock(benchmark::State& state)
+{
+    EncryptionInput input;
+    state.SetBytesPerIteration(16);
+    while (state.KeepRunning())
+        encryptBlockWithGost15(input.hashes[0].begin(), input.hashes[7].begin());
+}
+
+static void KuznechikEncryptBlockVectorised(benchmark::State& state)
+{
+    EncryptionInput input;
+    TKuznechikKeySchedule schedule;
+    IntermediateEncryptionKeySchedule_GOST_2015_Kuznechik(input.hashes[0].begin(), schedule);
+    state.SetBytesPerIteration(16);
+    while (state.KeepRunning())
+        IntermediateEncryptionBlock_GOST_2015_Kuznechik(schedule, input.hashes[7].begin());
+}
+
+// The library entry point, which allocates and schedules the key on every call.
+static void ThreeFishEncrypt(benchmark::State& state)
+{
+    EncryptionInput input;
+    const char tweak[16] = {0};
+    state.SetBytesPerIteration(64);
+    while (state.KeepRunning())
+        libskein_threefish_encrypt((char*)input.hashes[7].begin(), (const char*)input.hashes[0].begin(), tweak, (const char*)input.hashes[6].begin(), 64, 512);
+}
+
+static void ThreeFishKeySchedule(benchmark::State& state)
+{
+    EncryptionInput input;
+    TThreeFishKeySchedule schedule;
+    while (state.KeepRunning())
+        IntermediateEncryptionKeySchedule_ThreeFish(input.hashes[0].begin(), schedule);
+}
+
+static void ThreeFishEncryptBlock(benchmark::State& state)
+{
+    EncryptionInput input;
+    TThreeFishKeySchedule schedule;
+    IntermediateEncryptionKeySchedule_ThreeFish(input.hashes[0].begin(), schedule);
+    state.SetBytesPerIteration(64);
+    while (state.KeepRunning())
+        IntermediateEncryptionBlock_ThreeFish(schedule, input.hashes[6].begin(), input.hashes[7].begin());
+}
+
+static void CamelliaKeySchedule(benchmark::State& state)
+{
+    EncryptionInput input;
+    TCamelliaKeySchedule schedule;
+    while (state.KeepRunning())
+        IntermediateEncryptionKeySchedule_Camellia(input.hashes[0].begin(), schedule);
+}
+
+static void CamelliaEncryptBlock(benchmark::State& state)
+{
+    EncryptionInput input;
+    TCamelliaKeySchedule schedule;
+    IntermediateEncryptionKeySchedule_Camellia(input.hashes[0].begin(), schedule);
+    state.SetBytesPerIteration(16);
+    while (state.KeepRunning())
+        IntermediateEncryptionBlock_Camellia(schedule, input.hashes[6].begin(), input.hashes[7].begin());
+}
+
+// Whole encryption stages of the SHA256AndX11 pipeline, as run once per nonce.
+template <unsigned int I_INDEX>
+static void EncryptionStage(benchmark::State& state)
+{
+    EncryptionInput input;
+    state.SetBytesPerIteration(64);
+    while (state.KeepRunning())
+        IntermediateEncryptionFunction<I_INDEX>(input.hashes[6].begin(), 64, input.hashes[0].begin(), input.hashes[7].begin());
+}
+
+static void EncryptionStageKuznechik(benchmark::State& state) { EncryptionStage<0>(state); }
+static void EncryptionStageThreeFish(benchmark::State& state) { EncryptionStage<1>(state); }
+static void EncryptionStageCamellia(benchmark::State& state) { EncryptionStage<2>(state); }
+
+BENCHMARK(KuznechikEncryptBlock);
+BENCHMARK(KuznechikEncryptBlockVectorised);
+BENCHMARK(ThreeFishEncrypt);
+BENCHMARK(ThreeFishKeySchedule);
+BENCHMARK(ThreeFishEncryptBlock);
+BENCHMARK(CamelliaKeySchedule);
+BENCHMARK(CamelliaEncryptBlock);
+BENCHMARK(EncryptionStageKuznechik);
+BENCHMARK(EncryptionStageThreeFish);
+BENCHMARK(EncryptionStageCamellia);
@@ -0,0 +1,69 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "arith_uint256.h"
+#include "flat-database.h"
+#include "masternodeman.h"
+#include "netbase.h"
+#include "random.h"
+
+static const int CACHE_MASTERNODES = 5000;
+
+// A masternode cache as a node keeps it on a network of CACHE_MASTERNODES masternodes: each one
+// with its last broadcast and ping seen
+static void FillMasternodeCache(CMasternodeMan& mnman)
+{
+    for (int i = 0; i < CACHE_MASTERNODES; i++) {
+        COutPoint outpoint(ArithToUint256(arith_uint256(i + 1)), 0);
+        CService service = LookupNumeric("10.0.0.1", 10000 + i);
+        CMasternodeBroadcast mnb(service, outpoint, CPubKey(), CPubKey(), PROTOCOL_VERSION);
+        mnb.lastPing.vin = CTxIn(outpoint);
+        mnb.lastPing.blockHash = ArithToUint256(arith_uint256(1000 + i));
+        mnb.lastPing.vchSig.resize(65, (unsigned char)i);
+        mnb.vchSig.resize(65, (unsigned char)i);
+
+        CMasternode mn(mnb);
+        mnman.Add(mn);
+        mnman.mapSeenMasternodeBroadcast[mnb.GetHash()] = std::make_pair(GetTime(), mnb);
+        mnman.mapSeenMasternodePing[mnb.lastPing.GetHash()] = mnb.lastPing;
+    }
+}
+
+// Startup load of mncache.dat, in the single stream format before sectioned snapshots or as a snapshot
+static void MasternodeCacheLoad(benchmark::State& state, bool fSnapshot)
+{
+    benchmark::TempDatadirSetup datadir;
+
+    CMasternodeMan mnmanSaved;
+    FillMasternodeCache(mnmanSaved);
+    if (fSnapshot) {
+        CFlatDB<CMasternodeMan> flatdb("mncache.dat", "magicMasternodeCache");
+        flatdb.Dump(mnmanSaved);
+    } else {
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << std::string("magicMasternodeCache");
+        ss << FLATDATA(Params().MessageStart());
+        ss << mnmanSaved;
+        uint256 hash = Hash(ss.begin(), ss.end());
+        ss << hash;
+        CAutoFile fileout(fopen((datadir.pathTemp / "mncache.dat").string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+        fileout << ss;
+    }
+
+    while (state.KeepRunning()) {
+        CMasternodeMan mnman;
+        CFlatDB<CMasternodeMan> flatdb("mncache.dat", "magicMasternodeCache");
+        bool fLoaded = flatdb.Load(mnman);
+        assert(fLoaded && mnman.size() == CACHE_MASTERNODES);
+    }
+
+}
+
+static void MasternodeCacheLoadLegacy(benchmark::State& state) { MasternodeCacheLoad(state, false); }
+static void MasternodeCacheLoadSnapshot(benchmark::State& state) { MasternodeCacheLoad(state, true); }
+
+BENCHMARK(MasternodeCacheLoadLegacy);
+BENCHMARK(MasternodeCacheLoadSnapshot);
@@ -0,0 +1,124 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "hash.h"
+#include "powhash.h"
+#include "primitives/block.h"
+#include "uint256.h"
+#include "crypto/encryption/salsa20/ecrypt-sync.h"
+#include "crypto/encryption/salsa20/salsa20_blocks.h"
+
+#include <boost/bind.hpp>
+
+#include <memory>
+#include <vector>
+
+// Every entry of aIntermediateHashFunctions, on a single 64 bytes hash as in the SHA256AndX11
+// pipeline and on a whole 80 bytes header.
+template <unsigned int I_INDEX>
+static void IntermediateHash(benchmark::State& state, uint32_t nSize)
+{
+    unsigned char data[80], result[64];
+    for (unsigned int i = 0; i < sizeof(data); i++)
+        data[i] = i * 7;
+    state.SetBytesPerIteration(nSize);
+    while (state.KeepRunning())
+        IntermediateHashFunction<I_INDEX>(data, nSize, data, result);
+}
+
+#define INTERMEDIATE_HASH_BENCHMARKS(index, label, name) \
+    static void IntermediateHash##label##_##name##_64(benchmark::State& state) { IntermediateHash<index>(state, 64); } \
+    static void IntermediateHash##label##_##name##_80(benchmark::State& state) { IntermediateHash<index>(state, 80); } \
+    BENCHMARK(IntermediateHash##label##_##name##_64); \
+    BENCHMARK(IntermediateHash##label##_##name##_80);
+
+INTERMEDIATE_HASH_BENCHMARKS(0, 00, blake512)
+INTERMEDIATE_HASH_BENCHMARKS(1, 01, bmw512)
+INTERMEDIATE_HASH_BENCHMARKS(2, 02, groestl512)
+INTERMEDIATE_HASH_BENCHMARKS(3, 03, jh512)
+INTERMEDIATE_HASH_BENCHMARKS(4, 04, keccak512)
+INTERMEDIATE_HASH_BENCHMARKS(5, 05, skein512)
+INTERMEDIATE_HASH_BENCHMARKS(6, 06, luffa512)
+INTERMEDIATE_HASH_BENCHMARKS(7, 07, cubehash512)
+INTERMEDIATE_HASH_BENCHMARKS(8, 08, shavite512)
+INTERMEDIATE_HASH_BENCHMARKS(9, 09, simd512)
+INTERMEDIATE_HASH_BENCHMARKS(10, 10, echo512)
+INTERMEDIATE_HASH_BENCHMARKS(11, 11, streebog512)
+INTERMEDIATE_HASH_BENCHMARKS(12, 12, whirlpool)
+INTERMEDIATE_HASH_BENCHMARKS(13, 13, streebog512)
+
+// The keystream of the memory-hard stage of one nonce.
+static void Salsa20Fill(benchmark::State& state, bool fPortable)
+{
+    unsigned char key[32] = {0}, iv[8] = {0};
+    std::vector<unsigned char> vKeyStream(I_POW_HASH_MEMORY_HARD_ITERATIONS * 64);
+    ECRYPT_ctx ctx;
+    ECRYPT_keysetup(&ctx, key, ECRYPT_MAXKEYSIZE, ECRYPT_MAXIVSIZE);
+    ECRYPT_ivsetup(&ctx, iv);
+    state.SetBytesPerIteration(vKeyStream.size());
+    while (state.KeepRunning()) {
+        if (fPortable)
+            salsa20_keystream_blocks_portable(&ctx, vKeyStream.data(), I_POW_HASH_MEMORY_HARD_ITERATIONS);
+        else
+            salsa20_keystream_blocks(&ctx, vKeyStream.data(), I_POW_HASH_MEMORY_HARD_ITERATIONS);
+    }
+}
+
+static void Salsa20MemoryHardFill(benchmark::State& state) { Salsa20Fill(state, false); }
+static void Salsa20MemoryHardFillPortable(benchmark::State& state) { Salsa20Fill(state, true); }
+
+BENCHMARK(Salsa20MemoryHardFill);
+BENCHMARK(Salsa20MemoryHardFillPortable);
+
+static CBlockHeader HashingHeader(uint32_t nTimeFromGenesisBlock)
+{
+    const CBlock& genesis = Params().GenesisBlock();
+    CBlockHeader header;
+    header.nVersion = 0x20000000;
+    header.hashPrevBlock = genesis.GetHash();
+    header.nTime = genesis.nTime + nTimeFromGenesisBlock;
+    header.nBits = genesis.nBits;
+    return header;
+}
+
+static void PoWHashX11(benchmark::State& state)
+{
+    CBlockHeader header = HashingHeader(60);
+    state.SetBytesPerIteration(I_BLOCK_HEADER_SIZE);
+    while (state.KeepRunning())
+        header.GetHash_X11(NULL, 60);
+}
+
+BENCHMARK(PoWHashX11);
+
+// Full GetHash_SHA256AndX11 () of one nonce, for the stage combination ( week + nBits ) % 42 == iCombination.
+static void PoWHashSHA256AndX11(benchmark::State& state, unsigned int iCombination)
+{
+    CBlockHeader header = HashingHeader(3528000 + 60);
+    unsigned int iCombinationOfGenesisBits = GetPoWPlan(header).iCombination;
+    header.nBits += (iCombination + I_AMOUNT_OF_POW_PLAN_COMBINATIONS - iCombinationOfGenesisBits) % I_AMOUNT_OF_POW_PLAN_COMBINATIONS;
+    state.SetBytesPerIteration(I_BLOCK_HEADER_SIZE);
+    while (state.KeepRunning()) {
+        header.nNonce++;
+        header.GetHash_SHA256AndX11(NULL, header.nTime - Params().GenesisBlock().nTime);
+    }
+}
+
+// Registers one benchmark per stage combination, named after the stages it runs.
+static struct PoWHashSHA256AndX11Benchmarks {
+    PoWHashSHA256AndX11Benchmarks()
+    {
+        for (unsigned int i = 0; i < I_AMOUNT_OF_POW_PLAN_COMBINATIONS; i++) {
+            TPoWPlan plan;
+            plan.iCombination = i;
+            char name[128];
+            snprintf(name, sizeof(name), "PoWHashSHA256AndX11_%02u_%s_%s_%s", i, plan.GetFirstVariableHashFunctionName(),
+                plan.GetEncryptionFunctionName(), plan.GetSecondVariableHashFunctionName());
+            benchmark::BenchRunner(name, boost::bind(&PoWHashSHA256AndX11, _1, i));
+        }
+    }
+} powHashSHA256AndX11Benchmarks;
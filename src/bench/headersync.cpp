@@ -0,0 +1,158 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "arith_uint256.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "consensus/validation.h"
+#include "primitives/block.h"
+#include "streams.h"
+#include "txdb.h"
+#include "util.h"
+#include "validation.h"
+#include "version.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <boost/thread.hpp>
+
+// Builds a synthetic run of serialized headers on top of the main network genesis block,
+// far enough from genesis for the memory-hard SHA256AndX11 pipeline to be selected.
+static CDataStream CreateHeaderStream(unsigned int nHeaders)
+{
+    const CBlock& genesis = Params().GenesisBlock();
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+
+    CBlockHeader header;
+    header.nVersion = 0x20000000;
+    header.hashPrevBlock = genesis.GetHash();
+    header.nTime = genesis.nTime + 3528000 + 60;
+    header.nBits = genesis.nBits;
+    for (unsigned int i = 0; i < nHeaders; i++) {
+        header.hashMerkleRoot = ArithToUint256(arith_uint256(i + 1));
+        header.nNonce = i;
+        header.nTime += 120;
+        stream << header;
+        header.hashPrevBlock = header.GetHash();
+    }
+    return stream;
+}
+
+// Mines a chain of headers on top of the regtest genesis block, far enough from genesis for the
+// memory-hard SHA256AndX11 pipeline to be selected, and serializes it as a peer sends it.
+static CDataStream CreateHeaderChain(unsigned int nHeaders)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    const CBlock& genesis = Params().GenesisBlock();
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+
+    CBlockHeader header;
+    header.nVersion = 0x20000000;
+    header.hashPrevBlock = genesis.GetHash();
+    header.nTime = genesis.nTime + 3528000;
+    header.nBits = genesis.nBits;
+    arith_uint256 bnTarget;
+    bnTarget.SetCompact(header.nBits);
+    for (unsigned int i = 0; i < nHeaders; i++) {
+        header.hashMerkleRoot = ArithToUint256(arith_uint256(i + 1));
+        header.nTime += consensusParams.nPowTargetSpacing;
+        header.nNonce = 0;
+        while (UintToArith256(header.GetHash()) > bnTarget)
+            header.nNonce++;
+        stream << header;
+        header.hashPrevBlock = header.GetHash();
+    }
+    return stream;
+}
+
+// The headers sync of a new node: ProcessNewBlockHeaders() accepts a mined header chain into a
+// block index that InitBlockIndex() set up with the genesis block only, in memory databases as
+// test_binarium uses. Headers are deserialized for every round, exactly as they arrive from the
+// network.
+static void HeaderSyncPoW(benchmark::State& state)
+{
+    const unsigned int nHeaders = 100;
+    SelectParams(CBaseChainParams::REGTEST);
+    const CDataStream streamHeaders = CreateHeaderChain(nHeaders);
+
+    benchmark::TempDatadirSetup datadir;
+    pblocktree = new CBlockTreeDB(1 << 20, true);
+    pcoinsdbview = new CCoinsViewDB(1 << 23, true);
+    pcoinsTip = new CCoinsViewCache(pcoinsdbview, true);
+
+    uint64_t nEvaluationsStart = GetAmountOfPoWHashEvaluations();
+    uint64_t nHeadersAccepted = 0;
+    state.SetItemsPerIteration(nHeaders);
+    while (state.KeepRunning()) {
+        UnloadBlockIndex();
+        bool fInitialized = InitBlockIndex(Params());
+        assert(fInitialized);
+
+        CDataStream stream(streamHeaders);
+        std::vector<CBlockHeader> headers(nHeaders);
+        for (CBlockHeader& header : headers)
+            stream >> header;
+        CValidationState validationState;
+        CBlockIndex* pindexLast = NULL;
+        bool fAccepted = ProcessNewBlockHeaders(headers, validationState, Params(), &pindexLast);
+        assert(fAccepted && pindexLast->nHeight == (int)nHeaders);
+        nHeadersAccepted += nHeaders;
+    }
+
+    UnloadBlockIndex();
+    delete pcoinsTip;
+    delete pcoinsdbview;
+    delete pblocktree;
+    pcoinsTip = NULL;
+    pcoinsdbview = NULL;
+    pblocktree = NULL;
+    SelectParams(CBaseChainParams::MAIN);
+
+    // On stderr, so that the results on stdout stay machine-readable.
+    std::cerr << "# HeaderSyncPoW: " << double(GetAmountOfPoWHashEvaluations() - nEvaluationsStart) / nHeadersAccepted
+              << " PoW evaluations per accepted header\n";
+}
+
+// CheckBlockHeadersProofOfWork() on a full headers message, as the headers message handler runs
+// it before taking cs_main. The target is the largest one, so that the synthetic headers pass.
+static void HeaderBatchPoW(benchmark::State& state, int nThreads)
+{
+    const unsigned int nHeaders = MAX_HEADERS_RESULTS;
+    const CDataStream streamHeaders = CreateHeaderStream(nHeaders);
+    Consensus::Params consensusParams = Params().GetConsensus();
+    consensusParams.powLimit = uint256S("ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+
+    const int nPoWCheckThreadsSaved = nPoWCheckThreads;
+    nPoWCheckThreads = nThreads > 1 ? nThreads : 0;
+    boost::thread_group threadGroup;
+    for (int i = 0; i < nPoWCheckThreads - 1; i++)
+        threadGroup.create_thread(&ThreadPoWCheck);
+
+    state.SetItemsPerIteration(nHeaders);
+    state.SetBytesPerIteration(nHeaders * I_BLOCK_HEADER_SIZE);
+    while (state.KeepRunning()) {
+        CDataStream stream(streamHeaders);
+        std::vector<CBlockHeader> headers(nHeaders);
+        for (CBlockHeader& header : headers) {
+            stream >> header;
+            header.nBits = 0x2100ffff;
+        }
+        bool fValid = CheckBlockHeadersProofOfWork(headers, consensusParams);
+        assert(fValid);
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    nPoWCheckThreads = nPoWCheckThreadsSaved;
+}
+
+static void HeaderBatchPoWSerial(benchmark::State& state) { HeaderBatchPoW(state, 1); }
+static void HeaderBatchPoWParallel(benchmark::State& state) { HeaderBatchPoW(state, std::max(2, std::min(GetNumCores(), MAX_POWCHECK_THREADS))); }
+
+BENCHMARK(HeaderSyncPoW);
+BENCHMARK(HeaderBatchPoWSerial);
+BENCHMARK(HeaderBatchPoWParallel);
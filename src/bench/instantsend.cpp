@@ -0,0 +1,119 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "arith_uint256.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "instantx.h"
+#include "masternode-sync.h"
+#include "net.h"
+#include "utiltime.h"
+
+static const int LOAD_TXES_PER_BLOCK = 250;
+static const int LOAD_TX_INPUTS = 2;
+static const int LOAD_ORPHAN_VOTES_PER_BLOCK = 1000;
+
+// Lock state filled the way ProcessTxLockVote does for valid votes, without signatures and quorums
+class CInstantSendLoad : public CInstantSend
+{
+public:
+    void AddLockedTransaction(const CTransaction& tx)
+    {
+        LOCK(cs_instantsend);
+        uint256 txHash = tx.GetHash();
+        CTxLockCandidate txLockCandidate((CTxLockRequest(tx)));
+        BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+            txLockCandidate.AddOutPointLock(txin.prevout);
+            for (int i = 0; i < COutPointLock::SIGNATURES_REQUIRED; i++) {
+                CTxLockVote vote(txHash, txin.prevout, COutPoint(txin.prevout.hash, i + 1));
+                AddTxLockVote(vote);
+                txLockCandidate.AddVote(vote);
+            }
+            mapVotedOutpoints[txin.prevout].insert(txHash);
+            mapLockedOutpoints.insert(std::make_pair(txin.prevout, txHash));
+        }
+        mapLockRequestAccepted.insert(std::make_pair(txHash, CTxLockRequest(tx)));
+        mapTxLockCandidates.insert(std::make_pair(txHash, txLockCandidate));
+    }
+
+    void AddOrphanVote(const uint256& txHash, const COutPoint& outpointMasternode)
+    {
+        LOCK(cs_instantsend);
+        CTxLockVote vote(txHash, COutPoint(txHash, 0), outpointMasternode);
+        AddTxLockVote(vote);
+        AddTxLockVoteOrphan(vote);
+    }
+};
+
+static void CheckLocks(CInstantSendLoad& is, const std::vector<CTransaction>& vtx)
+{
+    uint256 hashLocked;
+    BOOST_FOREACH(const CTransaction& tx, vtx) {
+        BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+            bool fLocked = is.GetLockedOutPointTxHash(txin.prevout, hashLocked);
+            assert(fLocked && hashLocked == tx.GetHash());
+        }
+        assert(is.IsLockedInstantSendTransaction(tx.GetHash()));
+    }
+}
+
+// A block interval on a network with heavy InstantSend use: LOAD_TXES_PER_BLOCK transactions get
+// locked and their inputs checked against the locks when they enter the mempool and again when the
+// block including them is connected, masternodes spam orphan votes and the lock state is cleaned up
+// every minute. Candidates and votes are kept for nInstantSendKeepLock blocks after their block, so
+// in steady state the maps hold that many blocks worth of locks.
+static void ConnectInstantSendBlock(CInstantSendLoad& is, CBlockIndex& index, uint64_t& nCounter)
+{
+    std::vector<CTransaction> vtx;
+    for (int i = 0; i < LOAD_TXES_PER_BLOCK; i++) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(LOAD_TX_INPUTS);
+        for (int j = 0; j < LOAD_TX_INPUTS; j++)
+            mtx.vin[j].prevout = COutPoint(ArithToUint256(arith_uint256(++nCounter)), 0);
+        mtx.vout.resize(1);
+        mtx.vout[0].nValue = COIN;
+        vtx.push_back(CTransaction(mtx));
+        is.AddLockedTransaction(vtx.back());
+    }
+    CheckLocks(is, vtx);
+
+    for (int i = 0; i < LOAD_ORPHAN_VOTES_PER_BLOCK; i++)
+        is.AddOrphanVote(ArithToUint256(arith_uint256(++nCounter)), COutPoint(uint256(), i % 100));
+
+    for (int64_t nTime = 0; nTime < Params().GetConsensus().nPowTargetSpacing; nTime += 60) {
+        SetMockTime(GetTime() + 60);
+        is.CheckAndRemove();
+    }
+
+    index.nHeight++;
+    CheckLocks(is, vtx);
+    for (int i = 0; i < (int)vtx.size(); i++)
+        is.SyncTransaction(vtx[i], &index, i + 1);
+    is.UpdatedBlockTip(&index);
+}
+
+static void InstantSendLoad(benchmark::State& state)
+{
+    CConnman connman;
+    while (!masternodeSync.IsMasternodeListSynced())
+        masternodeSync.SwitchToNextAsset(connman);
+    SetMockTime(GetTime());
+
+    CInstantSendLoad is;
+    CBlockIndex index;
+    index.nHeight = 0;
+    uint64_t nCounter = 0;
+    for (int i = 0; i <= Params().GetConsensus().nInstantSendKeepLock + 1; i++)
+        ConnectInstantSendBlock(is, index, nCounter);
+
+    while (state.KeepRunning()) {
+        ConnectInstantSendBlock(is, index, nCounter);
+    }
+
+    SetMockTime(0);
+}
+
+BENCHMARK(InstantSendLoad);
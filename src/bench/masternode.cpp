@@ -0,0 +1,24 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "arith_uint256.h"
+#include "masternode.h"
+#include "netbase.h"
+#include "uint256.h"
+
+// One score of the masternode rank computation, which CMasternodeMan runs for every masternode per block.
+static void MasternodeCalculateScore(benchmark::State& state)
+{
+    CMasternode mn(CService(), COutPoint(uint256S("1b4b1c3a2e5f8d7c9a0b6e3f2d1c4b5a6978e8d7c6b5a4f3e2d1c0b9a8f7e6d5"), 1), CPubKey(), CPubKey(), PROTOCOL_VERSION);
+    uint256 blockHash = uint256S("00000000000000000000000000000000000000000000000000000000000000ff");
+    arith_uint256 nScore;
+    while (state.KeepRunning()) {
+        nScore ^= mn.CalculateScore(blockHash);
+        blockHash = ArithToUint256(UintToArith256(blockHash) + 1);
+    }
+}
+
+BENCHMARK(MasternodeCalculateScore);
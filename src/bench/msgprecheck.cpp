@@ -0,0 +1,211 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "activemasternode.h"
+#include "arith_uint256.h"
+#include "governance-vote.h"
+#include "instantx.h"
+#include "key.h"
+#include "masternode-payments.h"
+#include "masternodeman.h"
+#include "messagesigner.h"
+#include "msgprecheck.h"
+#include "net_processing.h"
+#include "netbase.h"
+#include "protocol.h"
+#include "streams.h"
+#include "util.h"
+
+#include <boost/thread.hpp>
+
+typedef std::vector<std::pair<std::string, CDataStream> > SyncSession;
+
+static const int SESSION_MASTERNODES = 50;
+static const int SESSION_PAYMENT_VOTES = 10;
+static const int SESSION_GOVERNANCE_VOTES = 10;
+static const int SESSION_LOCK_VOTES = 5;
+
+template<typename T>
+static void RecordMessage(SyncSession& session, const char* pszCommand, const T& obj)
+{
+    session.emplace_back(pszCommand, CDataStream(SER_NETWORK, PROTOCOL_VERSION));
+    session.back().second << obj;
+}
+
+// The masternode part of a sync session as it arrives from a peer: a broadcast with its last ping
+// per masternode, then pings, payment votes, governance votes and InstantSend lock votes signed
+// by all of them. The masternodes are added to mnodeman, so that the checks find their keys.
+static SyncSession RecordSyncSession()
+{
+    SyncSession session;
+    std::vector<CKey> vecKeys;
+    std::vector<COutPoint> vecOutpoints;
+
+    for (int i = 0; i < SESSION_MASTERNODES; i++) {
+        CKey keyCollateral, keyMasternode;
+        keyCollateral.MakeNewKey(true);
+        keyMasternode.MakeNewKey(true);
+        COutPoint outpoint(ArithToUint256(arith_uint256(i + 1)), 0);
+        CService service = LookupNumeric("10.0.0.1", 9999 + i);
+
+        CMasternodeBroadcast mnb(service, outpoint, keyCollateral.GetPubKey(), keyMasternode.GetPubKey(), PROTOCOL_VERSION);
+        mnb.lastPing.vin = CTxIn(outpoint);
+        mnb.lastPing.blockHash = ArithToUint256(arith_uint256(1000 + i));
+        mnb.lastPing.Sign(keyMasternode, keyMasternode.GetPubKey());
+        mnb.Sign(keyCollateral);
+        RecordMessage(session, NetMsgType::MNANNOUNCE, mnb);
+
+        CMasternode mn(mnb);
+        mnodeman.Add(mn);
+        vecKeys.push_back(keyMasternode);
+        vecOutpoints.push_back(outpoint);
+    }
+
+    for (int i = 0; i < SESSION_MASTERNODES; i++) {
+        CMasternodePing mnp;
+        mnp.vin = CTxIn(vecOutpoints[i]);
+        mnp.blockHash = ArithToUint256(arith_uint256(2000 + i));
+        mnp.Sign(vecKeys[i], vecKeys[i].GetPubKey());
+        RecordMessage(session, NetMsgType::MNPING, mnp);
+    }
+
+    for (int i = 0; i < SESSION_MASTERNODES; i++) {
+        CPubKey pubKeyMasternode = vecKeys[i].GetPubKey();
+        activeMasternode.keyMasternode = vecKeys[i];
+        activeMasternode.pubKeyMasternode = pubKeyMasternode;
+        for (int j = 0; j < SESSION_PAYMENT_VOTES; j++) {
+            CMasternodePaymentVote vote(vecOutpoints[i], 100 + j, CScript() << OP_TRUE);
+            vote.Sign();
+            RecordMessage(session, NetMsgType::MASTERNODEPAYMENTVOTE, vote);
+        }
+        for (int j = 0; j < SESSION_GOVERNANCE_VOTES; j++) {
+            CGovernanceVote vote(vecOutpoints[i], ArithToUint256(arith_uint256(3000 + j)), VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+            vote.Sign(vecKeys[i], pubKeyMasternode);
+            RecordMessage(session, NetMsgType::MNGOVERNANCEOBJECTVOTE, vote);
+        }
+        for (int j = 0; j < SESSION_LOCK_VOTES; j++) {
+            CTxLockVote vote(ArithToUint256(arith_uint256(4000 + j)), COutPoint(ArithToUint256(arith_uint256(5000 + j)), 0), vecOutpoints[i]);
+            vote.Sign();
+            RecordMessage(session, NetMsgType::TXLOCKVOTE, vote);
+        }
+    }
+    activeMasternode.keyMasternode = CKey();
+    activeMasternode.pubKeyMasternode = CPubKey();
+
+    return session;
+}
+
+// The signature checks the managers run on each message in their ProcessMessage
+static bool ApplyMessage(const std::string& strCommand, CDataStream& vRecv)
+{
+    int nDos = 0;
+    if (strCommand == NetMsgType::MNANNOUNCE) {
+        CMasternodeBroadcast mnb;
+        vRecv >> mnb;
+        return mnb.CheckSignature(nDos) && mnb.lastPing.CheckSignature(mnb.pubKeyMasternode, nDos);
+    }
+
+    masternode_info_t infoMn;
+    if (strCommand == NetMsgType::MNPING) {
+        CMasternodePing mnp;
+        vRecv >> mnp;
+        return mnodeman.GetMasternodeInfo(mnp.vin.prevout, infoMn) && mnp.CheckSignature(infoMn.pubKeyMasternode, nDos);
+    }
+    if (strCommand == NetMsgType::MASTERNODEPAYMENTVOTE) {
+        CMasternodePaymentVote vote;
+        vRecv >> vote;
+        return mnodeman.GetMasternodeInfo(vote.vinMasternode.prevout, infoMn) && vote.CheckSignature(infoMn.pubKeyMasternode, vote.nBlockHeight, nDos);
+    }
+    if (strCommand == NetMsgType::MNGOVERNANCEOBJECTVOTE) {
+        CGovernanceVote vote;
+        vRecv >> vote;
+        return vote.IsValid(true);
+    }
+    CTxLockVote vote;
+    vRecv >> vote;
+    return vote.CheckSignature();
+}
+
+// Replays the session through the signature checks of the message handler thread, with nThreads
+// precheck threads fed as the socket thread would feed them. Every round starts without any
+// recovered key, as a node does for a session it has not seen.
+static void MasternodeSyncReplay(benchmark::State& state, int nThreads)
+{
+    ECCVerifyHandle verifyHandle;
+    const SyncSession session = RecordSyncSession();
+
+    RegisterNodeSignals(GetNodeSignals());
+    boost::thread_group threadGroup;
+    for (int i = 0; i < nThreads; i++)
+        threadGroup.create_thread(&ThreadMessagePrecheck);
+    // the pushes are ignored until a worker is up
+    while (nThreads > 0 && messagePrecheckQueue.nChecked == 0) {
+        messagePrecheckQueue.Push(session[0].first, session[0].second, PROTOCOL_VERSION);
+        MilliSleep(1);
+    }
+
+    state.SetItemsPerIteration(session.size());
+    while (state.KeepRunning()) {
+        CHashSigner::ClearPrecheckCache();
+        for (const auto& message : session)
+            messagePrecheckQueue.Push(message.first, message.second, PROTOCOL_VERSION);
+        for (const auto& message : session) {
+            CDataStream vRecv(message.second);
+            bool fValid = ApplyMessage(message.first, vRecv);
+            assert(fValid);
+        }
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    UnregisterNodeSignals(GetNodeSignals());
+    mnodeman.Clear();
+}
+
+static void MasternodeSyncReplaySerial(benchmark::State& state) { MasternodeSyncReplay(state, 0); }
+static void MasternodeSyncReplayPipelined(benchmark::State& state) { MasternodeSyncReplay(state, std::max(1, std::min(GetNumCores() - 1, MAX_MSGCHECK_THREADS))); }
+
+BENCHMARK(MasternodeSyncReplaySerial);
+BENCHMARK(MasternodeSyncReplayPipelined);
+
+// Verifies the signatures of one governance object's votes as CGovernanceManager::Sync does,
+// with nThreads precheck threads
+static void SignatureBatchVerify(benchmark::State& state, int nThreads)
+{
+    ECCVerifyHandle verifyHandle;
+    std::vector<CHashSignatureCheck> vChecks;
+    for (int i = 0; i < SESSION_MASTERNODES * SESSION_GOVERNANCE_VOTES; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        uint256 hash = CMessageSigner::GetMessageHash(std::to_string(i));
+        std::vector<unsigned char> vchSig;
+        key.SignCompact(hash, vchSig);
+        vChecks.emplace_back(hash, key.GetPubKey(), vchSig);
+    }
+
+    boost::thread_group threadGroup;
+    for (int i = 0; i < nThreads; i++)
+        threadGroup.create_thread(&ThreadMessagePrecheck);
+    while (messagePrecheckQueue.GetThreadCount() < nThreads)
+        MilliSleep(1);
+
+    state.SetItemsPerIteration(vChecks.size());
+    while (state.KeepRunning()) {
+        CHashSigner::ClearPrecheckCache();
+        std::vector<CHashSignatureCheck> vBatch(vChecks);
+        std::vector<bool> vResults = messagePrecheckQueue.VerifyBatchWait(std::move(vBatch));
+        assert(vResults.size() == vChecks.size());
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+static void SignatureBatchVerifySerial(benchmark::State& state) { SignatureBatchVerify(state, 0); }
+static void SignatureBatchVerifyParallel(benchmark::State& state) { SignatureBatchVerify(state, std::max(1, std::min(GetNumCores(), MAX_MSGCHECK_THREADS))); }
+
+BENCHMARK(SignatureBatchVerifySerial);
+BENCHMARK(SignatureBatchVerifyParallel);
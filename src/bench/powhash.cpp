@@ -0,0 +1,68 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "powhash.h"
+#include "primitives/block.h"
+
+#include <memory>
+
+static CBlockHeader MiningHeader()
+{
+    const CBlock& genesis = Params().GenesisBlock();
+    CBlockHeader header;
+    header.nVersion = 0x20000000;
+    header.hashPrevBlock = genesis.GetHash();
+    header.nTime = genesis.nTime + 3528000 + 60;
+    header.nBits = genesis.nBits;
+    return header;
+}
+
+// The miner loop before batching: one nonce per CBlockHeader::GetHash() call.
+static void PoWHashSingleNonce(benchmark::State& state)
+{
+    CBlockHeader header = MiningHeader();
+    state.SetBytesPerIteration(I_BLOCK_HEADER_SIZE);
+    while (state.KeepRunning()) {
+        header.nNonce++;
+        header.GetHash();
+    }
+}
+
+// One iteration hashes I_POW_HASH_MAX_LANES nonces.
+static void PoWHashBatch(benchmark::State& state)
+{
+    CBlockHeader header = MiningHeader();
+    state.SetBytesPerIteration(I_BLOCK_HEADER_SIZE * I_POW_HASH_MAX_LANES);
+    state.SetItemsPerIteration(I_POW_HASH_MAX_LANES);
+    std::unique_ptr<TPoWHashScratch> pScratch(new TPoWHashScratch);
+    uint256 hashes[I_POW_HASH_MAX_LANES];
+    uint32_t nNonce = 0;
+    while (state.KeepRunning()) {
+        GetPoWHashes(header, nNonce, I_POW_HASH_MAX_LANES, hashes, *pScratch);
+        nNonce += I_POW_HASH_MAX_LANES;
+    }
+}
+
+// Same as PoWHashBatch, on the scratch of a miner thread started with -powhashhugepages.
+static void PoWHashBatchHugePages(benchmark::State& state)
+{
+    CBlockHeader header = MiningHeader();
+    state.SetBytesPerIteration(I_BLOCK_HEADER_SIZE * I_POW_HASH_MAX_LANES);
+    state.SetItemsPerIteration(I_POW_HASH_MAX_LANES);
+    TPoWHashScratch* pScratch = AllocatePoWHashScratch(true);
+    uint256 hashes[I_POW_HASH_MAX_LANES];
+    uint32_t nNonce = 0;
+    while (state.KeepRunning()) {
+        GetPoWHashes(header, nNonce, I_POW_HASH_MAX_LANES, hashes, *pScratch);
+        nNonce += I_POW_HASH_MAX_LANES;
+    }
+    FreePoWHashScratch(pScratch);
+}
+
+BENCHMARK(PoWHashSingleNonce);
+BENCHMARK(PoWHashBatch);
+BENCHMARK(PoWHashBatchHugePages);
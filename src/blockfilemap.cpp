@@ -0,0 +1,149 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilemap.h"
+
+#include "clientversion.h"
+#include "streams.h"
+#include "validation.h"
+
+#include <string.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CBlockFileMapCache blockFileMapCache;
+
+CBlockFileMapCache::CBlockFileMapCache(size_t nMaxMappingsIn)
+: nMaxMappings(nMaxMappingsIn),
+  listMappings(),
+  nMaps(0)
+{}
+
+CBlockFileMapCache::~CBlockFileMapCache()
+{
+    Clear();
+}
+
+bool CBlockFileMapCache::Map(int nFile)
+{
+#ifdef WIN32
+    return false;
+#else
+    boost::filesystem::path path = GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk");
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps the file open
+    close(fd);
+    if (p == MAP_FAILED)
+        return false;
+
+    CMapping mapping;
+    mapping.nFile = nFile;
+    size_t nSize = st.st_size;
+    mapping.pBegin.reset((const unsigned char*)p, [nSize](const unsigned char* pBegin) { munmap((void*)pBegin, nSize); });
+    mapping.nSize = nSize;
+    listMappings.push_front(mapping);
+    nMaps++;
+
+    while (listMappings.size() > nMaxMappings)
+        Unmap(--listMappings.end());
+    return true;
+#endif
+}
+
+void CBlockFileMapCache::Unmap(std::list<CMapping>::iterator it)
+{
+    // reads still copying from the mapping keep it alive
+    listMappings.erase(it);
+}
+
+static bool ReadFromFile(const CDiskBlockPos& pos, unsigned char* pch, size_t nSize)
+{
+    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return false;
+    try {
+        filein.read((char*)pch, nSize);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+bool CBlockFileMapCache::Read(const CDiskBlockPos& pos, unsigned char* pch, size_t nSize)
+{
+    uint64_t nEnd = (uint64_t)pos.nPos + nSize;
+    std::shared_ptr<const unsigned char> pBegin;
+
+    {
+        LOCK(cs);
+        std::list<CMapping>::iterator it = listMappings.begin();
+        while (it != listMappings.end() && it->nFile != pos.nFile)
+            ++it;
+        if (it != listMappings.end() && nEnd > it->nSize) {
+            // the file grew since it was mapped
+            Unmap(it);
+            it = listMappings.end();
+        }
+        if (it == listMappings.end()) {
+            // out of address space, or no mappings at all
+            if (nMaxMappings != 0 && Map(pos.nFile))
+                it = listMappings.begin();
+        } else {
+            listMappings.splice(listMappings.begin(), listMappings, it);
+        }
+        if (it != listMappings.end()) {
+            if (nEnd > it->nSize)
+                return false;
+            pBegin = it->pBegin;
+        }
+    }
+
+    if (!pBegin)
+        return ReadFromFile(pos, pch, nSize);
+    memcpy(pch, pBegin.get() + pos.nPos, nSize);
+    return true;
+}
+
+void CBlockFileMapCache::Unmap(int nFile)
+{
+    LOCK(cs);
+    for (std::list<CMapping>::iterator it = listMappings.begin(); it != listMappings.end(); ++it) {
+        if (it->nFile == nFile) {
+            Unmap(it);
+            return;
+        }
+    }
+}
+
+void CBlockFileMapCache::Clear()
+{
+    LOCK(cs);
+    while (!listMappings.empty())
+        Unmap(listMappings.begin());
+}
+
+size_t CBlockFileMapCache::size() const
+{
+    LOCK(cs);
+    return listMappings.size();
+}
+
+uint64_t CBlockFileMapCache::GetMaps() const
+{
+    LOCK(cs);
+    return nMaps;
+}
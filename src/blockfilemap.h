@@ -0,0 +1,66 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILEMAP_H
+#define BITCOIN_BLOCKFILEMAP_H
+
+#include "chain.h"
+#include "sync.h"
+
+#include <list>
+#include <memory>
+
+/** Number of blk?????.dat files kept mapped, a file is at most MAX_BLOCKFILE_SIZE */
+static const size_t DEFAULT_BLOCK_FILE_MAPPINGS = sizeof(void*) > 4 ? 16 : 2;
+
+/**
+ * Read-only memory mappings of the block files, so that reading a block record costs a copy out of
+ * the page cache instead of opening, seeking and reading a file.
+ *
+ * Mappings are made on first use and dropped least recently used first. A file is mapped up to its
+ * size at the time, a read past that end maps it again, which picks up blocks appended since. Only
+ * ranges that were written through the block index are read, so the truncation of a finalized file
+ * never shrinks it below a mapped range that is still read. Pruned files must be unmapped.
+ * A read pins the mapping it copies from and copies outside the lock, the mapping is released
+ * once it is dropped from the cache and the last read from it is done.
+ * On Windows every read goes through the file.
+ */
+class CBlockFileMapCache
+{
+private:
+    struct CMapping
+    {
+        int nFile;
+        // munmap()s the file when the last reference goes
+        std::shared_ptr<const unsigned char> pBegin;
+        size_t nSize;
+    };
+
+    mutable CCriticalSection cs;
+    size_t nMaxMappings;
+    // most recently used first
+    std::list<CMapping> listMappings;
+    uint64_t nMaps;
+
+    bool Map(int nFile);
+    void Unmap(std::list<CMapping>::iterator it);
+
+public:
+    CBlockFileMapCache(size_t nMaxMappingsIn = DEFAULT_BLOCK_FILE_MAPPINGS);
+    ~CBlockFileMapCache();
+
+    /** Copy nSize bytes at pos of a block file to pch, false if the file does not hold them */
+    bool Read(const CDiskBlockPos& pos, unsigned char* pch, size_t nSize);
+    /** Drop the mapping of a file, before it is deleted */
+    void Unmap(int nFile);
+    void Clear();
+
+    size_t size() const;
+    /** Number of mappings made so far, including remappings of grown files */
+    uint64_t GetMaps() const;
+};
+
+extern CBlockFileMapCache blockFileMapCache;
+
+#endif // BITCOIN_BLOCKFILEMAP_H
@@ -0,0 +1,229 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockimport.h"
+
+#include "clientversion.h"
+#include "util.h"
+#include "validation.h"
+
+#include <boost/bind.hpp>
+
+CImportedBlock::CImportedBlock() :
+    nPos(0),
+    nSize(0),
+    fDecoded(false),
+    fChecksum(false),
+    ssBlock(SER_DISK, CLIENT_VERSION),
+    fHaveTrailer(false),
+    nTrailer(0),
+    fDone(false)
+{}
+
+void CImportedBlock::Decode()
+{
+    try {
+        // the hash of the header is needed for the checksum, which covers the serialized block
+        CBlockHeader header;
+        CDataStream ssHeader(ssBlock.begin(), ssBlock.begin() + I_BLOCK_HEADER_SIZE, SER_DISK, CLIENT_VERSION);
+        ssHeader >> header;
+        uint256 hash = header.GetHash();
+        fChecksum = fHaveTrailer && nTrailer == GetBlockChecksum(hash, ssBlock);
+
+        ssBlock >> block;
+        block.SetHashCache(hash);
+        fDecoded = true;
+    } catch (const std::exception& e) {
+        strError = e.what();
+    }
+    ssBlock.clear();
+}
+
+CBlockImporter::CBlockImporter(FILE* fileIn, const CMessageHeader::MessageStartChars& messageStartIn, unsigned int nMaxBlockSizeIn, int nWorkers) :
+    blkdat(fileIn, 2*nMaxBlockSizeIn, nMaxBlockSizeIn+8, SER_DISK, CLIENT_VERSION),
+    nMaxBlockSize(nMaxBlockSizeIn),
+    nBytesQueued(0),
+    fReaderDone(false),
+    fRescan(false),
+    nRescanPos(0),
+    fStopping(false)
+{
+    memcpy(messageStart, messageStartIn, MESSAGE_START_SIZE);
+    threadGroup.create_thread(boost::bind(&CBlockImporter::ThreadReader, this));
+    for (int i = 0; i < nWorkers; i++)
+        threadGroup.create_thread(boost::bind(&CBlockImporter::ThreadDecode, this));
+}
+
+CBlockImporter::~CBlockImporter()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStopping = true;
+    }
+    condReader.notify_all();
+    condWorker.notify_all();
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+void CBlockImporter::Push(const std::shared_ptr<CImportedBlock>& pimported)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (nBytesQueued >= MAX_IMPORT_PREFETCH_BYTES && !queueRecords.empty() && !fStopping && !fRescan)
+        condReader.wait(lock);
+    // framed after the position Next() asked to scan again from
+    if (fRescan)
+        return;
+    queueRecords.push_back(pimported);
+    queueDecode.push_back(pimported);
+    nBytesQueued += pimported->nSize;
+    condWorker.notify_one();
+    condNext.notify_one();
+}
+
+void CBlockImporter::ThreadReader()
+{
+    RenameThread("binarium-blkread");
+    uint64_t nRewind = blkdat.GetPos();
+    bool fEnd = false;
+    while (true) {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (fEnd && !fRescan) {
+                // until Next() finds a record that fails to decode
+                fReaderDone = true;
+                condNext.notify_all();
+                while (!fRescan && !fStopping)
+                    condReader.wait(lock);
+            }
+            if (fStopping)
+                break;
+            if (fRescan) {
+                nRewind = nRescanPos;
+                fRescan = false;
+                fEnd = false;
+            }
+        }
+
+        try {
+            boost::this_thread::interruption_point();
+            if (!blkdat.SetPos(nRewind) && nRewind < blkdat.GetPos()) {
+                // a rescan from further back than the buffer reaches
+                blkdat.Seek(nRewind);
+            }
+            if (blkdat.eof()) {
+                fEnd = true;
+                continue;
+            }
+
+            nRewind++; // start one byte further next time, in case of failure
+            blkdat.SetLimit(); // remove former limit
+            unsigned int nSize = 0;
+            try {
+                // locate a header
+                unsigned char buf[MESSAGE_START_SIZE];
+                blkdat.FindByte(messageStart[0]);
+                nRewind = blkdat.GetPos()+1;
+                blkdat >> FLATDATA(buf);
+                if (memcmp(buf, messageStart, MESSAGE_START_SIZE))
+                    continue;
+                // read size
+                blkdat >> nSize;
+                if (nSize < 80 || nSize > nMaxBlockSize)
+                    continue;
+            } catch (const std::exception&) {
+                // no valid block header found; don't complain
+                fEnd = true;
+                continue;
+            }
+
+            std::shared_ptr<CImportedBlock> pimported = std::make_shared<CImportedBlock>();
+            try {
+                // read block
+                pimported->nPos = blkdat.GetPos();
+                pimported->nSize = nSize;
+                pimported->ssBlock.resize(nSize);
+                blkdat.read(&pimported->ssBlock[0], nSize);
+                nRewind = blkdat.GetPos();
+            } catch (const std::exception& e) {
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+                continue;
+            }
+            try {
+                // a checksum, or the start of the next record
+                blkdat >> pimported->nTrailer;
+                pimported->fHaveTrailer = true;
+            } catch (const std::exception&) {
+                // end of the file
+            }
+            Push(pimported);
+        } catch (const boost::thread_interrupted&) {
+            throw;
+        } catch (const std::exception& e) {
+            LogPrintf("%s: I/O error - %s\n", __func__, e.what());
+            fEnd = true;
+        }
+    }
+}
+
+void CBlockImporter::ThreadDecode()
+{
+    RenameThread("binarium-blkdec");
+    while (true) {
+        std::shared_ptr<CImportedBlock> pimported;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (queueDecode.empty() && !fStopping)
+                condWorker.wait(lock);
+            if (fStopping)
+                return;
+            pimported = queueDecode.front();
+            queueDecode.pop_front();
+        }
+        pimported->Decode();
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            pimported->fDone = true;
+        }
+        condNext.notify_all();
+    }
+}
+
+bool CBlockImporter::Next(std::shared_ptr<CImportedBlock>& pimportedRet)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (true) {
+        if (!queueRecords.empty()) {
+            std::shared_ptr<CImportedBlock> pimported = queueRecords.front();
+            if (!pimported->fDone && !queueDecode.empty() && queueDecode.front() == pimported) {
+                // no worker took it yet, or there are none
+                queueDecode.pop_front();
+                lock.unlock();
+                pimported->Decode();
+                lock.lock();
+                pimported->fDone = true;
+            }
+            if (pimported->fDone) {
+                queueRecords.pop_front();
+                nBytesQueued -= pimported->nSize;
+                if (!pimported->fDecoded) {
+                    // scan again from the byte after its magic, so that a record inside it is
+                    // found, the records framed after it are framed again
+                    queueRecords.clear();
+                    queueDecode.clear();
+                    nBytesQueued = 0;
+                    nRescanPos = pimported->nPos - MESSAGE_START_SIZE - sizeof(unsigned int) + 1;
+                    fRescan = true;
+                    fReaderDone = false;
+                }
+                condReader.notify_all();
+                pimportedRet = pimported;
+                return true;
+            }
+        } else if (fReaderDone) {
+            return false;
+        }
+        condNext.wait(lock);
+    }
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKIMPORT_H
+#define BITCOIN_BLOCKIMPORT_H
+
+#include "primitives/block.h"
+#include "protocol.h"
+#include "streams.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+/** Bytes of framed block records read ahead of the block returned by CBlockImporter::Next() */
+static const uint64_t MAX_IMPORT_PREFETCH_BYTES = 64 * 1024 * 1024;
+
+/** A block record of a block file, see CBlockImporter */
+class CImportedBlock
+{
+public:
+    //! Position of the block in the file, after its index header
+    uint64_t nPos;
+    //! Size of the serialized block
+    unsigned int nSize;
+    //! The block with its hash computed, if fDecoded
+    CBlock block;
+    bool fDecoded;
+    //! Whether the block is followed by the checksum WriteBlockToDisk writes
+    bool fChecksum;
+    std::string strError;
+
+    CImportedBlock();
+
+private:
+    friend class CBlockImporter;
+
+    CDataStream ssBlock;
+    // the 8 bytes following the block, if the file does not end before
+    bool fHaveTrailer;
+    uint64_t nTrailer;
+    // protected by CBlockImporter::mutex
+    bool fDone;
+
+    void Decode();
+};
+
+/**
+ * Reads the blocks of a block file (blk?????.dat, bootstrap.dat or a -loadblock file) in a pipeline:
+ * a reader thread frames records ahead, workers deserialize them and compute their proof-of-work
+ * hashes in parallel, and Next() returns them in file order. Without workers, Next() decodes every
+ * record itself, while the reader still prefetches the following ones.
+ *
+ * A record whose block fails to decode is scanned again from the byte after its magic, like the
+ * serial loop did, and the records the reader framed after it are dropped and framed again.
+ */
+class CBlockImporter
+{
+private:
+    CBufferedFile blkdat;
+    CMessageHeader::MessageStartChars messageStart;
+    unsigned int nMaxBlockSize;
+
+    boost::mutex mutex;
+    boost::condition_variable condReader;
+    boost::condition_variable condWorker;
+    boost::condition_variable condNext;
+    //! Framed records not returned by Next() yet, in file order
+    std::deque<std::shared_ptr<CImportedBlock> > queueRecords;
+    //! Framed records no worker took yet, in file order
+    std::deque<std::shared_ptr<CImportedBlock> > queueDecode;
+    uint64_t nBytesQueued;
+    //! Whether the reader is at the end of the file, waiting for a rescan
+    bool fReaderDone;
+    //! Set by Next() for the reader to scan from nRescanPos again
+    bool fRescan;
+    uint64_t nRescanPos;
+    bool fStopping;
+    boost::thread_group threadGroup;
+
+    void ThreadReader();
+    void ThreadDecode();
+    void Push(const std::shared_ptr<CImportedBlock>& pimported);
+
+public:
+    /** Takes over fileIn and closes it */
+    CBlockImporter(FILE* fileIn, const CMessageHeader::MessageStartChars& messageStartIn, unsigned int nMaxBlockSizeIn, int nWorkers);
+    ~CBlockImporter();
+
+    /** The next block record of the file, false at its end */
+    bool Next(std::shared_ptr<CImportedBlock>& pimportedRet);
+};
+
+#endif // BITCOIN_BLOCKIMPORT_H
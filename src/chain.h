@@ -144,6 +144,8 @@ enum BlockStatus {
     BLOCK_FAILED_VALID       =   32, //!< stage after last reached validness failed
     BLOCK_FAILED_CHILD       =   64, //!< descends from failed block
     BLOCK_FAILED_MASK        =   BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
+
+    BLOCK_HAVE_CHECKSUM      =  128, //!< block data in blk*.dat is followed by its checksum, see WriteBlockToDisk
 };
 
 /** The block chain is a tree shaped structure starting with the
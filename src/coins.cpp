@@ -32,7 +32,242 @@ size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
 
 SaltedOutpointHasher::SaltedOutpointHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {}
+CCoinsMap::CCoinsMap(int nShardBitsIn) : nShardBits(nShardBitsIn), nSize(0)
+{
+    for (int i = 0; i < (1 << nShardBits); i++)
+        vShards.emplace_back(new Shard());
+}
+
+CCoinsMap::~CCoinsMap()
+{
+    clear();
+}
+
+bool CCoinsMap::Find(const Shard& shard, const COutPoint& key, uint32_t nHash, size_t& nSlotRet) const
+{
+    if (shard.vSlots.empty())
+        return false;
+    size_t nMask = shard.vSlots.size() - 1;
+    for (size_t nSlot = nHash & nMask; ; nSlot = (nSlot + 1) & nMask) {
+        const Slot& slot = shard.vSlots[nSlot];
+        if (slot.nEntry == ENTRY_NONE)
+            return false;
+        if (slot.nEntry != ENTRY_ERASED && slot.nHash == nHash && Entry(shard, slot.nEntry)->first == key) {
+            nSlotRet = nSlot;
+            return true;
+        }
+    }
+}
+
+size_t CCoinsMap::ReserveSlot(Shard& shard, uint32_t nHash)
+{
+    // keep at least a quarter of the slots empty, for probes to end early
+    if (shard.vSlots.empty()) {
+        Rehash(shard, MIN_SLOTS);
+    } else if ((shard.nEntries + shard.nErased + 1) * 4 > shard.vSlots.size() * 3) {
+        // a cache that spends as many coins as it adds keeps its size and only drops the tombstones
+        if ((shard.nEntries + 1) * 8 > shard.vSlots.size() * 5)
+            Rehash(shard, shard.vSlots.size() * 2);
+        else
+            DropErased(shard);
+    }
+    size_t nMask = shard.vSlots.size() - 1;
+    size_t nSlot = nHash & nMask;
+    while (shard.vSlots[nSlot].nEntry != ENTRY_NONE && shard.vSlots[nSlot].nEntry != ENTRY_ERASED)
+        nSlot = (nSlot + 1) & nMask;
+    return nSlot;
+}
+
+void CCoinsMap::Rehash(Shard& shard, size_t nSlots)
+{
+    Slot slotNone = {ENTRY_NONE, 0};
+    std::vector<Slot> vSlots(nSlots, slotNone);
+    size_t nMask = nSlots - 1;
+    for (const Slot& slot : shard.vSlots) {
+        if (slot.nEntry == ENTRY_NONE || slot.nEntry == ENTRY_ERASED)
+            continue;
+        size_t nSlot = slot.nHash & nMask;
+        while (vSlots[nSlot].nEntry != ENTRY_NONE)
+            nSlot = (nSlot + 1) & nMask;
+        vSlots[nSlot] = slot;
+    }
+    shard.vSlots.swap(vSlots);
+    shard.nErased = 0;
+}
+
+void CCoinsMap::DropErased(Shard& shard)
+{
+    // Without the tombstones, every entry is moved back to the first empty slot from its hash on.
+    // Starting after a slot that was empty before, which no probe crosses, each entry only moves
+    // within its own probe and never leaves a gap in the probe of an entry already moved.
+    size_t nMask = shard.vSlots.size() - 1;
+    size_t nStart = 0;
+    while (shard.vSlots[nStart].nEntry != ENTRY_NONE)
+        nStart++;
+    for (Slot& slot : shard.vSlots) {
+        if (slot.nEntry == ENTRY_ERASED)
+            slot.nEntry = ENTRY_NONE;
+    }
+    for (size_t i = 1; i <= nMask; i++) {
+        size_t nSlot = (nStart + i) & nMask;
+        Slot slot = shard.vSlots[nSlot];
+        if (slot.nEntry == ENTRY_NONE)
+            continue;
+        shard.vSlots[nSlot].nEntry = ENTRY_NONE;
+        size_t nSlotNew = slot.nHash & nMask;
+        while (shard.vSlots[nSlotNew].nEntry != ENTRY_NONE)
+            nSlotNew = (nSlotNew + 1) & nMask;
+        shard.vSlots[nSlotNew] = slot;
+    }
+    shard.nErased = 0;
+}
+
+uint32_t CCoinsMap::AllocateEntry(Shard& shard)
+{
+    if (shard.nFreed != ENTRY_NONE) {
+        uint32_t nEntry = shard.nFreed;
+        shard.nFreed = *reinterpret_cast<uint32_t*>(Entry(shard, nEntry));
+        return nEntry;
+    }
+    if (shard.nPoolUsed == shard.vChunks.size() * CHUNK_ENTRIES)
+        shard.vChunks.push_back(static_cast<value_type*>(::operator new(CHUNK_ENTRIES * sizeof(value_type))));
+    return shard.nPoolUsed++;
+}
+
+void CCoinsMap::FreeEntry(Shard& shard, uint32_t nEntry)
+{
+    *reinterpret_cast<uint32_t*>(Entry(shard, nEntry)) = shard.nFreed;
+    shard.nFreed = nEntry;
+}
+
+void CCoinsMap::SkipEmpty(size_t& nShard, size_t& nSlot) const
+{
+    for (; nShard < vShards.size(); nShard++, nSlot = 0) {
+        const std::vector<Slot>& vSlots = vShards[nShard]->vSlots;
+        for (; nSlot < vSlots.size(); nSlot++) {
+            if (vSlots[nSlot].nEntry != ENTRY_NONE && vSlots[nSlot].nEntry != ENTRY_ERASED)
+                return;
+        }
+    }
+    nSlot = 0;
+}
+
+CCoinsMap::iterator CCoinsMap::find(const COutPoint& key)
+{
+    uint64_t nHash = hasher.Hash(key);
+    size_t nShard = ShardOf(nHash);
+    size_t nSlot;
+    if (!Find(*vShards[nShard], key, (uint32_t)nHash, nSlot))
+        return end();
+    return iterator(this, nShard, nSlot);
+}
+
+CCoinsMap::const_iterator CCoinsMap::find(const COutPoint& key) const
+{
+    return const_cast<CCoinsMap*>(this)->find(key);
+}
+
+void CCoinsMap::erase(const_iterator it)
+{
+    Shard& shard = *vShards[it.nShard];
+    Slot& slot = shard.vSlots[it.nSlot];
+    Entry(shard, slot.nEntry)->~value_type();
+    FreeEntry(shard, slot.nEntry);
+    // no probe goes past an empty slot, so this one can be empty too if the next one is
+    if (shard.vSlots[(it.nSlot + 1) & (shard.vSlots.size() - 1)].nEntry == ENTRY_NONE) {
+        slot.nEntry = ENTRY_NONE;
+    } else {
+        slot.nEntry = ENTRY_ERASED;
+        shard.nErased++;
+    }
+    shard.nEntries--;
+    nSize--;
+}
+
+void CCoinsMap::clear()
+{
+    for (const std::unique_ptr<Shard>& pshard : vShards) {
+        Shard& shard = *pshard;
+        for (const Slot& slot : shard.vSlots) {
+            if (slot.nEntry != ENTRY_NONE && slot.nEntry != ENTRY_ERASED)
+                Entry(shard, slot.nEntry)->~value_type();
+        }
+        for (value_type* pchunk : shard.vChunks)
+            ::operator delete(pchunk);
+        std::vector<Slot>().swap(shard.vSlots);
+        std::vector<value_type*>().swap(shard.vChunks);
+        shard.nEntries = 0;
+        shard.nErased = 0;
+        shard.nPoolUsed = 0;
+        shard.nFreed = ENTRY_NONE;
+    }
+    nSize = 0;
+}
+
+size_t CCoinsMap::DynamicMemoryUsage() const
+{
+    size_t nUsage = memusage::MallocUsage(vShards.capacity() * sizeof(std::unique_ptr<Shard>));
+    for (const std::unique_ptr<Shard>& pshard : vShards) {
+        nUsage += memusage::MallocUsage(sizeof(Shard));
+        nUsage += memusage::MallocUsage(pshard->vSlots.capacity() * sizeof(Slot));
+        nUsage += memusage::MallocUsage(pshard->vChunks.capacity() * sizeof(value_type*));
+        nUsage += pshard->vChunks.size() * memusage::MallocUsage(CHUNK_ENTRIES * sizeof(value_type));
+    }
+    return nUsage;
+}
+
+void CCoinsMap::LockShards() const
+{
+    for (const std::unique_ptr<Shard>& pshard : vShards)
+        pshard->mutex.lock();
+}
+
+void CCoinsMap::UnlockShards() const
+{
+    for (const std::unique_ptr<Shard>& pshard : vShards)
+        pshard->mutex.unlock();
+}
+
+namespace {
+
+/** Shards of a cache with concurrent reads, for the time of a change */
+class CCoinsShardsLock
+{
+private:
+    const CCoinsMap* pmapAll;
+    boost::mutex* pmutex;
+
+public:
+    //! Lock all shards
+    CCoinsShardsLock(const CCoinsMap& map, bool fLock) : pmapAll(fLock ? &map : NULL), pmutex(NULL)
+    {
+        if (pmapAll)
+            pmapAll->LockShards();
+    }
+
+    //! Lock the shard of an outpoint
+    CCoinsShardsLock(const CCoinsMap& map, const COutPoint& outpoint, bool fLock) : pmapAll(NULL), pmutex(fLock ? &map.GetMutex(outpoint) : NULL)
+    {
+        if (pmutex)
+            pmutex->lock();
+    }
+
+    ~CCoinsShardsLock()
+    {
+        if (pmutex)
+            pmutex->unlock();
+        if (pmapAll)
+            pmapAll->UnlockShards();
+    }
+};
+
+} // anon namespace
+
+//! Shards of the caches with concurrent reads
+static const int COINS_CACHE_SHARD_BITS = 4;
+
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn, bool fConcurrentReadsIn) :
+    CCoinsViewBacked(baseIn), cacheCoins(fConcurrentReadsIn ? COINS_CACHE_SHARD_BITS : 0), cachedCoinsUsage(0), fConcurrentReads(fConcurrentReadsIn) {}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
     return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
@@ -45,7 +280,8 @@ CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const
     Coin tmp;
     if (!base->GetCoin(outpoint, tmp))
         return cacheCoins.end();
-    CCoinsMap::iterator ret = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(tmp))).first;
+    CCoinsShardsLock lock(cacheCoins, outpoint, fConcurrentReads);
+    CCoinsMap::iterator ret = cacheCoins.emplace(outpoint, std::move(tmp)).first;
     if (ret->second.coin.IsSpent()) {
         // The parent only has an empty entry for this outpoint; we can consider our
         // version as fresh.
@@ -67,9 +303,10 @@ bool CCoinsViewCache::GetCoin(const COutPoint &outpoint, Coin &coin) const {
 void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possible_overwrite) {
     assert(!coin.IsSpent());
     if (coin.out.scriptPubKey.IsUnspendable()) return;
+    CCoinsShardsLock lock(cacheCoins, outpoint, fConcurrentReads);
     CCoinsMap::iterator it;
     bool inserted;
-    std::tie(it, inserted) = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::tuple<>());
+    std::tie(it, inserted) = cacheCoins.emplace(outpoint);
     bool fresh = false;
     if (!inserted) {
         cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
@@ -98,6 +335,7 @@ void AddCoins(CCoinsViewCache& cache, const CTransaction &tx, int nHeight) {
 bool CCoinsViewCache::SpendCoin(const COutPoint &outpoint, Coin* moveout) {
     CCoinsMap::iterator it = FetchCoin(outpoint);
     if (it == cacheCoins.end()) return false;
+    CCoinsShardsLock lock(cacheCoins, outpoint, fConcurrentReads);
     cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
     if (moveout) {
         *moveout = std::move(it->second.coin);
@@ -132,17 +370,38 @@ bool CCoinsViewCache::HaveCoinInCache(const COutPoint &outpoint) const {
     return (it != cacheCoins.end() && !it->second.coin.IsSpent());
 }
 
+bool CCoinsViewCache::PeekCoin(const COutPoint &outpoint, Coin &coin, uint256 &hashBlockRet) const {
+    boost::unique_lock<boost::mutex> lock(cacheCoins.GetMutex(outpoint));
+    hashBlockRet = hashBlock.IsNull() ? base->GetBestBlock() : hashBlock;
+    CCoinsMap::const_iterator it = cacheCoins.find(outpoint);
+    if (it != cacheCoins.end()) {
+        coin = it->second.coin;
+        return !coin.IsSpent();
+    }
+    return base->GetCoin(outpoint, coin);
+}
+
+uint256 CCoinsViewCache::PeekBestBlock() const {
+    // changes to the best block lock all shards
+    boost::unique_lock<boost::mutex> lock(cacheCoins.GetMutex(COutPoint()));
+    return hashBlock.IsNull() ? base->GetBestBlock() : hashBlock;
+}
+
 uint256 CCoinsViewCache::GetBestBlock() const {
-    if (hashBlock.IsNull())
+    if (hashBlock.IsNull()) {
+        CCoinsShardsLock lock(cacheCoins, fConcurrentReads);
         hashBlock = base->GetBestBlock();
+    }
     return hashBlock;
 }
 
 void CCoinsViewCache::SetBestBlock(const uint256 &hashBlockIn) {
+    CCoinsShardsLock lock(cacheCoins, fConcurrentReads);
     hashBlock = hashBlockIn;
 }
 
 bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn) {
+    CCoinsShardsLock lock(cacheCoins, fConcurrentReads);
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) { // Ignore non-dirty entries (optimization).
             CCoinsMap::iterator itUs = cacheCoins.find(it->first);
@@ -152,7 +411,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
                 if (!(it->second.flags & CCoinsCacheEntry::FRESH && it->second.coin.IsSpent())) {
                     // Otherwise we will need to create it in the parent
                     // and move the data up and mark it as dirty
-                    CCoinsCacheEntry& entry = cacheCoins[it->first];
+                    CCoinsCacheEntry& entry = cacheCoins.emplace(it->first).first->second;
                     entry.coin = std::move(it->second.coin);
                     cachedCoinsUsage += entry.coin.DynamicMemoryUsage();
                     entry.flags = CCoinsCacheEntry::DIRTY;
@@ -199,6 +458,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
 }
 
 bool CCoinsViewCache::Flush() {
+    CCoinsShardsLock lock(cacheCoins, fConcurrentReads);
     bool fOk = base->BatchWrite(cacheCoins, hashBlock);
     cacheCoins.clear();
     cachedCoinsUsage = 0;
@@ -209,6 +469,7 @@ void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
     if (it != cacheCoins.end() && it->second.flags == 0) {
+        CCoinsShardsLock lock(cacheCoins, hash, fConcurrentReads);
         cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
         cacheCoins.erase(it);
     }
@@ -16,8 +16,15 @@
 #include <assert.h>
 #include <stdint.h>
 
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 #include <boost/foreach.hpp>
-#include <unordered_map>
+#include <boost/thread/mutex.hpp>
 
 /**
  * A UTXO entry.
@@ -96,6 +103,10 @@ public:
      * uint64_t, resulting in failures when syncing the chain (#4634).
      */
     size_t operator()(const COutPoint& id) const {
+        return Hash(id);
+    }
+
+    uint64_t Hash(const COutPoint& id) const {
         return SipHashUint256Extra(k0, k1, id.hash, id.n);
     }
 };
@@ -119,7 +130,170 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * The entries of a CCoinsViewCache, in an open-addressing hash table with linear probing. The table
+ * holds 8-byte slots with the index of an entry and 32 bits of its hash, so that probing does not
+ * touch the entries of other hashes. The entries are constructed in place in chunks of a pool and
+ * never move; erased ones are reused by the next insertions.
+ *
+ * The table may be split in shards by the high bits of the hash, each with its own slots, pool and
+ * mutex, for CCoinsViewCache::PeekCoin() to read the coins of one shard while others are changed.
+ *
+ * Unlike std::unordered_map, erasing leaves a tombstone in the table and never moves other entries,
+ * so that erasing while iterating is fine. Inserting invalidates iterators, but not references.
+ */
+class CCoinsMap
+{
+public:
+    typedef COutPoint key_type;
+    typedef std::pair<const COutPoint, CCoinsCacheEntry> value_type;
+
+private:
+    static const uint32_t ENTRY_NONE = 0xffffffff;
+    static const uint32_t ENTRY_ERASED = 0xfffffffe;
+    static const uint32_t CHUNK_ENTRIES = 64;
+    static const size_t MIN_SLOTS = 16;
+
+    struct Slot
+    {
+        uint32_t nEntry;
+        //! The low 32 bits of the hash, which also select the first slot to probe
+        uint32_t nHash;
+    };
+
+    struct Shard
+    {
+        //! A power of two of slots, or none
+        std::vector<Slot> vSlots;
+        std::vector<value_type*> vChunks;
+        size_t nEntries;
+        size_t nErased;
+        //! Entries handed out from the chunks, whether freed since or not
+        uint32_t nPoolUsed;
+        //! The last freed entry, which holds the index of the previous one
+        uint32_t nFreed;
+        boost::mutex mutex;
+
+        Shard() : nEntries(0), nErased(0), nPoolUsed(0), nFreed(ENTRY_NONE) {}
+    };
+
+    SaltedOutpointHasher hasher;
+    std::vector<std::unique_ptr<Shard> > vShards;
+    int nShardBits;
+    size_t nSize;
+
+    size_t ShardOf(uint64_t nHash) const { return nShardBits ? (size_t)(nHash >> (64 - nShardBits)) : 0; }
+    value_type* Entry(const Shard& shard, uint32_t nEntry) const { return shard.vChunks[nEntry / CHUNK_ENTRIES] + nEntry % CHUNK_ENTRIES; }
+    value_type* Entry(size_t nShard, size_t nSlot) const { return Entry(*vShards[nShard], vShards[nShard]->vSlots[nSlot].nEntry); }
+
+    bool Find(const Shard& shard, const COutPoint& key, uint32_t nHash, size_t& nSlotRet) const;
+    //! The slot to insert a new entry of this hash into, growing or cleaning up the table first if needed
+    size_t ReserveSlot(Shard& shard, uint32_t nHash);
+    void Rehash(Shard& shard, size_t nSlots);
+    //! Remove the tombstones without reallocating the slots
+    void DropErased(Shard& shard);
+    uint32_t AllocateEntry(Shard& shard);
+    void FreeEntry(Shard& shard, uint32_t nEntry);
+    //! Move to the first slot with an entry from this one on, or to the end
+    void SkipEmpty(size_t& nShard, size_t& nSlot) const;
+
+public:
+    template <bool fConst>
+    class Iterator
+    {
+    private:
+        friend class CCoinsMap;
+        template <bool> friend class Iterator;
+        typedef typename std::conditional<fConst, const CCoinsMap, CCoinsMap>::type Map;
+        typedef typename std::conditional<fConst, const value_type, value_type>::type Value;
+
+        Map* map;
+        size_t nShard;
+        size_t nSlot;
+
+        Iterator(Map* mapIn, size_t nShardIn, size_t nSlotIn) : map(mapIn), nShard(nShardIn), nSlot(nSlotIn) {}
+
+    public:
+        Iterator() : map(NULL), nShard(0), nSlot(0) {}
+        template <bool fOther, typename = typename std::enable_if<fConst && !fOther>::type>
+        Iterator(const Iterator<fOther>& it) : map(it.map), nShard(it.nShard), nSlot(it.nSlot) {}
+
+        Value& operator*() const { return *map->Entry(nShard, nSlot); }
+        Value* operator->() const { return map->Entry(nShard, nSlot); }
+        Iterator& operator++() { map->SkipEmpty(nShard, ++nSlot); return *this; }
+        Iterator operator++(int) { Iterator it(*this); ++*this; return it; }
+        template <bool fOther>
+        bool operator==(const Iterator<fOther>& it) const { return nShard == it.nShard && nSlot == it.nSlot; }
+        template <bool fOther>
+        bool operator!=(const Iterator<fOther>& it) const { return !(*this == it); }
+    };
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+
+    /** A map of 2^nShardBitsIn shards */
+    explicit CCoinsMap(int nShardBitsIn = 0);
+    ~CCoinsMap();
+
+    size_t size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+
+    iterator begin() { size_t nShard = 0, nSlot = 0; SkipEmpty(nShard, nSlot); return iterator(this, nShard, nSlot); }
+    iterator end() { return iterator(this, vShards.size(), 0); }
+    const_iterator begin() const { size_t nShard = 0, nSlot = 0; SkipEmpty(nShard, nSlot); return const_iterator(this, nShard, nSlot); }
+    const_iterator end() const { return const_iterator(this, vShards.size(), 0); }
+
+    iterator find(const COutPoint& key);
+    const_iterator find(const COutPoint& key) const;
+
+    /** Insert an entry constructed from args, unless there is one for the key already */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(const COutPoint& key, Args&&... args)
+    {
+        uint64_t nHash = hasher.Hash(key);
+        size_t nShard = ShardOf(nHash);
+        Shard& shard = *vShards[nShard];
+        size_t nSlot;
+        if (Find(shard, key, (uint32_t)nHash, nSlot))
+            return std::make_pair(iterator(this, nShard, nSlot), false);
+
+        nSlot = ReserveSlot(shard, (uint32_t)nHash);
+        uint32_t nEntry = AllocateEntry(shard);
+        try {
+            new (Entry(shard, nEntry)) value_type(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+        } catch (...) {
+            FreeEntry(shard, nEntry);
+            throw;
+        }
+        if (shard.vSlots[nSlot].nEntry == ENTRY_ERASED)
+            shard.nErased--;
+        shard.vSlots[nSlot].nEntry = nEntry;
+        shard.vSlots[nSlot].nHash = (uint32_t)nHash;
+        shard.nEntries++;
+        nSize++;
+        return std::make_pair(iterator(this, nShard, nSlot), true);
+    }
+
+    void erase(const_iterator it);
+    void clear();
+
+    //! Memory allocated for the table and the pool, without what the coins allocate themselves
+    size_t DynamicMemoryUsage() const;
+
+    /** The mutex of the shard of an outpoint */
+    boost::mutex& GetMutex(const COutPoint& key) const { return vShards[ShardOf(hasher.Hash(key))]->mutex; }
+    /** Lock the mutexes of all shards, in order */
+    void LockShards() const;
+    void UnlockShards() const;
+};
+
+namespace memusage {
+
+static inline size_t DynamicUsage(const CCoinsMap& m)
+{
+    return m.DynamicMemoryUsage();
+}
+
+}
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -205,8 +379,16 @@ protected:
     /* Cached dynamic memory usage for the inner Coin objects. */
     mutable size_t cachedCoinsUsage;
 
+    /* Whether PeekCoin() may be called from other threads, so that changes lock the shards they make them in. */
+    const bool fConcurrentReads;
+
 public:
-    CCoinsViewCache(CCoinsView *baseIn);
+    /**
+     * @param[in] fConcurrentReadsIn  Split the cache in shards for PeekCoin() to be called
+     *                                from other threads. Changes to the cache then lock the
+     *                                shards they make them in.
+     */
+    CCoinsViewCache(CCoinsView *baseIn, bool fConcurrentReadsIn = false);
 
     // Standard CCoinsView methods
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
@@ -225,6 +407,16 @@ public:
      */
     bool HaveCoinInCache(const COutPoint &outpoint) const;
 
+    /**
+     * GetCoin() from another thread than the one changing the cache, without filling the cache,
+     * along with the best block of the view the coin was read from. Only blocks changes to the
+     * shard of the outpoint for the time of the lookup, and to the cache while it is flushed.
+     */
+    bool PeekCoin(const COutPoint &outpoint, Coin &coin, uint256 &hashBlockRet) const;
+
+    /** GetBestBlock() from another thread than the one changing the cache */
+    uint256 PeekBestBlock() const;
+
     /**
      * Return a reference to Coin in the cache, or a pruned one if not found. This is
      * more efficient than GetCoin.
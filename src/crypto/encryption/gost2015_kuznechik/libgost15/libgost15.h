@@ -22,6 +22,16 @@ void encryptBlockWithGost15(
         void *block
 );
 
+/* Same result as encryptBlockWithGost15(), with the LS transformation done
+ * on 128-bit table entries where SSE2 is available. Round keys may overlap
+ * the block, every round key is read after the previous round stored its
+ * output.
+ */
+void encryptBlockWithGost15Vectorised(
+        const void *roundKeys,
+        void *block
+);
+
 void decryptBlockWithGost15(
         const void *roundKeys,
         void *block
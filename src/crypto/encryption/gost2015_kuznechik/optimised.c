@@ -3,6 +3,11 @@
 #include "optimised_tables.h"
 #include <string.h>
 
+#if defined(__SSE2__) && defined(__x86_64__) && defined(__GNUC__)
+#define LIBGOST15_SSE2_LS_TRANSFORMATION
+#include <emmintrin.h>
+#endif
+
 
 const size_t WorkspaceOfScheduleRoundKeys = BlockLengthInBytes * 2;
 
@@ -204,3 +209,68 @@ void decryptBlockWithGost15(
     data_[0] = cache_[0] ^ roundKeys_[2 * round_];
     data_[1] = cache_[1] ^ roundKeys_[2 * round_ + 1];
 }
+
+
+#if defined LIBGOST15_SSE2_LS_TRANSFORMATION
+
+/* precomputedLSTableLeft and precomputedLSTableRight interleaved, so that
+ * one aligned load fetches the contribution of an input byte to the whole
+ * output block. Filled before any C++ static initialiser can hash.
+ */
+static __m128i precomputedLSTable[16][256];
+
+
+__attribute__((constructor(101)))
+static void interleavePrecomputedLSTables(void) {
+    for (int index_ = 0; index_ < 16; ++index_) {
+        for (int byte_ = 0; byte_ < 256; ++byte_) {
+            precomputedLSTable[index_][byte_] = _mm_set_epi64x(
+                    (long long) precomputedLSTableRight[index_][byte_].asQWord,
+                    (long long) precomputedLSTableLeft[index_][byte_].asQWord);
+        }
+    }
+}
+
+
+static inline __m128i applyLSTransformationWithSse2(
+        __m128i input
+) {
+    uint64_t left_ = (uint64_t) _mm_cvtsi128_si64(input);
+    uint64_t right_ = (uint64_t) _mm_cvtsi128_si64(_mm_unpackhi_epi64(input, input));
+    __m128i output1_ = _mm_setzero_si128(), output2_ = _mm_setzero_si128();
+
+    /* Two accumulators, the bytes of both halves are independent. */
+    for (int index_ = 0; index_ < 8; ++index_) {
+        output1_ = _mm_xor_si128(output1_, precomputedLSTable[index_][(left_ >> (8 * index_)) & 0xff]);
+        output2_ = _mm_xor_si128(output2_, precomputedLSTable[index_ + 8][(right_ >> (8 * index_)) & 0xff]);
+    }
+
+    return _mm_xor_si128(output1_, output2_);
+}
+
+#endif
+
+
+void encryptBlockWithGost15Vectorised(
+        const void *roundKeys,
+        void *data
+) {
+#if defined LIBGOST15_SSE2_LS_TRANSFORMATION
+    /* Round keys and data are not restrict-qualified here: the proof-of-work
+     * passes round keys which overlap the block being encrypted, so each round
+     * key is loaded only after the previous round has stored its output.
+     */
+    const __m128i *roundKeys_ = roundKeys;
+    __m128i *data_ = data;
+    size_t round_ = 0;
+
+    for (; round_ < NumberOfRounds - 1; ++round_) {
+        __m128i cache_ = _mm_xor_si128(_mm_loadu_si128(data_), _mm_loadu_si128(&roundKeys_[round_]));
+        _mm_storeu_si128(data_, applyLSTransformationWithSse2(cache_));
+    }
+
+    _mm_storeu_si128(data_, _mm_xor_si128(_mm_loadu_si128(data_), _mm_loadu_si128(&roundKeys_[round_])));
+#else
+    encryptBlockWithGost15(roundKeys, data);
+#endif
+}
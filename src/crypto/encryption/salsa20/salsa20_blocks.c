@@ -0,0 +1,210 @@
+/*
+Multi-block Salsa20/20 keystream generation.
+
+The keystream of Salsa20 only depends on the key, the nonce and the block
+counter, so consecutive blocks are independent of each other and can be
+computed in SIMD lanes: lane i of every vector register holds state word k of
+block (counter + i).
+*/
+
+#include "salsa20_blocks.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SALSA20_BLOCKS_X86 1
+#include <immintrin.h>
+#endif
+
+#define ROTATE(v,c) (ROTL32(v,c))
+#define XOR(v,w) ((v) ^ (w))
+#define PLUS(v,w) (U32V((v) + (w)))
+
+static void salsa20_block(const u32 input[16], u32 counterlow, u32 counterhigh, u8 *c)
+{
+  u32 x[16];
+  u32 j[16];
+  int i;
+
+  for (i = 0;i < 16;++i) j[i] = input[i];
+  j[8] = counterlow;
+  j[9] = counterhigh;
+  for (i = 0;i < 16;++i) x[i] = j[i];
+
+  for (i = 20;i > 0;i -= 2) {
+     x[ 4] = XOR(x[ 4],ROTATE(PLUS(x[ 0],x[12]), 7));
+     x[ 8] = XOR(x[ 8],ROTATE(PLUS(x[ 4],x[ 0]), 9));
+     x[12] = XOR(x[12],ROTATE(PLUS(x[ 8],x[ 4]),13));
+     x[ 0] = XOR(x[ 0],ROTATE(PLUS(x[12],x[ 8]),18));
+     x[ 9] = XOR(x[ 9],ROTATE(PLUS(x[ 5],x[ 1]), 7));
+     x[13] = XOR(x[13],ROTATE(PLUS(x[ 9],x[ 5]), 9));
+     x[ 1] = XOR(x[ 1],ROTATE(PLUS(x[13],x[ 9]),13));
+     x[ 5] = XOR(x[ 5],ROTATE(PLUS(x[ 1],x[13]),18));
+     x[14] = XOR(x[14],ROTATE(PLUS(x[10],x[ 6]), 7));
+     x[ 2] = XOR(x[ 2],ROTATE(PLUS(x[14],x[10]), 9));
+     x[ 6] = XOR(x[ 6],ROTATE(PLUS(x[ 2],x[14]),13));
+     x[10] = XOR(x[10],ROTATE(PLUS(x[ 6],x[ 2]),18));
+     x[ 3] = XOR(x[ 3],ROTATE(PLUS(x[15],x[11]), 7));
+     x[ 7] = XOR(x[ 7],ROTATE(PLUS(x[ 3],x[15]), 9));
+     x[11] = XOR(x[11],ROTATE(PLUS(x[ 7],x[ 3]),13));
+     x[15] = XOR(x[15],ROTATE(PLUS(x[11],x[ 7]),18));
+     x[ 1] = XOR(x[ 1],ROTATE(PLUS(x[ 0],x[ 3]), 7));
+     x[ 2] = XOR(x[ 2],ROTATE(PLUS(x[ 1],x[ 0]), 9));
+     x[ 3] = XOR(x[ 3],ROTATE(PLUS(x[ 2],x[ 1]),13));
+     x[ 0] = XOR(x[ 0],ROTATE(PLUS(x[ 3],x[ 2]),18));
+     x[ 6] = XOR(x[ 6],ROTATE(PLUS(x[ 5],x[ 4]), 7));
+     x[ 7] = XOR(x[ 7],ROTATE(PLUS(x[ 6],x[ 5]), 9));
+     x[ 4] = XOR(x[ 4],ROTATE(PLUS(x[ 7],x[ 6]),13));
+     x[ 5] = XOR(x[ 5],ROTATE(PLUS(x[ 4],x[ 7]),18));
+     x[11] = XOR(x[11],ROTATE(PLUS(x[10],x[ 9]), 7));
+     x[ 8] = XOR(x[ 8],ROTATE(PLUS(x[11],x[10]), 9));
+     x[ 9] = XOR(x[ 9],ROTATE(PLUS(x[ 8],x[11]),13));
+     x[10] = XOR(x[10],ROTATE(PLUS(x[ 9],x[ 8]),18));
+     x[12] = XOR(x[12],ROTATE(PLUS(x[15],x[14]), 7));
+     x[13] = XOR(x[13],ROTATE(PLUS(x[12],x[15]), 9));
+     x[14] = XOR(x[14],ROTATE(PLUS(x[13],x[12]),13));
+     x[15] = XOR(x[15],ROTATE(PLUS(x[14],x[13]),18));
+  }
+
+  for (i = 0;i < 16;++i) U32TO8_LITTLE(c + 4 * i,PLUS(x[i],j[i]));
+}
+
+static u64 counter_of(const ECRYPT_ctx *ctx)
+{
+  return (u64)ctx->input[8] | ((u64)ctx->input[9] << 32);
+}
+
+static void set_counter(ECRYPT_ctx *ctx, u64 counter)
+{
+  ctx->input[8] = U32V(counter);
+  ctx->input[9] = U32V(counter >> 32);
+}
+
+void salsa20_keystream_blocks_portable(ECRYPT_ctx *ctx, u8 *stream, u32 blocks)
+{
+  u64 counter = counter_of(ctx);
+  u32 i;
+
+  for (i = 0;i < blocks;++i, ++counter)
+    salsa20_block(ctx->input, U32V(counter), U32V(counter >> 32), stream + 64 * i);
+
+  set_counter(ctx, counter);
+}
+
+#ifdef SALSA20_BLOCKS_X86
+
+/* One quarter round on vectors, each lane belonging to a different block. */
+#define QR_SSE2(a, b, c, d) \
+  t = _mm_add_epi32(a, d); b = _mm_xor_si128(b, _mm_or_si128(_mm_slli_epi32(t, 7), _mm_srli_epi32(t, 25))); \
+  t = _mm_add_epi32(b, a); c = _mm_xor_si128(c, _mm_or_si128(_mm_slli_epi32(t, 9), _mm_srli_epi32(t, 23))); \
+  t = _mm_add_epi32(c, b); d = _mm_xor_si128(d, _mm_or_si128(_mm_slli_epi32(t, 13), _mm_srli_epi32(t, 19))); \
+  t = _mm_add_epi32(d, c); a = _mm_xor_si128(a, _mm_or_si128(_mm_slli_epi32(t, 18), _mm_srli_epi32(t, 14)));
+
+__attribute__((target("sse2")))
+static void salsa20_4blocks_sse2(const u32 input[16], u64 counter, u8 *c)
+{
+  __m128i j[16], x[16], t;
+  u32 lanes[16][4] __attribute__((aligned(16)));
+  int i, b;
+
+  for (i = 0;i < 16;++i) j[i] = _mm_set1_epi32((int)input[i]);
+  j[8] = _mm_set_epi32((int)U32V(counter + 3), (int)U32V(counter + 2), (int)U32V(counter + 1), (int)U32V(counter));
+  j[9] = _mm_set_epi32((int)U32V((counter + 3) >> 32), (int)U32V((counter + 2) >> 32), (int)U32V((counter + 1) >> 32), (int)U32V(counter >> 32));
+  for (i = 0;i < 16;++i) x[i] = j[i];
+
+  for (i = 20;i > 0;i -= 2) {
+    QR_SSE2(x[ 0], x[ 4], x[ 8], x[12])
+    QR_SSE2(x[ 5], x[ 9], x[13], x[ 1])
+    QR_SSE2(x[10], x[14], x[ 2], x[ 6])
+    QR_SSE2(x[15], x[ 3], x[ 7], x[11])
+    QR_SSE2(x[ 0], x[ 1], x[ 2], x[ 3])
+    QR_SSE2(x[ 5], x[ 6], x[ 7], x[ 4])
+    QR_SSE2(x[10], x[11], x[ 8], x[ 9])
+    QR_SSE2(x[15], x[12], x[13], x[14])
+  }
+
+  for (i = 0;i < 16;++i) _mm_store_si128((__m128i *)lanes[i], _mm_add_epi32(x[i], j[i]));
+  for (b = 0;b < 4;++b)
+    for (i = 0;i < 16;++i) U32TO8_LITTLE(c + 64 * b + 4 * i, lanes[i][b]);
+}
+
+#define QR_AVX2(a, b, c, d) \
+  t = _mm256_add_epi32(a, d); b = _mm256_xor_si256(b, _mm256_or_si256(_mm256_slli_epi32(t, 7), _mm256_srli_epi32(t, 25))); \
+  t = _mm256_add_epi32(b, a); c = _mm256_xor_si256(c, _mm256_or_si256(_mm256_slli_epi32(t, 9), _mm256_srli_epi32(t, 23))); \
+  t = _mm256_add_epi32(c, b); d = _mm256_xor_si256(d, _mm256_or_si256(_mm256_slli_epi32(t, 13), _mm256_srli_epi32(t, 19))); \
+  t = _mm256_add_epi32(d, c); a = _mm256_xor_si256(a, _mm256_or_si256(_mm256_slli_epi32(t, 18), _mm256_srli_epi32(t, 14)));
+
+__attribute__((target("avx2")))
+static void salsa20_8blocks_avx2(const u32 input[16], u64 counter, u8 *c)
+{
+  __m256i j[16], x[16], t;
+  u32 lanes[16][8] __attribute__((aligned(32)));
+  u32 low[8], high[8];
+  int i, b;
+
+  for (b = 0;b < 8;++b) {
+    low[b] = U32V(counter + b);
+    high[b] = U32V((counter + b) >> 32);
+  }
+  for (i = 0;i < 16;++i) j[i] = _mm256_set1_epi32((int)input[i]);
+  j[8] = _mm256_loadu_si256((const __m256i *)low);
+  j[9] = _mm256_loadu_si256((const __m256i *)high);
+  for (i = 0;i < 16;++i) x[i] = j[i];
+
+  for (i = 20;i > 0;i -= 2) {
+    QR_AVX2(x[ 0], x[ 4], x[ 8], x[12])
+    QR_AVX2(x[ 5], x[ 9], x[13], x[ 1])
+    QR_AVX2(x[10], x[14], x[ 2], x[ 6])
+    QR_AVX2(x[15], x[ 3], x[ 7], x[11])
+    QR_AVX2(x[ 0], x[ 1], x[ 2], x[ 3])
+    QR_AVX2(x[ 5], x[ 6], x[ 7], x[ 4])
+    QR_AVX2(x[10], x[11], x[ 8], x[ 9])
+    QR_AVX2(x[15], x[12], x[13], x[14])
+  }
+
+  for (i = 0;i < 16;++i) _mm256_store_si256((__m256i *)lanes[i], _mm256_add_epi32(x[i], j[i]));
+  for (b = 0;b < 8;++b)
+    for (i = 0;i < 16;++i) U32TO8_LITTLE(c + 64 * b + 4 * i, lanes[i][b]);
+}
+
+enum { SALSA20_PORTABLE = 1, SALSA20_SSE2 = 2, SALSA20_AVX2 = 3 };
+
+static int salsa20_implementation(void)
+{
+  static volatile int implementation = 0;
+  int result = implementation;
+
+  if (!result) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      result = SALSA20_AVX2;
+    else if (__builtin_cpu_supports("sse2"))
+      result = SALSA20_SSE2;
+    else
+      result = SALSA20_PORTABLE;
+    implementation = result;
+  }
+  return result;
+}
+
+#endif /* SALSA20_BLOCKS_X86 */
+
+void salsa20_keystream_blocks(ECRYPT_ctx *ctx, u8 *stream, u32 blocks)
+{
+#ifdef SALSA20_BLOCKS_X86
+  u64 counter = counter_of(ctx);
+  int implementation = salsa20_implementation();
+
+  if (implementation == SALSA20_AVX2) {
+    for (;blocks >= 8;blocks -= 8, counter += 8, stream += 8 * 64)
+      salsa20_8blocks_avx2(ctx->input, counter, stream);
+  }
+  if (implementation >= SALSA20_SSE2) {
+    for (;blocks >= 4;blocks -= 4, counter += 4, stream += 4 * 64)
+      salsa20_4blocks_sse2(ctx->input, counter, stream);
+  }
+  set_counter(ctx, counter);
+#endif
+
+  salsa20_keystream_blocks_portable(ctx, stream, blocks);
+}
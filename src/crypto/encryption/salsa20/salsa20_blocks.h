@@ -0,0 +1,26 @@
+#ifndef SALSA20_BLOCKS_H
+#define SALSA20_BLOCKS_H
+
+#include "ecrypt-sync.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Writes `blocks` consecutive 64-byte Salsa20/20 keystream blocks, starting at
+ * the block counter held in ctx, and advances the counter. The output is
+ * identical to ECRYPT_keystream_bytes(ctx, stream, blocks * 64), but several
+ * blocks are computed side by side: 8 at a time with AVX2 or 4 at a time with
+ * SSE2, chosen at runtime, with the portable code as fallback.
+ */
+void salsa20_keystream_blocks(ECRYPT_ctx *ctx, u8 *stream, u32 blocks);
+
+/* Reference single-block implementation, exported for tests and benchmarks. */
+void salsa20_keystream_blocks_portable(ECRYPT_ctx *ctx, u8 *stream, u32 blocks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
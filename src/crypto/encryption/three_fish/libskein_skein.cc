@@ -445,3 +445,90 @@ void libskein_threefish_encrypt(char *E,
 
   threefish_encrypt(E, K, T, P, P_size, block_size);
 }
+
+void libskein_threefish512_schedule_key
+(struct libskein_threefish512_key_schedule *S,
+ const char *K,
+ const char *T)
+{
+  if(!S || !K || !T)
+    return;
+
+  /*
+  ** Section 3.3.2, with Nw = 8 and Nr = 72.
+  */
+
+  uint64_t k[8 + 1];
+  uint64_t t[3];
+
+  bytesToWords(k, K, 64);
+  bytesToWords(t, T, 16);
+  k[8] = 0x1bd11bdaa9fc1a22;
+
+  for(size_t i = 0; i < 8; i++)
+    k[8] ^= k[i];
+
+  t[2] = t[0] ^ t[1];
+
+  for(size_t d = 0; d < 72 / 4 + 1; d++)
+    for(size_t i = 0; i < 8; i++)
+      {
+	S->s[d][i] = k[(d + i) % (8 + 1)];
+
+	if(i == 8 - 1)
+	  S->s[d][i] += d;
+	else if(i == 8 - 2)
+	  S->s[d][i] += t[(d + 1) % 3];
+	else if(i == 8 - 3)
+	  S->s[d][i] += t[d % 3];
+      }
+
+  memset(k, 0, sizeof(k));
+  memset(t, 0, sizeof(t));
+}
+
+void libskein_threefish512_encrypt_block
+(const struct libskein_threefish512_key_schedule *S,
+ char *E,
+ const char *P)
+{
+  if(!S || !E || !P)
+    return;
+
+  /*
+  ** Section 3.3, the same rounds as threefish_encrypt() with
+  ** mix() inlined for a 512-bit block.
+  */
+
+  uint64_t v[8];
+
+  bytesToWords(v, P, 64);
+
+  for(size_t d = 0; d < 72; d++)
+    {
+      if(d % 4 == 0)
+	for(size_t i = 0; i < 8; i++)
+	  v[i] += S->s[d / 4][i];
+
+      uint64_t f[8];
+      const uint8_t *r = R_8[d % 8];
+
+      for(size_t i = 0; i < 4; i++)
+	{
+	  uint64_t x0 = v[i * 2];
+	  uint64_t x1 = v[i * 2 + 1];
+
+	  f[i * 2] = x0 + x1;
+	  f[i * 2 + 1] = ((x1 << r[i]) | (x1 >> (64 - r[i]))) ^ f[i * 2];
+	}
+
+      for(size_t i = 0; i < 8; i++)
+	v[i] = f[Pi_8[i]];
+    }
+
+  for(size_t i = 0; i < 8; i++)
+    v[i] += S->s[72 / 4][i];
+
+  wordsToBytes(E, v, 8);
+  memset(v, 0, sizeof(v));
+}
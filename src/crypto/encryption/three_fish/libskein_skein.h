@@ -75,6 +75,30 @@ void libskein_threefish_encrypt
 			   ** 512, or 1024.
 			   */
 
+/*
+** Threefish-512 with the key schedule separated from the block
+** encryption. Produces the same ciphertext as
+** libskein_threefish_encrypt() with a block size of 512, but does
+** not allocate and does not touch the state shared by the functions
+** above, so a schedule may be prepared once and used by several
+** threads.
+*/
+
+struct libskein_threefish512_key_schedule
+{
+  uint64_t s[72 / 4 + 1][8]; // Subkeys, section 3.3.2.
+};
+
+void libskein_threefish512_schedule_key
+(struct libskein_threefish512_key_schedule *S,
+ const char *K, // Must be 64 bytes.
+ const char *T); // Must be 16 bytes.
+
+void libskein_threefish512_encrypt_block
+(const struct libskein_threefish512_key_schedule *S,
+ char *E, // 64 bytes of output storage.
+ const char *P); // 64 bytes of plaintext. May be identical to E.
+
 #ifdef __cplusplus
 }
 #endif
@@ -4,326 +4,229 @@
  *  Created on: Feb 15, 2013
  *      Author: Oleksandr Kazymyrov
  *		Acknowledgments: Oleksii Shevchuk
+ *
+ *  The state is kept in 64-bit words with the same memory layout as the
+ *  original byte arrays, so the digests are unchanged. The LPS transformation
+ *  has a portable and an SSE4.1 implementation, the latter is selected at
+ *  runtime when the CPU supports it.
  */
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <memory.h>
-#include <math.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "stribog_data.h"
-//#include "../stribog.h"
+#include "../stribog.h"
 
-void AddModulo512(const void *a,const void *b,void *c)
-{
-	const unsigned char *A=a, *B=b;
-	unsigned char *C=c;
-	int t = 0;
-#ifdef FULL_UNROLL
-#define ADDBYTE_8(i) t = A[i] + B[i] + (t >> 8); C[i] = t & 0xFF;
-
-	ADDBYTE_8(63)
-	ADDBYTE_8(62)
-	ADDBYTE_8(61)
-	ADDBYTE_8(60)
-	ADDBYTE_8(59)
-	ADDBYTE_8(58)
-	ADDBYTE_8(57)
-	ADDBYTE_8(56)
-	ADDBYTE_8(55)
-	ADDBYTE_8(54)
-	ADDBYTE_8(53)
-	ADDBYTE_8(52)
-	ADDBYTE_8(51)
-	ADDBYTE_8(50)
-	ADDBYTE_8(49)
-	ADDBYTE_8(48)
-	ADDBYTE_8(47)
-	ADDBYTE_8(46)
-	ADDBYTE_8(45)
-	ADDBYTE_8(44)
-	ADDBYTE_8(43)
-	ADDBYTE_8(42)
-	ADDBYTE_8(41)
-	ADDBYTE_8(40)
-	ADDBYTE_8(39)
-	ADDBYTE_8(38)
-	ADDBYTE_8(37)
-	ADDBYTE_8(36)
-	ADDBYTE_8(35)
-	ADDBYTE_8(34)
-	ADDBYTE_8(33)
-	ADDBYTE_8(32)
-	ADDBYTE_8(31)
-	ADDBYTE_8(30)
-	ADDBYTE_8(29)
-	ADDBYTE_8(28)
-	ADDBYTE_8(27)
-	ADDBYTE_8(26)
-	ADDBYTE_8(25)
-	ADDBYTE_8(24)
-	ADDBYTE_8(23)
-	ADDBYTE_8(22)
-	ADDBYTE_8(21)
-	ADDBYTE_8(20)
-	ADDBYTE_8(19)
-	ADDBYTE_8(18)
-	ADDBYTE_8(17)
-	ADDBYTE_8(16)
-	ADDBYTE_8(15)
-	ADDBYTE_8(14)
-	ADDBYTE_8(13)
-	ADDBYTE_8(12)
-	ADDBYTE_8(11)
-	ADDBYTE_8(10)
-	ADDBYTE_8(9)
-	ADDBYTE_8(8)
-	ADDBYTE_8(7)
-	ADDBYTE_8(6)
-	ADDBYTE_8(5)
-	ADDBYTE_8(4)
-	ADDBYTE_8(3)
-	ADDBYTE_8(2)
-	ADDBYTE_8(1)
-	ADDBYTE_8(0)
+#if defined(__x86_64__) && defined(__GNUC__)
+#define STRIBOG_SSE41
+#include <smmintrin.h>
+#endif
 
-#else
-	int i = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define STRIBOG_LITTLE_ENDIAN
+#endif
 
-	for(i=63;i>=0;i--)
-	{
-		t = A[i] + B[i] + (t >> 8);
-		C[i] = t & 0xFF;
-	}
+/* Byte i of a 512-bit value in memory order, i.e. state[8 * w + i] of the byte array. */
+#ifdef STRIBOG_LITTLE_ENDIAN
+#define WORD_BYTE(w, i) (((w) >> (8 * (i))) & 0xFF)
+#define BIG_ENDIAN_WORD(w) __builtin_bswap64(w)
+#else
+#define WORD_BYTE(w, i) (((w) >> (56 - 8 * (i))) & 0xFF)
+#define BIG_ENDIAN_WORD(w) (w)
 #endif
-}
 
-void AddXor512(const void *a,const void *b,void *c)
+/* Numbers are stored big-endian, byte 63 being the least significant. */
+static void AddModulo512(const uint64_t *a, const uint64_t *b, uint64_t *c)
 {
-	const unsigned long long *A=a, *B=b;
-	unsigned long long *C=c;
-#ifdef FULL_UNROLL
-	C[0] = A[0] ^ B[0];
-	C[1] = A[1] ^ B[1];
-	C[2] = A[2] ^ B[2];
-	C[3] = A[3] ^ B[3];
-	C[4] = A[4] ^ B[4];
-	C[5] = A[5] ^ B[5];
-	C[6] = A[6] ^ B[6];
-	C[7] = A[7] ^ B[7];
-#else
-	int i = 0;
+	uint64_t carry = 0;
+	int i;
 
-	for(i=0;i<8;i++)
+	for (i = 7; i >= 0; i--)
 	{
-		C[i] = A[i] ^ B[i];
+		uint64_t x = BIG_ENDIAN_WORD(a[i]);
+		uint64_t s = x + BIG_ENDIAN_WORD(b[i]);
+		uint64_t overflow = s < x;
+
+		s += carry;
+		carry = overflow | (s < carry);
+		c[i] = BIG_ENDIAN_WORD(s);
 	}
-#endif
 }
 
-void F(unsigned char *state)
+static void AddXor512(const uint64_t *a, const uint64_t *b, uint64_t *c)
 {
-	unsigned long long return_state[8];
-	register unsigned long long r = 0;
-	r ^= T[0][state[56]];
-	r ^= T[1][state[48]];
-	r ^= T[2][state[40]];
-	r ^= T[3][state[32]];
-	r ^= T[4][state[24]];
-	r ^= T[5][state[16]];
-	r ^= T[6][state[8]];
-	r ^= T[7][state[0]];	
-	return_state[0] = r;
-	r = 0;
-
-	r ^= T[0][state[57]];
-	r ^= T[1][state[49]];
-	r ^= T[2][state[41]];
-	r ^= T[3][state[33]];
-	r ^= T[4][state[25]];
-	r ^= T[5][state[17]];
-	r ^= T[6][state[9]];
-	r ^= T[7][state[1]];
-	return_state[1] = r;
-	r = 0;
-
-	r ^= T[0][state[58]];
-	r ^= T[1][state[50]];
-	r ^= T[2][state[42]];
-	r ^= T[3][state[34]];
-	r ^= T[4][state[26]];
-	r ^= T[5][state[18]];
-	r ^= T[6][state[10]];
-	r ^= T[7][state[2]];
-	return_state[2] = r;
-	r = 0;
-
-	r ^= T[0][state[59]];
-	r ^= T[1][state[51]];
-	r ^= T[2][state[43]];
-	r ^= T[3][state[35]];
-	r ^= T[4][state[27]];
-	r ^= T[5][state[19]];
-	r ^= T[6][state[11]];
-	r ^= T[7][state[3]];
-	return_state[3] = r;
-	r = 0;
-
-	r ^= T[0][state[60]];
-	r ^= T[1][state[52]];
-	r ^= T[2][state[44]];
-	r ^= T[3][state[36]];
-	r ^= T[4][state[28]];
-	r ^= T[5][state[20]];
-	r ^= T[6][state[12]];
-	r ^= T[7][state[4]];
-	return_state[4] = r;
-	r = 0;
-
-	r ^= T[0][state[61]];
-	r ^= T[1][state[53]];
-	r ^= T[2][state[45]];
-	r ^= T[3][state[37]];
-	r ^= T[4][state[29]];
-	r ^= T[5][state[21]];
-	r ^= T[6][state[13]];
-	r ^= T[7][state[5]];
-	return_state[5] = r;
-	r = 0;
-
-	r ^= T[0][state[62]];
-	r ^= T[1][state[54]];
-	r ^= T[2][state[46]];
-	r ^= T[3][state[38]];
-	r ^= T[4][state[30]];
-	r ^= T[5][state[22]];
-	r ^= T[6][state[14]];
-	r ^= T[7][state[6]];
-	return_state[6] = r;
-	r = 0;
-
-	r ^= T[0][state[63]];
-	r ^= T[1][state[55]];
-	r ^= T[2][state[47]];
-	r ^= T[3][state[39]];
-	r ^= T[4][state[31]];
-	r ^= T[5][state[23]];
-	r ^= T[6][state[15]];
-	r ^= T[7][state[7]];
-	return_state[7] = r;
-
-	memcpy(state,(unsigned char*)return_state,64);
+	int i;
+
+	for (i = 0; i < 8; i++)
+		c[i] = a[i] ^ b[i];
 }
 
-#define KeySchedule(K,i) AddXor512(K,C[i],K); F(K);
+#define LPS_WORD(in, i) \
+	(T[0][WORD_BYTE(in[7], i)] ^ T[1][WORD_BYTE(in[6], i)] ^ \
+	 T[2][WORD_BYTE(in[5], i)] ^ T[3][WORD_BYTE(in[4], i)] ^ \
+	 T[4][WORD_BYTE(in[3], i)] ^ T[5][WORD_BYTE(in[2], i)] ^ \
+	 T[6][WORD_BYTE(in[1], i)] ^ T[7][WORD_BYTE(in[0], i)])
 
-void E(unsigned char *K,const unsigned char *m, unsigned char *state)
+/* out = LPS(a ^ b). out may alias a or b. */
+static void XorLPS_Portable(const uint64_t *a, const uint64_t *b, uint64_t *out)
 {
-#ifdef FULL_UNROLL
-	AddXor512(m,K,state);
+	uint64_t in[8];
+
+	AddXor512(a, b, in);
+
+	out[0] = LPS_WORD(in, 0);
+	out[1] = LPS_WORD(in, 1);
+	out[2] = LPS_WORD(in, 2);
+	out[3] = LPS_WORD(in, 3);
+	out[4] = LPS_WORD(in, 4);
+	out[5] = LPS_WORD(in, 5);
+	out[6] = LPS_WORD(in, 6);
+	out[7] = LPS_WORD(in, 7);
+}
 
-    F(state);
-    KeySchedule(K,0);
-    AddXor512(state,K,state);
+#ifdef STRIBOG_SSE41
 
-    F(state);
-    KeySchedule(K,1);
-    AddXor512(state,K,state);
+/* The XOR is done on four 128-bit registers, and the bytes for the table
+ * lookups are taken from them in 16-bit pairs with PEXTRW: one extraction
+ * serves output words 2j and 2j + 1.
+ */
+#define LPS_EXTRACT(row, xmm0, xmm1, xmm2, xmm3, r0, r1) \
+	{ \
+		uint16_t t_; \
+		t_ = (uint16_t) _mm_extract_epi16(xmm3, row + 4); r0  = T[0][t_ & 0xFF]; r1  = T[0][t_ >> 8]; \
+		t_ = (uint16_t) _mm_extract_epi16(xmm3, row);     r0 ^= T[1][t_ & 0xFF]; r1 ^= T[1][t_ >> 8]; \
+		t_ = (uint16_t) _mm_extract_epi16(xmm2, row + 4); r0 ^= T[2][t_ & 0xFF]; r1 ^= T[2][t_ >> 8]; \
+		t_ = (uint16_t) _mm_extract_epi16(xmm2, row);     r0 ^= T[3][t_ & 0xFF]; r1 ^= T[3][t_ >> 8]; \
+		t_ = (uint16_t) _mm_extract_epi16(xmm1, row + 4); r0 ^= T[4][t_ & 0xFF]; r1 ^= T[4][t_ >> 8]; \
+		t_ = (uint16_t) _mm_extract_epi16(xmm1, row);     r0 ^= T[5][t_ & 0xFF]; r1 ^= T[5][t_ >> 8]; \
+		t_ = (uint16_t) _mm_extract_epi16(xmm0, row + 4); r0 ^= T[6][t_ & 0xFF]; r1 ^= T[6][t_ >> 8]; \
+		t_ = (uint16_t) _mm_extract_epi16(xmm0, row);     r0 ^= T[7][t_ & 0xFF]; r1 ^= T[7][t_ >> 8]; \
+	}
 
-    F(state);
-    KeySchedule(K,2);
-    AddXor512(state,K,state);
+__attribute__((target("sse4.1")))
+static void XorLPS_SSE41(const uint64_t *a, const uint64_t *b, uint64_t *out)
+{
+	__m128i xmm0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) &a[0]), _mm_loadu_si128((const __m128i *) &b[0]));
+	__m128i xmm1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) &a[2]), _mm_loadu_si128((const __m128i *) &b[2]));
+	__m128i xmm2 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) &a[4]), _mm_loadu_si128((const __m128i *) &b[4]));
+	__m128i xmm3 = _mm_xor_si128(_mm_loadu_si128((const __m128i *) &a[6]), _mm_loadu_si128((const __m128i *) &b[6]));
+	uint64_t r0, r1, r2, r3, r4, r5, r6, r7;
+
+	LPS_EXTRACT(0, xmm0, xmm1, xmm2, xmm3, r0, r1);
+	LPS_EXTRACT(1, xmm0, xmm1, xmm2, xmm3, r2, r3);
+	LPS_EXTRACT(2, xmm0, xmm1, xmm2, xmm3, r4, r5);
+	LPS_EXTRACT(3, xmm0, xmm1, xmm2, xmm3, r6, r7);
+
+	_mm_storeu_si128((__m128i *) &out[0], _mm_insert_epi64(_mm_cvtsi64_si128((long long) r0), (long long) r1, 1));
+	_mm_storeu_si128((__m128i *) &out[2], _mm_insert_epi64(_mm_cvtsi64_si128((long long) r2), (long long) r3, 1));
+	_mm_storeu_si128((__m128i *) &out[4], _mm_insert_epi64(_mm_cvtsi64_si128((long long) r4), (long long) r5, 1));
+	_mm_storeu_si128((__m128i *) &out[6], _mm_insert_epi64(_mm_cvtsi64_si128((long long) r6), (long long) r7, 1));
+}
 
-    F(state);
-    KeySchedule(K,3);
-    AddXor512(state,K,state);
+#endif
 
-    F(state);
-    KeySchedule(K,4);
-    AddXor512(state,K,state);
+typedef void (*XorLPSFunction)(const uint64_t *, const uint64_t *, uint64_t *);
 
-    F(state);
-    KeySchedule(K,5);
-    AddXor512(state,K,state);
+static XorLPSFunction SelectXorLPS(void)
+{
+#ifdef STRIBOG_SSE41
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse4.1"))
+		return XorLPS_SSE41;
+#endif
+	return XorLPS_Portable;
+}
 
-    F(state);
-    KeySchedule(K,6);
-    AddXor512(state,K,state);
+static XorLPSFunction XorLPS = XorLPS_Portable;
 
-    F(state);
-    KeySchedule(K,7);
-    AddXor512(state,K,state);
+#if defined(__GNUC__)
+__attribute__((constructor))
+static void InitialiseXorLPS(void)
+{
+	XorLPS = SelectXorLPS();
+}
+#endif
 
-    F(state);
-    KeySchedule(K,8);
-    AddXor512(state,K,state);
+static const uint64_t Zero512[8] = {0, 0, 0, 0, 0, 0, 0, 0};
 
-    F(state);
-    KeySchedule(K,9);
-    AddXor512(state,K,state);
+/* state = E(K, m), K holding the first round key, which is consumed. */
+static void E(uint64_t *K, const uint64_t *m, uint64_t *state)
+{
+	uint64_t c[8];
+	int i;
 
-    F(state);
-    KeySchedule(K,10);
-    AddXor512(state,K,state);
+	AddXor512(m, K, state);
 
-    F(state);
-    KeySchedule(K,11);
-    AddXor512(state,K,state);
-#else
-	int i = 0;
+	for (i = 0; i < 12; i++)
+	{
+		memcpy(c, C[i], 64);
+		XorLPS(state, Zero512, state);
+		XorLPS(K, c, K);
+		AddXor512(state, K, state);
+	}
+}
 
-	AddXor512(m,K,state);
+static void g_N(const uint64_t *N, uint64_t *h, const uint64_t *m)
+{
+	uint64_t t[8], K[8];
 
-    for(i=0;i<12;i++)
-    {
-        F(state);
-        KeySchedule(K,i);
-        AddXor512(state,K,state);
-    }
-#endif
+	XorLPS(N, h, K);
+
+	E(K, m, t);
+
+	AddXor512(t, h, t);
+	AddXor512(t, m, h);
 }
 
-void g_N(const unsigned char *N,unsigned char *h,const unsigned char *m)
+#if defined(__GNUC__)
+#define STRIBOG_ZERO_ROUND_KEYS
+
+/* Round keys of g_N(0, 0, m): LPS(0), and then each one from the previous and C[i].
+ * The first compression of a hash_512() of less than 512 bits has exactly these, so
+ * they are computed once instead of for every call.
+ */
+static uint64_t ZeroRoundKeys[13][8];
+
+/* Before any C++ static initialiser can hash. */
+__attribute__((constructor(101)))
+static void InitialiseZeroRoundKeys(void)
 {
-	unsigned char t[64], K[64];
+	uint64_t c[8];
+	int i;
 
-	AddXor512(N,h,K);
+	XorLPS_Portable(Zero512, Zero512, ZeroRoundKeys[0]);
+	for (i = 0; i < 12; i++)
+	{
+		memcpy(c, C[i], 64);
+		XorLPS_Portable(ZeroRoundKeys[i], c, ZeroRoundKeys[i + 1]);
+	}
+}
+
+/* g_N(0, h, m) for h == 0. */
+static void g_N_ZeroKey(uint64_t *h, const uint64_t *m)
+{
+	uint64_t state[8];
+	int i;
 
-    F(K);
+	AddXor512(m, ZeroRoundKeys[0], state);
 
-    E(K,m,t);
+	for (i = 0; i < 12; i++)
+	{
+		XorLPS(state, Zero512, state);
+		AddXor512(state, ZeroRoundKeys[i + 1], state);
+	}
 
-    AddXor512(t,h,t);
-    AddXor512(t,m,h);
+	AddXor512(state, m, h);
 }
 
-void hash_X(unsigned char *IV,const unsigned char *message,unsigned long long length,unsigned char *out)
+#endif
+
+static void hash_X(uint64_t *hash, const unsigned char *message, unsigned long long length, unsigned char *out)
 {
-	unsigned char v512[64] = {
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x02,0x00
-	};
-	unsigned char v0[64] = {
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
-	};
-	unsigned char Sigma[64] = {
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
-	};
-	unsigned char N[64] = {
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
-	};
-	unsigned char m[64], *hash = IV;
+	uint64_t v512[8] = {0, 0, 0, 0, 0, 0, 0, BIG_ENDIAN_WORD((uint64_t) 512)};
+	uint64_t N[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+	uint64_t Sigma[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+	uint64_t m[8];
 	unsigned long long len = length;
 
 	// Stage 2
@@ -338,57 +241,45 @@ void hash_X(unsigned char *IV,const unsigned char *message,unsigned long long le
 	}
 
 	memset(m,0,64);
-	memcpy(m + 63 - len/8 + ( (len & 0x7) == 0 ), message, len/8 + 1 - ( (len & 0x7) == 0 ));
+	memcpy((unsigned char *) m + 63 - len/8 + ( (len & 0x7) == 0 ), message, len/8 + 1 - ( (len & 0x7) == 0 ));
 
 	// Stage 3
-	m[ 63 - len/8 ] |= (1 << (len & 0x7));
+	((unsigned char *) m)[ 63 - len/8 ] |= (1 << (len & 0x7));
+
+#ifdef STRIBOG_ZERO_ROUND_KEYS
+	// Single block hash_512 (), as for every hash of the proof-of-work: N and the IV are zero.
+	if (length < 512 && memcmp(hash, Zero512, 64) == 0)
+		g_N_ZeroKey(hash,m);
+	else
+#endif
+		g_N(N,hash,m);
 
-	g_N(N,hash,m);
-	v512[63] = len & 0xFF;
-	v512[62] = len >> 8;
+	v512[7] = BIG_ENDIAN_WORD((uint64_t) len);
 	AddModulo512(N,v512,N);
 
 	AddModulo512(Sigma,m,Sigma);
 
-	g_N(v0,hash,N);
-	g_N(v0,hash,Sigma);
+	g_N(Zero512,hash,N);
+	g_N(Zero512,hash,Sigma);
 
 	memcpy(out, hash, 64);
 }
 
-#ifdef __cplusplus
-extern "C"{
-#endif
-
 void hash_512(const unsigned char *message,unsigned long long length,unsigned char *out)
 {
-	unsigned char IV[64] =
-	{
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-			0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
-	};
+	uint64_t IV[8] = {0, 0, 0, 0, 0, 0, 0, 0};
 
 	hash_X(IV,message,length,out);
 }
 
 void hash_256(const unsigned char *message,unsigned long long length,unsigned char *out)
 {
-	unsigned char IV[64] =
-	{
-			0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
-			0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
-			0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
-			0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01
-	};
+	uint64_t IV[8];
 	unsigned char hash[64];
 
+	memset(IV, 0x01, 64);
+
 	hash_X(IV,message,length,hash);
 
 	memcpy(out,hash,32);
 }
-
-#ifdef __cplusplus
-}
-#endif
\ No newline at end of file
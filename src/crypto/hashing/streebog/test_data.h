@@ -12,7 +12,7 @@
 #define TEST_VECTORS 2
 #define MAX_MESSAGE_LENGTH 72 // in bytes
 
-unsigned char Message[TEST_VECTORS][MAX_MESSAGE_LENGTH] = {
+static const unsigned char Message[TEST_VECTORS][MAX_MESSAGE_LENGTH] = {
 	{
 		0x32,0x31,0x30,0x39,0x38,0x37,0x36,0x35,0x34,0x33,0x32,0x31,0x30,0x39,0x38,0x37,
 		0x36,0x35,0x34,0x33,0x32,0x31,0x30,0x39,0x38,0x37,0x36,0x35,0x34,0x33,0x32,0x31,
@@ -28,7 +28,7 @@ unsigned char Message[TEST_VECTORS][MAX_MESSAGE_LENGTH] = {
 	},
 };
 
-unsigned char Hash_512[TEST_VECTORS][64] = {
+static const unsigned char Hash_512[TEST_VECTORS][64] = {
 	{
 		0x48,0x6f,0x64,0xc1,0x91,0x78,0x79,0x41,0x7f,0xef,0x08,0x2b,0x33,0x81,0xa4,0xe2,
 		0x11,0xc3,0x24,0xf0,0x74,0x65,0x4c,0x38,0x82,0x3a,0x7b,0x76,0xf8,0x30,0xad,0x00,
@@ -43,7 +43,7 @@ unsigned char Hash_512[TEST_VECTORS][64] = {
 	},
 };
 
-unsigned char Hash_256[TEST_VECTORS][32] = {
+static const unsigned char Hash_256[TEST_VECTORS][32] = {
 	{
 		0x00,0x55,0x7b,0xe5,0xe5,0x84,0xfd,0x52,0xa4,0x49,0xb1,0x6b,0x02,0x51,0xd0,0x5d,
 		0x27,0xf9,0x4a,0xb7,0x6c,0xba,0xa6,0xda,0x89,0x0b,0x59,0xd8,0xef,0x1e,0x15,0x9d
@@ -55,7 +55,7 @@ unsigned char Hash_256[TEST_VECTORS][32] = {
 };
 
 // Message length in bits
-unsigned long long MessageLength[TEST_VECTORS] = {
+static const unsigned long long MessageLength[TEST_VECTORS] = {
 		504, 576
 };
 
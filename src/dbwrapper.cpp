@@ -15,12 +15,33 @@
 #include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
+#include <atomic>
 
 class CBitcoinLevelDBLogger : public leveldb::Logger {
 public:
+    // Events counted from the messages of LevelDB, for CDBWrapper::GetStats()
+    std::atomic<uint64_t> nCompactions;
+    std::atomic<uint64_t> nTrivialMoves;
+    std::atomic<uint64_t> nMemTableFlushes;
+    std::atomic<uint64_t> nWriteStalls;
+
+    CBitcoinLevelDBLogger() : nCompactions(0), nTrivialMoves(0), nMemTableFlushes(0), nWriteStalls(0) {}
+
+    void Count(const char* format) {
+        if (strncmp(format, "Compacted ", 10) == 0)
+            nCompactions++;
+        else if (strncmp(format, "Moved #", 7) == 0)
+            nTrivialMoves++;
+        else if (strncmp(format, "Level-0 table #%llu: started", 28) == 0)
+            nMemTableFlushes++;
+        else if (strstr(format, "; waiting...") != NULL)
+            nWriteStalls++;
+    }
+
     // This code is adapted from posix_logger.h, which is why it is using vsprintf.
     // Please do not do this in normal code
     virtual void Logv(const char * format, va_list ap) override {
+            Count(format);
             if (!LogAcceptCategory("leveldb"))
                 return;
             char buffer[500];
@@ -73,14 +94,47 @@ public:
     }
 };
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+/** A block cache that counts its hits and misses */
+class CCountingCache : public leveldb::Cache {
+private:
+    leveldb::Cache* cache;
+
+public:
+    const size_t nCapacity;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+
+    CCountingCache(size_t nCapacityIn) : cache(leveldb::NewLRUCache(nCapacityIn)), nCapacity(nCapacityIn), nHits(0), nMisses(0) {}
+    ~CCountingCache() { delete cache; }
+
+    Handle* Insert(const leveldb::Slice& key, void* value, size_t charge, void (*deleter)(const leveldb::Slice& key, void* value)) override {
+        return cache->Insert(key, value, charge, deleter);
+    }
+    Handle* Lookup(const leveldb::Slice& key) override {
+        Handle* handle = cache->Lookup(key);
+        if (handle)
+            nHits++;
+        else
+            nMisses++;
+        return handle;
+    }
+    void Release(Handle* handle) override { cache->Release(handle); }
+    void* Value(Handle* handle) override { return cache->Value(handle); }
+    void Erase(const leveldb::Slice& key) override { cache->Erase(key); }
+    uint64_t NewId() override { return cache->NewId(); }
+};
+
+static leveldb::Options GetOptions(size_t nCacheSize, const CDBProfile& profile)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    options.block_cache = new CCountingCache(nCacheSize * profile.nBlockCachePercent / 100);
+    // up to two write buffers may be held in memory simultaneously
+    options.write_buffer_size = nCacheSize * (100 - profile.nBlockCachePercent) / 200;
+    options.block_size = profile.nBlockSize;
+    if (profile.nBloomBitsPerKey > 0)
+        options.filter_policy = leveldb::NewBloomFilterPolicy(profile.nBloomBitsPerKey);
     options.compression = leveldb::kNoCompression;
-    options.max_open_files = 64;
+    options.max_open_files = profile.nMaxOpenFiles;
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
@@ -90,14 +144,15 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
+CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate, const CDBProfile& profileIn)
+    : profile(profileIn)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(nCacheSize, profile);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -111,6 +166,8 @@ CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, b
         TryCreateDirectory(path);
         LogPrintf("Opening LevelDB in %s\n", path.string());
     }
+    LogPrint("leveldb", "Using LevelDB profile %s: %u bytes of block cache, %u bytes of write buffer\n", profile.name,
+             static_cast<CCountingCache*>(options.block_cache)->nCapacity, options.write_buffer_size);
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
@@ -189,6 +246,38 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
+void CDBWrapper::GetStats(CDBStats& stats) const
+{
+    stats.strProfile = profile.name;
+    stats.nWriteBufferSize = options.write_buffer_size;
+    stats.nBlockSize = options.block_size;
+    stats.nBloomBitsPerKey = profile.nBloomBitsPerKey;
+    stats.nMaxOpenFiles = options.max_open_files;
+
+    // every key starts with a type character below 0xff
+    leveldb::Range range(leveldb::Slice(""), leveldb::Slice("\xff"));
+    stats.nApproximateSize = 0;
+    pdb->GetApproximateSizes(&range, 1, &stats.nApproximateSize);
+
+    stats.vFilesAtLevel.clear();
+    std::string strValue;
+    for (int nLevel = 0; pdb->GetProperty(strprintf("leveldb.num-files-at-level%d", nLevel), &strValue); nLevel++)
+        stats.vFilesAtLevel.push_back(atoi(strValue));
+    stats.strStats.clear();
+    pdb->GetProperty("leveldb.stats", &stats.strStats);
+
+    const CBitcoinLevelDBLogger* logger = static_cast<const CBitcoinLevelDBLogger*>(options.info_log);
+    stats.nCompactions = logger->nCompactions;
+    stats.nTrivialMoves = logger->nTrivialMoves;
+    stats.nMemTableFlushes = logger->nMemTableFlushes;
+    stats.nWriteStalls = logger->nWriteStalls;
+
+    const CCountingCache* cache = static_cast<const CCountingCache*>(options.block_cache);
+    stats.nBlockCacheSize = cache->nCapacity;
+    stats.nCacheHits = cache->nHits;
+    stats.nCacheMisses = cache->nMisses;
+}
+
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
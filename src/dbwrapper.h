@@ -20,6 +20,54 @@
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
+/**
+ * How a database spends its cache and lays out its tables. The cache is split between the block
+ * cache and the write buffers, of which LevelDB may hold two at once.
+ */
+struct CDBProfile
+{
+    const char* name;
+    //! Percentage of the cache for the block cache, the rest is for the write buffers
+    int nBlockCachePercent;
+    //! Uncompressed size of the table blocks, the unit of reads and of the block cache
+    size_t nBlockSize;
+    //! Bloom filter bits per key, 0 for no filters
+    int nBloomBitsPerKey;
+    int nMaxOpenFiles;
+};
+
+//! Settings all databases used before there were profiles
+static const CDBProfile DBPROFILE_DEFAULT = {"default", 50, 4 * 1024, 10, 64};
+//! Point lookups of coins, which are rarely read twice before they are spent, and large flushes
+static const CDBProfile DBPROFILE_CHAINSTATE = {"chainstate", 50, 4 * 1024, 10, 96};
+//! The block index, and the address, spent and timestamp indexes that are read by range scans,
+//! which bypass the block cache. Larger blocks and write buffers suit them better.
+static const CDBProfile DBPROFILE_BLOCKINDEX = {"blockindex", 30, 16 * 1024, 10, 32};
+
+/** Settings and counters of a database, see CDBWrapper::GetStats() */
+struct CDBStats
+{
+    std::string strProfile;
+    size_t nBlockCacheSize;
+    size_t nWriteBufferSize;
+    size_t nBlockSize;
+    int nBloomBitsPerKey;
+    int nMaxOpenFiles;
+    //! Size of all keys on disk, as estimated by LevelDB
+    uint64_t nApproximateSize;
+    std::vector<int> vFilesAtLevel;
+    uint64_t nCompactions;
+    //! Compactions that only moved a table to the next level
+    uint64_t nTrivialMoves;
+    uint64_t nMemTableFlushes;
+    //! Writes that waited for a compaction
+    uint64_t nWriteStalls;
+    uint64_t nCacheHits;
+    uint64_t nCacheMisses;
+    //! The leveldb.stats property
+    std::string strStats;
+};
+
 class dbwrapper_error : public std::runtime_error
 {
 public:
@@ -185,6 +233,9 @@ private:
     //! database options used
     leveldb::Options options;
 
+    //! the profile the options were made from
+    CDBProfile profile;
+
     //! options used when reading from the database
     leveldb::ReadOptions readoptions;
 
@@ -219,8 +270,9 @@ public:
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
      *                        with a zero'd byte array.
+     * @param[in] profileIn   How nCacheSize is split, and how tables are laid out.
      */
-    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false, const CDBProfile& profileIn = DBPROFILE_DEFAULT);
     ~CDBWrapper();
 
     template <typename K, typename V>
@@ -308,6 +360,9 @@ public:
      */
     bool IsEmpty();
 
+    /** Settings, LevelDB properties and counters of the database */
+    void GetStats(CDBStats& stats) const;
+
     template<typename K>
     size_t EstimateSize(const K& key_begin, const K& key_end) const
     {
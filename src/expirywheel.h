@@ -0,0 +1,115 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef EXPIRYWHEEL_H
+#define EXPIRYWHEEL_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Hashed timer wheel of keys that expire at a given tick (a block height or a time in seconds).
+ *
+ * Scheduling is O(1) and Advance() only visits the slots of the ticks that passed since the
+ * previous call, so expiring entries costs in proportion to what expires instead of to
+ * everything that is tracked. Entries are only hints: a key can be scheduled several times
+ * and callers re-check their own state for every key that Advance() returns.
+ */
+template <typename K>
+class CExpiryWheel
+{
+private:
+    struct Entry
+    {
+        int64_t nTick;
+        K key;
+        Entry(int64_t nTickIn, const K& keyIn) : nTick(nTickIn), key(keyIn) {}
+    };
+
+    std::vector<std::vector<Entry> > vSlots;
+    // entries scheduled at or before nLastTick, returned by the next Advance()
+    std::vector<Entry> vDue;
+    int64_t nLastTick;
+    size_t nSize;
+
+    void TakeExpired(std::vector<Entry>& vEntries, int64_t nTick, std::vector<K>& vExpiredRet)
+    {
+        size_t nKept = 0;
+        for (size_t i = 0; i < vEntries.size(); i++) {
+            if (vEntries[i].nTick <= nTick) {
+                vExpiredRet.push_back(vEntries[i].key);
+            } else {
+                if (nKept != i)
+                    vEntries[nKept] = vEntries[i];
+                nKept++;
+            }
+        }
+        vEntries.erase(vEntries.begin() + nKept, vEntries.end());
+    }
+
+public:
+    explicit CExpiryWheel(size_t nSlots) :
+        vSlots(nSlots),
+        vDue(),
+        nLastTick(0),
+        nSize(0)
+    {
+        assert(nSlots > 0);
+    }
+
+    void Schedule(int64_t nTick, const K& key)
+    {
+        if (nTick <= nLastTick)
+            vDue.push_back(Entry(nTick, key));
+        else
+            vSlots[nTick % vSlots.size()].push_back(Entry(nTick, key));
+        nSize++;
+    }
+
+    /** Return the keys scheduled at or before nTick, nTick may go backwards (reorgs, mock time) */
+    std::vector<K> Advance(int64_t nTick)
+    {
+        std::vector<K> vExpired;
+        std::vector<Entry> vDueNow;
+        vDueNow.swap(vDue);
+
+        if (nTick > nLastTick) {
+            if (nTick - nLastTick >= (int64_t)vSlots.size()) {
+                for (size_t i = 0; i < vSlots.size(); i++)
+                    TakeExpired(vSlots[i], nTick, vExpired);
+            } else {
+                for (int64_t n = nLastTick + 1; n <= nTick; n++)
+                    TakeExpired(vSlots[n % vSlots.size()], nTick, vExpired);
+            }
+        }
+        nLastTick = nTick;
+        nSize -= vExpired.size();
+
+        // entries that were due at a later tick than the one we went back to
+        for (size_t i = 0; i < vDueNow.size(); i++) {
+            nSize--;
+            if (vDueNow[i].nTick <= nTick)
+                vExpired.push_back(vDueNow[i].key);
+            else
+                Schedule(vDueNow[i].nTick, vDueNow[i].key);
+        }
+
+        return vExpired;
+    }
+
+    size_t size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+
+    void clear()
+    {
+        for (size_t i = 0; i < vSlots.size(); i++)
+            vSlots[i].clear();
+        vDue.clear();
+        nSize = 0;
+    }
+};
+
+#endif // EXPIRYWHEEL_H
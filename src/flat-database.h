@@ -12,10 +12,64 @@
 #include "util.h"
 
 #include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+/** Leading bytes of a snapshot file. A file in the older format starts with the size of its magic message instead. */
+static const unsigned char FLATDB_SNAPSHOT_MAGIC[4] = {0xff, 'b', 'n', 's'};
+/** Snapshot format version, for readers to refuse layouts they do not know */
+static const uint32_t FLATDB_SNAPSHOT_VERSION = 1;
+
+/** A part of an object that a snapshot stores, checks and loads on its own */
+struct CFlatDBSection
+{
+    std::string strName;
+    // without a required section nothing is loaded, a corrupted or unreadable optional one is left out
+    bool fRequired;
+
+    CFlatDBSection(const std::string& strNameIn, bool fRequiredIn) : strName(strNameIn), fRequired(fRequiredIn) {}
+};
+
+/** Where a section is in the data of a snapshot file, and its checksum */
+struct CFlatDBSectionEntry
+{
+    std::string strName;
+    uint64_t nOffset;
+    uint64_t nSize;
+    uint256 hash;
+
+    CFlatDBSectionEntry() : nOffset(0), nSize(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(LIMITED_STRING(strName, 64));
+        READWRITE(nOffset);
+        READWRITE(nSize);
+        READWRITE(hash);
+    }
+};
 
 /** 
 *   Generic Dumping and Loading
 *   ---------------------------
+*
+*   Objects are written as sectioned snapshots:
+*
+*     FLATDB_SNAPSHOT_MAGIC, network magic number, FLATDB_SNAPSHOT_VERSION,
+*     magic message, section table (CFlatDBSectionEntry), checksum of all of the above,
+*     then the sections back to back at the offsets of the table.
+*
+*   T provides the sections:
+*
+*     static std::vector<CFlatDBSection> GetSnapshotSections();
+*     void WriteSnapshotSections(std::vector<CDataStream>& vSections);  // one stream per section, under its locks
+*     void ReadSnapshotSection(size_t nSection, CDataStream& s);        // called in parallel for different sections,
+*                                                                       // drops what it read of a section it throws on
+*     void ReadSnapshotDone();                                          // after all sections are read
+*
+*   Sections are read in parallel and written out after T's locks are released. Files in the
+*   older single-stream format are still read.
 */
 
 template<typename T>
@@ -37,42 +91,230 @@ private:
     std::string strFilename;
     std::string strMagicMessage;
 
-    bool Write(const T& objToSave)
+    bool Write(T& objToSave)
     {
-        // LOCK(objToSave.cs);
-
         int64_t nStart = GetTimeMillis();
 
-        // serialize, checksum data up to that point, then append checksum
-        CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-        ssObj << strMagicMessage; // specific magic message for this type of object
-        ssObj << FLATDATA(Params().MessageStart()); // network specific magic number
-        ssObj << objToSave;
-        uint256 hash = Hash(ssObj.begin(), ssObj.end());
-        ssObj << hash;
+        // the only part that holds the object's locks
+        std::vector<CFlatDBSection> vecSections = T::GetSnapshotSections();
+        std::vector<CDataStream> vecData(vecSections.size(), CDataStream(SER_DISK, CLIENT_VERSION));
+        objToSave.WriteSnapshotSections(vecData);
+        int64_t nSnapshotTime = GetTimeMillis() - nStart;
+
+        std::vector<CFlatDBSectionEntry> vecEntries(vecSections.size());
+        uint64_t nOffset = 0;
+        for (size_t i = 0; i < vecSections.size(); i++) {
+            vecEntries[i].strName = vecSections[i].strName;
+            vecEntries[i].nOffset = nOffset;
+            vecEntries[i].nSize = vecData[i].size();
+            vecEntries[i].hash = Hash(vecData[i].begin(), vecData[i].end());
+            nOffset += vecData[i].size();
+        }
 
-        // open output file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "wb");
+        CDataStream ssHeader(SER_DISK, CLIENT_VERSION);
+        ssHeader << FLATDATA(FLATDB_SNAPSHOT_MAGIC);
+        ssHeader << FLATDATA(Params().MessageStart()); // network specific magic number
+        ssHeader << FLATDB_SNAPSHOT_VERSION;
+        ssHeader << strMagicMessage; // specific magic message for this type of object
+        ssHeader << vecEntries;
+        uint256 hashHeader = Hash(ssHeader.begin(), ssHeader.end());
+        ssHeader << hashHeader;
+
+        // write next to the old file and replace it once complete
+        boost::filesystem::path pathTmp = pathDB;
+        pathTmp += ".new";
+        FILE *file = fopen(pathTmp.string().c_str(), "wb");
         CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
 
-        // Write and commit header, data
         try {
-            fileout << ssObj;
+            fileout.write(&ssHeader[0], ssHeader.size());
+            for (size_t i = 0; i < vecData.size(); i++) {
+                if (!vecData[i].empty())
+                    fileout.write(&vecData[i][0], vecData[i].size());
+            }
         }
         catch (std::exception &e) {
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
+        FileCommit(fileout.Get());
         fileout.fclose();
+        if (!RenameOver(pathTmp, pathDB))
+            return error("%s: Rename-into-place failed", __func__);
 
-        LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
+        LogPrintf("Written info to %s  %dms (snapshot %dms)\n", strFilename, GetTimeMillis() - nStart, nSnapshotTime);
         LogPrintf("     %s\n", objToSave.ToString());
 
         return true;
     }
 
     ReadResult Read(T& objToLoad, bool fDryRun = false)
+    {
+        unsigned char pchFileMagic[4] = {};
+        FILE *file = fopen(pathDB.string().c_str(), "rb");
+        if (file) {
+            if (fread(pchFileMagic, 1, sizeof(pchFileMagic), file) != sizeof(pchFileMagic))
+                memset(pchFileMagic, 0, sizeof(pchFileMagic));
+            fclose(file);
+        }
+        if (memcmp(pchFileMagic, FLATDB_SNAPSHOT_MAGIC, sizeof(pchFileMagic)))
+            return ReadLegacy(objToLoad, fDryRun);
+        return ReadSnapshot(objToLoad, fDryRun);
+    }
+
+    ReadResult ReadSnapshot(T& objToLoad, bool fDryRun)
+    {
+        int64_t nStart = GetTimeMillis();
+        FILE *file = fopen(pathDB.string().c_str(), "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+        {
+            error("%s: Failed to open file %s", __func__, pathDB.string());
+            return FileError;
+        }
+
+        unsigned char pchFileMagic[4];
+        unsigned char pchMsgTmp[4];
+        uint32_t nFormatVersion;
+        std::string strMagicMessageTmp;
+        std::vector<CFlatDBSectionEntry> vecEntries;
+        uint256 hashHeaderIn;
+        std::vector<char> vchData;
+        try {
+            filein >> FLATDATA(pchFileMagic) >> FLATDATA(pchMsgTmp) >> nFormatVersion;
+            if (nFormatVersion != FLATDB_SNAPSHOT_VERSION)
+            {
+                error("%s: Unknown snapshot version %u", __func__, nFormatVersion);
+                return IncorrectFormat;
+            }
+            filein >> strMagicMessageTmp >> vecEntries >> hashHeaderIn;
+
+            long nDataStart = ftell(filein.Get());
+            int64_t nDataSize = (int64_t)boost::filesystem::file_size(pathDB) - nDataStart;
+            if (nDataStart < 0 || nDataSize < 0)
+                throw std::ios_base::failure("invalid data size");
+            // all sections in one buffer
+            vchData.resize(nDataSize);
+            if (nDataSize > 0)
+                filein.read(&vchData[0], nDataSize);
+        }
+        catch (std::exception &e) {
+            error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            return HashReadError;
+        }
+        filein.fclose();
+
+        CHashWriter hasherHeader(SER_DISK, CLIENT_VERSION);
+        hasherHeader << FLATDATA(pchFileMagic) << FLATDATA(pchMsgTmp) << nFormatVersion << strMagicMessageTmp << vecEntries;
+        if (hashHeaderIn != hasherHeader.GetHash())
+        {
+            error("%s: Checksum mismatch, header corrupted", __func__);
+            return IncorrectHash;
+        }
+
+        if (strMagicMessage != strMagicMessageTmp)
+        {
+            error("%s: Invalid magic message", __func__);
+            return IncorrectMagicMessage;
+        }
+
+        if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+        {
+            error("%s: Invalid network magic number", __func__);
+            return IncorrectMagicNumber;
+        }
+
+        // match the stored sections to the ones T knows now, by name
+        std::vector<CFlatDBSection> vecSections = T::GetSnapshotSections();
+        std::vector<const CFlatDBSectionEntry*> vecSectionEntries(vecSections.size(), nullptr);
+        for (const CFlatDBSectionEntry& entry : vecEntries) {
+            if (entry.nOffset > vchData.size() || entry.nSize > vchData.size() - entry.nOffset)
+            {
+                error("%s: Section %s is out of the file", __func__, entry.strName);
+                return IncorrectFormat;
+            }
+            for (size_t i = 0; i < vecSections.size(); i++) {
+                if (vecSections[i].strName == entry.strName)
+                    vecSectionEntries[i] = &entry;
+            }
+        }
+        for (size_t i = 0; i < vecSections.size(); i++) {
+            if (!vecSectionEntries[i] && vecSections[i].fRequired)
+            {
+                error("%s: Missing section %s", __func__, vecSections[i].strName);
+                return IncorrectFormat;
+            }
+        }
+
+        // check and read each section on its own thread
+        std::vector<char> vfCorrupted(vecSections.size(), 0);
+        std::vector<char> vfFormatError(vecSections.size(), 0);
+        auto readSection = [&](size_t i) {
+            const CFlatDBSectionEntry& entry = *vecSectionEntries[i];
+            const char* pbegin = vchData.data() + entry.nOffset;
+            const char* pend = pbegin + entry.nSize;
+            if (Hash(pbegin, pend) != entry.hash) {
+                vfCorrupted[i] = 1;
+                return;
+            }
+            if (fDryRun)
+                return;
+            try {
+                CDataStream ss(pbegin, pend, SER_DISK, CLIENT_VERSION);
+                objToLoad.ReadSnapshotSection(i, ss);
+            }
+            catch (std::exception &e) {
+                error("%s: Deserialize error in section %s - %s", __func__, entry.strName, e.what());
+                vfFormatError[i] = 1;
+            }
+        };
+        boost::thread_group threadGroup;
+        size_t nFirst = vecSections.size();
+        for (size_t i = 0; i < vecSections.size(); i++) {
+            if (!vecSectionEntries[i])
+                continue;
+            if (nFirst == vecSections.size())
+                nFirst = i;
+            else
+                threadGroup.create_thread(boost::bind<void>(readSection, i));
+        }
+        if (nFirst < vecSections.size())
+            readSection(nFirst);
+        threadGroup.join_all();
+
+        bool fCorrupted = false;
+        bool fFormatError = false;
+        for (size_t i = 0; i < vecSections.size(); i++) {
+            if (vfCorrupted[i]) {
+                error("%s: Checksum mismatch, section %s corrupted%s", __func__, vecSections[i].strName, vecSections[i].fRequired ? "" : ", leaving it out");
+                fCorrupted |= vecSections[i].fRequired;
+            }
+            if (vfFormatError[i]) {
+                error("%s: Section %s is not readable%s", __func__, vecSections[i].strName, vecSections[i].fRequired ? "" : ", leaving it out");
+                fFormatError |= vecSections[i].fRequired;
+            }
+        }
+        if (fCorrupted || fFormatError) {
+            if (!fDryRun)
+                objToLoad.Clear();
+            return fCorrupted ? IncorrectHash : IncorrectFormat;
+        }
+        if (fDryRun)
+            return Ok;
+
+        objToLoad.ReadSnapshotDone();
+
+        LogPrintf("Loaded info from %s  %dms\n", strFilename, GetTimeMillis() - nStart);
+        LogPrintf("     %s\n", objToLoad.ToString());
+        LogPrintf("%s: Cleaning....\n", __func__);
+        objToLoad.CheckAndRemove();
+        LogPrintf("     %s\n", objToLoad.ToString());
+
+        return Ok;
+    }
+
+    ReadResult ReadLegacy(T& objToLoad, bool fDryRun)
     {
         //LOCK(objToLoad.cs);
 
@@ -14,6 +14,7 @@ using namespace std;
 
 class CGovernanceVote;
 class CConnman;
+struct CHashSignatureCheck;
 
 // INTENTION OF MASTERNODES REGARDING ITEM
 enum vote_outcome_enum_t  {
@@ -121,8 +122,13 @@ public:
 
     void SetSignature(const std::vector<unsigned char>& vchSigIn) { vchSig = vchSigIn; }
 
+    std::string GetSignatureMessage() const;
     bool Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode);
     bool IsValid(bool fSignatureCheck) const;
+    /// Recover the signer ahead of IsValid, see CMessageSigner::PrecheckMessage
+    bool PrecheckSignature() const;
+    /// Signature to verify ahead of IsValid in a batch, false if the masternode is unknown
+    bool GetSignatureCheck(CHashSignatureCheck& checkRet) const;
     void Relay(CConnman& connman) const;
 
     std::string GetVoteString() const {
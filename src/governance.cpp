@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "governance.h"
+#include "flat-database.h"
 #include "governance-object.h"
 #include "governance-vote.h"
 #include "governance-classes.h"
@@ -11,7 +12,9 @@
 #include "masternode-sync.h"
 #include "masternodeman.h"
 #include "messagesigner.h"
+#include "msgprecheck.h"
 #include "netfulfilledman.h"
+#include "relaycache.h"
 #include "util.h"
 
 CGovernanceManager governance;
@@ -539,6 +542,7 @@ void CGovernanceManager::UpdateCachesAndClean()
             }
 
             mapErasedGovernanceObjects.insert(std::make_pair(nHash, nTimeExpired));
+            relayMessageCache.Erase(CInv(MSG_GOVERNANCE_OBJECT, nHash));
             mapObjects.erase(it++);
         } else {
             ++it;
@@ -749,6 +753,10 @@ void CGovernanceManager::Sync(CNode* pfrom, const uint256& nProp, const CBloomFi
 
     LogPrint("gobject", "CGovernanceManager::Sync -- syncing to peer=%d, nProp = %s\n", pfrom->id, nProp.ToString());
 
+    // votes the peer doesn't have yet and their signature checks
+    std::vector<CGovernanceVote> vecVotes;
+    std::vector<CHashSignatureCheck> vecChecks;
+
     {
         LOCK2(cs_main, cs);
 
@@ -794,20 +802,34 @@ void CGovernanceManager::Sync(CNode* pfrom, const uint256& nProp, const CBloomFi
             pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT, it->first));
             ++nObjCount;
 
-            std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
-            for(size_t i = 0; i < vecVotes.size(); ++i) {
-                if(filter.contains(vecVotes[i].GetHash())) {
+            for(const CGovernanceVote& vote : govobj.GetVoteFile().GetVotes()) {
+                if(filter.contains(vote.GetHash())) {
                     continue;
                 }
-                if(!vecVotes[i].IsValid(true)) {
-                    continue;
+                vecVotes.push_back(vote);
+                CHashSignatureCheck check;
+                if(vote.GetSignatureCheck(check)) {
+                    vecChecks.push_back(check);
                 }
-                pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, vecVotes[i].GetHash()));
-                ++nVoteCount;
             }
         }
     }
 
+    if(!vecVotes.empty()) {
+        // verify all signatures at once on the precheck threads, without the locks the messages
+        // queued ahead of the batch may need, IsValid() below finds them verified
+        messagePrecheckQueue.VerifyBatchWait(std::move(vecChecks));
+
+        LOCK2(cs_main, cs);
+        for(size_t i = 0; i < vecVotes.size(); ++i) {
+            if(!vecVotes[i].IsValid(true)) {
+                continue;
+            }
+            pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, vecVotes[i].GetHash()));
+            ++nVoteCount;
+        }
+    }
+
     connman.PushMessage(pfrom, NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_GOVOBJ, nObjCount);
     connman.PushMessage(pfrom, NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_GOVOBJ_VOTE, nVoteCount);
     LogPrintf("CGovernanceManager::Sync -- sent %d objects and %d votes to peer=%d\n", nObjCount, nVoteCount, pfrom->id);
@@ -1305,6 +1327,75 @@ void CGovernanceManager::InitOnLoad()
     LogPrintf("     %s\n", ToString());
 }
 
+std::vector<CFlatDBSection> CGovernanceManager::GetSnapshotSections()
+{
+    return {
+        CFlatDBSection("objects", true),
+        CFlatDBSection("watchdogs", false),
+        CFlatDBSection("votes", false)
+    };
+}
+
+void CGovernanceManager::WriteSnapshotSections(std::vector<CDataStream>& vSections)
+{
+    LOCK(cs);
+    vSections[0] << SERIALIZATION_VERSION_STRING << mapObjects;
+    vSections[1] << SERIALIZATION_VERSION_STRING << mapWatchdogObjects << nHashWatchdogCurrent << nTimeWatchdogCurrent << mapLastMasternodeObject;
+    vSections[2] << SERIALIZATION_VERSION_STRING << mapErasedGovernanceObjects << mapInvalidVotes << mapOrphanVotes;
+}
+
+void CGovernanceManager::ReadSnapshotSection(size_t nSection, CDataStream& s)
+{
+    std::string strVersion;
+    s >> strVersion;
+    if(strVersion != SERIALIZATION_VERSION_STRING) {
+        throw std::ios_base::failure("unknown version " + strVersion);
+    }
+
+    // sections are read in parallel, only the swap into place takes cs
+    switch(nSection) {
+    case 0: {
+        object_m_t mapObjectsIn;
+        s >> mapObjectsIn;
+        LOCK(cs);
+        mapObjects.swap(mapObjectsIn);
+        break;
+    }
+    case 1: {
+        hash_time_m_t mapWatchdogObjectsIn;
+        uint256 nHashWatchdogCurrentIn;
+        int64_t nTimeWatchdogCurrentIn;
+        txout_m_t mapLastMasternodeObjectIn;
+        s >> mapWatchdogObjectsIn >> nHashWatchdogCurrentIn >> nTimeWatchdogCurrentIn >> mapLastMasternodeObjectIn;
+        LOCK(cs);
+        mapWatchdogObjects.swap(mapWatchdogObjectsIn);
+        nHashWatchdogCurrent = nHashWatchdogCurrentIn;
+        nTimeWatchdogCurrent = nTimeWatchdogCurrentIn;
+        mapLastMasternodeObject.swap(mapLastMasternodeObjectIn);
+        break;
+    }
+    case 2: {
+        LOCK(cs);
+        try {
+            s >> mapErasedGovernanceObjects >> mapInvalidVotes >> mapOrphanVotes;
+        }
+        catch (const std::exception&) {
+            // the caches can't be swapped in, drop what was read of them
+            mapErasedGovernanceObjects.clear();
+            mapInvalidVotes.Clear();
+            mapOrphanVotes.Clear();
+            throw;
+        }
+        break;
+    }
+    }
+}
+
+void CGovernanceManager::ReadSnapshotDone()
+{
+    // the indexes are rebuilt by InitOnLoad()
+}
+
 std::string CGovernanceManager::ToString() const
 {
     LOCK(cs);
@@ -19,6 +19,8 @@
 #include "timedata.h"
 #include "util.h"
 
+struct CFlatDBSection;
+
 class CGovernanceManager;
 class CGovernanceTriggerManager;
 class CGovernanceObject;
@@ -366,6 +368,12 @@ public:
         }
     }
 
+    /// Snapshot sections for CFlatDB
+    static std::vector<CFlatDBSection> GetSnapshotSections();
+    void WriteSnapshotSections(std::vector<CDataStream>& vSections);
+    void ReadSnapshotSection(size_t nSection, CDataStream& s);
+    void ReadSnapshotDone();
+
     void UpdatedBlockTip(const CBlockIndex *pindex, CConnman& connman);
     int64_t GetLastDiffTime() { return nTimeLastDiff; }
     void UpdateLastDiffTime(int64_t nTimeIn) { nTimeLastDiff = nTimeIn; }
@@ -392,11 +392,20 @@ class CSipHasher
 {
 private:
     uint64_t v[4];
+    uint64_t tmp;
     int count;
 
 public:
+    /** Construct a SipHash calculator initialized with 128-bit key (k0, k1) */
     CSipHasher(uint64_t k0, uint64_t k1);
+    /** Hash a 64-bit integer worth of data
+     *  It is treated as if this was the little-endian interpretation of 8 bytes.
+     *  This function can only be used when a multiple of 8 bytes have been written so far.
+     */
     CSipHasher& Write(uint64_t data);
+    /** Hash arbitrary bytes. */
+    CSipHasher& Write(const unsigned char* data, size_t size);
+    /** Compute the 64-bit SipHash-2-4 of the data written so far. The object remains untouched. */
     uint64_t Finalize() const;
 };
 
@@ -653,6 +662,47 @@ inline void IntermediateHashFunction_Whirlpool ( const void * _pData, const uint
 }*/
 
 //---Encryption.----------------------------------------------------------------------
+// Each encryption function is split into a key schedule and the encryption with it, so that callers
+// encrypting several blocks with one key schedule it once.
+
+// The proof-of-work does not expand a Kuznechik key : the 160 bytes at the key are used as the ten round
+// keys in place, and they may overlap the block being encrypted. The key schedule is therefore only a view.
+struct TKuznechikKeySchedule {
+    const void * pRoundKeys;
+};
+
+typedef libskein_threefish512_key_schedule TThreeFishKeySchedule;
+typedef CAMELLIA_KEY TCamelliaKeySchedule;
+
+inline void IntermediateEncryptionKeySchedule_GOST_2015_Kuznechik ( const void * _pKey, TKuznechikKeySchedule & _keySchedule ) {
+    _keySchedule.pRoundKeys = _pKey;
+}
+
+// Encrypts 16 bytes at _pBlock in place.
+inline void IntermediateEncryptionBlock_GOST_2015_Kuznechik ( const TKuznechikKeySchedule & _keySchedule, void * _pBlock ) {
+    encryptBlockWithGost15Vectorised ( _keySchedule.pRoundKeys, _pBlock );
+}
+
+inline void IntermediateEncryptionKeySchedule_ThreeFish ( const void * _pKey, TThreeFishKeySchedule & _keySchedule ) {
+    const char T[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+    libskein_threefish512_schedule_key ( & _keySchedule, ( const char * ) _pKey, T );
+}
+
+// Encrypts 64 bytes from _pData into _pResult.
+inline void IntermediateEncryptionBlock_ThreeFish ( const TThreeFishKeySchedule & _keySchedule, const void * _pData, void * _pResult ) {
+    libskein_threefish512_encrypt_block ( & _keySchedule, ( char * ) _pResult, ( const char * ) _pData );
+}
+
+inline void IntermediateEncryptionKeySchedule_Camellia ( const void * _pKey, TCamelliaKeySchedule & _keySchedule ) {
+    Camellia_set_key ( ( const unsigned char * ) _pKey, 256, & _keySchedule ); // userKey
+}
+
+// Encrypts 16 bytes from _pData into _pResult.
+inline void IntermediateEncryptionBlock_Camellia ( const TCamelliaKeySchedule & _keySchedule, const void * _pData, void * _pResult ) {
+    Camellia_encrypt ( ( const unsigned char * ) _pData, ( unsigned char * ) _pResult, & _keySchedule );        // in, out, key
+}
+
 inline void IntermediateEncryptionFunction_GOST_2015_Kuznechik ( const void * _pData, const uint32_t _iDataSize, const void * _pKey, void * _pResult ) {
     //char roundkeys_str [ 401 ];
 
@@ -662,23 +712,28 @@ inline void IntermediateEncryptionFunction_GOST_2015_Kuznechik ( const void * _p
     //bin2hex(roundkeys_str, (unsigned char *) _pData, 200 );
     //fprintf(stdout, "IntermediateEncryptionFunction_GOST_2015_Kuznechik () : roundkeys_str : %s.\n", roundkeys_str );
 
-    encryptBlockWithGost15 ( _pKey, ( unsigned char * ) _pResult );           // _pKey & chainActive [ chainActive.Height () - iIndex ] -> nVersion
-    encryptBlockWithGost15 ( _pData, ( unsigned char * ) _pResult + 16 );     // _pData
-    encryptBlockWithGost15 ( _pKey, ( unsigned char * ) _pResult + 32 );      // _pKey
-    encryptBlockWithGost15 ( _pData, ( unsigned char * ) _pResult + 48 );     // _pData
+    TKuznechikKeySchedule structKeySchedule;
+    TKuznechikKeySchedule structDataSchedule;
+    IntermediateEncryptionKeySchedule_GOST_2015_Kuznechik ( _pKey, structKeySchedule );      // _pKey & chainActive [ chainActive.Height () - iIndex ] -> nVersion
+    IntermediateEncryptionKeySchedule_GOST_2015_Kuznechik ( _pData, structDataSchedule );
+
+    // The order matters : the round keys at _pData overlap _pResult.
+    IntermediateEncryptionBlock_GOST_2015_Kuznechik ( structKeySchedule, ( unsigned char * ) _pResult );
+    IntermediateEncryptionBlock_GOST_2015_Kuznechik ( structDataSchedule, ( unsigned char * ) _pResult + 16 );
+    IntermediateEncryptionBlock_GOST_2015_Kuznechik ( structKeySchedule, ( unsigned char * ) _pResult + 32 );
+    IntermediateEncryptionBlock_GOST_2015_Kuznechik ( structDataSchedule, ( unsigned char * ) _pResult + 48 );
 }
 
 inline void IntermediateEncryptionFunction_ThreeFish ( const void * _pData, const uint32_t _iDataSize, const void * _pKey, void * _pResult ) {
-    char T[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-        
-    // Result, Key, Text.
-    libskein_threefish_encrypt( ( char * ) _pResult, ( const char * ) _pKey, T, ( const char * ) _pData, 64, 512);
+    TThreeFishKeySchedule structKeySchedule;
+    IntermediateEncryptionKeySchedule_ThreeFish ( _pKey, structKeySchedule );
+    IntermediateEncryptionBlock_ThreeFish ( structKeySchedule, _pData, _pResult );
 }
 
 inline void IntermediateEncryptionFunction_Camellia ( const void * _pData, const uint32_t _iDataSize, const void * _pKey, void * _pResult ) {
-    CAMELLIA_KEY stKey;
-    Camellia_set_key ( ( const unsigned char * ) _pKey, 256, & stKey ); // userKey    
-    Camellia_encrypt ( ( const unsigned char * ) _pData, ( unsigned char * ) _pResult, & stKey );        // in, out, key 
+    TCamelliaKeySchedule structKeySchedule;
+    IntermediateEncryptionKeySchedule_Camellia ( _pKey, structKeySchedule );
+    IntermediateEncryptionBlock_Camellia ( structKeySchedule, _pData, _pResult );
 }
 
 
@@ -705,6 +760,42 @@ inline void HashGenerator_Init () {
     aIntermediateEncryptionFunctions [ 2 ]         = & IntermediateEncryptionFunction_Camellia;
 }
 
+// Compile time counterparts of aIntermediateHashFunctions [ I_INDEX ] and aIntermediateEncryptionFunctions [ I_INDEX ],
+// with the same order as in HashGenerator_Init (). The switch is resolved by the compiler, so callers get a direct,
+// inlinable call.
+template < unsigned int I_INDEX >
+inline void IntermediateHashFunction ( const void * _pData, const uint32_t _iDataSize, const void * _pKey, void * _pResult ) {
+    static_assert ( I_INDEX < I_AMOUNT_OF_INTERMEDIATE_HASH_FUNCTIONS, "unknown intermediate hash function" );
+
+    switch ( I_INDEX ) {
+        case 0 :  IntermediateHashFunction_Blake ( _pData, _iDataSize, _pKey, _pResult ); break;
+        case 1 :  IntermediateHashFunction_BMW ( _pData, _iDataSize, _pKey, _pResult ); break;
+        case 2 :  IntermediateHashFunction_Groestl ( _pData, _iDataSize, _pKey, _pResult ); break;
+        case 3 :  IntermediateHashFunction_JH ( _pData, _iDataSize, _pKey, _pResult ); break;
+        case 4 :  IntermediateHashFunction_Keccak ( _pData, _iDataSize, _pKey, _pResult ); break;
+        case 5 :  IntermediateHashFunction_Skein ( _pData, _iDataSize, _pKey, _pResult ); break;
+        case 6 :  IntermediateHashFunction_Luffa ( _pData, _iDataSize, _pKey, _pResult ); break;
+        case 7 :  IntermediateHashFunction_Cubehash ( _pData, _iDataSize, _pKey, _pResult ); break;
+        case 8 :  IntermediateHashFunction_Shavite ( _pData, _iDataSize, _pKey, _pResult ); break;
+        case 9 :  IntermediateHashFunction_Simd ( _pData, _iDataSize, _pKey, _pResult ); break;
+        case 10 : IntermediateHashFunction_Echo ( _pData, _iDataSize, _pKey, _pResult ); break;
+        case 11 : IntermediateHashFunction_GOST_2012_Streebog ( _pData, _iDataSize, _pKey, _pResult ); break;
+        case 12 : IntermediateHashFunction_Whirlpool ( _pData, _iDataSize, _pKey, _pResult ); break;
+        case 13 : IntermediateHashFunction_GOST_2012_Streebog ( _pData, _iDataSize, _pKey, _pResult ); break;
+    } //-switch
+}
+
+template < unsigned int I_INDEX >
+inline void IntermediateEncryptionFunction ( const void * _pData, const uint32_t _iDataSize, const void * _pKey, void * _pResult ) {
+    static_assert ( I_INDEX < I_AMOUNT_OF_INTERMEDIATE_ENCRYPTION_FUNCTIONS, "unknown intermediate encryption function" );
+
+    switch ( I_INDEX ) {
+        case 0 : IntermediateEncryptionFunction_GOST_2015_Kuznechik ( _pData, _iDataSize, _pKey, _pResult ); break;
+        case 1 : IntermediateEncryptionFunction_ThreeFish ( _pData, _iDataSize, _pKey, _pResult ); break;
+        case 2 : IntermediateEncryptionFunction_Camellia ( _pData, _iDataSize, _pKey, _pResult ); break;
+    } //-switch
+}
+
 #endif // HASH_GENERATOR
 
 
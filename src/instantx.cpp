@@ -35,6 +35,10 @@ int nCompleteTXLocks;
 
 CInstantSend instantsend;
 
+// Slots of the expiry wheels, enough for every deadline to fall within the first turn of a wheel
+static const size_t INSTANTSEND_HEIGHT_WHEEL_SLOTS  = 64;
+static const size_t INSTANTSEND_TIME_WHEEL_SLOTS    = 1024;
+
 // Transaction Locks
 //
 // step 1) Some node announces intention to lock transaction inputs via "txlreg" message
@@ -46,6 +50,17 @@ CInstantSend instantsend;
 // CInstantSend
 //
 
+CInstantSend::CInstantSend() :
+    nCachedBlockHeight(0),
+    nMasternodeOrphanVotesTimeTotal(0),
+    wheelTxLockCandidatesExpired(INSTANTSEND_HEIGHT_WHEEL_SLOTS),
+    wheelTxLockVotesExpired(INSTANTSEND_HEIGHT_WHEEL_SLOTS),
+    wheelTxLockVotesOrphanTimedOut(INSTANTSEND_TIME_WHEEL_SLOTS),
+    wheelTxLockVotesFailed(INSTANTSEND_TIME_WHEEL_SLOTS),
+    wheelMasternodeOrphanVotes(INSTANTSEND_TIME_WHEEL_SLOTS),
+    fLocksEnabled(true)
+{}
+
 void CInstantSend::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman)
 {
     if(fLiteMode) return; // disable all Binarium specific functionality
@@ -75,8 +90,7 @@ void CInstantSend::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataSt
 #endif
         LOCK(cs_instantsend);
 
-        if(mapTxLockVotes.count(nVoteHash)) return;
-        mapTxLockVotes.insert(std::make_pair(nVoteHash, vote));
+        if(!AddTxLockVote(vote)) return;
 
         ProcessTxLockVote(pfrom, vote, connman);
 
@@ -92,7 +106,7 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CCo
 
     // Check to see if we conflict with existing completed lock
     BOOST_FOREACH(const CTxIn& txin, txLockRequest.vin) {
-        std::map<COutPoint, uint256>::iterator it = mapLockedOutpoints.find(txin.prevout);
+        std::unordered_map<COutPoint, uint256, SaltedOutpointHasher>::iterator it = mapLockedOutpoints.find(txin.prevout);
         if(it != mapLockedOutpoints.end() && it->second != txLockRequest.GetHash()) {
             // Conflicting with complete lock, proceed to see if we should cancel them both
             LogPrintf("CInstantSend::ProcessTxLockRequest -- WARNING: Found conflicting completed Transaction Lock, txid=%s, completed lock txid=%s\n",
@@ -103,7 +117,7 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CCo
     // Check to see if there are votes for conflicting request,
     // if so - do not fail, just warn user
     BOOST_FOREACH(const CTxIn& txin, txLockRequest.vin) {
-        std::map<COutPoint, std::set<uint256> >::iterator it = mapVotedOutpoints.find(txin.prevout);
+        std::unordered_map<COutPoint, std::set<uint256>, SaltedOutpointHasher>::iterator it = mapVotedOutpoints.find(txin.prevout);
         if(it != mapVotedOutpoints.end()) {
             BOOST_FOREACH(const uint256& hash, it->second) {
                 if(hash != txLockRequest.GetHash()) {
@@ -125,7 +139,7 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CCo
     // Masternodes will sometimes propagate votes before the transaction is known to the client.
     // If this just happened - lock inputs, resolve conflicting locks, update transaction status
     // forcing external script notification.
-	std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+	std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     TryToFinalizeLockCandidate(itLockCandidate->second);
 
     return true;
@@ -139,7 +153,7 @@ bool CInstantSend::CreateTxLockCandidate(const CTxLockRequest& txLockRequest)
 
     uint256 txHash = txLockRequest.GetHash();
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     if(itLockCandidate == mapTxLockCandidates.end()) {
         LogPrintf("CInstantSend::CreateTxLockCandidate -- new, txid=%s\n", txHash.ToString());
 
@@ -183,7 +197,7 @@ void CInstantSend::Vote(const uint256& txHash, CConnman& connman)
     AssertLockHeld(cs_main);
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate == mapTxLockCandidates.end()) return;
     Vote(itLockCandidate->second, connman);
     // Let's see if our vote changed smth
@@ -229,14 +243,14 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate, CConnman& connman)
 
         LogPrint("instantsend", "CInstantSend::Vote -- In the top %d (%d)\n", nSignaturesTotal, nRank);
 
-        std::map<COutPoint, std::set<uint256> >::iterator itVoted = mapVotedOutpoints.find(itOutpointLock->first);
+        std::unordered_map<COutPoint, std::set<uint256>, SaltedOutpointHasher>::iterator itVoted = mapVotedOutpoints.find(itOutpointLock->first);
 
         // Check to see if we already voted for this outpoint,
         // refuse to vote twice or to include the same outpoint in another tx
         bool fAlreadyVoted = false;
         if(itVoted != mapVotedOutpoints.end()) {
             BOOST_FOREACH(const uint256& hash, itVoted->second) {
-                std::map<uint256, CTxLockCandidate>::iterator it2 = mapTxLockCandidates.find(hash);
+                std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::iterator it2 = mapTxLockCandidates.find(hash);
                 if(it2->second.HasMasternodeVoted(itOutpointLock->first, activeMasternode.outpoint)) {
                     // we already voted for this outpoint to be included either in the same tx or in a competing one,
                     // skip it anyway
@@ -266,7 +280,7 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate, CConnman& connman)
 
         // vote constructed sucessfully, let's store and relay it
         uint256 nVoteHash = vote.GetHash();
-        mapTxLockVotes.insert(std::make_pair(nVoteHash, vote));
+        AddTxLockVote(vote);
         if(itOutpointLock->second.AddVote(vote)) {
             LogPrintf("CInstantSend::Vote -- Vote created successfully, relaying: txHash=%s, outpoint=%s, vote=%s\n",
                     txHash.ToString(), itOutpointLock->first.ToStringShort(), nVoteHash.ToString());
@@ -316,16 +330,16 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
     // Masternodes will sometimes propagate votes before the transaction is known to the client,
     // will actually process only after the lock request itself has arrived
 
-    std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+    std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::iterator it = mapTxLockCandidates.find(txHash);
     if(it == mapTxLockCandidates.end() || !it->second.txLockRequest) {
         if(!mapTxLockVotesOrphan.count(vote.GetHash())) {
             // start timeout countdown after the very first vote
             CreateEmptyTxLockCandidate(txHash);
-            mapTxLockVotesOrphan[vote.GetHash()] = vote;
+            AddTxLockVoteOrphan(vote);
             LogPrint("instantsend", "CInstantSend::ProcessTxLockVote -- Orphan vote: txid=%s  masternode=%s new\n",
                     txHash.ToString(), vote.GetMasternodeOutpoint().ToStringShort());
             bool fReprocess = true;
-            std::map<uint256, CTxLockRequest>::iterator itLockRequest = mapLockRequestAccepted.find(txHash);
+            std::unordered_map<uint256, CTxLockRequest, SaltedTxidHasher>::iterator itLockRequest = mapLockRequestAccepted.find(txHash);
             if(itLockRequest == mapLockRequestAccepted.end()) {
                 itLockRequest = mapLockRequestRejected.find(txHash);
                 if(itLockRequest == mapLockRequestRejected.end()) {
@@ -349,10 +363,9 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
         // TODO: make sure this works good enough for multi-quorum
 
         int nMasternodeOrphanExpireTime = GetTime() + 60*10; // keep time data for 10 minutes
-        if(!mapMasternodeOrphanVotes.count(vote.GetMasternodeOutpoint())) {
-            mapMasternodeOrphanVotes[vote.GetMasternodeOutpoint()] = nMasternodeOrphanExpireTime;
-        } else {
-            int64_t nPrevOrphanVote = mapMasternodeOrphanVotes[vote.GetMasternodeOutpoint()];
+        std::unordered_map<COutPoint, int64_t, SaltedOutpointHasher>::iterator itMasternodeOrphan = mapMasternodeOrphanVotes.find(vote.GetMasternodeOutpoint());
+        if(itMasternodeOrphan != mapMasternodeOrphanVotes.end()) {
+            int64_t nPrevOrphanVote = itMasternodeOrphan->second;
             if(nPrevOrphanVote > GetTime() && nPrevOrphanVote > GetAverageMasternodeOrphanVoteTime()) {
                 LogPrint("instantsend", "CInstantSend::ProcessTxLockVote -- masternode is spamming orphan Transaction Lock Votes: txid=%s  masternode=%s\n",
                         txHash.ToString(), vote.GetMasternodeOutpoint().ToStringShort());
@@ -360,8 +373,8 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
                 return false;
             }
             // not spamming, refresh
-            mapMasternodeOrphanVotes[vote.GetMasternodeOutpoint()] = nMasternodeOrphanExpireTime;
         }
+        SetMasternodeOrphanVoteTime(vote.GetMasternodeOutpoint(), nMasternodeOrphanExpireTime);
 
         return true;
     }
@@ -375,14 +388,14 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
 
     LogPrint("instantsend", "CInstantSend::ProcessTxLockVote -- Transaction Lock Vote, txid=%s\n", txHash.ToString());
 
-    std::map<COutPoint, std::set<uint256> >::iterator it1 = mapVotedOutpoints.find(vote.GetOutpoint());
+    std::unordered_map<COutPoint, std::set<uint256>, SaltedOutpointHasher>::iterator it1 = mapVotedOutpoints.find(vote.GetOutpoint());
     if(it1 != mapVotedOutpoints.end()) {
         BOOST_FOREACH(const uint256& hash, it1->second) {
             if(hash != txHash) {
                 // same outpoint was already voted to be locked by another tx lock request,
                 // let's see if it was the same masternode who voted on this outpoint
                 // for another tx lock request
-                std::map<uint256, CTxLockCandidate>::iterator it2 = mapTxLockCandidates.find(hash);
+                std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::iterator it2 = mapTxLockCandidates.find(hash);
                 if(it2 !=mapTxLockCandidates.end() && it2->second.HasMasternodeVoted(vote.GetOutpoint(), vote.GetMasternodeOutpoint())) {
                     // yes, it was the same masternode
                     LogPrintf("CInstantSend::ProcessTxLockVote -- masternode sent conflicting votes! %s\n", vote.GetMasternodeOutpoint().ToStringShort());
@@ -431,7 +444,7 @@ void CInstantSend::ProcessOrphanTxLockVotes(CConnman& connman)
 #endif
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotesOrphan.begin();
+    std::unordered_map<uint256, CTxLockVote, SaltedTxidHasher>::iterator it = mapTxLockVotesOrphan.begin();
     while(it != mapTxLockVotesOrphan.end()) {
         if(ProcessTxLockVote(NULL, it->second, connman)) {
             mapTxLockVotesOrphan.erase(it++);
@@ -459,15 +472,16 @@ bool CInstantSend::IsEnoughOrphanVotesForTxAndOutPoint(const uint256& txHash, co
     // Scan orphan votes to check if this outpoint has enough orphan votes to be locked in some tx.
     LOCK2(cs_main, cs_instantsend);
     int nCountVotes = 0;
-    std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotesOrphan.begin();
-    while(it != mapTxLockVotesOrphan.end()) {
-        if(it->second.GetTxHash() == txHash && it->second.GetOutpoint() == outpoint) {
+    std::unordered_map<uint256, std::set<uint256>, SaltedTxidHasher>::iterator itVoteHashes = mapTxLockVoteHashes.find(txHash);
+    if(itVoteHashes == mapTxLockVoteHashes.end()) return false;
+    BOOST_FOREACH(const uint256& nVoteHash, itVoteHashes->second) {
+        std::unordered_map<uint256, CTxLockVote, SaltedTxidHasher>::iterator it = mapTxLockVotesOrphan.find(nVoteHash);
+        if(it != mapTxLockVotesOrphan.end() && it->second.GetOutpoint() == outpoint) {
             nCountVotes++;
             if(nCountVotes >= COutPointLock::SIGNATURES_REQUIRED) {
                 return true;
             }
         }
-        ++it;
     }
     return false;
 }
@@ -547,7 +561,7 @@ void CInstantSend::LockTransactionInputs(const CTxLockCandidate& txLockCandidate
 bool CInstantSend::GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet)
 {
     LOCK(cs_instantsend);
-    std::map<COutPoint, uint256>::iterator it = mapLockedOutpoints.find(outpoint);
+    std::unordered_map<COutPoint, uint256, SaltedOutpointHasher>::iterator it = mapLockedOutpoints.find(outpoint);
     if(it == mapLockedOutpoints.end()) return false;
     hashRet = it->second;
     return true;
@@ -569,8 +583,8 @@ bool CInstantSend::ResolveConflicts(const CTxLockCandidate& txLockCandidate)
         if(GetLockedOutPointTxHash(txin.prevout, hashConflicting) && txHash != hashConflicting) {
             // completed lock which conflicts with another completed one?
             // this means that majority of MNs in the quorum for this specific tx input are malicious!
-            std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
-            std::map<uint256, CTxLockCandidate>::iterator itLockCandidateConflicting = mapTxLockCandidates.find(hashConflicting);
+            std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+            std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::iterator itLockCandidateConflicting = mapTxLockCandidates.find(hashConflicting);
             if(itLockCandidate == mapTxLockCandidates.end() || itLockCandidateConflicting == mapTxLockCandidates.end()) {
                 // safety check, should never really happen
                 LogPrintf("CInstantSend::ResolveConflicts -- ERROR: Found conflicting completed Transaction Lock, but one of txLockCandidate-s is missing, txid=%s, conflicting txid=%s\n",
@@ -581,8 +595,8 @@ bool CInstantSend::ResolveConflicts(const CTxLockCandidate& txLockCandidate)
                     txHash.ToString(), hashConflicting.ToString());
             CTxLockRequest txLockRequest = itLockCandidate->second.txLockRequest;
             CTxLockRequest txLockRequestConflicting = itLockCandidateConflicting->second.txLockRequest;
-            itLockCandidate->second.SetConfirmedHeight(0); // expired
-            itLockCandidateConflicting->second.SetConfirmedHeight(0); // expired
+            SetTxLockCandidateConfirmedHeight(txHash, itLockCandidate->second, 0); // expired
+            SetTxLockCandidateConfirmedHeight(hashConflicting, itLockCandidateConflicting->second, 0); // expired
             CheckAndRemove(); // clean up
             // AlreadyHave should still return "true" for both of them
             mapLockRequestRejected.insert(make_pair(txHash, txLockRequest));
@@ -634,15 +648,7 @@ int64_t CInstantSend::GetAverageMasternodeOrphanVoteTime()
     // NOTE: should never actually call this function when mapMasternodeOrphanVotes is empty
     if(mapMasternodeOrphanVotes.empty()) return 0;
 
-    std::map<COutPoint, int64_t>::iterator it = mapMasternodeOrphanVotes.begin();
-    int64_t total = 0;
-
-    while(it != mapMasternodeOrphanVotes.end()) {
-        total+= it->second;
-        ++it;
-    }
-
-    return total / mapMasternodeOrphanVotes.size();
+    return nMasternodeOrphanVotesTimeTotal / (int64_t)mapMasternodeOrphanVotes.size();
 }
 
 void CInstantSend::CheckAndRemove()
@@ -651,79 +657,170 @@ void CInstantSend::CheckAndRemove()
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.begin();
+    int64_t nTimeNow = GetTime();
+
+    // all locks end at once when they get disabled by the spork or a large-work fork
+    bool fLocksEnabledNow = AreLocksEnabled();
+    if(fLocksEnabled && !fLocksEnabledNow) {
+        std::unordered_map<uint256, std::set<uint256>, SaltedTxidHasher>::iterator itVoteHashes = mapTxLockVoteHashes.begin();
+        while(itVoteHashes != mapTxLockVoteHashes.end()) {
+            ScheduleFailedTxLockVotes(itVoteHashes->first);
+            ++itVoteHashes;
+        }
+    }
+    fLocksEnabled = fLocksEnabledNow;
 
     // remove expired candidates
-    while(itLockCandidate != mapTxLockCandidates.end()) {
+    std::vector<uint256> vExpired = wheelTxLockCandidatesExpired.Advance(nCachedBlockHeight);
+    BOOST_FOREACH(const uint256& txHash, vExpired) {
+        std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+        if(itLockCandidate == mapTxLockCandidates.end()) continue;
         CTxLockCandidate &txLockCandidate = itLockCandidate->second;
-        uint256 txHash = txLockCandidate.GetHash();
-        if(txLockCandidate.IsExpired(nCachedBlockHeight)) {
-            LogPrintf("CInstantSend::CheckAndRemove -- Removing expired Transaction Lock Candidate: txid=%s\n", txHash.ToString());
-            std::map<COutPoint, COutPointLock>::iterator itOutpointLock = txLockCandidate.mapOutPointLocks.begin();
-            while(itOutpointLock != txLockCandidate.mapOutPointLocks.end()) {
-                mapLockedOutpoints.erase(itOutpointLock->first);
-                mapVotedOutpoints.erase(itOutpointLock->first);
-                ++itOutpointLock;
+        if(!txLockCandidate.IsExpired(nCachedBlockHeight)) continue;
+        LogPrintf("CInstantSend::CheckAndRemove -- Removing expired Transaction Lock Candidate: txid=%s\n", txHash.ToString());
+        std::map<COutPoint, COutPointLock>::iterator itOutpointLock = txLockCandidate.mapOutPointLocks.begin();
+        while(itOutpointLock != txLockCandidate.mapOutPointLocks.end()) {
+            std::unordered_map<COutPoint, uint256, SaltedOutpointHasher>::iterator itLocked = mapLockedOutpoints.find(itOutpointLock->first);
+            if(itLocked != mapLockedOutpoints.end()) {
+                // the transaction which locked this outpoint is not locked anymore, its votes can fail now
+                if(itLocked->second != txHash) ScheduleFailedTxLockVotes(itLocked->second);
+                mapLockedOutpoints.erase(itLocked);
             }
-            mapLockRequestAccepted.erase(txHash);
-            mapLockRequestRejected.erase(txHash);
-            mapTxLockCandidates.erase(itLockCandidate++);
-        } else {
-            ++itLockCandidate;
+            mapVotedOutpoints.erase(itOutpointLock->first);
+            ++itOutpointLock;
         }
+        mapLockRequestAccepted.erase(txHash);
+        mapLockRequestRejected.erase(txHash);
+        mapTxLockCandidates.erase(itLockCandidate);
+        ScheduleFailedTxLockVotes(txHash);
     }
 
     // remove expired votes
-    std::map<uint256, CTxLockVote>::iterator itVote = mapTxLockVotes.begin();
-    while(itVote != mapTxLockVotes.end()) {
-        if(itVote->second.IsExpired(nCachedBlockHeight)) {
-            LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing expired vote: txid=%s  masternode=%s\n",
-                    itVote->second.GetTxHash().ToString(), itVote->second.GetMasternodeOutpoint().ToStringShort());
-            mapTxLockVotes.erase(itVote++);
-        } else {
-            ++itVote;
-        }
+    vExpired = wheelTxLockVotesExpired.Advance(nCachedBlockHeight);
+    BOOST_FOREACH(const uint256& nVoteHash, vExpired) {
+        std::unordered_map<uint256, CTxLockVote, SaltedTxidHasher>::iterator itVote = mapTxLockVotes.find(nVoteHash);
+        if(itVote == mapTxLockVotes.end() || !itVote->second.IsExpired(nCachedBlockHeight)) continue;
+        LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing expired vote: txid=%s  masternode=%s\n",
+                itVote->second.GetTxHash().ToString(), itVote->second.GetMasternodeOutpoint().ToStringShort());
+        RemoveTxLockVote(nVoteHash);
     }
 
     // remove timed out orphan votes
-    std::map<uint256, CTxLockVote>::iterator itOrphanVote = mapTxLockVotesOrphan.begin();
-    while(itOrphanVote != mapTxLockVotesOrphan.end()) {
-        if(itOrphanVote->second.IsTimedOut()) {
-            LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing timed out orphan vote: txid=%s  masternode=%s\n",
-                    itOrphanVote->second.GetTxHash().ToString(), itOrphanVote->second.GetMasternodeOutpoint().ToStringShort());
-            mapTxLockVotes.erase(itOrphanVote->first);
-            mapTxLockVotesOrphan.erase(itOrphanVote++);
-        } else {
-            ++itOrphanVote;
-        }
+    vExpired = wheelTxLockVotesOrphanTimedOut.Advance(nTimeNow);
+    BOOST_FOREACH(const uint256& nVoteHash, vExpired) {
+        std::unordered_map<uint256, CTxLockVote, SaltedTxidHasher>::iterator itOrphanVote = mapTxLockVotesOrphan.find(nVoteHash);
+        if(itOrphanVote == mapTxLockVotesOrphan.end() || !itOrphanVote->second.IsTimedOut()) continue;
+        LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing timed out orphan vote: txid=%s  masternode=%s\n",
+                itOrphanVote->second.GetTxHash().ToString(), itOrphanVote->second.GetMasternodeOutpoint().ToStringShort());
+        mapTxLockVotesOrphan.erase(itOrphanVote);
+        RemoveTxLockVote(nVoteHash);
     }
 
-    // remove invalid votes and votes for failed lock attempts
-    itVote = mapTxLockVotes.begin();
-    while(itVote != mapTxLockVotes.end()) {
-        if(itVote->second.IsFailed()) {
-            LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing vote for failed lock attempt: txid=%s  masternode=%s\n",
-                    itVote->second.GetTxHash().ToString(), itVote->second.GetMasternodeOutpoint().ToStringShort());
-            mapTxLockVotes.erase(itVote++);
-        } else {
-            ++itVote;
-        }
+    // remove invalid votes and votes for failed lock attempts,
+    // votes which are locked are scheduled again once their lock candidate is removed or locks get disabled
+    vExpired = wheelTxLockVotesFailed.Advance(nTimeNow);
+    BOOST_FOREACH(const uint256& nVoteHash, vExpired) {
+        std::unordered_map<uint256, CTxLockVote, SaltedTxidHasher>::iterator itVote = mapTxLockVotes.find(nVoteHash);
+        if(itVote == mapTxLockVotes.end()) continue;
+        if(nTimeNow - itVote->second.GetTimeCreated() <= INSTANTSEND_FAILED_TIMEOUT_SECONDS ||
+            IsLockedInstantSendTransaction(itVote->second.GetTxHash())) continue;
+        LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing vote for failed lock attempt: txid=%s  masternode=%s\n",
+                itVote->second.GetTxHash().ToString(), itVote->second.GetMasternodeOutpoint().ToStringShort());
+        RemoveTxLockVote(nVoteHash);
     }
 
     // remove timed out masternode orphan votes (DOS protection)
-    std::map<COutPoint, int64_t>::iterator itMasternodeOrphan = mapMasternodeOrphanVotes.begin();
-    while(itMasternodeOrphan != mapMasternodeOrphanVotes.end()) {
-        if(itMasternodeOrphan->second < GetTime()) {
-            LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing timed out orphan masternode vote: masternode=%s\n",
-                    itMasternodeOrphan->first.ToStringShort());
-            mapMasternodeOrphanVotes.erase(itMasternodeOrphan++);
-        } else {
-            ++itMasternodeOrphan;
-        }
+    std::vector<COutPoint> vExpiredMasternodes = wheelMasternodeOrphanVotes.Advance(nTimeNow);
+    BOOST_FOREACH(const COutPoint& outpointMasternode, vExpiredMasternodes) {
+        std::unordered_map<COutPoint, int64_t, SaltedOutpointHasher>::iterator itMasternodeOrphan = mapMasternodeOrphanVotes.find(outpointMasternode);
+        if(itMasternodeOrphan == mapMasternodeOrphanVotes.end() || itMasternodeOrphan->second >= GetTime()) continue;
+        LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing timed out orphan masternode vote: masternode=%s\n",
+                outpointMasternode.ToStringShort());
+        nMasternodeOrphanVotesTimeTotal -= itMasternodeOrphan->second;
+        mapMasternodeOrphanVotes.erase(itMasternodeOrphan);
     }
     LogPrintf("CInstantSend::CheckAndRemove -- %s\n", ToString());
 }
 
+bool CInstantSend::AddTxLockVote(const CTxLockVote& vote)
+{
+    AssertLockHeld(cs_instantsend);
+
+    uint256 nVoteHash = vote.GetHash();
+    if(!mapTxLockVotes.insert(std::make_pair(nVoteHash, vote)).second) return false;
+    mapTxLockVoteHashes[vote.GetTxHash()].insert(nVoteHash);
+    wheelTxLockVotesFailed.Schedule(vote.GetTimeCreated() + INSTANTSEND_FAILED_TIMEOUT_SECONDS + 1, nVoteHash);
+    return true;
+}
+
+void CInstantSend::AddTxLockVoteOrphan(const CTxLockVote& vote)
+{
+    AssertLockHeld(cs_instantsend);
+
+    mapTxLockVotesOrphan[vote.GetHash()] = vote;
+    wheelTxLockVotesOrphanTimedOut.Schedule(vote.GetTimeCreated() + INSTANTSEND_LOCK_TIMEOUT_SECONDS + 1, vote.GetHash());
+}
+
+void CInstantSend::RemoveTxLockVote(const uint256& nVoteHash)
+{
+    AssertLockHeld(cs_instantsend);
+
+    std::unordered_map<uint256, CTxLockVote, SaltedTxidHasher>::iterator itVote = mapTxLockVotes.find(nVoteHash);
+    if(itVote == mapTxLockVotes.end()) return;
+    uint256 txHash = itVote->second.GetTxHash();
+    std::unordered_map<uint256, std::set<uint256>, SaltedTxidHasher>::iterator itVoteHashes = mapTxLockVoteHashes.find(txHash);
+    if(itVoteHashes != mapTxLockVoteHashes.end()) {
+        itVoteHashes->second.erase(nVoteHash);
+        if(itVoteHashes->second.empty()) mapTxLockVoteHashes.erase(itVoteHashes);
+    }
+    // an orphan vote should not outlive the vote itself
+    mapTxLockVotesOrphan.erase(nVoteHash);
+    mapTxLockVotes.erase(itVote);
+}
+
+void CInstantSend::SetTxLockCandidateConfirmedHeight(const uint256& txHash, CTxLockCandidate& txLockCandidate, int nConfirmedHeight)
+{
+    txLockCandidate.SetConfirmedHeight(nConfirmedHeight);
+    if(nConfirmedHeight != -1) {
+        wheelTxLockCandidatesExpired.Schedule(nConfirmedHeight + Params().GetConsensus().nInstantSendKeepLock + 1, txHash);
+    }
+}
+
+void CInstantSend::SetTxLockVoteConfirmedHeight(const uint256& nVoteHash, CTxLockVote& vote, int nConfirmedHeight)
+{
+    vote.SetConfirmedHeight(nConfirmedHeight);
+    if(nConfirmedHeight != -1) {
+        wheelTxLockVotesExpired.Schedule(nConfirmedHeight + Params().GetConsensus().nInstantSendKeepLock + 1, nVoteHash);
+    }
+}
+
+void CInstantSend::SetMasternodeOrphanVoteTime(const COutPoint& outpointMasternode, int64_t nExpireTime)
+{
+    std::pair<std::unordered_map<COutPoint, int64_t, SaltedOutpointHasher>::iterator, bool> ret =
+            mapMasternodeOrphanVotes.insert(std::make_pair(outpointMasternode, nExpireTime));
+    if(!ret.second) {
+        nMasternodeOrphanVotesTimeTotal -= ret.first->second;
+        ret.first->second = nExpireTime;
+    }
+    nMasternodeOrphanVotesTimeTotal += nExpireTime;
+    wheelMasternodeOrphanVotes.Schedule(nExpireTime + 1, outpointMasternode);
+}
+
+void CInstantSend::ScheduleFailedTxLockVotes(const uint256& txHash)
+{
+    // Votes which were too old to fail only because their transaction was locked
+    // can fail now, the rest is still scheduled for when they are old enough.
+    std::unordered_map<uint256, std::set<uint256>, SaltedTxidHasher>::iterator itVoteHashes = mapTxLockVoteHashes.find(txHash);
+    if(itVoteHashes == mapTxLockVoteHashes.end()) return;
+    int64_t nTimeNow = GetTime();
+    BOOST_FOREACH(const uint256& nVoteHash, itVoteHashes->second) {
+        std::unordered_map<uint256, CTxLockVote, SaltedTxidHasher>::iterator itVote = mapTxLockVotes.find(nVoteHash);
+        if(itVote != mapTxLockVotes.end() && nTimeNow - itVote->second.GetTimeCreated() > INSTANTSEND_FAILED_TIMEOUT_SECONDS) {
+            wheelTxLockVotesFailed.Schedule(nTimeNow, nVoteHash);
+        }
+    }
+}
+
 bool CInstantSend::AlreadyHave(const uint256& hash)
 {
     LOCK(cs_instantsend);
@@ -754,7 +851,7 @@ bool CInstantSend::GetTxLockRequest(const uint256& txHash, CTxLockRequest& txLoc
 {
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+    std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::iterator it = mapTxLockCandidates.find(txHash);
     if(it == mapTxLockCandidates.end()) return false;
     txLockRequestRet = it->second.txLockRequest;
 
@@ -765,7 +862,7 @@ bool CInstantSend::GetTxLockVote(const uint256& hash, CTxLockVote& txLockVoteRet
 {
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotes.find(hash);
+    std::unordered_map<uint256, CTxLockVote, SaltedTxidHasher>::iterator it = mapTxLockVotes.find(hash);
     if(it == mapTxLockVotes.end()) return false;
     txLockVoteRet = it->second;
 
@@ -780,19 +877,24 @@ bool CInstantSend::IsInstantSendReadyToLock(const uint256& txHash)
     LOCK(cs_instantsend);
     // There must be a successfully verified lock request
     // and all outputs must be locked (i.e. have enough signatures)
-    std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
+    std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::iterator it = mapTxLockCandidates.find(txHash);
     return it != mapTxLockCandidates.end() && it->second.IsAllOutPointsReady();
 }
 
+bool CInstantSend::AreLocksEnabled()
+{
+    return fEnableInstantSend && !fLargeWorkForkFound && !fLargeWorkInvalidChainFound &&
+        sporkManager.IsSporkActive(SPORK_3_INSTANTSEND_BLOCK_FILTERING);
+}
+
 bool CInstantSend::IsLockedInstantSendTransaction(const uint256& txHash)
 {
-    if(!fEnableInstantSend || fLargeWorkForkFound || fLargeWorkInvalidChainFound ||
-        !sporkManager.IsSporkActive(SPORK_3_INSTANTSEND_BLOCK_FILTERING)) return false;
+    if(!AreLocksEnabled()) return false;
 
     LOCK(cs_instantsend);
 
     // there must be a lock candidate
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     if(itLockCandidate == mapTxLockCandidates.end()) return false;
 
     // which should have outpoints
@@ -817,7 +919,7 @@ int CInstantSend::GetTransactionLockSignatures(const uint256& txHash)
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     if(itLockCandidate != mapTxLockCandidates.end()) {
         return itLockCandidate->second.CountVotes();
     }
@@ -836,7 +938,7 @@ bool CInstantSend::IsTxLockCandidateTimedOut(const uint256& txHash)
 
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate != mapTxLockCandidates.end()) {
         return !itLockCandidate->second.IsAllOutPointsReady() &&
                 itLockCandidate->second.IsTimedOut();
@@ -849,7 +951,7 @@ void CInstantSend::Relay(const uint256& txHash, CConnman& connman)
 {
     LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockCandidate>::const_iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::const_iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     if (itLockCandidate != mapTxLockCandidates.end()) {
         itLockCandidate->second.Relay(connman);
     }
@@ -877,25 +979,25 @@ void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlockIndex *pi
     LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d\n", txHash.ToString(), nHeightNew);
 
     // Check lock candidates
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
+    std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
     if(itLockCandidate != mapTxLockCandidates.end()) {
         LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d lock candidate updated\n",
                 txHash.ToString(), nHeightNew);
-        itLockCandidate->second.SetConfirmedHeight(nHeightNew);
+        SetTxLockCandidateConfirmedHeight(txHash, itLockCandidate->second, nHeightNew);
         // Loop through outpoint locks
         std::map<COutPoint, COutPointLock>::iterator itOutpointLock = itLockCandidate->second.mapOutPointLocks.begin();
         while(itOutpointLock != itLockCandidate->second.mapOutPointLocks.end()) {
             // Check corresponding lock votes
             std::vector<CTxLockVote> vVotes = itOutpointLock->second.GetVotes();
             std::vector<CTxLockVote>::iterator itVote = vVotes.begin();
-            std::map<uint256, CTxLockVote>::iterator it;
+            std::unordered_map<uint256, CTxLockVote, SaltedTxidHasher>::iterator it;
             while(itVote != vVotes.end()) {
                 uint256 nVoteHash = itVote->GetHash();
                 LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d vote %s updated\n",
                         txHash.ToString(), nHeightNew, nVoteHash.ToString());
                 it = mapTxLockVotes.find(nVoteHash);
                 if(it != mapTxLockVotes.end()) {
-                    it->second.SetConfirmedHeight(nHeightNew);
+                    SetTxLockVoteConfirmedHeight(nVoteHash, it->second, nHeightNew);
                 }
                 ++itVote;
             }
@@ -904,14 +1006,14 @@ void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlockIndex *pi
     }
 
     // check orphan votes
-    std::map<uint256, CTxLockVote>::iterator itOrphanVote = mapTxLockVotesOrphan.begin();
-    while(itOrphanVote != mapTxLockVotesOrphan.end()) {
-        if(itOrphanVote->second.GetTxHash() == txHash) {
+    std::unordered_map<uint256, std::set<uint256>, SaltedTxidHasher>::iterator itVoteHashes = mapTxLockVoteHashes.find(txHash);
+    if(itVoteHashes != mapTxLockVoteHashes.end()) {
+        BOOST_FOREACH(const uint256& nVoteHash, itVoteHashes->second) {
+            if(!mapTxLockVotesOrphan.count(nVoteHash)) continue;
             LogPrint("instantsend", "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d vote %s updated\n",
-                    txHash.ToString(), nHeightNew, itOrphanVote->first.ToString());
-            mapTxLockVotes[itOrphanVote->first].SetConfirmedHeight(nHeightNew);
+                    txHash.ToString(), nHeightNew, nVoteHash.ToString());
+            SetTxLockVoteConfirmedHeight(nVoteHash, mapTxLockVotes[nVoteHash], nHeightNew);
         }
-        ++itOrphanVote;
     }
 }
 
@@ -1041,10 +1143,15 @@ uint256 CTxLockVote::GetHash() const
     return ss.GetHash();
 }
 
+std::string CTxLockVote::GetSignatureMessage() const
+{
+    return txHash.ToString() + outpoint.ToStringShort();
+}
+
 bool CTxLockVote::CheckSignature() const
 {
     std::string strError;
-    std::string strMessage = txHash.ToString() + outpoint.ToStringShort();
+    std::string strMessage = GetSignatureMessage();
 
     masternode_info_t infoMn;
 
@@ -1061,10 +1168,15 @@ bool CTxLockVote::CheckSignature() const
     return true;
 }
 
+bool CTxLockVote::PrecheckSignature() const
+{
+    return CMessageSigner::PrecheckMessage(vchMasternodeSignature, GetSignatureMessage());
+}
+
 bool CTxLockVote::Sign()
 {
     std::string strError;
-    std::string strMessage = txHash.ToString() + outpoint.ToStringShort();
+    std::string strMessage = GetSignatureMessage();
 
     if(!CMessageSigner::SignMessage(strMessage, vchMasternodeSignature, activeMasternode.keyMasternode)) {
         LogPrintf("CTxLockVote::Sign -- SignMessage() failed\n");
@@ -1096,11 +1208,6 @@ bool CTxLockVote::IsTimedOut() const
     return GetTime() - nTimeCreated > INSTANTSEND_LOCK_TIMEOUT_SECONDS;
 }
 
-bool CTxLockVote::IsFailed() const
-{
-    return (GetTime() - nTimeCreated > INSTANTSEND_FAILED_TIMEOUT_SECONDS) && !instantsend.IsLockedInstantSendTransaction(GetTxHash());
-}
-
 //
 // COutPointLock
 //
@@ -5,8 +5,12 @@
 #define INSTANTX_H
 
 #include "chain.h"
+#include "expirywheel.h"
 #include "net.h"
 #include "primitives/transaction.h"
+#include "txmempool.h"
+
+#include <unordered_map>
 
 class CTxLockVote;
 class COutPointLock;
@@ -44,22 +48,46 @@ extern int nCompleteTXLocks;
 class CInstantSend
 {
 private:
+    // fills the lock state directly, without signatures and quorums
+    friend class CInstantSendLoad;
+
     // Keep track of current block height
     int nCachedBlockHeight;
 
     // maps for AlreadyHave
-    std::map<uint256, CTxLockRequest> mapLockRequestAccepted; // tx hash - tx
-    std::map<uint256, CTxLockRequest> mapLockRequestRejected; // tx hash - tx
-    std::map<uint256, CTxLockVote> mapTxLockVotes; // vote hash - vote
-    std::map<uint256, CTxLockVote> mapTxLockVotesOrphan; // vote hash - vote
+    std::unordered_map<uint256, CTxLockRequest, SaltedTxidHasher> mapLockRequestAccepted; // tx hash - tx
+    std::unordered_map<uint256, CTxLockRequest, SaltedTxidHasher> mapLockRequestRejected; // tx hash - tx
+    std::unordered_map<uint256, CTxLockVote, SaltedTxidHasher> mapTxLockVotes; // vote hash - vote
+    std::unordered_map<uint256, CTxLockVote, SaltedTxidHasher> mapTxLockVotesOrphan; // vote hash - vote
+    std::unordered_map<uint256, std::set<uint256>, SaltedTxidHasher> mapTxLockVoteHashes; // tx hash - hashes of its votes in mapTxLockVotes
 
-    std::map<uint256, CTxLockCandidate> mapTxLockCandidates; // tx hash - lock candidate
+    std::unordered_map<uint256, CTxLockCandidate, SaltedTxidHasher> mapTxLockCandidates; // tx hash - lock candidate
 
-    std::map<COutPoint, std::set<uint256> > mapVotedOutpoints; // utxo - tx hash set
-    std::map<COutPoint, uint256> mapLockedOutpoints; // utxo - tx hash
+    std::unordered_map<COutPoint, std::set<uint256>, SaltedOutpointHasher> mapVotedOutpoints; // utxo - tx hash set
+    std::unordered_map<COutPoint, uint256, SaltedOutpointHasher> mapLockedOutpoints; // utxo - tx hash
 
     //track masternodes who voted with no txreq (for DOS protection)
-    std::map<COutPoint, int64_t> mapMasternodeOrphanVotes; // mn outpoint - time
+    std::unordered_map<COutPoint, int64_t, SaltedOutpointHasher> mapMasternodeOrphanVotes; // mn outpoint - time
+    int64_t nMasternodeOrphanVotesTimeTotal;
+
+    // when entries can expire, CheckAndRemove only looks at what is due instead of scanning the maps
+    CExpiryWheel<uint256> wheelTxLockCandidatesExpired; // height - tx hash
+    CExpiryWheel<uint256> wheelTxLockVotesExpired; // height - vote hash
+    CExpiryWheel<uint256> wheelTxLockVotesOrphanTimedOut; // time - vote hash
+    CExpiryWheel<uint256> wheelTxLockVotesFailed; // time - vote hash
+    CExpiryWheel<COutPoint> wheelMasternodeOrphanVotes; // time - mn outpoint
+
+    bool AddTxLockVote(const CTxLockVote& vote);
+    void AddTxLockVoteOrphan(const CTxLockVote& vote);
+    void RemoveTxLockVote(const uint256& nVoteHash);
+    void SetTxLockCandidateConfirmedHeight(const uint256& txHash, CTxLockCandidate& txLockCandidate, int nConfirmedHeight);
+    void SetTxLockVoteConfirmedHeight(const uint256& nVoteHash, CTxLockVote& vote, int nConfirmedHeight);
+    void SetMasternodeOrphanVoteTime(const COutPoint& outpointMasternode, int64_t nExpireTime);
+    void ScheduleFailedTxLockVotes(const uint256& txHash);
+
+    // whether locks were honored at the last CheckAndRemove
+    bool fLocksEnabled;
+    bool AreLocksEnabled();
 
     bool CreateTxLockCandidate(const CTxLockRequest& txLockRequest);
     void CreateEmptyTxLockCandidate(const uint256& txHash);
@@ -83,6 +111,8 @@ private:
 public:
     CCriticalSection cs_instantsend;
 
+    CInstantSend();
+
     void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman);
 
     bool ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CConnman& connman);
@@ -185,15 +215,18 @@ public:
     uint256 GetTxHash() const { return txHash; }
     COutPoint GetOutpoint() const { return outpoint; }
     COutPoint GetMasternodeOutpoint() const { return outpointMasternode; }
+    int64_t GetTimeCreated() const { return nTimeCreated; }
 
     bool IsValid(CNode* pnode, CConnman& connman) const;
     void SetConfirmedHeight(int nConfirmedHeightIn) { nConfirmedHeight = nConfirmedHeightIn; }
     bool IsExpired(int nHeight) const;
     bool IsTimedOut() const;
-    bool IsFailed() const;
 
+    std::string GetSignatureMessage() const;
     bool Sign();
     bool CheckSignature() const;
+    /// Recover the signer ahead of CheckSignature, see CMessageSigner::PrecheckMessage
+    bool PrecheckSignature() const;
 
     void Relay(CConnman& connman) const;
 };
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "activemasternode.h"
+#include "flat-database.h"
 #include "governance-classes.h"
 #include "masternode-payments.h"
 #include "masternode-sync.h"
@@ -415,12 +416,17 @@ void CMasternodePayments::ProcessMessage(CNode* pfrom, std::string& strCommand,
     }
 }
 
-bool CMasternodePaymentVote::Sign()
+std::string CMasternodePaymentVote::GetSignatureMessage() const
 {
-    std::string strError;
-    std::string strMessage = vinMasternode.prevout.ToStringShort() +
+    return vinMasternode.prevout.ToStringShort() +
                 boost::lexical_cast<std::string>(nBlockHeight) +
                 ScriptToAsmStr(payee);
+}
+
+bool CMasternodePaymentVote::Sign()
+{
+    std::string strError;
+    std::string strMessage = GetSignatureMessage();
 
     if(!CMessageSigner::SignMessage(strMessage, vchSig, activeMasternode.keyMasternode)) {
         LogPrintf("CMasternodePaymentVote::Sign -- SignMessage() failed\n");
@@ -466,6 +472,23 @@ bool CMasternodePayments::IsScheduled(CMasternode& mn, int nNotBlockHeight)
     return false;
 }
 
+void CMasternodePayments::GetScheduledPayees(int nNotBlockHeight, std::set<CScript>& setPayeesRet)
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    setPayeesRet.clear();
+
+    if(!masternodeSync.IsMasternodeListSynced()) return;
+
+    CScript payee;
+    for(int64_t h = nCachedBlockHeight; h <= nCachedBlockHeight + 8; h++){
+        if(h == nNotBlockHeight) continue;
+        if(mapMasternodeBlocks.count(h) && mapMasternodeBlocks[h].GetBestPayee(payee)) {
+            setPayeesRet.insert(payee);
+        }
+    }
+}
+
 bool CMasternodePayments::AddPaymentVote(const CMasternodePaymentVote& vote)
 {
     uint256 blockHash = uint256();
@@ -855,9 +878,7 @@ bool CMasternodePaymentVote::CheckSignature(const CPubKey& pubKeyMasternode, int
     // do not ban by default
     nDos = 0;
 
-    std::string strMessage = vinMasternode.prevout.ToStringShort() +
-                boost::lexical_cast<std::string>(nBlockHeight) +
-                ScriptToAsmStr(payee);
+    std::string strMessage = GetSignatureMessage();
 
     std::string strError = "";
     if (!CMessageSigner::VerifyMessage(pubKeyMasternode, vchSig, strMessage, strError)) {
@@ -873,6 +894,11 @@ bool CMasternodePaymentVote::CheckSignature(const CPubKey& pubKeyMasternode, int
     return true;
 }
 
+bool CMasternodePaymentVote::PrecheckSignature() const
+{
+    return CMessageSigner::PrecheckMessage(vchSig, GetSignatureMessage());
+}
+
 std::string CMasternodePaymentVote::ToString() const
 {
     std::ostringstream info;
@@ -991,6 +1017,46 @@ void CMasternodePayments::RequestLowDataPaymentBlocks(CNode* pnode, CConnman& co
     }
 }
 
+std::vector<CFlatDBSection> CMasternodePayments::GetSnapshotSections()
+{
+    return {
+        CFlatDBSection("votes", true),
+        CFlatDBSection("blocks", true)
+    };
+}
+
+void CMasternodePayments::WriteSnapshotSections(std::vector<CDataStream>& vSections)
+{
+    LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
+    vSections[0] << mapMasternodePaymentVotes;
+    vSections[1] << mapMasternodeBlocks;
+}
+
+void CMasternodePayments::ReadSnapshotSection(size_t nSection, CDataStream& s)
+{
+    // sections are read in parallel, only the swap into place takes the locks
+    switch(nSection) {
+    case 0: {
+        std::map<uint256, CMasternodePaymentVote> mapMasternodePaymentVotesIn;
+        s >> mapMasternodePaymentVotesIn;
+        LOCK(cs_mapMasternodePaymentVotes);
+        mapMasternodePaymentVotes.swap(mapMasternodePaymentVotesIn);
+        break;
+    }
+    case 1: {
+        std::map<int, CMasternodeBlockPayees> mapMasternodeBlocksIn;
+        s >> mapMasternodeBlocksIn;
+        LOCK(cs_mapMasternodeBlocks);
+        mapMasternodeBlocks.swap(mapMasternodeBlocksIn);
+        break;
+    }
+    }
+}
+
+void CMasternodePayments::ReadSnapshotDone()
+{
+}
+
 std::string CMasternodePayments::ToString() const
 {
     std::ostringstream info;
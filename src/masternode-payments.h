@@ -12,6 +12,8 @@
 #include "net_processing.h"
 #include "utilstrencodings.h"
 
+struct CFlatDBSection;
+
 class CMasternodePayments;
 class CMasternodePaymentVote;
 class CMasternodeBlockPayees;
@@ -147,8 +149,11 @@ public:
         return ss.GetHash();
     }
 
+    std::string GetSignatureMessage() const;
     bool Sign();
     bool CheckSignature(const CPubKey& pubKeyMasternode, int nValidationHeight, int &nDos);
+    /// Recover the signer ahead of CheckSignature, see CMessageSigner::PrecheckMessage
+    bool PrecheckSignature() const;
 
     bool IsValid(CNode* pnode, int nValidationHeight, std::string& strError, CConnman& connman);
     void Relay(CConnman& connman);
@@ -191,6 +196,12 @@ public:
         READWRITE(mapMasternodeBlocks);
     }
 
+    /// Snapshot sections for CFlatDB
+    static std::vector<CFlatDBSection> GetSnapshotSections();
+    void WriteSnapshotSections(std::vector<CDataStream>& vSections);
+    void ReadSnapshotSection(size_t nSection, CDataStream& s);
+    void ReadSnapshotDone();
+
     void Clear();
 
     bool AddPaymentVote(const CMasternodePaymentVote& vote);
@@ -205,6 +216,8 @@ public:
     bool GetBlockPayee(int nBlockHeight, CScript& payee);
     bool IsTransactionValid(const CTransaction& txNew, int nBlockHeight);
     bool IsScheduled(CMasternode& mn, int nNotBlockHeight);
+    /// Best payees of the blocks IsScheduled looks at, to check many masternodes at once
+    void GetScheduledPayees(int nNotBlockHeight, std::set<CScript>& setPayeesRet);
 
     bool CanVote(COutPoint outMasternode, int nBlockHeight);
 
@@ -0,0 +1,77 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternode-scorecache.h"
+
+#include "masternode.h"
+
+#include <algorithm>
+
+struct CompareScoreMN
+{
+    bool operator()(const std::pair<arith_uint256, CMasternode*>& t1,
+                    const std::pair<arith_uint256, CMasternode*>& t2) const
+    {
+        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->vin < t2.second->vin);
+    }
+};
+
+CMasternodeScoreCache::CMasternodeScoreCache(size_t nMaxEntriesIn)
+: nMaxEntries(std::max<size_t>(nMaxEntriesIn, 1)),
+  listEntries(),
+  mapEntries(),
+  vecPrefixes(),
+  fPrefixesValid(false),
+  nHits(0),
+  nMisses(0)
+{}
+
+CMasternodeScoreCache::score_pair_vec_ptr CMasternodeScoreCache::Get(const uint256& blockHash, std::map<COutPoint, CMasternode>& mapMasternodes)
+{
+    auto it = mapEntries.find(blockHash);
+    if (it != mapEntries.end()) {
+        nHits++;
+        listEntries.splice(listEntries.begin(), listEntries, it->second);
+        return it->second->second;
+    }
+    nMisses++;
+
+    if (!fPrefixesValid) {
+        vecPrefixes.clear();
+        vecPrefixes.reserve(mapMasternodes.size());
+        for (auto& mnpair : mapMasternodes) {
+            CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+            ss << mnpair.second.vin.prevout << mnpair.second.nCollateralMinConfBlockHash;
+            vecPrefixes.push_back(std::make_pair(&mnpair.second, ss));
+        }
+        fPrefixesValid = true;
+    }
+
+    // same result as CMasternode::CalculateScore(blockHash) for every masternode
+    std::shared_ptr<score_pair_vec_t> pvecScores = std::make_shared<score_pair_vec_t>();
+    pvecScores->reserve(vecPrefixes.size());
+    for (const auto& prefix : vecPrefixes) {
+        CHashWriter ss(prefix.second);
+        ss << blockHash;
+        pvecScores->push_back(std::make_pair(UintToArith256(ss.GetHash()), prefix.first));
+    }
+    sort(pvecScores->rbegin(), pvecScores->rend(), CompareScoreMN());
+
+    if (listEntries.size() >= nMaxEntries) {
+        mapEntries.erase(listEntries.back().first);
+        listEntries.pop_back();
+    }
+    listEntries.push_front(std::make_pair(blockHash, pvecScores));
+    mapEntries[blockHash] = listEntries.begin();
+
+    return pvecScores;
+}
+
+void CMasternodeScoreCache::Clear()
+{
+    listEntries.clear();
+    mapEntries.clear();
+    vecPrefixes.clear();
+    fPrefixesValid = false;
+}
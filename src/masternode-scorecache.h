@@ -0,0 +1,70 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MASTERNODE_SCORECACHE_H
+#define MASTERNODE_SCORECACHE_H
+
+#include "arith_uint256.h"
+#include "hash.h"
+#include "uint256.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+class CMasternode;
+class COutPoint;
+
+/**
+ * Scores of all masternodes for the recently asked block hashes, sorted from the best to the worst.
+ *
+ * A score only depends on the block hash and on the collateral outpoint and the hash of its
+ * confirmation block, which never change for an entry of the masternode map. So a score vector
+ * stays valid until masternodes are added or removed, and the cache is cleared only then.
+ * The vectors hold pointers into the masternode map, the filter by protocol version is left
+ * to the caller, because the protocol version of a masternode may change.
+ *
+ * Not thread safe, guarded by CMasternodeMan::cs.
+ */
+class CMasternodeScoreCache
+{
+public:
+    typedef std::pair<arith_uint256, CMasternode*> score_pair_t;
+    typedef std::vector<score_pair_t> score_pair_vec_t;
+    typedef std::shared_ptr<const score_pair_vec_t> score_pair_vec_ptr;
+
+    static const size_t DEFAULT_MAX_ENTRIES = 64;
+
+private:
+    typedef std::pair<uint256, score_pair_vec_ptr> entry_t;
+
+    size_t nMaxEntries;
+    // most recently used first
+    std::list<entry_t> listEntries;
+    std::map<uint256, std::list<entry_t>::iterator> mapEntries;
+
+    // CalculateScore() hashes outpoint, nCollateralMinConfBlockHash and the block hash, the state
+    // after the first two is kept for every masternode and shared by all block hashes
+    std::vector<std::pair<CMasternode*, CHashWriter> > vecPrefixes;
+    bool fPrefixesValid;
+
+    uint64_t nHits;
+    uint64_t nMisses;
+
+public:
+    CMasternodeScoreCache(size_t nMaxEntriesIn = DEFAULT_MAX_ENTRIES);
+
+    /// Sorted scores of all masternodes in mapMasternodes for blockHash, computed on a miss
+    score_pair_vec_ptr Get(const uint256& blockHash, std::map<COutPoint, CMasternode>& mapMasternodes);
+
+    /// Forget everything, must be called whenever masternodes are added to or removed from the map
+    void Clear();
+
+    size_t size() const { return listEntries.size(); }
+    uint64_t GetHits() const { return nHits; }
+    uint64_t GetMisses() const { return nMisses; }
+};
+
+#endif // MASTERNODE_SCORECACHE_H
@@ -72,8 +72,11 @@ public:
 
     bool IsExpired() const { return GetAdjustedTime() - sigTime > MASTERNODE_NEW_START_REQUIRED_SECONDS; }
 
+    std::string GetSignatureMessage() const;
     bool Sign(const CKey& keyMasternode, const CPubKey& pubKeyMasternode);
     bool CheckSignature(CPubKey& pubKeyMasternode, int &nDos);
+    /// Recover the signer ahead of CheckSignature, see CMessageSigner::PrecheckMessage
+    bool PrecheckSignature() const;
     bool SimpleCheck(int& nDos);
     bool CheckAndUpdate(CMasternode* pmn, bool fFromNewBroadcast, int& nDos, CConnman& connman);
     void Relay(CConnman& connman);
@@ -352,8 +355,11 @@ public:
     bool Update(CMasternode* pmn, int& nDos, CConnman& connman);
     bool CheckOutpoint(int& nDos);
 
+    std::string GetSignatureMessage() const;
     bool Sign(const CKey& keyCollateralAddress);
     bool CheckSignature(int& nDos);
+    /// Recover the signers of the broadcast and its ping ahead of CheckSignature
+    bool PrecheckSignature() const;
     void Relay(CConnman& connman);
 };
 
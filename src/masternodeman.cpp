@@ -4,12 +4,14 @@
 
 #include "activemasternode.h"
 #include "addrman.h"
+#include "flat-database.h"
 #include "governance.h"
 #include "masternode-payments.h"
 #include "masternode-sync.h"
 #include "masternodeman.h"
 #include "messagesigner.h"
 #include "netfulfilledman.h"
+#include "relaycache.h"
 #ifdef ENABLE_WALLET
 #include "privatesend-client.h"
 #endif // ENABLE_WALLET
@@ -21,24 +23,6 @@ CMasternodeMan mnodeman;
 
 const std::string CMasternodeMan::SERIALIZATION_VERSION_STRING = "CMasternodeMan-Version-7";
 
-struct CompareLastPaidBlock
-{
-    bool operator()(const std::pair<int, CMasternode*>& t1,
-                    const std::pair<int, CMasternode*>& t2) const
-    {
-        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->vin < t2.second->vin);
-    }
-};
-
-struct CompareScoreMN
-{
-    bool operator()(const std::pair<arith_uint256, CMasternode*>& t1,
-                    const std::pair<arith_uint256, CMasternode*>& t2) const
-    {
-        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->vin < t2.second->vin);
-    }
-};
-
 struct CompareByAddr
 
 {
@@ -52,6 +36,9 @@ struct CompareByAddr
 CMasternodeMan::CMasternodeMan()
 : cs(),
   mapMasternodes(),
+  scoreCache(),
+  mapPaymentQueue(),
+  pindexPaymentQueue(NULL),
   mAskedUsForMasternodeList(),
   mWeAskedForMasternodeList(),
   mWeAskedForMasternodeListEntry(),
@@ -76,6 +63,8 @@ bool CMasternodeMan::Add(CMasternode &mn)
 
     LogPrint("masternode", "CMasternodeMan::Add -- Adding new Masternode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
     mapMasternodes[mn.vin.prevout] = mn;
+    scoreCache.Clear();
+    AddToPaymentQueue(mapMasternodes[mn.vin.prevout]);
     fMasternodesAdded = true;
     return true;
 }
@@ -185,11 +174,14 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
 
                 // erase all of the broadcasts we've seen from this txin, ...
                 mapSeenMasternodeBroadcast.erase(hash);
+                relayMessageCache.Erase(CInv(MSG_MASTERNODE_ANNOUNCE, hash));
                 mWeAskedForMasternodeListEntry.erase(it->first);
 
                 // and finally remove it from the list
                 it->second.FlagGovernanceItemsAsDirty();
+                RemoveFromPaymentQueue(it->second);
                 mapMasternodes.erase(it++);
+                scoreCache.Clear();
                 fMasternodesRemoved = true;
             } else {
                 bool fAsk = (nAskForMnbRecovery > 0) &&
@@ -316,6 +308,7 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
         while(it4 != mapSeenMasternodePing.end()){
             if((*it4).second.IsExpired()) {
                 LogPrint("masternode", "CMasternodeMan::CheckAndRemove -- Removing expired Masternode ping: hash=%s\n", (*it4).second.GetHash().ToString());
+                relayMessageCache.Erase(CInv(MSG_MASTERNODE_PING, it4->first));
                 mapSeenMasternodePing.erase(it4++);
             } else {
                 ++it4;
@@ -345,11 +338,15 @@ void CMasternodeMan::Clear()
 {
     LOCK(cs);
     mapMasternodes.clear();
+    scoreCache.Clear();
+    mapPaymentQueue.clear();
+    pindexPaymentQueue = NULL;
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
     mapSeenMasternodeBroadcast.clear();
     mapSeenMasternodePing.clear();
+    relayMessageCache.Clear();
     nDsqCount = 0;
     nLastWatchdogVoteTime = 0;
 }
@@ -482,6 +479,54 @@ bool CMasternodeMan::Has(const COutPoint& outpoint)
     return mapMasternodes.find(outpoint) != mapMasternodes.end();
 }
 
+void CMasternodeMan::AddToPaymentQueue(CMasternode& mn)
+{
+    payment_queue_item_t item;
+    item.pmn = &mn;
+    item.payee = GetScriptForDestination(mn.pubKeyCollateralAddress.GetID());
+    item.nCollateralHeight = -1;
+    mapPaymentQueue[std::make_pair(mn.GetLastPaidBlock(), mn.vin.prevout)] = item;
+}
+
+void CMasternodeMan::RemoveFromPaymentQueue(CMasternode& mn)
+{
+    mapPaymentQueue.erase(std::make_pair(mn.GetLastPaidBlock(), mn.vin.prevout));
+}
+
+void CMasternodeMan::RebuildPaymentQueue()
+{
+    mapPaymentQueue.clear();
+    for (auto& mnpair : mapMasternodes) {
+        AddToPaymentQueue(mnpair.second);
+    }
+}
+
+bool CMasternodeMan::ForgetSpentCollateralHeights(const CBlockIndex* pindexTip)
+{
+    if (!pindexTip || !pindexPaymentQueue || pindexTip->nHeight - pindexPaymentQueue->nHeight > MAX_PAYMENT_QUEUE_BLOCKS_SCANNED)
+        return false;
+    if (pindexTip->GetAncestor(pindexPaymentQueue->nHeight) != pindexPaymentQueue)
+        return false;
+
+    for (const CBlockIndex* pindex = pindexTip; pindex != pindexPaymentQueue; pindex = pindex->pprev) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
+            return false;
+        BOOST_FOREACH(const CTransaction& tx, block.vtx) {
+            if (tx.IsCoinBase()) continue;
+            BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+                std::map<COutPoint, CMasternode>::iterator it = mapMasternodes.find(txin.prevout);
+                if (it == mapMasternodes.end()) continue;
+                payment_queue_t::iterator itQueue = mapPaymentQueue.find(std::make_pair(it->second.GetLastPaidBlock(), txin.prevout));
+                if (itQueue != mapPaymentQueue.end()) {
+                    itQueue->second.nCollateralHeight = -1;
+                }
+            }
+        }
+    }
+    return true;
+}
+
 //
 // Deterministically select the oldest/best masternode to pay on the network
 //
@@ -503,65 +548,91 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
     // Need LOCK2 here to ensure consistent locking order because the GetBlockHash call below locks cs_main
     LOCK2(cs_main,cs);
 
-    std::vector<std::pair<int, CMasternode*> > vecMasternodeLastPaid;
+    // collateral heights stay valid as long as the chain is only extended by blocks which don't spend them
+    const CBlockIndex* pindexTip = chainActive.Tip();
+    if (pindexPaymentQueue != pindexTip) {
+        if (!ForgetSpentCollateralHeights(pindexTip)) {
+            for (auto& item : mapPaymentQueue) {
+                item.second.nCollateralHeight = -1;
+            }
+        }
+        pindexPaymentQueue = pindexTip;
+    }
+    int nTipHeight = pindexTip ? pindexTip->nHeight : -1;
 
-    /*
-        Make a vector with all of the last paid times
-    */
+    // payees in the list (up to 8 entries ahead of current block to allow propagation) are skipped
+    std::set<CScript> setScheduledPayees;
+    mnpayments.GetScheduledPayees(nBlockHeight, setScheduledPayees);
 
     int nMnCount = CountMasternodes();
+    int nMinPaymentsProto = mnpayments.GetMinMasternodePaymentsProto();
+    int64_t nAdjustedTime = GetAdjustedTime();
 
-    for (auto& mnpair : mapMasternodes) {
-        if(!mnpair.second.IsValidForPayment()) continue;
+    /*
+        The queue is already sorted by last paid block, low to high. Count the masternodes, which
+        qualify for payment, with and without the sigTime filter, and remember the first tenth of
+        the network of both. Look at 1/10 of the oldest nodes (by last payment) and pay the one
+        with the best score
+        -- This doesn't look at who is being paid in the +8-10 blocks, allowing for double payments very rarely
+        -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
+        -- (chance per block * chances before IsScheduled will fire)
+    */
+    int nTenthNetwork = std::max(nMnCount/10, 1);
+    int nCount = 0, nCountFiltered = 0;
+    std::set<const CMasternode*> setTenthNetwork, setTenthNetworkFiltered;
+
+    for (auto& item : mapPaymentQueue) {
+        CMasternode* pmn = item.second.pmn;
+        if(!pmn->IsValidForPayment()) continue;
 
         //check protocol version
-        if(mnpair.second.nProtocolVersion < mnpayments.GetMinMasternodePaymentsProto()) continue;
+        if(pmn->nProtocolVersion < nMinPaymentsProto) continue;
 
         //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
-        if(mnpayments.IsScheduled(mnpair.second, nBlockHeight)) continue;
+        if(setScheduledPayees.count(item.second.payee)) continue;
 
-        //it's too new, wait for a cycle
-        if(fFilterSigTime && mnpair.second.sigTime + (nMnCount*2.6*60) > GetAdjustedTime()) continue;
+        //make sure it has at least as many confirmations as there are masternodes,
+        //the ones which may be paid are looked up again in case their collateral was spent
+        bool fCandidate = (int)setTenthNetwork.size() < nTenthNetwork || (fFilterSigTime && (int)setTenthNetworkFiltered.size() < nTenthNetwork);
+        if(item.second.nCollateralHeight < 0 || fCandidate) {
+            item.second.nCollateralHeight = GetUTXOHeight(pmn->vin.prevout);
+        }
+        int nConfirmations = (item.second.nCollateralHeight > -1 && pindexTip) ? nTipHeight - item.second.nCollateralHeight + 1 : -1;
+        if(nConfirmations < nMnCount) continue;
 
-        //make sure it has at least as many confirmations as there are masternodes
-        if(GetUTXOConfirmations(mnpair.first) < nMnCount) continue;
+        nCount++;
+        if((int)setTenthNetwork.size() < nTenthNetwork) setTenthNetwork.insert(pmn);
 
-        vecMasternodeLastPaid.push_back(std::make_pair(mnpair.second.GetLastPaidBlock(), &mnpair.second));
+        //it's too new, wait for a cycle
+        if(fFilterSigTime && pmn->sigTime + (nMnCount*2.6*60) > nAdjustedTime) continue;
+
+        nCountFiltered++;
+        if((int)setTenthNetworkFiltered.size() < nTenthNetwork) setTenthNetworkFiltered.insert(pmn);
     }
 
-    nCountRet = (int)vecMasternodeLastPaid.size();
+    nCountRet = fFilterSigTime ? nCountFiltered : nCount;
 
     //when the network is in the process of upgrading, don't penalize nodes that recently restarted
-    if(fFilterSigTime && nCountRet < nMnCount/3)
-        return GetNextMasternodeInQueueForPayment(nBlockHeight, false, nCountRet, mnInfoRet);
-
-    // Sort them low to high
-    sort(vecMasternodeLastPaid.begin(), vecMasternodeLastPaid.end(), CompareLastPaidBlock());
+    if(fFilterSigTime && nCountRet < nMnCount/3) {
+        nCountRet = nCount;
+    } else if(fFilterSigTime) {
+        setTenthNetwork.swap(setTenthNetworkFiltered);
+    }
 
     uint256 blockHash;
     if(!GetBlockHash(blockHash, nBlockHeight - 101)) {
         LogPrintf("CMasternode::GetNextMasternodeInQueueForPayment -- ERROR: GetBlockHash() failed at nBlockHeight %d\n", nBlockHeight - 101);
         return false;
     }
-    // Look at 1/10 of the oldest nodes (by last payment), calculate their scores and pay the best one
-    //  -- This doesn't look at who is being paid in the +8-10 blocks, allowing for double payments very rarely
-    //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
-    //  -- (chance per block * chances before IsScheduled will fire)
-    int nTenthNetwork = nMnCount/10;
-    int nCountTenth = 0;
-    arith_uint256 nHighest = 0;
-    CMasternode *pBestMasternode = NULL;
-    BOOST_FOREACH (PAIRTYPE(int, CMasternode*)& s, vecMasternodeLastPaid){
-        arith_uint256 nScore = s.second->CalculateScore(blockHash);
-        if(nScore > nHighest){
-            nHighest = nScore;
-            pBestMasternode = s.second;
+
+    // the cached scores are sorted from the highest, so the first one of the tenth is the best
+    CMasternodeScoreCache::score_pair_vec_ptr pvecScores = scoreCache.Get(blockHash, mapMasternodes);
+    for (const auto& scorePair : *pvecScores) {
+        if (!setTenthNetwork.count(scorePair.second)) continue;
+        if (scorePair.first > 0) {
+            mnInfoRet = scorePair.second->GetInfo();
         }
-        nCountTenth++;
-        if(nCountTenth >= nTenthNetwork) break;
-    }
-    if (pBestMasternode) {
-        mnInfoRet = pBestMasternode->GetInfo();
+        break;
     }
     return mnInfoRet.fInfoValid;
 }
@@ -621,14 +692,15 @@ bool CMasternodeMan::GetMasternodeScores(const uint256& nBlockHash, CMasternodeM
     if (mapMasternodes.empty())
         return false;
 
-    // calculate scores
-    for (auto& mnpair : mapMasternodes) {
-        if (mnpair.second.nProtocolVersion >= nMinProtocol) {
-            vecMasternodeScoresRet.push_back(std::make_pair(mnpair.second.CalculateScore(nBlockHash), &mnpair.second));
+    // scores of all masternodes are calculated once per block hash, filter them by protocol
+    CMasternodeScoreCache::score_pair_vec_ptr pvecScores = scoreCache.Get(nBlockHash, mapMasternodes);
+    vecMasternodeScoresRet.reserve(pvecScores->size());
+    for (const auto& scorePair : *pvecScores) {
+        if (scorePair.second->nProtocolVersion >= nMinProtocol) {
+            vecMasternodeScoresRet.push_back(scorePair);
         }
     }
 
-    sort(vecMasternodeScoresRet.rbegin(), vecMasternodeScoresRet.rend(), CompareScoreMN());
     return !vecMasternodeScoresRet.empty();
 }
 
@@ -1313,6 +1385,81 @@ void CMasternodeMan::ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerif
     }
 }
 
+std::vector<CFlatDBSection> CMasternodeMan::GetSnapshotSections()
+{
+    return {
+        CFlatDBSection("masternodes", true),
+        CFlatDBSection("requests", false),
+        CFlatDBSection("seen", false)
+    };
+}
+
+void CMasternodeMan::WriteSnapshotSections(std::vector<CDataStream>& vSections)
+{
+    LOCK(cs);
+    vSections[0] << SERIALIZATION_VERSION_STRING << mapMasternodes;
+    vSections[1] << SERIALIZATION_VERSION_STRING << mAskedUsForMasternodeList << mWeAskedForMasternodeList << mWeAskedForMasternodeListEntry
+                 << mMnbRecoveryRequests << mMnbRecoveryGoodReplies << nLastWatchdogVoteTime << nDsqCount;
+    vSections[2] << SERIALIZATION_VERSION_STRING << mapSeenMasternodeBroadcast << mapSeenMasternodePing;
+}
+
+void CMasternodeMan::ReadSnapshotSection(size_t nSection, CDataStream& s)
+{
+    std::string strVersion;
+    s >> strVersion;
+    if(strVersion != SERIALIZATION_VERSION_STRING) {
+        throw std::ios_base::failure("unknown version " + strVersion);
+    }
+
+    // sections are read in parallel, only the swap into place takes cs
+    switch(nSection) {
+    case 0: {
+        std::map<COutPoint, CMasternode> mapMasternodesIn;
+        s >> mapMasternodesIn;
+        LOCK(cs);
+        // both point into the old map, ReadSnapshotDone() rebuilds the queue
+        mapPaymentQueue.clear();
+        scoreCache.Clear();
+        mapMasternodes.swap(mapMasternodesIn);
+        break;
+    }
+    case 1: {
+        std::map<CNetAddr, int64_t> mAskedUsForMasternodeListIn, mWeAskedForMasternodeListIn;
+        std::map<COutPoint, std::map<CNetAddr, int64_t> > mWeAskedForMasternodeListEntryIn;
+        std::map<uint256, std::pair< int64_t, std::set<CNetAddr> > > mMnbRecoveryRequestsIn;
+        std::map<uint256, std::vector<CMasternodeBroadcast> > mMnbRecoveryGoodRepliesIn;
+        int64_t nLastWatchdogVoteTimeIn, nDsqCountIn;
+        s >> mAskedUsForMasternodeListIn >> mWeAskedForMasternodeListIn >> mWeAskedForMasternodeListEntryIn
+          >> mMnbRecoveryRequestsIn >> mMnbRecoveryGoodRepliesIn >> nLastWatchdogVoteTimeIn >> nDsqCountIn;
+        LOCK(cs);
+        mAskedUsForMasternodeList.swap(mAskedUsForMasternodeListIn);
+        mWeAskedForMasternodeList.swap(mWeAskedForMasternodeListIn);
+        mWeAskedForMasternodeListEntry.swap(mWeAskedForMasternodeListEntryIn);
+        mMnbRecoveryRequests.swap(mMnbRecoveryRequestsIn);
+        mMnbRecoveryGoodReplies.swap(mMnbRecoveryGoodRepliesIn);
+        nLastWatchdogVoteTime = nLastWatchdogVoteTimeIn;
+        nDsqCount = nDsqCountIn;
+        break;
+    }
+    case 2: {
+        std::map<uint256, std::pair<int64_t, CMasternodeBroadcast> > mapSeenMasternodeBroadcastIn;
+        std::map<uint256, CMasternodePing> mapSeenMasternodePingIn;
+        s >> mapSeenMasternodeBroadcastIn >> mapSeenMasternodePingIn;
+        LOCK(cs);
+        mapSeenMasternodeBroadcast.swap(mapSeenMasternodeBroadcastIn);
+        mapSeenMasternodePing.swap(mapSeenMasternodePingIn);
+        break;
+    }
+    }
+}
+
+void CMasternodeMan::ReadSnapshotDone()
+{
+    LOCK(cs);
+    scoreCache.Clear();
+    RebuildPaymentQueue();
+}
+
 std::string CMasternodeMan::ToString() const
 {
     std::ostringstream info;
@@ -1344,6 +1491,7 @@ void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast mnb, CConnman& co
         if(pmn->UpdateFromNewBroadcast(mnb, connman)) {
             masternodeSync.BumpAssetLastTime("CMasternodeMan::UpdateMasternodeList - seen");
             mapSeenMasternodeBroadcast.erase(mnbOld.GetHash());
+            relayMessageCache.Erase(CInv(MSG_MASTERNODE_ANNOUNCE, mnbOld.GetHash()));
         }
     }
 }
@@ -1409,6 +1557,7 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
             }
             if(hash != mnbOld.GetHash()) {
                 mapSeenMasternodeBroadcast.erase(mnbOld.GetHash());
+                relayMessageCache.Erase(CInv(MSG_MASTERNODE_ANNOUNCE, mnbOld.GetHash()));
             }
             return true;
         }
@@ -1456,7 +1605,17 @@ void CMasternodeMan::UpdateLastPaid(const CBlockIndex* pindex)
     //                         nCachedBlockHeight, nMaxBlocksToScanBack, IsFirstRun ? "true" : "false");
 
     for (auto& mnpair: mapMasternodes) {
+        int nBlockLastPaid = mnpair.second.GetLastPaidBlock();
         mnpair.second.UpdateLastPaid(pindex, nMaxBlocksToScanBack);
+        if (mnpair.second.GetLastPaidBlock() != nBlockLastPaid) {
+            // move it back in the payment queue
+            payment_queue_t::iterator it = mapPaymentQueue.find(std::make_pair(nBlockLastPaid, mnpair.first));
+            if (it != mapPaymentQueue.end()) {
+                payment_queue_item_t item = it->second;
+                mapPaymentQueue.erase(it);
+                mapPaymentQueue[std::make_pair(mnpair.second.GetLastPaidBlock(), mnpair.first)] = item;
+            }
+        }
     }
 
     IsFirstRun = false;
@@ -1537,6 +1696,7 @@ void CMasternodeMan::SetMasternodeLastPing(const COutPoint& outpoint, const CMas
     uint256 hash = mnb.GetHash();
     if(mapSeenMasternodeBroadcast.count(hash)) {
         mapSeenMasternodeBroadcast[hash].second.lastPing = mnp;
+        relayMessageCache.Erase(CInv(MSG_MASTERNODE_ANNOUNCE, hash));
     }
 }
 
@@ -6,8 +6,11 @@
 #define MASTERNODEMAN_H
 
 #include "masternode.h"
+#include "masternode-scorecache.h"
 #include "sync.h"
 
+struct CFlatDBSection;
+
 using namespace std;
 
 class CMasternodeMan;
@@ -18,8 +21,8 @@ extern CMasternodeMan mnodeman;
 class CMasternodeMan
 {
 public:
-    typedef std::pair<arith_uint256, CMasternode*> score_pair_t;
-    typedef std::vector<score_pair_t> score_pair_vec_t;
+    typedef CMasternodeScoreCache::score_pair_t score_pair_t;
+    typedef CMasternodeScoreCache::score_pair_vec_t score_pair_vec_t;
     typedef std::pair<int, CMasternode> rank_pair_t;
     typedef std::vector<rank_pair_t> rank_pair_vec_t;
 
@@ -30,6 +33,8 @@ private:
 
     static const int LAST_PAID_SCAN_BLOCKS      = 100;
 
+    static const int MAX_PAYMENT_QUEUE_BLOCKS_SCANNED = 10;
+
     static const int MIN_POSE_PROTO_VERSION     = 70203;
     static const int MAX_POSE_CONNECTIONS       = 10;
     static const int MAX_POSE_RANK              = 10;
@@ -50,6 +55,23 @@ private:
 
     // map to hold all MNs
     std::map<COutPoint, CMasternode> mapMasternodes;
+    // sorted scores of mapMasternodes for recent block hashes, cleared when the map entries change
+    CMasternodeScoreCache scoreCache;
+
+    struct payment_queue_item_t
+    {
+        CMasternode* pmn;
+        // script the masternode is paid to
+        CScript payee;
+        // height of the collateral, -1 if not looked up yet on the current chain
+        int nCollateralHeight;
+    };
+    typedef std::map<std::pair<int, COutPoint>, payment_queue_item_t> payment_queue_t;
+
+    // all masternodes in payment order, i.e. by last paid block and then by collateral
+    payment_queue_t mapPaymentQueue;
+    // tip of the chain the collateral heights in mapPaymentQueue were looked up on
+    const CBlockIndex* pindexPaymentQueue;
     // who's asked for the Masternode list and the last time
     std::map<CNetAddr, int64_t> mAskedUsForMasternodeList;
     // who we asked for the Masternode list and the last time
@@ -80,6 +102,13 @@ private:
 
     bool GetMasternodeScores(const uint256& nBlockHash, score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol = 0);
 
+    void AddToPaymentQueue(CMasternode& mn);
+    void RemoveFromPaymentQueue(CMasternode& mn);
+    void RebuildPaymentQueue();
+    /// Forget the collateral heights spent by the blocks from pindexPaymentQueue up to pindexTip,
+    /// false if pindexTip doesn't extend pindexPaymentQueue by a few readable blocks
+    bool ForgetSpentCollateralHeights(const CBlockIndex* pindexTip);
+
 public:
     // Keep track of all broadcasts I've seen
     std::map<uint256, std::pair<int64_t, CMasternodeBroadcast> > mapSeenMasternodeBroadcast;
@@ -106,6 +135,10 @@ public:
         }
 
         READWRITE(mapMasternodes);
+        if(ser_action.ForRead()) {
+            scoreCache.Clear();
+            RebuildPaymentQueue();
+        }
         READWRITE(mAskedUsForMasternodeList);
         READWRITE(mWeAskedForMasternodeList);
         READWRITE(mWeAskedForMasternodeListEntry);
@@ -121,6 +154,12 @@ public:
         }
     }
 
+    /// Snapshot sections for CFlatDB
+    static std::vector<CFlatDBSection> GetSnapshotSections();
+    void WriteSnapshotSections(std::vector<CDataStream>& vSections);
+    void ReadSnapshotSection(size_t nSection, CDataStream& s);
+    void ReadSnapshotDone();
+
     CMasternodeMan();
 
     /// Add an entry
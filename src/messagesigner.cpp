@@ -4,11 +4,150 @@
 
 #include "base58.h"
 #include "hash.h"
+#include "memusage.h"
+#include "random.h"
 #include "validation.h" // For strMessageMagic
 #include "messagesigner.h"
+#include "sync.h"
 #include "tinyformat.h"
+#include "util.h"
 #include "utilstrencodings.h"
 
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+
+#include <boost/thread.hpp>
+#include <boost/unordered_set.hpp>
+
+namespace {
+
+/** Keys recovered by PrecheckHash, by the hash of the signed hash and the signature */
+class CRecoveredKeyCache
+{
+private:
+    // A sync session carries a few signatures per masternode, this covers several thousand of them
+    static const size_t MAX_ENTRIES = 50000;
+
+    struct EntryHasher {
+        size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
+    };
+
+    CCriticalSection cs;
+    std::unordered_map<uint256, CKeyID, EntryHasher> mapKeys;
+    // insertion order, oldest first
+    std::deque<uint256> dequeKeys;
+
+public:
+    std::atomic<uint64_t> nHits{0};
+
+    static uint256 GetEntryHash(const uint256& hash, const std::vector<unsigned char>& vchSig)
+    {
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << hash << vchSig;
+        return ss.GetHash();
+    }
+
+    void Add(const uint256& hashEntry, const CKeyID& keyID)
+    {
+        LOCK(cs);
+        if (!mapKeys.emplace(hashEntry, keyID).second)
+            return;
+        dequeKeys.push_back(hashEntry);
+        if (dequeKeys.size() > MAX_ENTRIES) {
+            mapKeys.erase(dequeKeys.front());
+            dequeKeys.pop_front();
+        }
+    }
+
+    bool Get(const uint256& hashEntry, CKeyID& keyIDRet)
+    {
+        LOCK(cs);
+        auto it = mapKeys.find(hashEntry);
+        if (it == mapKeys.end())
+            return false;
+        keyIDRet = it->second;
+        return true;
+    }
+
+    void Clear()
+    {
+        LOCK(cs);
+        mapKeys.clear();
+        dequeKeys.clear();
+    }
+};
+
+CRecoveredKeyCache recoveredKeyCache;
+
+/**
+ * Signatures that VerifyHash found valid for a key, the same as the script signature cache
+ * (script/sigcache.cpp). A masternode message is checked again whenever it is relayed, synced
+ * to a peer or re-applied, each of these is a lookup here.
+ */
+class CVerifiedSignatureCache
+{
+private:
+    struct EntryHasher {
+        size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
+    };
+
+    //! Entries are SHA256(nonce || signed hash || public key || signature)
+    uint256 nonce;
+    typedef boost::unordered_set<uint256, EntryHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs;
+
+public:
+    CVerifiedSignatureCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& hash, const CPubKey& pubkey, const std::vector<unsigned char>& vchSig)
+    {
+        CSHA256 sha256;
+        sha256.Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(pubkey.begin(), pubkey.size());
+        if (!vchSig.empty())
+            sha256.Write(&vchSig[0], vchSig.size());
+        sha256.Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs);
+        return setValid.count(entry);
+    }
+
+    void Set(const uint256& entry)
+    {
+        size_t nMaxCacheSize = GetArg("-maxmnsigcachesize", DEFAULT_MAX_MN_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+        if (nMaxCacheSize <= 0) return;
+
+        boost::unique_lock<boost::shared_mutex> lock(cs);
+        while (memusage::DynamicUsage(setValid) > nMaxCacheSize)
+        {
+            map_type::size_type s = GetRand(setValid.bucket_count());
+            map_type::local_iterator it = setValid.begin(s);
+            if (it != setValid.end(s)) {
+                setValid.erase(*it);
+            }
+        }
+
+        setValid.insert(entry);
+    }
+
+    void Clear()
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs);
+        setValid.clear();
+    }
+};
+
+CVerifiedSignatureCache verifiedSignatureCache;
+
+} // anon namespace
+
 bool CMessageSigner::GetKeysFromSecret(const std::string strSecret, CKey& keyRet, CPubKey& pubkeyRet)
 {
     CBitcoinSecret vchSecret;
@@ -21,22 +160,27 @@ bool CMessageSigner::GetKeysFromSecret(const std::string strSecret, CKey& keyRet
     return true;
 }
 
-bool CMessageSigner::SignMessage(const std::string strMessage, std::vector<unsigned char>& vchSigRet, const CKey key)
+uint256 CMessageSigner::GetMessageHash(const std::string& strMessage)
 {
     CHashWriter ss(SER_GETHASH, 0);
     ss << strMessageMagic;
     ss << strMessage;
+    return ss.GetHash();
+}
 
-    return CHashSigner::SignHash(ss.GetHash(), key, vchSigRet);
+bool CMessageSigner::SignMessage(const std::string strMessage, std::vector<unsigned char>& vchSigRet, const CKey key)
+{
+    return CHashSigner::SignHash(GetMessageHash(strMessage), key, vchSigRet);
 }
 
 bool CMessageSigner::VerifyMessage(const CPubKey pubkey, const std::vector<unsigned char>& vchSig, const std::string strMessage, std::string& strErrorRet)
 {
-    CHashWriter ss(SER_GETHASH, 0);
-    ss << strMessageMagic;
-    ss << strMessage;
+    return CHashSigner::VerifyHash(GetMessageHash(strMessage), pubkey, vchSig, strErrorRet);
+}
 
-    return CHashSigner::VerifyHash(ss.GetHash(), pubkey, vchSig, strErrorRet);
+bool CMessageSigner::PrecheckMessage(const std::vector<unsigned char>& vchSig, const std::string& strMessage)
+{
+    return CHashSigner::PrecheckHash(GetMessageHash(strMessage), vchSig);
 }
 
 bool CHashSigner::SignHash(const uint256& hash, const CKey key, std::vector<unsigned char>& vchSigRet)
@@ -46,18 +190,58 @@ bool CHashSigner::SignHash(const uint256& hash, const CKey key, std::vector<unsi
 
 bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet)
 {
-    CPubKey pubkeyFromSig;
-    if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
-        strErrorRet = "Error recovering public key.";
-        return false;
+    uint256 entry;
+    verifiedSignatureCache.ComputeEntry(entry, hash, pubkey, vchSig);
+    if(verifiedSignatureCache.Get(entry)) {
+        recoveredKeyCache.nHits++;
+        return true;
+    }
+
+    CKeyID keyIDFromSig;
+    if(recoveredKeyCache.Get(CRecoveredKeyCache::GetEntryHash(hash, vchSig), keyIDFromSig)) {
+        recoveredKeyCache.nHits++;
+    } else {
+        CPubKey pubkeyFromSig;
+        if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
+            strErrorRet = "Error recovering public key.";
+            return false;
+        }
+        keyIDFromSig = pubkeyFromSig.GetID();
     }
 
-    if(pubkeyFromSig.GetID() != pubkey.GetID()) {
+    if(keyIDFromSig != pubkey.GetID()) {
         strErrorRet = strprintf("Keys don't match: pubkey=%s, pubkeyFromSig=%s, hash=%s, vchSig=%s",
-                    pubkey.GetID().ToString(), pubkeyFromSig.GetID().ToString(), hash.ToString(),
+                    pubkey.GetID().ToString(), keyIDFromSig.ToString(), hash.ToString(),
                     EncodeBase64(&vchSig[0], vchSig.size()));
         return false;
     }
 
+    verifiedSignatureCache.Set(entry);
     return true;
 }
+
+bool CHashSigner::PrecheckHash(const uint256& hash, const std::vector<unsigned char>& vchSig)
+{
+    uint256 hashEntry = CRecoveredKeyCache::GetEntryHash(hash, vchSig);
+    CKeyID keyID;
+    if(recoveredKeyCache.Get(hashEntry, keyID))
+        return true;
+
+    CPubKey pubkeyFromSig;
+    if(!pubkeyFromSig.RecoverCompact(hash, vchSig))
+        return false;
+
+    recoveredKeyCache.Add(hashEntry, pubkeyFromSig.GetID());
+    return true;
+}
+
+void CHashSigner::ClearPrecheckCache()
+{
+    recoveredKeyCache.Clear();
+    verifiedSignatureCache.Clear();
+}
+
+uint64_t CHashSigner::GetPrecheckHits()
+{
+    return recoveredKeyCache.nHits;
+}
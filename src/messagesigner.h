@@ -7,6 +7,9 @@
 
 #include "key.h"
 
+/** -maxmnsigcachesize default, in MiB */
+static const unsigned int DEFAULT_MAX_MN_SIG_CACHE_SIZE = 10;
+
 /** Helper class for signing messages and checking their signatures
  */
 class CMessageSigner
@@ -18,6 +21,10 @@ public:
     static bool SignMessage(const std::string strMessage, std::vector<unsigned char>& vchSigRet, const CKey key);
     /// Verify the message signature, returns true if succcessful
     static bool VerifyMessage(const CPubKey pubkey, const std::vector<unsigned char>& vchSig, const std::string strMessage, std::string& strErrorRet);
+    /// Recover the signer of the message ahead of VerifyMessage, see CHashSigner::PrecheckHash
+    static bool PrecheckMessage(const std::vector<unsigned char>& vchSig, const std::string& strMessage);
+    /// Hash that is actually signed for strMessage
+    static uint256 GetMessageHash(const std::string& strMessage);
 };
 
 /** Helper class for signing hashes and checking their signatures
@@ -29,6 +36,13 @@ public:
     static bool SignHash(const uint256& hash, const CKey key, std::vector<unsigned char>& vchSigRet);
     /// Verify the hash signature, returns true if succcessful
     static bool VerifyHash(const uint256& hash, const CPubKey pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet);
+    /// Recover the key that signed the hash and remember it, so that a later VerifyHash
+    /// of the same signature only has to compare keys. Safe to call from any thread.
+    static bool PrecheckHash(const uint256& hash, const std::vector<unsigned char>& vchSig);
+    /// Forget all prechecked and verified signatures
+    static void ClearPrecheckCache();
+    /// Number of VerifyHash calls answered by a precheck or an earlier verification
+    static uint64_t GetPrecheckHits();
 };
 
 #endif
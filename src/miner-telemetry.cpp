@@ -0,0 +1,208 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "miner-telemetry.h"
+
+#include "miner.h"
+
+#include <univalue.h>
+
+#include <chrono>
+#include <math.h>
+#include <new>
+#include <stdlib.h>
+#ifdef WIN32
+#include <malloc.h>
+#endif
+
+
+
+static TMinerThreadTelemetry g_aMinerThreadTelemetry [ I_MAX_GENERATE_THREADS * 2 ];
+
+static const double aHashRateWindowsInSeconds [ I_MINER_TELEMETRY_AMOUNT_OF_WINDOWS ] = { 10.0, 60.0, 900.0 };
+static const char * aHashRateWindowNames [ I_MINER_TELEMETRY_AMOUNT_OF_WINDOWS ] = { "10s", "60s", "15m" };
+static std :: atomic < double > g_aHashRateAverages [ I_MINER_TELEMETRY_AMOUNT_OF_WINDOWS ];
+
+static std :: atomic < int64_t > g_iWorkPublicationTimeInNanoSeconds ( 0 );
+static std :: atomic < uint64_t > g_iAmountOfPublishedWorks ( 0 );
+
+// State of MinerTelemetry_Sample (), which has a single caller.
+static uint64_t g_iSampledAmountOfHashes = 0;
+static int64_t g_iSampleTimeInNanoSeconds = 0;
+
+
+
+//---Utility functions.---------------------------------------------------
+static uint64_t GetTotalAmountOfHashes () {
+    uint64_t iAmountOfHashes = 0;
+    for ( unsigned int i = 0; i < I_MAX_GENERATE_THREADS * 2; i ++ )
+        iAmountOfHashes += g_aMinerThreadTelemetry [ i ].iAmountOfHashes.load ( std :: memory_order_relaxed );
+    return iAmountOfHashes;
+}
+
+// Upper bound of the latency bucket, at which the _fFraction of all steps are.
+static uint64_t GetLatencyPercentile ( const uint64_t * _pHistogram, uint64_t _iAmountOfSteps, double _fFraction ) {
+    uint64_t iAmountOfSteps = 0;
+    for ( unsigned int i = 0; i < I_MINER_TELEMETRY_LATENCY_BUCKETS; i ++ ) {
+        iAmountOfSteps += _pHistogram [ i ];
+        if ( iAmountOfSteps > 0 && iAmountOfSteps >= _fFraction * _iAmountOfSteps )
+            return ( uint64_t ( 1 ) << ( i + 1 ) ) - 1;
+    } //-for
+    return 0;
+}
+
+//---Recording.-----------------------------------------------------------
+TMinerThreadTelemetry & MinerTelemetry_AcquireThreadSlot () {
+    // The lowest free slot, so that the threads of a generation are reported in the first slots.
+    for ( unsigned int i = 0; i < I_MAX_GENERATE_THREADS * 2; i ++ ) {
+        bool bInUse = false;
+        if ( g_aMinerThreadTelemetry [ i ].bInUse.compare_exchange_strong ( bInUse, true, std :: memory_order_acquire ) )
+            return g_aMinerThreadTelemetry [ i ];
+    } //-for
+
+    // Aligned by hand, operator new ignores the alignment of the type before C++17.
+    void * pMemory = nullptr;
+#ifdef WIN32
+    pMemory = _aligned_malloc ( sizeof ( TMinerThreadTelemetry ), alignof ( TMinerThreadTelemetry ) );
+#else
+    if ( posix_memalign ( & pMemory, alignof ( TMinerThreadTelemetry ), sizeof ( TMinerThreadTelemetry ) ) != 0 )
+        pMemory = nullptr;
+#endif
+    if ( pMemory == nullptr )
+        throw std :: bad_alloc ();
+
+    TMinerThreadTelemetry * pTelemetry = new ( pMemory ) TMinerThreadTelemetry ();
+    pTelemetry->bInUse.store ( true, std :: memory_order_relaxed );
+    return * pTelemetry;
+}
+
+void MinerTelemetry_ReleaseThreadSlot ( TMinerThreadTelemetry & _telemetry ) {
+    if ( & _telemetry < g_aMinerThreadTelemetry || & _telemetry >= g_aMinerThreadTelemetry + I_MAX_GENERATE_THREADS * 2 ) {
+        _telemetry.~TMinerThreadTelemetry ();
+#ifdef WIN32
+        _aligned_free ( & _telemetry );
+#else
+        free ( & _telemetry );
+#endif
+        return;
+    } //-if
+    _telemetry.bInUse.store ( false, std :: memory_order_release );
+}
+
+int64_t MinerTelemetry_GetTimeInNanoSeconds () {
+    return std :: chrono :: duration_cast < std :: chrono :: nanoseconds > ( std :: chrono :: steady_clock :: now ().time_since_epoch () ).count ();
+}
+
+void MinerTelemetry_RecordStep ( TMinerThreadTelemetry & _telemetry, uint32_t _iAmountOfHashes, int64_t _iDurationInNanoSeconds ) {
+    uint64_t iNanoSecondsPerHash = _iAmountOfHashes > 0 && _iDurationInNanoSeconds > 0 ? _iDurationInNanoSeconds / _iAmountOfHashes : 0;
+    unsigned int iBucket = 0;
+    while ( iNanoSecondsPerHash > 1 && iBucket < I_MINER_TELEMETRY_LATENCY_BUCKETS - 1 ) {
+        iNanoSecondsPerHash >>= 1;
+        iBucket ++;
+    } //-while
+
+    MinerTelemetry_Add ( _telemetry.iAmountOfHashes, _iAmountOfHashes );
+    MinerTelemetry_Add ( _telemetry.iAmountOfSteps, 1 );
+    MinerTelemetry_Add ( _telemetry.aLatencyHistogram [ iBucket ], 1 );
+}
+
+void MinerTelemetry_WorkPublished () {
+    g_iWorkPublicationTimeInNanoSeconds.store ( MinerTelemetry_GetTimeInNanoSeconds (), std :: memory_order_relaxed );
+    g_iAmountOfPublishedWorks.fetch_add ( 1, std :: memory_order_relaxed );
+}
+
+//---Averages.------------------------------------------------------------
+void MinerTelemetry_Sample () {
+    int64_t iTimeInNanoSeconds = MinerTelemetry_GetTimeInNanoSeconds ();
+    uint64_t iAmountOfHashes = GetTotalAmountOfHashes ();
+
+    if ( g_iSampleTimeInNanoSeconds != 0 && iTimeInNanoSeconds > g_iSampleTimeInNanoSeconds ) {
+        double fElapsedSeconds = ( iTimeInNanoSeconds - g_iSampleTimeInNanoSeconds ) * 1e-9;
+        double fHashRate = ( iAmountOfHashes - g_iSampledAmountOfHashes ) / fElapsedSeconds;
+
+        for ( unsigned int i = 0; i < I_MINER_TELEMETRY_AMOUNT_OF_WINDOWS; i ++ ) {
+            double fAverage = g_aHashRateAverages [ i ].load ( std :: memory_order_relaxed );
+            fAverage += ( 1.0 - exp ( - fElapsedSeconds / aHashRateWindowsInSeconds [ i ] ) ) * ( fHashRate - fAverage );
+            g_aHashRateAverages [ i ].store ( fAverage, std :: memory_order_relaxed );
+        } //-for
+    } //-if
+
+    g_iSampleTimeInNanoSeconds = iTimeInNanoSeconds;
+    g_iSampledAmountOfHashes = iAmountOfHashes;
+}
+
+void MinerTelemetry_Reset () {
+    for ( unsigned int i = 0; i < I_MINER_TELEMETRY_AMOUNT_OF_WINDOWS; i ++ )
+        g_aHashRateAverages [ i ].store ( 0.0, std :: memory_order_relaxed );
+    g_iWorkPublicationTimeInNanoSeconds.store ( 0, std :: memory_order_relaxed );
+    g_iSampleTimeInNanoSeconds = 0;
+}
+
+double MinerTelemetry_GetHashRate () {
+    return g_aHashRateAverages [ 0 ].load ( std :: memory_order_relaxed );
+}
+
+//---Reporting.-----------------------------------------------------------
+static UniValue LatencyToJSON ( const uint64_t * _pHistogram, uint64_t _iAmountOfSteps ) {
+    UniValue result ( UniValue :: VOBJ );
+    result.push_back ( Pair ( "p50", GetLatencyPercentile ( _pHistogram, _iAmountOfSteps, 0.5 ) ) );
+    result.push_back ( Pair ( "p90", GetLatencyPercentile ( _pHistogram, _iAmountOfSteps, 0.9 ) ) );
+    result.push_back ( Pair ( "p99", GetLatencyPercentile ( _pHistogram, _iAmountOfSteps, 0.99 ) ) );
+    return result;
+}
+
+UniValue MinerTelemetry_ToJSON ( unsigned int _iAmountOfThreads ) {
+    UniValue result ( UniValue :: VOBJ );
+    UniValue hashRates ( UniValue :: VOBJ );
+    UniValue threads ( UniValue :: VARR );
+    uint64_t aTotalLatencyHistogram [ I_MINER_TELEMETRY_LATENCY_BUCKETS ] = { 0 };
+    uint64_t iTotalAmountOfHashes = 0, iTotalAmountOfSteps = 0, iTotalAmountOfBlocksFound = 0;
+    uint64_t iTotalAmountOfStaleBlocks = 0, iTotalAmountOfStaleSlices = 0;
+    unsigned int i, j;
+
+    if ( _iAmountOfThreads > I_MAX_GENERATE_THREADS * 2 )
+        _iAmountOfThreads = I_MAX_GENERATE_THREADS * 2;
+
+    for ( i = 0; i < I_MINER_TELEMETRY_AMOUNT_OF_WINDOWS; i ++ )
+        hashRates.push_back ( Pair ( aHashRateWindowNames [ i ], g_aHashRateAverages [ i ].load ( std :: memory_order_relaxed ) ) );
+
+    for ( i = 0; i < _iAmountOfThreads; i ++ ) {
+        const TMinerThreadTelemetry & telemetry = g_aMinerThreadTelemetry [ i ];
+        uint64_t aLatencyHistogram [ I_MINER_TELEMETRY_LATENCY_BUCKETS ];
+        for ( j = 0; j < I_MINER_TELEMETRY_LATENCY_BUCKETS; j ++ ) {
+            aLatencyHistogram [ j ] = telemetry.aLatencyHistogram [ j ].load ( std :: memory_order_relaxed );
+            aTotalLatencyHistogram [ j ] += aLatencyHistogram [ j ];
+        } //-for
+
+        UniValue thread ( UniValue :: VOBJ );
+        uint64_t iAmountOfSteps = telemetry.iAmountOfSteps.load ( std :: memory_order_relaxed );
+        thread.push_back ( Pair ( "hashes", telemetry.iAmountOfHashes.load ( std :: memory_order_relaxed ) ) );
+        thread.push_back ( Pair ( "blocksfound", telemetry.iAmountOfBlocksFound.load ( std :: memory_order_relaxed ) ) );
+        thread.push_back ( Pair ( "staleblocks", telemetry.iAmountOfStaleBlocks.load ( std :: memory_order_relaxed ) ) );
+        thread.push_back ( Pair ( "staleslices", telemetry.iAmountOfStaleSlices.load ( std :: memory_order_relaxed ) ) );
+        thread.push_back ( Pair ( "hashlatencyns", LatencyToJSON ( aLatencyHistogram, iAmountOfSteps ) ) );
+        threads.push_back ( thread );
+
+        iTotalAmountOfHashes += telemetry.iAmountOfHashes.load ( std :: memory_order_relaxed );
+        iTotalAmountOfSteps += iAmountOfSteps;
+        iTotalAmountOfBlocksFound += telemetry.iAmountOfBlocksFound.load ( std :: memory_order_relaxed );
+        iTotalAmountOfStaleBlocks += telemetry.iAmountOfStaleBlocks.load ( std :: memory_order_relaxed );
+        iTotalAmountOfStaleSlices += telemetry.iAmountOfStaleSlices.load ( std :: memory_order_relaxed );
+    } //-for
+
+    int64_t iWorkPublicationTime = g_iWorkPublicationTimeInNanoSeconds.load ( std :: memory_order_relaxed );
+    double fTemplateAge = iWorkPublicationTime != 0 ? ( MinerTelemetry_GetTimeInNanoSeconds () - iWorkPublicationTime ) * 1e-9 : 0.0;
+
+    result.push_back ( Pair ( "threads", ( uint64_t ) _iAmountOfThreads ) );
+    result.push_back ( Pair ( "hashespersec", hashRates ) );
+    result.push_back ( Pair ( "hashes", iTotalAmountOfHashes ) );
+    result.push_back ( Pair ( "hashlatencyns", LatencyToJSON ( aTotalLatencyHistogram, iTotalAmountOfSteps ) ) );
+    result.push_back ( Pair ( "templates", g_iAmountOfPublishedWorks.load ( std :: memory_order_relaxed ) ) );
+    result.push_back ( Pair ( "templateage", fTemplateAge ) );
+    result.push_back ( Pair ( "blocksfound", iTotalAmountOfBlocksFound ) );
+    result.push_back ( Pair ( "staleblocks", iTotalAmountOfStaleBlocks ) );
+    result.push_back ( Pair ( "staleslices", iTotalAmountOfStaleSlices ) );
+    result.push_back ( Pair ( "perthread", threads ) );
+    return result;
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_MINER_TELEMETRY_H
+#define BITCOIN_MINER_TELEMETRY_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+class UniValue;
+
+
+
+// Bucket i of a latency histogram counts steps of 2^i .. 2^(i+1)-1 nanoseconds per hash.
+#define I_MINER_TELEMETRY_LATENCY_BUCKETS 32
+// Length of the hash rate averaging windows.
+#define I_MINER_TELEMETRY_AMOUNT_OF_WINDOWS 3
+
+
+
+/** Counters of one miner thread. They are written by that thread only, with a relaxed load and store
+ *  instead of a locked read-modify-write, and read by anyone without a lock. Every thread has its own
+ *  cache lines, so that the miner threads do not bounce them between cores.
+ */
+struct alignas ( 64 ) TMinerThreadTelemetry {
+    // Held by the miner thread, which writes the counters, see MinerTelemetry_AcquireThreadSlot ().
+    std :: atomic < bool > bInUse;
+    std :: atomic < uint64_t > iAmountOfHashes;
+    std :: atomic < uint64_t > iAmountOfSteps;
+    std :: atomic < uint64_t > iAmountOfBlocksFound;
+    // Found blocks, which were not accepted, because the tip had moved on or otherwise.
+    std :: atomic < uint64_t > iAmountOfStaleBlocks;
+    // Nonce slices left unfinished, because newer work had been published.
+    std :: atomic < uint64_t > iAmountOfStaleSlices;
+    std :: atomic < uint64_t > aLatencyHistogram [ I_MINER_TELEMETRY_LATENCY_BUCKETS ];
+};
+
+/** Reserves a slot of counters for the calling miner thread, until it calls MinerTelemetry_ReleaseThreadSlot (),
+ *  so that every slot has a single writer. Threads beyond the I_MAX_GENERATE_THREADS * 2 reported slots get
+ *  counters of their own, which are not reported.
+ */
+TMinerThreadTelemetry & MinerTelemetry_AcquireThreadSlot ();
+void MinerTelemetry_ReleaseThreadSlot ( TMinerThreadTelemetry & _telemetry );
+
+inline void MinerTelemetry_Add ( std :: atomic < uint64_t > & _iCounter, uint64_t _iValue ) {
+    _iCounter.store ( _iCounter.load ( std :: memory_order_relaxed ) + _iValue, std :: memory_order_relaxed );
+}
+
+/** Monotonic clock for the step latencies, much cheaper than GetTimeMicros (). */
+int64_t MinerTelemetry_GetTimeInNanoSeconds ();
+
+/** Accounts _iAmountOfHashes hashes, which took _iDurationInNanoSeconds, to the calling miner thread. */
+void MinerTelemetry_RecordStep ( TMinerThreadTelemetry & _telemetry, uint32_t _iAmountOfHashes, int64_t _iDurationInNanoSeconds );
+
+/** Called by the work producer for every published block template. */
+void MinerTelemetry_WorkPublished ();
+
+/** Updates the exponentially weighted hash rate averages over 10 s, 60 s and 15 min from the thread
+ *  counters. Called about once a second, by the work producer only.
+ */
+void MinerTelemetry_Sample ();
+
+/** Clears the averages and the template time when mining stops. The thread counters are cumulative. */
+void MinerTelemetry_Reset ();
+
+/** Hash rate of the built-in miner threads, averaged over the last 10 seconds. */
+double MinerTelemetry_GetHashRate ();
+
+/** Everything above as JSON, for getminingtelemetry and the miningtelemetry ZMQ topic. */
+UniValue MinerTelemetry_ToJSON ( unsigned int _iAmountOfThreads );
+
+#endif // BITCOIN_MINER_TELEMETRY_H
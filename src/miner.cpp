@@ -18,14 +18,17 @@
 #include "net.h"
 #include "policy/policy.h"
 #include "pow.h"
+#include "powhash.h"
 #include "primitives/transaction.h"
 #include "script/standard.h"
 #include "timedata.h"
 #include "txmempool.h"
+#include "ui_interface.h"
 #include "util.h"
 #include "utilmoneystr.h"
 #include "masternode-payments.h"
 #include "masternode-sync.h"
+#include "miner-telemetry.h"
 #include "validationinterface.h"
 #include "utiltime.h"
 
@@ -49,6 +52,7 @@
 //#elif
 //#include <atomic>
 //#endif
+#include <memory>
 #include <queue>
 
 //#include <QApplication>
@@ -68,8 +72,6 @@ using namespace std;
 bool g_bNotifyIsMiningEnabled = false;
 //std :: atomic_bool g_bNotifyIsMiningEnabled = false;
 
-//std :: atomic < THashRateCounter > aHashRateCounters [ I_MAX_GENERATE_THREADS * 2 ];
-boost::atomic < THashRateCounter > aHashRateCounters [ I_MAX_GENERATE_THREADS * 2 ];
 
 int g_iAmountOfMiningThreads = -2;
 int g_iPreviousAmountOfMiningThreads;
@@ -400,6 +402,17 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& s
     return pblocktemplate.release();
 }
 
+static void SetExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int nExtraNonce)
+{
+    unsigned int nHeight = pindexPrev->nHeight+1; // Height first in coinbase required for block.version=2
+    CMutableTransaction txCoinbase(pblock->vtx[0]);
+    txCoinbase.vin[0].scriptSig = (CScript() << nHeight << CScriptNum(nExtraNonce)) + COINBASE_FLAGS;
+    assert(txCoinbase.vin[0].scriptSig.size() <= 100);
+
+    pblock->vtx[0] = txCoinbase;
+    pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+}
+
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
 {
     // Update nExtraNonce
@@ -410,13 +423,7 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
         hashPrevBlock = pblock->hashPrevBlock;
     }
     ++nExtraNonce;
-    unsigned int nHeight = pindexPrev->nHeight+1; // Height first in coinbase required for block.version=2
-    CMutableTransaction txCoinbase(pblock->vtx[0]);
-    txCoinbase.vin[0].scriptSig = (CScript() << nHeight << CScriptNum(nExtraNonce)) + COINBASE_FLAGS;
-    assert(txCoinbase.vin[0].scriptSig.size() <= 100);
-
-    pblock->vtx[0] = txCoinbase;
-    pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+    SetExtraNonce(pblock, pindexPrev, nExtraNonce);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -480,22 +487,75 @@ static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainpar
     return true;
 }
 
-// ***TODO*** that part changed in bitcoin, we are using a mix with old one here for now
-void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman, const int _iIndex )   // const int & _iIndex
-{
-    int iIndex = _iIndex;
+//---Work distribution.---------------------------------------------------
+// A single work producer thread builds the block templates and publishes them, miner threads only
+// hash. Each template is split into slices of 2^I_MINER_NONCE_SLICE_BITS nonces, and miner threads
+// claim them with an atomic counter, so that no two threads hash the same ( extranonce, nonce ).
+#define I_MINER_NONCE_SLICE_BITS 22
+#define I_MINER_NONCES_PER_SLICE ( uint64_t ( 1 ) << I_MINER_NONCE_SLICE_BITS )
+#define I_MINER_SLICES_PER_EXTRA_NONCE ( uint64_t ( 1 ) << ( 32 - I_MINER_NONCE_SLICE_BITS ) )
+// Nonces hashed between two checks for new work.
+#define I_MINER_NONCES_PER_STEP 256
+
+struct TMinerWork {
+    uint64_t iEpoch;
+    std :: unique_ptr < CBlockTemplate > pBlockTemplate;
+    const CBlockIndex * pPreviousBlockIndex;
+    boost :: shared_ptr < CReserveScript > pCoinbaseScript;
+    // Extranonce of slice 0. Follows the slices claimed from the previous work on the same tip.
+    unsigned int nFirstExtraNonce;
+    boost :: atomic < uint64_t > iNextSlice;
+};
 
-    fprintf(stdout, "miner.cpp : BitcoinMiner () : Miner thread started : %i.\n", iIndex );
+// The current work, exchanged with std :: atomic_load () and std :: atomic_store (), null when the
+// miner threads have to wait. These are not lock-free for a shared_ptr: the standard library guards
+// them with an internal mutex, which miner threads only take once per new work.
+static std :: shared_ptr < TMinerWork > g_pMinerWork;
+// Changed by the work producer whenever g_pMinerWork is. Miner threads compare this lock-free
+// counter with the epoch of the work they hash instead of polling the tip, the mempool and the
+// peers themselves.
+static boost :: atomic < uint64_t > g_iMinerWorkEpoch ( 0 );
+
+// The tip to mine on, set from the block tip notification so that the work producer does not read
+// chainActive without cs_main. The work producer sleeps on g_conditionMinerTipChanged.
+static const CBlockIndex * g_pMinerTip = NULL;
+static bool g_bMinerTipChanged = false;
+static boost :: mutex g_mutexMinerTipChanged;
+static boost :: condition_variable g_conditionMinerTipChanged;
+
+static void MinerNotifyBlockTip ( bool _bInitialDownload, const CBlockIndex * _pNewTip ) {
+    boost :: lock_guard < boost :: mutex > lock ( g_mutexMinerTipChanged );
+    g_pMinerTip = _pNewTip;
+    g_bMinerTipChanged = true;
+    g_conditionMinerTipChanged.notify_one ();
+}
 
-    LogPrintf("BinariumMiner -- started\n");
-    SetThreadPriority(THREAD_PRIORITY_LOWEST);
-    RenameThread("binarium-miner");
+static void PublishMinerWork ( const std :: shared_ptr < TMinerWork > & _pWork ) {
+    std :: atomic_store ( & g_pMinerWork, _pWork );
+    g_iMinerWorkEpoch.fetch_add ( 1 );
+}
+
+// Claims the next slice of _work for _block: sets the extranonce of the slice and returns its first nonce.
+static uint32_t ClaimMinerWorkSlice ( TMinerWork & _work, CBlock & _block ) {
+    uint64_t iSlice = _work.iNextSlice.fetch_add ( 1 );
+
+    SetExtraNonce ( & _block, _work.pPreviousBlockIndex, _work.nFirstExtraNonce + iSlice / I_MINER_SLICES_PER_EXTRA_NONCE );
 
-    unsigned int nExtraNonce = 0;
+    return uint32_t ( iSlice % I_MINER_SLICES_PER_EXTRA_NONCE ) << I_MINER_NONCE_SLICE_BITS;
+}
+
+// Builds a new template whenever the tip changes, or the mempool did and the work is a minute old,
+// and withdraws the work while the node is not ready to mine.
+void static BinariumMinerWorkProducer(const CChainParams& chainparams, CConnman& connman)
+{
+    LogPrintf("BinariumMiner -- work producer started\n");
+    RenameThread("binarium-minerwk");
 
     boost::shared_ptr<CReserveScript> coinbaseScript;
     GetMainSignals().ScriptForMining(coinbaseScript);
 
+    std :: shared_ptr < TMinerWork > pWork;
+
     try {
         // Throw an error if no script was provided.  This can happen
         // due to some internal error but also if the keypool is empty.
@@ -503,150 +563,208 @@ void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman, con
         if (!coinbaseScript || coinbaseScript->reserveScript.empty())
             throw std::runtime_error("No coinbase script available (mining requires a wallet)");
 
+        unsigned int nTransactionsUpdatedLast = 0;
+        int64_t nWorkTime = 0;
+        int64_t nTelemetryNotificationTime = GetTime();
+
         while (true) {
-            LogPrintf("BinariumMiner : Starting miner cycle step.\n");
-
-            THashRateCounter structureHashRateCounter;
-
-            structureHashRateCounter.iAmountOfHashes = 0;
-            structureHashRateCounter.iStartTimeInMicroSeconds = GetTimeMicros ();
-            structureHashRateCounter.iCompletionTimeInMicroSeconds = 0;
-            aHashRateCounters [ iIndex ].store ( structureHashRateCounter );
-
-            if (chainparams.MiningRequiresPeers()) {
-                // Busy-wait for the network to come online so we don't waste time mining
-                // on an obsolete chain. In regtest mode we expect to fly solo.
-                do {                    
-                    bool fvNodesEmpty = connman.GetNodeCount(CConnman::CONNECTIONS_ALL) == 0;
-                    LogPrintf("BinariumMiner : iterating in \"if (chainparams.MiningRequiresPeers())\" cycle. : %i, %i, %i.\n",
-                        !fvNodesEmpty, !IsInitialBlockDownload(), masternodeSync.IsSynced());
-                    if (!fvNodesEmpty && !IsInitialBlockDownload() && masternodeSync.IsSynced())
-                        break;
-                    MilliSleep(1000);
-                } while (true);
+            boost::this_thread::interruption_point();
+            bool bTipChanged;
+            const CBlockIndex * pindexPrev;
+            {
+                boost :: lock_guard < boost :: mutex > lock ( g_mutexMinerTipChanged );
+                bTipChanged = g_bMinerTipChanged;
+                g_bMinerTipChanged = false;
+                pindexPrev = g_pMinerTip;
             }
 
-            //#ifdef BITCOIN_QT_BITCOINGUI_H
-            //fprintf(stdout, "miner.cpp : BitcoinMiner () : Notifing, that miner is enabled.\n" );
-            //Notify_MiningIsEnabled ( true );
-            //#endif
-            g_bNotifyIsMiningEnabled = true;
-
-            //
-            // Create new block
-            //
-            unsigned int nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-            CBlockIndex* pindexPrev = chainActive.Tip();
-            if(!pindexPrev) {
-                LogPrintf("BinariumMiner : if(!pindexPrev).\n");
-                break;
+            MinerTelemetry_Sample ();
+            if ( GetTime() - nTelemetryNotificationTime >= 10 && ! GetMainSignals().MiningTelemetry.empty() ) {
+                GetMainSignals().MiningTelemetry(MinerTelemetry_ToJSON(std::max(g_iAmountOfMiningThreads, 0)).write());
+                nTelemetryNotificationTime = GetTime();
+            } //-if
 
+            // Busy-wait for the network to come online so we don't waste time mining
+            // on an obsolete chain. In regtest mode we expect to fly solo.
+            bool bReady = true;
+            if (chainparams.MiningRequiresPeers())
+                bReady = connman.GetNodeCount(CConnman::CONNECTIONS_ALL) != 0 && !IsInitialBlockDownload() && masternodeSync.IsSynced();
+
+            if ( ! bReady || pindexPrev == NULL ) {
+                if ( pWork ) {
+                    LogPrintf("BinariumMiner -- waiting for peers and sync before mining\n");
+                    pWork.reset ();
+                    PublishMinerWork ( pWork );
+                } //-if
+
+            } else if ( ! pWork || bTipChanged || pWork->pPreviousBlockIndex != pindexPrev ||
+                        ( mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nWorkTime > 60 ) ) {
+                g_bNotifyIsMiningEnabled = true;
+
+                nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
+                std::unique_ptr<CBlockTemplate> pblocktemplate(CreateNewBlock(chainparams, coinbaseScript->reserveScript));
+                if (!pblocktemplate.get())
+                {
+                    LogPrintf("BinariumMiner -- Keypool ran out, please call keypoolrefill before restarting the mining thread\n");
+                    PublishMinerWork ( nullptr );
+                    return;
+                }
+                // Otherwise the tip moved on meanwhile, and its notification wakes the loop up again.
+                if ( pblocktemplate->block.hashPrevBlock == pindexPrev->GetBlockHash () ) {
+                    std :: shared_ptr < TMinerWork > pNewWork = std :: make_shared < TMinerWork > ();
+                    pNewWork->iEpoch = g_iMinerWorkEpoch.load () + 1;
+                    pNewWork->pBlockTemplate = std :: move ( pblocktemplate );
+                    pNewWork->pPreviousBlockIndex = pindexPrev;
+                    pNewWork->pCoinbaseScript = coinbaseScript;
+                    pNewWork->nFirstExtraNonce = 1;
+                    if ( pWork && pWork->pPreviousBlockIndex == pindexPrev )
+                        pNewWork->nFirstExtraNonce = pWork->nFirstExtraNonce + pWork->iNextSlice.load () / I_MINER_SLICES_PER_EXTRA_NONCE + 1;
+                    pNewWork->iNextSlice.store ( 0 );
+
+                    LogPrintf("BinariumMiner -- Running miner with %u transactions in block (%u bytes)\n", pNewWork->pBlockTemplate->block.vtx.size(),
+                        ::GetSerializeSize(pNewWork->pBlockTemplate->block, SER_NETWORK, PROTOCOL_VERSION));
+
+                    pWork = pNewWork;
+                    nWorkTime = GetTime();
+                    PublishMinerWork ( pWork );
+                    MinerTelemetry_WorkPublished ();
+                } //-if
             } //-if
 
-            std::unique_ptr<CBlockTemplate> pblocktemplate(CreateNewBlock(chainparams, coinbaseScript->reserveScript));
-            if (!pblocktemplate.get())
-            {
-                LogPrintf("BinariumMiner -- Keypool ran out, please call keypoolrefill before restarting the mining thread\n");
-                return;
-            }
-            CBlock *pblock = &pblocktemplate->block;
-            IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
+            // Until the tip notification, or for a second to look at the mempool and the peers again.
+            boost::unique_lock<boost::mutex> lock(g_mutexMinerTipChanged);
+            if ( ! g_bMinerTipChanged )
+                g_conditionMinerTipChanged.wait_for(lock, boost::chrono::seconds(1));
 
-            LogPrintf("BinariumMiner -- Running miner with %u transactions in block (%u bytes)\n", pblock->vtx.size(),
-                ::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION));
+        } //-while
 
-            //
-            // Search
-            //
-            int64_t nStart = GetTime();
-            arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
-            unsigned int nHashesDoneInThisMinerCycleStep = 0;
-            while (true)
-            {
-                unsigned int nHashesDone = 0;
+    } //-try
 
-                uint256 hash;
-                while (true)
-                {
-                    hash = pblock->GetHash();
-                    if (UintToArith256(hash) <= hashTarget)
-                    {
-                        // Found a solution
-                        SetThreadPriority(THREAD_PRIORITY_NORMAL);
-                        LogPrintf("BinariumMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
-                        ProcessBlockFound(pblock, chainparams);
-                        SetThreadPriority(THREAD_PRIORITY_LOWEST);
-                        coinbaseScript->KeepScript();
-
-                        //assert ( false );
-
-                        // In regression test mode, stop mining after a block is found. This
-                        // allows developers to controllably generate a block on demand.
-                        if (chainparams.MineBlocksOnDemand())
-                            throw boost::thread_interrupted();
+    catch (const boost::thread_interrupted&)
+    {
+        LogPrintf("BinariumMiner -- work producer terminated\n");
+        PublishMinerWork ( nullptr );
+        throw;
+    }
+    catch (const std::runtime_error &e)
+    {
+        LogPrintf("BinariumMiner -- work producer runtime error: %s\n", e.what());
+        PublishMinerWork ( nullptr );
+        return;
+    }
+}
 
-                        break;
-                    }
-                    pblock->nNonce += 1;
-                    //pblock->nNonce += GetTimeMicros () % 10 * 19;
-                    //pblock->nNonce         = ( get_uptime () + GetTimeMicros () % 100000000 ) % 100000000;
-                    //fprintf(stdout, "miner.cpp : BitcoinMiner () : %i : nNonce = %i.\n", nHashesDone, pblock->nNonce );
-                    nHashesDone += 1;
-                    nHashesDoneInThisMinerCycleStep = nHashesDoneInThisMinerCycleStep + 1;
-                    //aHashRateCounters [ iIndex ].iAmountOfHashes = aHashRateCounters [ iIndex ].iAmountOfHashes + 1;
-                    //if ((pblock->nNonce & 0xFF) == 0)
-                    if ((nHashesDone & 0xFF) == 0)
-                        break;
+// ***TODO*** that part changed in bitcoin, we are using a mix with old one here for now
+void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman, const int _iIndex )   // const int & _iIndex
+{
+    int iIndex = _iIndex;
 
-                } //-while
+    fprintf(stdout, "miner.cpp : BitcoinMiner () : Miner thread started : %i.\n", iIndex );
 
-                structureHashRateCounter = aHashRateCounters [ iIndex ].load ();
-                structureHashRateCounter.iCompletionTimeInMicroSeconds = GetTimeMicros ();
-                structureHashRateCounter.fHashRate = float ( nHashesDoneInThisMinerCycleStep ) /
-                    ( float ( structureHashRateCounter.iCompletionTimeInMicroSeconds - structureHashRateCounter.iStartTimeInMicroSeconds ) * 0.000001f );
-                aHashRateCounters [ iIndex ].store ( structureHashRateCounter );
+    LogPrintf("BinariumMiner -- started\n");
+    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+    RenameThread("binarium-miner");
 
-                //fprintf(stdout, "miner.cpp : BitcoinMiner () : %i, %i, %" PRIu64 ", %f.\n",
-                //    iIndex, nHashesDoneInThisMinerCycleStep, structureHashRateCounter.iCompletionTimeInMicroSeconds - structureHashRateCounter.iStartTimeInMicroSeconds,
-                //    structureHashRateCounter.fHashRate );
+    // Allocated once per thread, on huge pages with -powhashhugepages. GetPoWHashes () needs no other memory.
+    TPoWHashScratch & structPoWHashScratch = GetThreadPoWHashScratch ();
+    uint256 aHashes [ I_POW_HASH_MAX_LANES ];
 
-                // Check for stop or if block needs to be rebuilt
-                boost::this_thread::interruption_point();
-                // Regtest mode doesn't require peers
-                if (connman.GetNodeCount(CConnman::CONNECTIONS_ALL) == 0 && chainparams.MiningRequiresPeers())
-                    break;
-                //if (pblock->nNonce >= 0xffff0000)
-                if ( nHashesDoneInThisMinerCycleStep >= 0xffff0000 )
-                    break;
-                if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 60)
-                    break;
-                if (pindexPrev != chainActive.Tip())
-                    break;
+    std :: shared_ptr < TMinerWork > pWork;
+    uint64_t iEpoch = 0;
+    CBlock block;
+    arith_uint256 hashTarget;
+    TPoWPlan structPoWPlan;
+    uint64_t iNoncesLeftInSlice = 0;
+    TMinerThreadTelemetry & telemetry = MinerTelemetry_AcquireThreadSlot ();
+    int64_t iStepStartTime = MinerTelemetry_GetTimeInNanoSeconds ();
 
-                // Update nTime every few seconds
-                if (UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev) < 0)
-                    break; // Recreate the block if the clock has run backwards,
-                           // so that we can use the correct time.
-                if (chainparams.GetConsensus().fPowAllowMinDifficultyBlocks)
-                {
-                    // Changing pblock->nTime can change work required on testnet:
-                    hashTarget.SetCompact(pblock->nBits);
-                }
+    try {
+        while (true) {
+            // Check for stop or new work
+            boost::this_thread::interruption_point();
+            if ( ! pWork || g_iMinerWorkEpoch.load () != iEpoch ) {
+                if ( pWork && iNoncesLeftInSlice > 0 )
+                    MinerTelemetry_Add ( telemetry.iAmountOfStaleSlices, 1 );
+                iEpoch = g_iMinerWorkEpoch.load ();
+                pWork = std :: atomic_load ( & g_pMinerWork );
+                if ( ! pWork ) {
+                    MilliSleep(100);
+                    iStepStartTime = MinerTelemetry_GetTimeInNanoSeconds ();
+                    continue;
+                } //-if
 
-            } //-while
+                LogPrintf("BinariumMiner : Starting miner cycle step.\n");
+                iEpoch = pWork->iEpoch;
+                block = pWork->pBlockTemplate->block;
+                iNoncesLeftInSlice = 0;
+            } //-if
 
-            //#ifdef BITCOIN_QT_BITCOINGUI_H
-            //Notify_MiningIsEnabled ( false );
-            //#endif
-            //g_bNotifyIsMiningEnabled = false;
+            if ( iNoncesLeftInSlice == 0 ) {
+                block.nNonce = ClaimMinerWorkSlice ( * pWork, block );
+                iNoncesLeftInSlice = I_MINER_NONCES_PER_SLICE;
+                UpdateTime(&block, chainparams.GetConsensus(), pWork->pPreviousBlockIndex);
+                hashTarget.SetCompact(block.nBits);
+                structPoWPlan = GetPoWPlan ( block );
+            } //-if
 
-            /*structureHashRateCounter = aHashRateCounters [ iIndex ].load ();
-            structureHashRateCounter.iCompletionTimeInMicroSeconds = GetTimeMicros ();
-            structureHashRateCounter.fHashRate = float ( nHashesDoneInThisMinerCycleStep ) /
-                ( float ( structureHashRateCounter.iCompletionTimeInMicroSeconds - structureHashRateCounter.iStartTimeInMicroSeconds ) * 0.000001f );
-            aHashRateCounters [ iIndex ].store ( structureHashRateCounter );*/
+            //
+            // Search
+            //
+            bool bFound = false;
+            unsigned int iNonce;
+            for ( iNonce = 0; iNonce < I_MINER_NONCES_PER_STEP && ! bFound; iNonce += I_POW_HASH_MAX_LANES ) {
+                GetPoWHashes ( structPoWPlan, block, block.nNonce, I_POW_HASH_MAX_LANES, aHashes, structPoWHashScratch );
+                for ( unsigned int iLane = 0; iLane < I_POW_HASH_MAX_LANES; iLane ++ ) {
+                    if ( UintToArith256 ( aHashes [ iLane ] ) <= hashTarget ) {
+                        block.nNonce += iLane;
+                        bFound = true;
+                        break;
+                    }
+                } //-for
 
-            LogPrintf("BinariumMiner : Completing mining cycle step.\n\n");
+                if ( ! bFound )
+                    block.nNonce += I_POW_HASH_MAX_LANES;
+            } //-for
+            iNoncesLeftInSlice -= I_MINER_NONCES_PER_STEP;
+
+            // One clock read per step, the previous one is the start of this step.
+            int64_t iStepEndTime = MinerTelemetry_GetTimeInNanoSeconds ();
+            MinerTelemetry_RecordStep ( telemetry, iNonce, iStepEndTime - iStepStartTime );
+            iStepStartTime = iStepEndTime;
+
+            if ( bFound )
+            {
+                // Found a solution
+                SetThreadPriority(THREAD_PRIORITY_NORMAL);
+                LogPrintf("BinariumMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", block.GetHash().GetHex(), hashTarget.GetHex());
+                MinerTelemetry_Add ( telemetry.iAmountOfBlocksFound, 1 );
+                if (!ProcessBlockFound(&block, chainparams))
+                    MinerTelemetry_Add ( telemetry.iAmountOfStaleBlocks, 1 );
+                SetThreadPriority(THREAD_PRIORITY_LOWEST);
+                pWork->pCoinbaseScript->KeepScript();
+
+                // In regression test mode, stop mining after a block is found. This
+                // allows developers to controllably generate a block on demand.
+                if (chainparams.MineBlocksOnDemand())
+                    throw boost::thread_interrupted();
+
+                // The rest of the slice is of no use, the work producer is about to publish the next tip.
+                iNoncesLeftInSlice = 0;
+                continue;
+            }
+
+            // Update nTime every few seconds
+            if (UpdateTime(&block, chainparams.GetConsensus(), pWork->pPreviousBlockIndex) < 0)
+                iNoncesLeftInSlice = 0; // Take another slice if the clock has run backwards,
+                                        // so that no nonce is hashed twice with the same time.
+            if (chainparams.GetConsensus().fPowAllowMinDifficultyBlocks)
+            {
+                // Changing block.nTime can change work required on testnet:
+                hashTarget.SetCompact(block.nBits);
+            }
+            // A new week or nBits selects other pipeline stages.
+            if ( ! structPoWPlan.IsValidFor ( block ) )
+                structPoWPlan = GetPoWPlan ( block );
 
         } //-while
 
@@ -655,19 +773,13 @@ void static BitcoinMiner(const CChainParams& chainparams, CConnman& connman, con
     catch (const boost::thread_interrupted&)
     {
         LogPrintf("BinariumMiner -- terminated\n");
-        //#ifdef BITCOIN_QT_BITCOINGUI_H
-        //Notify_MiningIsEnabled ( false );
-        //#endif
-        //g_bNotifyIsMiningEnabled = false;
+        MinerTelemetry_ReleaseThreadSlot ( telemetry );
         throw;
     }
     catch (const std::runtime_error &e)
     {
-        //#ifdef BITCOIN_QT_BITCOINGUI_H
-        //Notify_MiningIsEnabled ( false );
-        //#endif
-        //g_bNotifyIsMiningEnabled = false;
         LogPrintf("BinariumMiner -- runtime error: %s\n", e.what());
+        MinerTelemetry_ReleaseThreadSlot ( telemetry );
         return;
     }
 }
@@ -682,16 +794,14 @@ void GenerateBitcoins(bool fGenerate, int nThreads, const CChainParams& chainpar
     if (minerThreads != NULL)
     {
         minerThreads->interrupt_all();
+        // So that an old work producer can not publish after the new one.
+        minerThreads->join_all();
         delete minerThreads;
         minerThreads = NULL;
+        uiInterface.NotifyBlockTip.disconnect(&MinerNotifyBlockTip);
     }
 
-    THashRateCounter structureHashRateCounter;
-    structureHashRateCounter.fHashRate = 0.0f;
-
-    for (unsigned int i = 0; i < I_MAX_GENERATE_THREADS * 2; i++) {
-        aHashRateCounters[i].store(structureHashRateCounter);
-    }
+    MinerTelemetry_Reset();
 
     g_iPreviousAmountOfMiningThreads = g_iAmountOfMiningThreads;
     g_iAmountOfMiningThreads = fGenerate ? nThreads : 0;
@@ -699,7 +809,15 @@ void GenerateBitcoins(bool fGenerate, int nThreads, const CChainParams& chainpar
     if (nThreads == 0 || !fGenerate)
         return;
 
+    // Connected before the tip is read, so that no tip change is missed in between.
+    uiInterface.NotifyBlockTip.connect(&MinerNotifyBlockTip);
+    {
+        LOCK(cs_main);
+        MinerNotifyBlockTip(IsInitialBlockDownload(), chainActive.Tip());
+    }
+
     minerThreads = new boost::thread_group();
+    minerThreads->create_thread(boost::bind(&BinariumMinerWorkProducer, boost::cref(chainparams), boost::ref(connman)));
     for (int j = 0; j < nThreads; j++) {
         minerThreads->create_thread(boost::bind(&BitcoinMiner, boost::cref(chainparams), boost::ref(connman), j));
     }
@@ -718,14 +836,7 @@ std::string HelpExampleRpc2(const std::string& methodname, const std::string& ar
 
 UniValue GetClientHashesPerSecond ()
 {
-    THashRateCounter structureHashRateCounter;
-    float fHashRateSum = 0.0f;
-    for (int i = 0; i < g_iAmountOfMiningThreads; i++) {
-        structureHashRateCounter = aHashRateCounters[i].load();
-        fHashRateSum = fHashRateSum + structureHashRateCounter.fHashRate;
-    }
-
-    return fHashRateSum + Wallet_PoolMiner_GetHashesRate ();
+    return MinerTelemetry_GetHashRate () + Wallet_PoolMiner_GetHashesRate ();
 }
 
 UniValue get_client_hashes_per_second(const UniValue& params, bool fHelp)
@@ -742,7 +853,6 @@ UniValue get_client_hashes_per_second(const UniValue& params, bool fHelp)
             + HelpExampleRpc2("get_client_hashes_per_second", "")
         );
 
-    LOCK(cs_main);
     return GetClientHashesPerSecond ();
 }
 
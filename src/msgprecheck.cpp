@@ -0,0 +1,190 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "msgprecheck.h"
+
+#include "messagesigner.h"
+#include "protocol.h"
+#include "util.h"
+
+#include <future>
+
+#include <boost/thread.hpp>
+
+CMessagePrecheckQueue messagePrecheckQueue;
+
+struct CMessagePrecheckQueue::CSignatureBatch
+{
+    std::vector<CHashSignatureCheck> vChecks;
+    // not std::vector<bool>, threads write next to each other
+    std::vector<char> vResults;
+    std::atomic<size_t> nRemaining;
+    SignatureBatchCallback callback;
+
+    CSignatureBatch(std::vector<CHashSignatureCheck>&& vChecksIn, const SignatureBatchCallback& callbackIn) :
+        vChecks(std::move(vChecksIn)), vResults(vChecks.size(), 0), nRemaining(vChecks.size()), callback(callbackIn) {}
+};
+
+void CMessagePrecheckQueue::VerifyBatchItem(CPrecheckItem& item)
+{
+    CSignatureBatch& batch = *item.batch;
+    const CHashSignatureCheck& check = batch.vChecks[item.nBatchPos];
+    std::string strError;
+    batch.vResults[item.nBatchPos] = CHashSigner::VerifyHash(check.hash, check.pubkey, check.vchSig, strError);
+    if (--batch.nRemaining == 0)
+        batch.callback(std::vector<bool>(batch.vResults.begin(), batch.vResults.end()));
+}
+
+CMessagePrecheckQueue::CMessagePrecheckQueue() :
+    nThreads(0),
+    nChecked(0),
+    nFailed(0),
+    nDropped(0)
+{}
+
+void CMessagePrecheckQueue::Register(const std::string& strCommand, const NetMessagePrecheck& precheck)
+{
+    int nIndex = getNetMessageTypeIndex(strCommand);
+    assert(nIndex >= 0);
+    if (vecPrechecks.empty())
+        vecPrechecks.resize(getAllNetMessageTypes().size());
+    vecPrechecks[nIndex] = precheck;
+}
+
+void CMessagePrecheckQueue::UnregisterAll()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    // batches stay queued, their callers wait for them
+    queue.remove_if([](const CPrecheckItem& item) { return !item.batch; });
+    vecPrechecks.clear();
+}
+
+void CMessagePrecheckQueue::Push(const std::string& strCommand, const CDataStream& vRecv, int nVersion)
+{
+    if (nThreads == 0)
+        return;
+
+    int nIndex = getNetMessageTypeIndex(strCommand);
+    if (nIndex < 0 || (size_t)nIndex >= vecPrechecks.size() || !vecPrechecks[nIndex])
+        return;
+
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (queue.size() >= MAX_MSGCHECK_QUEUE) {
+            nDropped++;
+            return;
+        }
+        queue.emplace_back(nIndex, vRecv);
+        queue.back().vRecv.SetVersion(nVersion);
+    }
+    condWorker.notify_one();
+}
+
+void CMessagePrecheckQueue::VerifyBatch(std::vector<CHashSignatureCheck>&& vChecks, const SignatureBatchCallback& callback)
+{
+    if (vChecks.empty()) {
+        callback(std::vector<bool>());
+        return;
+    }
+
+    std::shared_ptr<CSignatureBatch> batch = std::make_shared<CSignatureBatch>(std::move(vChecks), callback);
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (nThreads > 0) {
+            // callers wait for these, so they are not subject to MAX_MSGCHECK_QUEUE
+            for (size_t i = 0; i < batch->vChecks.size(); i++)
+                queue.emplace_back(batch, i);
+            condWorker.notify_all();
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < batch->vChecks.size(); i++) {
+        CPrecheckItem item(batch, i);
+        VerifyBatchItem(item);
+    }
+}
+
+std::vector<bool> CMessagePrecheckQueue::VerifyBatchWait(std::vector<CHashSignatureCheck>&& vChecks)
+{
+    std::promise<std::vector<bool> > promise;
+    std::future<std::vector<bool> > future = promise.get_future();
+    VerifyBatch(std::move(vChecks), [&promise](const std::vector<bool>& vResults) { promise.set_value(vResults); });
+    return future.get();
+}
+
+void CMessagePrecheckQueue::Thread()
+{
+    nThreads++;
+
+    try {
+        while (true) {
+            boost::this_thread::interruption_point();
+
+            std::list<CPrecheckItem> items;
+            std::vector<NetMessagePrecheck> vItemPrechecks;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (queue.empty())
+                    condWorker.wait(lock);
+                std::list<CPrecheckItem>::iterator itEnd = queue.begin();
+                while (itEnd != queue.end() && vItemPrechecks.size() < MAX_MSGCHECK_BATCH) {
+                    if (!itEnd->batch && (size_t)itEnd->nIndex < vecPrechecks.size())
+                        vItemPrechecks.push_back(vecPrechecks[itEnd->nIndex]);
+                    else
+                        vItemPrechecks.push_back(NetMessagePrecheck());
+                    ++itEnd;
+                }
+                items.splice(items.begin(), queue, queue.begin(), itEnd);
+            }
+
+            size_t nItem = 0;
+            for (CPrecheckItem& item : items) {
+                const NetMessagePrecheck& precheck = vItemPrechecks[nItem++];
+                if (item.batch) {
+                    VerifyBatchItem(item);
+                    continue;
+                }
+                if (!precheck)
+                    continue;
+
+                bool fOk = false;
+                try {
+                    fOk = precheck(item.vRecv);
+                } catch (const std::exception&) {
+                    // malformed, the message handler will tell
+                }
+                if (fOk)
+                    nChecked++;
+                else
+                    nFailed++;
+            }
+        }
+    } catch (const boost::thread_interrupted&) {
+        // the last thread to go finishes the batches that callers may be waiting for
+        std::list<CPrecheckItem> items;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (--nThreads == 0)
+                items.swap(queue);
+        }
+        for (CPrecheckItem& item : items) {
+            if (item.batch)
+                VerifyBatchItem(item);
+        }
+        throw;
+    }
+}
+
+size_t CMessagePrecheckQueue::size()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return queue.size();
+}
+
+void ThreadMessagePrecheck()
+{
+    RenameThread("binarium-msgchk");
+    messagePrecheckQueue.Thread();
+}
@@ -0,0 +1,123 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_MSGPRECHECK_H
+#define BITCOIN_MSGPRECHECK_H
+
+#include "pubkey.h"
+#include "streams.h"
+#include "uint256.h"
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+/** Maximum number of message precheck threads */
+static const int MAX_MSGCHECK_THREADS = 16;
+/** -parmsgcheck default (0 = auto) */
+static const int DEFAULT_MSGCHECK_THREADS = 0;
+/** Received messages waiting for a precheck thread, later ones are left to the message handler alone */
+static const size_t MAX_MSGCHECK_QUEUE = 20000;
+/** Queued messages and signatures a precheck thread takes at once */
+static const size_t MAX_MSGCHECK_BATCH = 64;
+
+/** Decode a received message and precheck its signatures, returns false if one could not be recovered */
+typedef std::function<bool(CDataStream& vRecv)> NetMessagePrecheck;
+
+/** A signature over a hash by a known key, see CMessagePrecheckQueue::VerifyBatch */
+struct CHashSignatureCheck
+{
+    uint256 hash;
+    CPubKey pubkey;
+    std::vector<unsigned char> vchSig;
+
+    CHashSignatureCheck() {}
+    CHashSignatureCheck(const uint256& hashIn, const CPubKey& pubkeyIn, const std::vector<unsigned char>& vchSigIn) :
+        hash(hashIn), pubkey(pubkeyIn), vchSig(vchSigIn) {}
+};
+
+/** Receives the result of every check of a batch, in the order they were passed */
+typedef std::function<void(const std::vector<bool>& vResults)> SignatureBatchCallback;
+
+/**
+ * Stage in front of the message handler thread for masternode broadcasts and pings, payment votes,
+ * governance votes and InstantSend lock votes. The socket thread queues a copy of every such message
+ * as soon as it is complete, and worker threads recover the keys that signed it while the message
+ * waits for its turn (CMessageSigner::PrecheckMessage). When the message handler gets to it, the
+ * signature checks of the single threaded apply phase only compare keys.
+ *
+ * Nothing is decided here: a message whose precheck failed, was dropped or did not run yet is
+ * processed exactly as without this stage.
+ *
+ * The same threads verify batches of signatures for code that checks many at once (VerifyBatch).
+ * Threads take up to MAX_MSGCHECK_BATCH queued items per wakeup.
+ */
+class CMessagePrecheckQueue
+{
+private:
+    struct CSignatureBatch;
+
+    /** Either a received message or one signature of a batch */
+    struct CPrecheckItem {
+        int nIndex;
+        CDataStream vRecv;
+        std::shared_ptr<CSignatureBatch> batch;
+        size_t nBatchPos;
+
+        CPrecheckItem(int nIndexIn, const CDataStream& vRecvIn) : nIndex(nIndexIn), vRecv(vRecvIn), nBatchPos(0) {}
+        CPrecheckItem(const std::shared_ptr<CSignatureBatch>& batchIn, size_t nBatchPosIn) :
+            nIndex(-1), vRecv(SER_NETWORK, 0), batch(batchIn), nBatchPos(nBatchPosIn) {}
+    };
+
+    static void VerifyBatchItem(CPrecheckItem& item);
+
+    boost::mutex mutex;
+    boost::condition_variable condWorker;
+    std::list<CPrecheckItem> queue;
+    // by getNetMessageTypeIndex(), registered before the network starts
+    std::vector<NetMessagePrecheck> vecPrechecks;
+    std::atomic<int> nThreads;
+
+public:
+    std::atomic<uint64_t> nChecked;
+    std::atomic<uint64_t> nFailed;
+    std::atomic<uint64_t> nDropped;
+
+    CMessagePrecheckQueue();
+
+    /** Run precheck for the messages of type strCommand, which must be one of getAllNetMessageTypes() */
+    void Register(const std::string& strCommand, const NetMessagePrecheck& precheck);
+    void UnregisterAll();
+
+    /** Queue a copy of a received message, if there is a precheck for strCommand and a thread to run it */
+    void Push(const std::string& strCommand, const CDataStream& vRecv, int nVersion);
+
+    /**
+     * Verify signatures on the precheck threads, with the checks of other callers and received
+     * messages. Valid signatures are remembered (CHashSigner::VerifyHash), and callback is called
+     * from the thread that finished the last check, or before returning if there are no threads.
+     */
+    void VerifyBatch(std::vector<CHashSignatureCheck>&& vChecks, const SignatureBatchCallback& callback);
+    /** VerifyBatch and wait for the results */
+    std::vector<bool> VerifyBatchWait(std::vector<CHashSignatureCheck>&& vChecks);
+
+    /** Worker loop, returns only by boost::thread_interrupted */
+    void Thread();
+
+    size_t size();
+    int GetThreadCount() const { return nThreads; }
+};
+
+extern CMessagePrecheckQueue messagePrecheckQueue;
+
+/** Run a precheck worker */
+void ThreadMessagePrecheck();
+
+#endif // BITCOIN_MSGPRECHECK_H
@@ -16,9 +16,11 @@
 #include "consensus/consensus.h"
 #include "crypto/common.h"
 #include "hash.h"
+#include "msgprecheck.h"
 #include "primitives/transaction.h"
 #include "netbase.h"
 #include "scheduler.h"
+#include "socketevents.h"
 #include "ui_interface.h"
 #include "utilstrencodings.h"
 
@@ -31,6 +33,7 @@
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
 #endif
 
 #ifdef USE_UPNP
@@ -43,6 +46,12 @@
 
 #include <math.h>
 
+// Queued send buffers passed to one sendmsg() call, well below IOV_MAX everywhere
+static const size_t MAX_SEND_BUFFERS_PER_CALL = 64;
+
+// The socket thread looks at every node for disconnects and timeouts at most this often
+static const int64_t SOCKET_SWEEP_INTERVAL_MILLIS = 100;
+
 // Dump addresses to peers.dat and banlist.dat every 15 minutes (900s)
 #define DUMP_ADDRESSES_INTERVAL 900
 
@@ -64,7 +73,7 @@
 #endif
 #endif
 
-const static std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
+const std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
 constexpr const CConnman::CFullyConnectedOnly CConnman::FullyConnectedOnly;
 constexpr const CConnman::CAllNodes CConnman::AllNodes;
@@ -81,7 +90,7 @@ static bool vfLimited[NET_MAX] = {};
 static CNode* pnodeLocalHost = NULL;
 std::string strSubVersion;
 
-std::map<CInv, CDataStream> mapRelay;
+std::map<CInv, CSerializedNetMsg> mapRelay;
 std::deque<pair<int64_t, CInv> > vRelayExpiration;
 CCriticalSection cs_mapRelay;
 limitedmap<uint256, int64_t> mapAlreadyAskedFor(MAX_INV_SZ);
@@ -391,7 +400,7 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
-        if (!IsSelectableSocket(hSocket)) {
+        if (!IsWatchableSocket(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return NULL;
@@ -436,8 +445,11 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
         }
 
         GetNodeSignals().InitializeNode(pnode, *this);
-        LOCK(cs_vNodes);
-        vNodes.push_back(pnode);
+        {
+            LOCK(cs_vNodes);
+            vNodes.push_back(pnode);
+        }
+        SocketEventsChanged(pnode);
 
         return pnode;
     } else if (!proxyConnectionFailed) {
@@ -663,6 +675,7 @@ void CNode::copyStats(CNodeStats &stats)
     X(mapSendBytesPerMsgCmd);
     X(nRecvBytes);
     X(mapRecvBytesPerMsgCmd);
+    X(mapProcessTimePerMsgCmd);
     X(fWhitelisted);
 
     // It is common for nodes with good ping times to suddenly become lagged,
@@ -686,6 +699,16 @@ void CNode::copyStats(CNodeStats &stats)
 }
 #undef X
 
+void CNode::AddProcessTimePerMsgCmd(const std::string& strCommand, int64_t nTimeMicros)
+{
+    // only valid commands have their own entry, like in mapRecvBytesPerMsgCmd
+    mapMsgCmdSize::iterator i = mapProcessTimePerMsgCmd.find(strCommand);
+    if (i == mapProcessTimePerMsgCmd.end())
+        i = mapProcessTimePerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
+    assert(i != mapProcessTimePerMsgCmd.end());
+    i->second += nTimeMicros;
+}
+
 bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete)
 {
     complete = false;
@@ -822,25 +845,53 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
 // requires LOCK(cs_vSend)
 size_t CConnman::SocketSendData(CNode *pnode)
 {
-    std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
+    std::deque<CSerializeDataRef>::iterator it = pnode->vSendMsg.begin();
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const CSerializeData &data = *it;
-        assert(data.size() > pnode->nSendOffset);
-        int nBytes = send(pnode->hSocket, &data[pnode->nSendOffset], data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+        assert((*it)->size() > pnode->nSendOffset);
+#ifdef WIN32
+        size_t nGathered = (*it)->size() - pnode->nSendOffset;
+        int nBytes = send(pnode->hSocket, &(**it)[pnode->nSendOffset], nGathered, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+        // hand as many queued buffers to the kernel as one call takes
+        struct iovec vIov[MAX_SEND_BUFFERS_PER_CALL];
+        size_t nIov = 0;
+        size_t nGathered = 0;
+        size_t nOffset = pnode->nSendOffset;
+        for (auto itIov = it; itIov != pnode->vSendMsg.end() && nIov < MAX_SEND_BUFFERS_PER_CALL; ++itIov, ++nIov) {
+            const CSerializeData& data = **itIov;
+            vIov[nIov].iov_base = (void*)(data.data() + nOffset);
+            vIov[nIov].iov_len = data.size() - nOffset;
+            nGathered += vIov[nIov].iov_len;
+            nOffset = 0;
+        }
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = vIov;
+        msg.msg_iovlen = nIov;
+        ssize_t nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            // drop the buffers that went out completely
+            size_t nRemaining = nBytes;
+            while (nRemaining > 0) {
+                const CSerializeData& data = **it;
+                if (nRemaining < data.size() - pnode->nSendOffset) {
+                    pnode->nSendOffset += nRemaining;
+                    break;
+                }
+                nRemaining -= data.size() - pnode->nSendOffset;
                 pnode->nSendOffset = 0;
                 pnode->nSendSize -= data.size();
                 pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            if ((size_t)nBytes < nGathered) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -1066,7 +1117,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (!IsWatchableSocket(hSocket))
     {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1116,18 +1167,142 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
+    SocketEventsChanged(pnode);
+}
+
+void CConnman::SocketEventsChanged(CNode* pnode)
+{
+    if (pnode->fSocketEventsChanged.exchange(true))
+        return;
+    pnode->AddRef();
+    LOCK(cs_vNodesSocketEventsChanged);
+    vNodesSocketEventsChanged.push_back(pnode);
 }
 
 void CConnman::ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+
+    std::unique_ptr<CSocketEvents> socketEvents = CreateSocketEvents(GetSocketEventsMode());
+    if (!socketEvents) {
+        LogPrintf("ThreadSocketHandler -- socket events mode %s is not available, using select\n", GetSocketEventsModeName(GetSocketEventsMode()));
+        socketEvents = CreateSocketEvents(SOCKETEVENTS_SELECT);
+    }
+    LogPrint("net", "ThreadSocketHandler -- waiting for socket events with %s\n", socketEvents->GetName());
+
+    BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
+        if (!socketEvents->Add(hListenSocket.socket, CSocketEvents::EVENT_RECV))
+            LogPrintf("ThreadSocketHandler -- cannot watch listening socket: %s\n", NetworkErrorString(WSAGetLastError()));
+    }
+
+    // sockets of the nodes as they are registered in socketEvents, each holding a reference to its node
+    std::map<SOCKET, std::pair<CNode*, unsigned int> > mapWatchedSockets;
+    CSocketEvents::events_vec_t vSocketEvents;
+    std::map<SOCKET, unsigned int> mapSocketEvents;
+    std::vector<CNode*> vNodesChanged, vNodesReady;
+    int64_t nLastSweep = 0;
+
+    // Tells the backend about the events the node waits for now, a socket number which was closed
+    // and reused by another node is registered again.
+    auto watchNode = [&](CNode* pnode) {
+        SOCKET hSocket = pnode->hSocket;
+        if (hSocket == INVALID_SOCKET || pnode->fDisconnect)
+            return;
+
+        // Implement the following logic:
+        // * If there is data to send, wait for sending data. As this only
+        //   happens when optimistic write failed, we choose to first drain the
+        //   write buffer in this case before receiving more. This avoids
+        //   needlessly queueing received data, if the remote peer is not themselves
+        //   receiving data. This means properly utilizing TCP flow control signalling.
+        // * Otherwise, if there is space left in the receive buffer, wait for
+        //   receiving data.
+        // * Hand off all complete messages to the processor, to be handled without
+        //   blocking here.
+        unsigned int nEvents = 0;
+        bool fSendUnknown = false;
+        {
+            TRY_LOCK(pnode->cs_vSend, lockSend);
+            if (!lockSend)
+                fSendUnknown = true;
+            else if (!pnode->vSendMsg.empty())
+                nEvents = CSocketEvents::EVENT_SEND;
+        }
+        if (!nEvents && !pnode->fPauseRecv)
+            nEvents = CSocketEvents::EVENT_RECV;
+
+        auto it = mapWatchedSockets.find(hSocket);
+        if (fSendUnknown) {
+            // the send queue is busy, look at the node again on the next pass and keep what
+            // is registered until then, which may be waiting for sending
+            SocketEventsChanged(pnode);
+            if (it != mapWatchedSockets.end() && it->second.first == pnode)
+                return;
+        }
+        if (it != mapWatchedSockets.end() && it->second.first == pnode) {
+            if (it->second.second != nEvents) {
+                if (!socketEvents->Modify(hSocket, nEvents)) {
+                    LogPrintf("socket %s registration error %s\n", socketEvents->GetName(), NetworkErrorString(WSAGetLastError()));
+                    pnode->fDisconnect = true;
+                    return;
+                }
+                it->second.second = nEvents;
+            }
+            return;
+        }
+        if (it != mapWatchedSockets.end()) {
+            socketEvents->Remove(hSocket);
+            it->second.first->Release();
+            mapWatchedSockets.erase(it);
+        }
+        if (!socketEvents->Add(hSocket, nEvents)) {
+            LogPrintf("socket %s registration error %s\n", socketEvents->GetName(), NetworkErrorString(WSAGetLastError()));
+            pnode->fDisconnect = true;
+            return;
+        }
+        pnode->AddRef();
+        mapWatchedSockets[hSocket] = std::make_pair(pnode, nEvents);
+    };
+
     while (!interruptNet)
     {
         //
-        // Disconnect nodes
+        // Disconnect nodes and check for inactivity, which needs a look at every node, so it is
+        // done every SOCKET_SWEEP_INTERVAL_MILLIS instead of on every socket event
         //
+        int64_t nTimeMillis = GetTimeMillis();
+        if (nTimeMillis - nLastSweep >= SOCKET_SWEEP_INTERVAL_MILLIS || nTimeMillis < nLastSweep)
         {
+            nLastSweep = nTimeMillis;
+            int64_t nTime = GetSystemTimeInSeconds();
+
             LOCK(cs_vNodes);
+            BOOST_FOREACH(CNode* pnode, vNodes)
+            {
+                if (pnode->fDisconnect || nTime - pnode->nTimeConnected <= 60)
+                    continue;
+                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
+                {
+                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+                    pnode->fDisconnect = true;
+                }
+                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
+                {
+                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+                    pnode->fDisconnect = true;
+                }
+                else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
+                {
+                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+                    pnode->fDisconnect = true;
+                }
+                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+                {
+                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+                    pnode->fDisconnect = true;
+                }
+            }
+
             // Disconnect unused nodes
             std::vector<CNode*> vNodesCopy = vNodes;
             BOOST_FOREACH(CNode* pnode, vNodesCopy)
@@ -1140,6 +1315,16 @@ void CConnman::ThreadSocketHandler()
                     // remove from vNodes
                     vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
 
+                    // stop watching its socket, which may have been closed already
+                    for (auto it = mapWatchedSockets.begin(); it != mapWatchedSockets.end(); ++it) {
+                        if (it->second.first == pnode) {
+                            socketEvents->Remove(it->first);
+                            pnode->Release();
+                            mapWatchedSockets.erase(it);
+                            break;
+                        }
+                    }
+
                     // release outbound grant (if any)
                     pnode->grantOutbound.Release();
                     pnode->grantMasternodeOutbound.Release();
@@ -1194,109 +1379,82 @@ void CConnman::ThreadSocketHandler()
         }
 
         //
-        // Find which sockets have data to receive
+        // Register the events of new nodes and of the nodes other threads queued data for
+        // or resumed receiving of, the others are looked at again when they are serviced
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
+        const int64_t nTimeoutMillis = 50; // frequency to look at the changed nodes
 
-        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
+        {
+            LOCK(cs_vNodesSocketEventsChanged);
+            vNodesChanged.swap(vNodesSocketEventsChanged);
         }
-
+        BOOST_FOREACH(CNode* pnode, vNodesChanged)
         {
-            LOCK(cs_vNodes);
-            BOOST_FOREACH(CNode* pnode, vNodes)
-            {
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is space left in the receive buffer, select() for
-                //   receiving data.
-                // * Hand off all complete messages to the processor, to be handled without
-                //   blocking here.
-                {
-                    TRY_LOCK(pnode->cs_vSend, lockSend);
-                    if (lockSend) {
-                        if (!pnode->vSendMsg.empty()) {
-                            FD_SET(pnode->hSocket, &fdsetSend);
-                            continue;
-                        }
-                    }
-                }
-                {
-                    if (!pnode->fPauseRecv)
-                        FD_SET(pnode->hSocket, &fdsetRecv);
-                }
-            }
+            // a change after this look queues the node again
+            pnode->fSocketEventsChanged = false;
+            watchNode(pnode);
+            pnode->Release();
         }
+        vNodesChanged.clear();
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
-        if (interruptNet)
-            return;
-
-        if (nSelect == SOCKET_ERROR)
+        if (!socketEvents->Wait(nTimeoutMillis, vSocketEvents))
         {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(boost::chrono::milliseconds(timeout.tv_usec/1000)))
+            int nErr = WSAGetLastError();
+            LogPrintf("socket %s error %s\n", socketEvents->GetName(), NetworkErrorString(nErr));
+            // let recv() find the broken sockets
+            vSocketEvents.clear();
+            for (const auto& socketpair : mapWatchedSockets)
+                vSocketEvents.push_back(std::make_pair(socketpair.first, (unsigned int)CSocketEvents::EVENT_RECV));
+            for (const ListenSocket& hListenSocket : vhListenSocket)
+                vSocketEvents.push_back(std::make_pair(hListenSocket.socket, (unsigned int)CSocketEvents::EVENT_RECV));
+            if (!interruptNet.sleep_for(boost::chrono::milliseconds(nTimeoutMillis)))
                 return;
         }
+        if (interruptNet)
+            return;
+
+        mapSocketEvents.clear();
+        for (const auto& eventpair : vSocketEvents)
+            mapSocketEvents[eventpair.first] |= eventpair.second;
 
         //
         // Accept new connections
         //
         BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (hListenSocket.socket != INVALID_SOCKET && mapSocketEvents.count(hListenSocket.socket))
             {
                 AcceptConnection(hListenSocket);
             }
         }
 
         //
-        // Service each socket
+        // Service the nodes with socket events, the others are not visited
         //
-        std::vector<CNode*> vNodesCopy = CopyNodeVector();
-        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+        for (const auto& eventpair : mapSocketEvents) {
+            auto it = mapWatchedSockets.find(eventpair.first);
+            if (it == mapWatchedSockets.end())
+                continue;
+            it->second.first->AddRef();
+            vNodesReady.push_back(it->second.first);
+        }
+        BOOST_FOREACH(CNode* pnode, vNodesReady)
         {
             if (interruptNet)
-                return;
+                break;
+
+            // the node may have closed the socket, whose number may belong to another node by now
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+            auto itEvents = mapSocketEvents.find(pnode->hSocket);
+            if (itEvents == mapSocketEvents.end())
+                continue;
+            unsigned int nEvents = itEvents->second;
 
             //
             // Receive
             //
-            if (pnode->hSocket == INVALID_SOCKET)
-                continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError))
+            if (nEvents & (CSocketEvents::EVENT_RECV | CSocketEvents::EVENT_ERROR))
             {
                 {
                     {
@@ -1316,6 +1474,8 @@ void CConnman::ThreadSocketHandler()
                                     if (!it->complete())
                                         break;
                                     nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+                                    // let the signatures be checked while the message waits in vProcessMsg
+                                    messagePrecheckQueue.Push(it->hdr.GetCommand(), it->vRecv, pnode->GetRecvVersion());
                                 }
                                 {
                                     LOCK(pnode->cs_vProcessMsg);
@@ -1353,7 +1513,7 @@ void CConnman::ThreadSocketHandler()
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetSend))
+            if (nEvents & CSocketEvents::EVENT_SEND)
             {
                 TRY_LOCK(pnode->cs_vSend, lockSend);
                 if (lockSend) {
@@ -1364,35 +1524,12 @@ void CConnman::ThreadSocketHandler()
                 }
             }
 
-            //
-            // Inactivity checking
-            //
-            int64_t nTime = GetSystemTimeInSeconds();
-            if (nTime - pnode->nTimeConnected > 60)
-            {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
-                {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
-                {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                }
-                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
-                {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
-            }
+            // receiving may have been paused, or the send queue drained
+            watchNode(pnode);
         }
-        ReleaseNodeVector(vNodesCopy);
+        BOOST_FOREACH(CNode* pnode, vNodesReady)
+            pnode->Release();
+        vNodesReady.clear();
     }
 }
 
@@ -2027,7 +2164,7 @@ bool CConnman::BindListenPort(const CService &addrBind, std::string& strError, b
         LogPrintf("%s\n", strError);
         return false;
     }
-    if (!IsSelectableSocket(hListenSocket))
+    if (!IsWatchableSocket(hListenSocket))
     {
         strError = "Error: Couldn't create a listenable socket for incoming connections";
         LogPrintf("%s\n", strError);
@@ -2393,6 +2530,10 @@ void CConnman::Stop()
     }
     vNodes.clear();
     vNodesDisconnected.clear();
+    {
+        LOCK(cs_vNodesSocketEventsChanged);
+        vNodesSocketEventsChanged.clear();
+    }
     vhListenSocket.clear();
     delete semOutbound;
     semOutbound = NULL;
@@ -2544,6 +2685,10 @@ void CConnman::RelayTransaction(const CTransaction& tx, const CDataStream& ss)
     int nInv = static_cast<bool>(CPrivateSend::GetDSTX(hash)) ? MSG_DSTX :
                 (instantsend.HasTxLockRequest(hash) ? MSG_TXLOCK_REQUEST : MSG_TX);
     CInv inv(nInv, hash);
+    // Save original serialized message so newer versions are preserved, every peer that
+    // asks for it is sent the same buffers
+    CDataStream payload(ss);
+    CSerializedNetMsg msg = MakeMessageFromPayload(inv.GetCommand(), payload);
     {
         LOCK(cs_mapRelay);
         // Expire old relay messages
@@ -2553,8 +2698,7 @@ void CConnman::RelayTransaction(const CTransaction& tx, const CDataStream& ss)
             vRelayExpiration.pop_front();
         }
 
-        // Save original serialized message so newer versions are preserved
-        mapRelay.insert(std::make_pair(inv, ss));
+        mapRelay.insert(std::make_pair(inv, msg));
         vRelayExpiration.push_back(std::make_pair(GetTime() + 15 * 60, inv));
     }
     LOCK(cs_vNodes);
@@ -2763,14 +2907,18 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nLocalServices = nLocalServicesIn;
     fPauseRecv = false;
     fPauseSend = false;
+    fSocketEventsChanged = false;
     nProcessQueueSize = 0;
 
     GetRandBytes((unsigned char*)&nLocalHostNonce, sizeof(nLocalHostNonce));
     nMyStartingHeight = nMyStartingHeightIn;
 
-    BOOST_FOREACH(const std::string &msg, getAllNetMessageTypes())
+    BOOST_FOREACH(const std::string &msg, getAllNetMessageTypes()) {
         mapRecvBytesPerMsgCmd[msg] = 0;
+        mapProcessTimePerMsgCmd[msg] = 0;
+    }
     mapRecvBytesPerMsgCmd[NET_MESSAGE_COMMAND_OTHER] = 0;
+    mapProcessTimePerMsgCmd[NET_MESSAGE_COMMAND_OTHER] = 0;
 
     if(fNetworkNode || fInbound)
         AddRef();
@@ -2861,53 +3009,69 @@ std::vector<unsigned char> CNode::CalculateKeyedNetGroup(CAddress& address)
     return vch;
 }
 
-CDataStream CConnman::BeginMessage(CNode* pnode, int nVersion, int flags, const std::string& sCommand)
+int CConnman::GetSendVersion(CNode* pnode, int nVersion) const
 {
-    return {SER_NETWORK, (nVersion ? nVersion : pnode->GetSendVersion()) | flags, CMessageHeader(Params().MessageStart(), sCommand.c_str(), 0) };
+    return nVersion ? nVersion : pnode->GetSendVersion();
 }
 
-void CConnman::EndMessage(CDataStream& strm)
+CSerializedNetMsg CConnman::MakeMessageFromPayload(const std::string& sCommand, CDataStream& payload)
 {
-    // Set the size
-    assert(strm.size () >= CMessageHeader::HEADER_SIZE);
-    unsigned int nSize = strm.size() - CMessageHeader::HEADER_SIZE;
-    WriteLE32((uint8_t*)&strm[CMessageHeader::MESSAGE_SIZE_OFFSET], nSize);
-    // Set the checksum
-    uint256 hash = Hash(strm.begin() + CMessageHeader::HEADER_SIZE, strm.end());
-    memcpy((char*)&strm[CMessageHeader::CHECKSUM_OFFSET], hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CSerializedNetMsg msg;
+    msg.command = sCommand;
+
+    std::shared_ptr<CSerializeData> pPayload = std::make_shared<CSerializeData>();
+    payload.GetAndClear(*pPayload);
+
+    CMessageHeader hdr(Params().MessageStart(), sCommand.c_str(), pPayload->size());
+    uint256 hash = Hash(pPayload->begin(), pPayload->end());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
+    CDataStream header(SER_NETWORK, PROTOCOL_VERSION);
+    header << hdr;
+    std::shared_ptr<CSerializeData> pHeader = std::make_shared<CSerializeData>();
+    header.GetAndClear(*pHeader);
+
+    msg.header = pHeader;
+    msg.payload = pPayload;
+    return msg;
 }
 
-void CConnman::PushMessage(CNode* pnode, CDataStream& strm, const std::string& sCommand)
+void CConnman::PushMessage(CNode* pnode, const CSerializedNetMsg& msg)
 {
-    if(strm.empty())
-        return;
-
-    unsigned int nSize = strm.size() - CMessageHeader::HEADER_SIZE;
-    LogPrint("net", "sending %s (%d bytes) peer=%d\n",  SanitizeString(sCommand.c_str()), nSize, pnode->id);
+    size_t nMessageSize = msg.size();
+    LogPrint("net", "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), msg.payload->size(), pnode->id);
 
     size_t nBytesSent = 0;
+    bool fSendQueued = false;
     {
         LOCK(pnode->cs_vSend);
         if(pnode->hSocket == INVALID_SOCKET) {
             return;
         }
         bool optimisticSend(pnode->vSendMsg.empty());
-        pnode->vSendMsg.emplace_back(strm.begin(), strm.end());
+        // only references are queued, the buffers may be queued for other peers as well
+        pnode->vSendMsg.push_back(msg.header);
+        if (!msg.payload->empty())
+            pnode->vSendMsg.push_back(msg.payload);
 
         //log total amount of bytes per command
-        pnode->mapSendBytesPerMsgCmd[sCommand] += strm.size();
-        pnode->nSendSize += strm.size();
+        pnode->mapSendBytesPerMsgCmd[msg.command] += nMessageSize;
+        pnode->nSendSize += nMessageSize;
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
 
         // If write queue empty, attempt "optimistic write"
-        if (optimisticSend == true)
+        if (optimisticSend == true) {
             nBytesSent = SocketSendData(pnode);
+            // the rest waits for the socket to become writable
+            fSendQueued = !pnode->vSendMsg.empty();
+        }
     }
     if (nBytesSent)
         RecordBytesSent(nBytesSent);
+    if (fSendQueued)
+        SocketEventsChanged(pnode);
 }
 
 bool CConnman::ForNode(const CService& addr, std::function<bool(const CNode* pnode)> cond, std::function<bool(CNode* pnode)> func)
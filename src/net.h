@@ -105,6 +105,23 @@ class CTransaction;
 class CNodeStats;
 class CClientUIInterface;
 
+/** Serialized data that is shared between the send queues of all the peers it was pushed to */
+typedef std::shared_ptr<const CSerializeData> CSerializeDataRef;
+
+/**
+ * A message as it goes out on the wire. Header and payload are serialized into separate
+ * buffers, which the send queues only reference, so a message that is made once can be
+ * pushed to any number of peers without being serialized or copied again.
+ */
+struct CSerializedNetMsg
+{
+    CSerializeDataRef header;
+    CSerializeDataRef payload;
+    std::string command;
+
+    size_t size() const { return header->size() + payload->size(); }
+};
+
 class CConnman
 {
 public:
@@ -174,13 +191,38 @@ public:
         return ForNode(id, FullyConnectedOnly, func);
     }
 
+    /** Serialize a message for peers with the given send version (and flags) */
+    template <typename... Args>
+    CSerializedNetMsg MakeMessage(int nVersion, const std::string& sCommand, Args&&... args)
+    {
+        CDataStream payload(SER_NETWORK, nVersion);
+        ::SerializeMany(payload, payload.nType, payload.nVersion, std::forward<Args>(args)...);
+        return MakeMessageFromPayload(sCommand, payload);
+    }
+
+    /** Wrap an already serialized payload into a message, payload is left empty */
+    CSerializedNetMsg MakeMessageFromPayload(const std::string& sCommand, CDataStream& payload);
+
+    void PushMessage(CNode* pnode, const CSerializedNetMsg& msg);
+
     template <typename... Args>
     void PushMessageWithVersionAndFlag(CNode* pnode, int nVersion, int flag, const std::string& sCommand, Args&&... args)
     {
-        auto msg(BeginMessage(pnode, nVersion, flag, sCommand));
-        ::SerializeMany(msg, msg.nType, msg.nVersion, std::forward<Args>(args)...);
-        EndMessage(msg);
-        PushMessage(pnode, msg, sCommand);
+        PushMessage(pnode, MakeMessage(GetSendVersion(pnode, nVersion) | flag, sCommand, std::forward<Args>(args)...));
+    }
+
+    /** Push the same message to every node that cond accepts, serialized once per send version */
+    template <typename Condition, typename... Args>
+    void PushMessageToNodes(const Condition& cond, const std::string& sCommand, const Args&... args)
+    {
+        std::map<int, CSerializedNetMsg> mapMsgByVersion;
+        ForEachNode(cond, [&](CNode* pnode) {
+            int nVersion = GetSendVersion(pnode, 0);
+            auto it = mapMsgByVersion.find(nVersion);
+            if (it == mapMsgByVersion.end())
+                it = mapMsgByVersion.emplace(nVersion, MakeMessage(nVersion, sCommand, args...)).first;
+            PushMessage(pnode, it->second);
+        });
     }
 
     template <typename... Args>
@@ -387,6 +429,9 @@ public:
 
 
     unsigned int GetReceiveFloodSize() const;
+
+    /** Have the socket thread look at the events a node waits for again, after its send queue filled up or its receiving resumed */
+    void SocketEventsChanged(CNode* pnode);
 private:
     struct ListenSocket {
         SOCKET socket;
@@ -419,6 +464,8 @@ private:
     NodeId GetNewNodeId();
 
     size_t SocketSendData(CNode *pnode);
+    //!nVersion if it is set, otherwise the version messages to pnode are serialized with
+    int GetSendVersion(CNode* pnode, int nVersion) const;
     //!check is the banlist has unwritten changes
     bool BannedSetIsDirty();
     //!set the "dirty" flag for the banlist
@@ -429,10 +476,6 @@ private:
     void DumpData();
     void DumpBanlist();
 
-    CDataStream BeginMessage(CNode* node, int nVersion, int flags, const std::string& sCommand);
-    void PushMessage(CNode* pnode, CDataStream& strm, const std::string& sCommand);
-    void EndMessage(CDataStream& strm);
-
     // Network stats
     void RecordBytesRecv(uint64_t bytes);
     void RecordBytesSent(uint64_t bytes);
@@ -490,6 +533,10 @@ private:
     std::atomic<int> nBestHeight;
     CClientUIInterface* clientInterface;
 
+    /** Nodes for the socket thread to look at again, each holding a reference, see SocketEventsChanged() */
+    std::vector<CNode*> vNodesSocketEventsChanged;
+    CCriticalSection cs_vNodesSocketEventsChanged;
+
     /** flag for waking the message processor. */
     bool fMsgProcWake;
 
@@ -573,7 +620,7 @@ extern bool fDiscover;
 extern bool fListen;
 extern bool fRelayTxes;
 
-extern std::map<CInv, CDataStream> mapRelay;
+extern std::map<CInv, CSerializedNetMsg> mapRelay;
 extern std::deque<std::pair<int64_t, CInv> > vRelayExpiration;
 extern CCriticalSection cs_mapRelay;
 extern limitedmap<uint256, int64_t> mapAlreadyAskedFor;
@@ -589,6 +636,8 @@ struct LocalServiceInfo {
 extern CCriticalSection cs_mapLocalHost;
 extern std::map<CNetAddr, LocalServiceInfo> mapLocalHost;
 typedef std::map<std::string, uint64_t> mapMsgCmdSize; //command, total bytes
+/** Key of the totals of all unknown commands in the per command maps */
+extern const std::string NET_MESSAGE_COMMAND_OTHER;
 
 class CNodeStats
 {
@@ -609,6 +658,7 @@ public:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     uint64_t nRecvBytes;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    mapMsgCmdSize mapProcessTimePerMsgCmd;
     bool fWhitelisted;
     double dPingTime;
     double dPingWait;
@@ -671,7 +721,8 @@ public:
     size_t nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<CSerializeData> vSendMsg;
+    // headers and payloads, in the order they go out
+    std::deque<CSerializeDataRef> vSendMsg;
     CCriticalSection cs_vSend;
 
     CCriticalSection cs_vProcessMsg;
@@ -721,10 +772,14 @@ public:
 
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // queued in CConnman::vNodesSocketEventsChanged
+    std::atomic_bool fSocketEventsChanged;
 protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    // microseconds the message handler spent on the messages of this node, by command
+    mapMsgCmdSize mapProcessTimePerMsgCmd;
 
 public:
     uint256 hashContinue;
@@ -896,6 +951,8 @@ public:
 
     void copyStats(CNodeStats &stats);
 
+    void AddProcessTimePerMsgCmd(const std::string& strCommand, int64_t nTimeMicros);
+
     ServiceFlags GetLocalServices() const
     {
         return nLocalServices;
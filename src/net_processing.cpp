@@ -14,6 +14,7 @@
 #include "init.h"
 #include "validation.h"
 #include "merkleblock.h"
+#include "msgprecheck.h"
 #include "net.h"
 #include "netbase.h"
 #include "policy/fees.h"
@@ -21,6 +22,7 @@
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "random.h"
+#include "relaycache.h"
 #include "tinyformat.h"
 #include "txmempool.h"
 #include "ui_interface.h"
@@ -107,6 +109,24 @@ namespace {
 
     /** Number of peers from which we're downloading blocks. */
     int nPeersWithValidatedDownloads = 0;
+
+    /** Handlers of the extension messages, indexed by getNetMessageTypeIndex(). */
+    std::vector<std::vector<NetMessageHandler> > vecNetMessageHandlers;
+
+    /** Totals of the received messages of one type. Written by the message handler thread only. */
+    struct CNetMessageCounters {
+        std::atomic<uint64_t> nCount{0};
+        std::atomic<uint64_t> nBytes{0};
+        std::atomic<int64_t> nTimeMicros{0};
+        std::atomic<int64_t> nMaxTimeMicros{0};
+    };
+
+    /** Indexed by getNetMessageTypeIndex(), the last one counts unknown types. */
+    std::vector<CNetMessageCounters>& GetNetMessageCounters()
+    {
+        static std::vector<CNetMessageCounters> vecNetMessageCounters(getAllNetMessageTypes().size() + 1);
+        return vecNetMessageCounters;
+    }
 } // anon namespace
 
 //////////////////////////////////////////////////////////////////////////////
@@ -482,12 +502,83 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
     return true;
 }
 
+static void RegisterExtensionMessageHandlers()
+{
+#ifdef ENABLE_WALLET
+    for (const char* pszCommand : {NetMsgType::DSQUEUE, NetMsgType::DSSTATUSUPDATE, NetMsgType::DSFINALTX, NetMsgType::DSCOMPLETE})
+        RegisterNetMessageHandler(pszCommand, [](CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+            privateSendClient.ProcessMessage(pfrom, strCommand, vRecv, connman);
+        });
+#endif // ENABLE_WALLET
+    for (const char* pszCommand : {NetMsgType::DSACCEPT, NetMsgType::DSQUEUE, NetMsgType::DSVIN, NetMsgType::DSSIGNFINALTX})
+        RegisterNetMessageHandler(pszCommand, [](CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+            privateSendServer.ProcessMessage(pfrom, strCommand, vRecv, connman);
+        });
+    for (const char* pszCommand : {NetMsgType::MNANNOUNCE, NetMsgType::MNPING, NetMsgType::DSEG, NetMsgType::MNVERIFY})
+        RegisterNetMessageHandler(pszCommand, [](CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+            mnodeman.ProcessMessage(pfrom, strCommand, vRecv, connman);
+        });
+    for (const char* pszCommand : {NetMsgType::MASTERNODEPAYMENTSYNC, NetMsgType::MASTERNODEPAYMENTVOTE})
+        RegisterNetMessageHandler(pszCommand, [](CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+            mnpayments.ProcessMessage(pfrom, strCommand, vRecv, connman);
+        });
+    RegisterNetMessageHandler(NetMsgType::TXLOCKVOTE, [](CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+        instantsend.ProcessMessage(pfrom, strCommand, vRecv, connman);
+    });
+    for (const char* pszCommand : {NetMsgType::SPORK, NetMsgType::GETSPORKS})
+        RegisterNetMessageHandler(pszCommand, [](CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+            sporkManager.ProcessSpork(pfrom, strCommand, vRecv, connman);
+        });
+    RegisterNetMessageHandler(NetMsgType::SYNCSTATUSCOUNT, [](CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+        masternodeSync.ProcessMessage(pfrom, strCommand, vRecv);
+    });
+    for (const char* pszCommand : {NetMsgType::MNGOVERNANCESYNC, NetMsgType::MNGOVERNANCEOBJECT, NetMsgType::MNGOVERNANCEOBJECTVOTE})
+        RegisterNetMessageHandler(pszCommand, [](CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+            governance.ProcessMessage(pfrom, strCommand, vRecv, connman);
+        });
+}
+
+// Deserialize as the handlers above do and recover the signers, see CMessagePrecheckQueue
+static void RegisterExtensionMessagePrechecks()
+{
+    messagePrecheckQueue.Register(NetMsgType::MNANNOUNCE, [](CDataStream& vRecv) {
+        CMasternodeBroadcast mnb;
+        vRecv >> mnb;
+        return mnb.PrecheckSignature();
+    });
+    messagePrecheckQueue.Register(NetMsgType::MNPING, [](CDataStream& vRecv) {
+        CMasternodePing mnp;
+        vRecv >> mnp;
+        return mnp.PrecheckSignature();
+    });
+    messagePrecheckQueue.Register(NetMsgType::MASTERNODEPAYMENTVOTE, [](CDataStream& vRecv) {
+        CMasternodePaymentVote vote;
+        vRecv >> vote;
+        return vote.PrecheckSignature();
+    });
+    messagePrecheckQueue.Register(NetMsgType::MNGOVERNANCEOBJECTVOTE, [](CDataStream& vRecv) {
+        CGovernanceVote vote;
+        vRecv >> vote;
+        return vote.PrecheckSignature();
+    });
+    messagePrecheckQueue.Register(NetMsgType::TXLOCKVOTE, [](CDataStream& vRecv) {
+        CTxLockVote vote;
+        vRecv >> vote;
+        return vote.PrecheckSignature();
+    });
+}
+
 void RegisterNodeSignals(CNodeSignals& nodeSignals)
 {
     nodeSignals.ProcessMessages.connect(&ProcessMessages);
     nodeSignals.SendMessages.connect(&SendMessages);
     nodeSignals.InitializeNode.connect(&InitializeNode);
     nodeSignals.FinalizeNode.connect(&FinalizeNode);
+
+    UnregisterNetMessageHandlers();
+    RegisterExtensionMessageHandlers();
+    messagePrecheckQueue.UnregisterAll();
+    RegisterExtensionMessagePrechecks();
 }
 
 void UnregisterNodeSignals(CNodeSignals& nodeSignals)
@@ -496,6 +587,40 @@ void UnregisterNodeSignals(CNodeSignals& nodeSignals)
     nodeSignals.SendMessages.disconnect(&SendMessages);
     nodeSignals.InitializeNode.disconnect(&InitializeNode);
     nodeSignals.FinalizeNode.disconnect(&FinalizeNode);
+
+    UnregisterNetMessageHandlers();
+    messagePrecheckQueue.UnregisterAll();
+}
+
+void RegisterNetMessageHandler(const std::string& strCommand, const NetMessageHandler& handler)
+{
+    int nIndex = getNetMessageTypeIndex(strCommand);
+    assert(nIndex >= 0);
+    if (vecNetMessageHandlers.empty())
+        vecNetMessageHandlers.resize(getAllNetMessageTypes().size());
+    vecNetMessageHandlers[nIndex].push_back(handler);
+}
+
+void UnregisterNetMessageHandlers()
+{
+    vecNetMessageHandlers.clear();
+}
+
+void GetNetMessageStats(std::vector<CNetMessageStats>& vecStatsRet)
+{
+    const std::vector<std::string>& allMessages = getAllNetMessageTypes();
+    std::vector<CNetMessageCounters>& vecCounters = GetNetMessageCounters();
+
+    vecStatsRet.clear();
+    for (size_t i = 0; i < vecCounters.size(); i++) {
+        CNetMessageStats stats;
+        stats.strCommand = i < allMessages.size() ? allMessages[i] : NET_MESSAGE_COMMAND_OTHER;
+        stats.nCount = vecCounters[i].nCount.load(std::memory_order_relaxed);
+        stats.nBytes = vecCounters[i].nBytes.load(std::memory_order_relaxed);
+        stats.nTimeMicros = vecCounters[i].nTimeMicros.load(std::memory_order_relaxed);
+        stats.nMaxTimeMicros = vecCounters[i].nMaxTimeMicros.load(std::memory_order_relaxed);
+        vecStatsRet.push_back(stats);
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -785,6 +910,34 @@ static void RelayAddress(const CAddress& addr, bool fReachable, CConnman& connma
     connman.ForEachNodeThen(std::move(sortfunc), std::move(pushfunc));
 }
 
+/** Push the cached wire form of inv for pfrom's send version, if there is one */
+static bool PushMessageFromRelayCache(CNode* pfrom, CConnman& connman, const CInv& inv)
+{
+    CSerializedNetMsg msg;
+    if (!relayMessageCache.Get(inv, pfrom->GetSendVersion(), msg))
+        return false;
+    connman.PushMessage(pfrom, msg);
+    return true;
+}
+
+/** Serialize and push an object, keeping the result for the next peer asking for inv */
+template<typename T>
+static void PushMessageAndCache(CNode* pfrom, CConnman& connman, const CInv& inv, const std::string& sCommand, const T& obj)
+{
+    int nSendVersion = pfrom->GetSendVersion();
+    CSerializedNetMsg msg = connman.MakeMessage(nSendVersion, sCommand, obj);
+    relayMessageCache.Put(inv, nSendVersion, msg);
+    connman.PushMessage(pfrom, msg);
+}
+
+/** Push an already serialized payload, keeping the message for the next peer asking for inv */
+static void PushPayloadAndCache(CNode* pfrom, CConnman& connman, const CInv& inv, const std::string& sCommand, CDataStream& payload)
+{
+    CSerializedNetMsg msg = connman.MakeMessageFromPayload(sCommand, payload);
+    relayMessageCache.Put(inv, pfrom->GetSendVersion(), msg);
+    connman.PushMessage(pfrom, msg);
+}
+
 void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParams, CConnman& connman, std::atomic<bool>& interruptMsgProc)
 {
     std::deque<CInv>::iterator it = pfrom->vRecvGetData.begin();
@@ -840,14 +993,29 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 // Pruned nodes may have deleted the block, so check whether
                 // it's available before trying to send.
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA)) {
-                    // Send block from disk
-                    CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second, consensusParams))
-                        assert(!"cannot load block from disk");
                     if (inv.type == MSG_BLOCK)
-                        connman.PushMessage(pfrom, NetMsgType::BLOCK, block);
+                    {
+                        // Send block from the relay cache, or as it is on disk: blocks are
+                        // serialized the same way on disk and on the network. With
+                        // -paranoidblockreads its proof of work is checked first.
+                        if (!PushMessageFromRelayCache(pfrom, connman, inv)) {
+                            CDataStream ssBlock(SER_NETWORK, pfrom->GetSendVersion());
+                            if (fParanoidBlockReads) {
+                                CBlock block;
+                                if (!ReadBlockFromDisk(block, (*mi).second, consensusParams))
+                                    assert(!"cannot load block from disk");
+                                ssBlock << block;
+                            } else if (!ReadRawBlockFromDisk(ssBlock, (*mi).second, Params().MessageStart())) {
+                                assert(!"cannot load block from disk");
+                            }
+                            PushPayloadAndCache(pfrom, connman, inv, NetMsgType::BLOCK, ssBlock);
+                        }
+                    }
                     else // MSG_FILTERED_BLOCK)
                     {
+                        CBlock block;
+                        if (!ReadBlockFromDisk(block, (*mi).second, consensusParams))
+                            assert(!"cannot load block from disk");
                         bool sendMerkleBlock = false;
                         CMerkleBlock merkleBlock;
                         {
@@ -891,17 +1059,17 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 // Send stream from relay memory
                 bool pushed = false;
                 {
-                    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+                    CSerializedNetMsg msg;
                     {
                         LOCK(cs_mapRelay);
-                        map<CInv, CDataStream>::iterator mi = mapRelay.find(inv);
+                        map<CInv, CSerializedNetMsg>::iterator mi = mapRelay.find(inv);
                         if (mi != mapRelay.end()) {
-                            ss += (*mi).second;
+                            msg = (*mi).second;
                             pushed = true;
                         }
                     }
                     if(pushed)
-                        connman.PushMessage(pfrom, inv.GetCommand(), ss);
+                        connman.PushMessage(pfrom, msg);
                 }
 
                 if (!pushed && inv.type == MSG_TX) {
@@ -978,20 +1146,16 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
 
                 if (!pushed && inv.type == MSG_MASTERNODE_ANNOUNCE) {
                     if(mnodeman.mapSeenMasternodeBroadcast.count(inv.hash)){
-                        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                        ss.reserve(1000);
-                        ss << mnodeman.mapSeenMasternodeBroadcast[inv.hash].second;
-                        connman.PushMessage(pfrom, NetMsgType::MNANNOUNCE, ss);
+                        if(!PushMessageFromRelayCache(pfrom, connman, inv))
+                            PushMessageAndCache(pfrom, connman, inv, NetMsgType::MNANNOUNCE, mnodeman.mapSeenMasternodeBroadcast[inv.hash].second);
                         pushed = true;
                     }
                 }
 
                 if (!pushed && inv.type == MSG_MASTERNODE_PING) {
                     if(mnodeman.mapSeenMasternodePing.count(inv.hash)) {
-                        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                        ss.reserve(1000);
-                        ss << mnodeman.mapSeenMasternodePing[inv.hash];
-                        connman.PushMessage(pfrom, NetMsgType::MNPING, ss);
+                        if(!PushMessageFromRelayCache(pfrom, connman, inv))
+                            PushMessageAndCache(pfrom, connman, inv, NetMsgType::MNPING, mnodeman.mapSeenMasternodePing[inv.hash]);
                         pushed = true;
                     }
                 }
@@ -1011,17 +1175,23 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                     LogPrint("net", "ProcessGetData -- MSG_GOVERNANCE_OBJECT: inv = %s\n", inv.ToString());
                     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                     bool topush = false;
+                    bool fCached = false;
                     {
                         if(governance.HaveObjectForHash(inv.hash)) {
-                            ss.reserve(1000);
-                            if(governance.SerializeObjectForHash(inv.hash, ss)) {
-                                topush = true;
+                            if(PushMessageFromRelayCache(pfrom, connman, inv)) {
+                                topush = fCached = true;
+                            } else {
+                                ss.reserve(1000);
+                                if(governance.SerializeObjectForHash(inv.hash, ss)) {
+                                    topush = true;
+                                }
                             }
                         }
                     }
                     LogPrint("net", "ProcessGetData -- MSG_GOVERNANCE_OBJECT: topush = %d, inv = %s\n", topush, inv.ToString());
                     if(topush) {
-                        connman.PushMessage(pfrom, NetMsgType::MNGOVERNANCEOBJECT, ss);
+                        if(!fCached)
+                            PushMessageAndCache(pfrom, connman, inv, NetMsgType::MNGOVERNANCEOBJECT, ss);
                         pushed = true;
                     }
                 }
@@ -1029,17 +1199,23 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 if (!pushed && inv.type == MSG_GOVERNANCE_OBJECT_VOTE) {
                     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                     bool topush = false;
+                    bool fCached = false;
                     {
                         if(governance.HaveVoteForHash(inv.hash)) {
-                            ss.reserve(1000);
-                            if(governance.SerializeVoteForHash(inv.hash, ss)) {
-                                topush = true;
+                            if(PushMessageFromRelayCache(pfrom, connman, inv)) {
+                                topush = fCached = true;
+                            } else {
+                                ss.reserve(1000);
+                                if(governance.SerializeVoteForHash(inv.hash, ss)) {
+                                    topush = true;
+                                }
                             }
                         }
                     }
                     if(topush) {
                         LogPrint("net", "ProcessGetData -- pushing: inv = %s\n", inv.ToString());
-                        connman.PushMessage(pfrom, NetMsgType::MNGOVERNANCEOBJECTVOTE, ss);
+                        if(!fCached)
+                            PushMessageAndCache(pfrom, connman, inv, NetMsgType::MNGOVERNANCEOBJECTVOTE, ss);
                         pushed = true;
                     }
                 }
@@ -1786,6 +1962,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
+        // Hashes the whole message on the proof-of-work check threads, outside cs_main. Invalid
+        // proof of work is reported by ProcessNewBlockHeaders() below, for the right header.
+        CheckBlockHeadersProofOfWork(headers, chainparams.GetConsensus());
+
         CBlockIndex *pindexLast = NULL;
         {
         LOCK(cs_main);
@@ -2166,28 +2346,15 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     }
     else
     {
-        bool found = false;
-        const std::vector<std::string> &allMessages = getAllNetMessageTypes();
-        BOOST_FOREACH(const std::string msg, allMessages) {
-            if(msg == strCommand) {
-                found = true;
-                break;
-            }
-        }
+        int nMessageTypeIndex = getNetMessageTypeIndex(strCommand);
 
-        if (found)
+        if (nMessageTypeIndex >= 0)
         {
-            //probably one the extensions
-#ifdef ENABLE_WALLET
-            privateSendClient.ProcessMessage(pfrom, strCommand, vRecv, connman);
-#endif // ENABLE_WALLET
-            privateSendServer.ProcessMessage(pfrom, strCommand, vRecv, connman);
-            mnodeman.ProcessMessage(pfrom, strCommand, vRecv, connman);
-            mnpayments.ProcessMessage(pfrom, strCommand, vRecv, connman);
-            instantsend.ProcessMessage(pfrom, strCommand, vRecv, connman);
-            sporkManager.ProcessSpork(pfrom, strCommand, vRecv, connman);
-            masternodeSync.ProcessMessage(pfrom, strCommand, vRecv);
-            governance.ProcessMessage(pfrom, strCommand, vRecv, connman);
+            //probably one the extensions, only the ones registered for this type are asked
+            if (nMessageTypeIndex < (int)vecNetMessageHandlers.size()) {
+                BOOST_FOREACH(const NetMessageHandler& handler, vecNetMessageHandlers[nMessageTypeIndex])
+                    handler(pfrom, strCommand, vRecv, connman);
+            }
         }
         else
         {
@@ -2226,6 +2393,7 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
             return false;
 
         std::list<CNetMessage> msgs;
+        bool fResumeRecv;
         {
             LOCK(pfrom->cs_vProcessMsg);
             if (pfrom->vProcessMsg.empty())
@@ -2233,9 +2401,13 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
             // Just take one message
             msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
             pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
-            pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman.GetReceiveFloodSize();
+            bool fPauseRecv = pfrom->nProcessQueueSize > connman.GetReceiveFloodSize();
+            fResumeRecv = pfrom->fPauseRecv && !fPauseRecv;
+            pfrom->fPauseRecv = fPauseRecv;
             fMoreWork = !pfrom->vProcessMsg.empty();
         }
+        if (fResumeRecv)
+            connman.SocketEventsChanged(pfrom);
         CNetMessage& msg(msgs.front());
 
         msg.SetVersion(pfrom->GetRecvVersion());
@@ -2272,6 +2444,7 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
 
         // Process message
         bool fRet = false;
+        int64_t nTimeProcessStart = GetTimeMicros();
         try
         {
             fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, connman, interruptMsgProc);
@@ -2307,6 +2480,18 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
         if (!fRet)
             LogPrintf("%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->id);
 
+        // account the processing time by message type, globally and to the peer
+        int64_t nTimeProcess = GetTimeMicros() - nTimeProcessStart;
+        int nMessageTypeIndex = getNetMessageTypeIndex(strCommand);
+        std::vector<CNetMessageCounters>& vecCounters = GetNetMessageCounters();
+        CNetMessageCounters& counters = vecCounters[nMessageTypeIndex >= 0 ? nMessageTypeIndex : vecCounters.size() - 1];
+        counters.nCount.fetch_add(1, std::memory_order_relaxed);
+        counters.nBytes.fetch_add(nMessageSize + CMessageHeader::HEADER_SIZE, std::memory_order_relaxed);
+        counters.nTimeMicros.fetch_add(nTimeProcess, std::memory_order_relaxed);
+        if (nTimeProcess > counters.nMaxTimeMicros.load(std::memory_order_relaxed))
+            counters.nMaxTimeMicros.store(nTimeProcess, std::memory_order_relaxed);
+        pfrom->AddProcessTimePerMsgCmd(strCommand, nTimeProcess);
+
     return fMoreWork;
 }
 
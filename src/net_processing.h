@@ -9,11 +9,34 @@
 #include "net.h"
 #include "validationinterface.h"
 
+#include <functional>
+
 /** Headers download timeout expressed in microseconds
  *  Timeout = base + per_header * (expected number of headers) */
 static constexpr int64_t HEADERS_DOWNLOAD_TIMEOUT_BASE = 15 * 60 * 1000000; // 15 minutes
 static constexpr int64_t HEADERS_DOWNLOAD_TIMEOUT_PER_HEADER = 1000; // 1ms/header
 
+/** Handler of the messages of one of the extensions: masternodes, PrivateSend, InstantSend, sporks, governance */
+typedef std::function<void(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CConnman& connman)> NetMessageHandler;
+
+/** Let handler process the messages of type strCommand, which must be one of getAllNetMessageTypes().
+ *  Handlers are registered before the message handler thread starts and called in registration order. */
+void RegisterNetMessageHandler(const std::string& strCommand, const NetMessageHandler& handler);
+/** Remove all message handlers */
+void UnregisterNetMessageHandlers();
+
+struct CNetMessageStats {
+    std::string strCommand;
+    uint64_t nCount;
+    uint64_t nBytes;
+    int64_t nTimeMicros;
+    int64_t nMaxTimeMicros;
+};
+
+/** Number, size and processing time of the received messages by type since startup,
+ *  unknown types are summed up as NET_MESSAGE_COMMAND_OTHER */
+void GetNetMessageStats(std::vector<CNetMessageStats>& vecStatsRet);
+
 /** Register with a network node to receive its signals */
 void RegisterNodeSignals(CNodeSignals& nodeSignals);
 /** Unregister a network node */
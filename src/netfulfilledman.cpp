@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chainparams.h"
+#include "flat-database.h"
 #include "netfulfilledman.h"
 #include "util.h"
 
@@ -64,6 +65,27 @@ void CNetFulfilledRequestManager::Clear()
     mapFulfilledRequests.clear();
 }
 
+std::vector<CFlatDBSection> CNetFulfilledRequestManager::GetSnapshotSections()
+{
+    return { CFlatDBSection("requests", true) };
+}
+
+void CNetFulfilledRequestManager::WriteSnapshotSections(std::vector<CDataStream>& vSections)
+{
+    LOCK(cs_mapFulfilledRequests);
+    vSections[0] << mapFulfilledRequests;
+}
+
+void CNetFulfilledRequestManager::ReadSnapshotSection(size_t nSection, CDataStream& s)
+{
+    LOCK(cs_mapFulfilledRequests);
+    s >> mapFulfilledRequests;
+}
+
+void CNetFulfilledRequestManager::ReadSnapshotDone()
+{
+}
+
 std::string CNetFulfilledRequestManager::ToString() const
 {
     std::ostringstream info;
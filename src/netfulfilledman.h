@@ -10,6 +10,9 @@
 #include "serialize.h"
 #include "sync.h"
 
+class CDataStream;
+struct CFlatDBSection;
+
 class CNetFulfilledRequestManager;
 extern CNetFulfilledRequestManager netfulfilledman;
 
@@ -36,6 +39,12 @@ public:
         READWRITE(mapFulfilledRequests);
     }
 
+    /// Snapshot sections for CFlatDB
+    static std::vector<CFlatDBSection> GetSnapshotSections();
+    void WriteSnapshotSections(std::vector<CDataStream>& vSections);
+    void ReadSnapshotSection(size_t nSection, CDataStream& s);
+    void ReadSnapshotDone();
+
     void AddFulfilledRequest(CAddress addr, std::string strRequest); // expire after 1 hour by default
     bool HasFulfilledRequest(CAddress addr, std::string strRequest);
     void RemoveFulfilledRequest(CAddress addr, std::string strRequest);
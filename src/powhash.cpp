@@ -0,0 +1,377 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "powhash.h"
+
+#include "chainparams.h"
+#include "hash.h"
+#include "utilstrencodings.h"
+#include "crypto/encryption/salsa20/ecrypt-sync.h"
+#include "crypto/encryption/salsa20/salsa20_blocks.h"
+
+#include <algorithm>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boost/thread/tss.hpp>
+
+#ifdef WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+
+
+// Must match the switch time in CBlockHeader::GetHash ().
+#define I_TIME_FROM_GENESIS_BLOCK_FOR_SHA256_AND_X11 3528000
+#define I_ALGORITHM_RECONFIGURATION_TIME_PERIOD_IN_SECONDS 604800
+#define I_PRIME_NUMBER_FOR_MEMORY_HARD_HASHING 3571
+#define I_POW_HASH_SCRATCH_ALIGNMENT 64
+#define I_HUGE_PAGE_SIZE ( 2 * 1024 * 1024 )
+
+
+
+bool g_bPoWHashHugePages = DEFAULT_POW_HASH_HUGE_PAGES;
+
+
+
+//---Utility functions.---------------------------------------------------
+static inline uint64_t ReadUint64 ( const unsigned char * _pData ) {
+    uint64_t iResult;
+    memcpy ( & iResult, _pData, sizeof ( iResult ) );
+    return iResult;
+}
+
+// Same value as GetUint64IndexFrom512BitsKey () in primitives/block.cpp.
+static inline uint64_t FoldUint64From512Bits ( const unsigned char * _pData ) {
+    return ReadUint64 ( _pData ) ^ ReadUint64 ( _pData + 8 ) ^ ReadUint64 ( _pData + 16 ) ^ ReadUint64 ( _pData + 24 ) ^
+           ReadUint64 ( _pData + 32 ) ^ ReadUint64 ( _pData + 40 ) ^ ReadUint64 ( _pData + 48 ) ^ ReadUint64 ( _pData + 56 );
+}
+
+void TPoWHashLane :: SetNull () {
+    for ( unsigned int i = 0; i < 11; i ++ )
+        aHashes [ i ].SetNull ();
+    uint512AdditionalHash.SetNull ();
+    uint1024CombinedHashes.SetNull ();
+}
+
+//---Scratch memory.------------------------------------------------------
+TPoWHashScratch :: TPoWHashScratch () {
+    // The only zeroing the memory-hard stage depends on, it keeps the area zero afterwards itself.
+    memset ( aMemoryArea, 0, I_POW_HASH_MEMORY_AREA_SIZE );
+    iHugePagesMappingSize = 0;
+}
+
+TPoWHashScratch * AllocatePoWHashScratch ( bool _bHugePages ) {
+    void * pMemory = nullptr;
+    size_t iMappingSize = 0;
+
+#if !defined ( WIN32 ) && defined ( MAP_HUGETLB )
+    if ( _bHugePages ) {
+        iMappingSize = ( sizeof ( TPoWHashScratch ) + I_HUGE_PAGE_SIZE - 1 ) / I_HUGE_PAGE_SIZE * I_HUGE_PAGE_SIZE;
+        pMemory = mmap ( nullptr, iMappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+        if ( pMemory == MAP_FAILED ) {
+            // No huge pages reserved by the system, falling back to normal pages.
+            pMemory = nullptr;
+            iMappingSize = 0;
+        } //-if
+    } //-if
+#endif
+
+    if ( pMemory == nullptr ) {
+#ifdef WIN32
+        pMemory = _aligned_malloc ( sizeof ( TPoWHashScratch ), I_POW_HASH_SCRATCH_ALIGNMENT );
+#else
+        if ( posix_memalign ( & pMemory, I_POW_HASH_SCRATCH_ALIGNMENT, sizeof ( TPoWHashScratch ) ) != 0 )
+            pMemory = nullptr;
+#endif
+        if ( pMemory == nullptr )
+            throw std :: bad_alloc ();
+    } //-if
+
+    TPoWHashScratch * pScratch = new ( pMemory ) TPoWHashScratch ();
+    pScratch->iHugePagesMappingSize = iMappingSize;
+    return pScratch;
+}
+
+void FreePoWHashScratch ( TPoWHashScratch * _pScratch ) {
+    if ( _pScratch == nullptr )
+        return;
+
+    size_t iMappingSize = _pScratch->iHugePagesMappingSize;
+    _pScratch->~TPoWHashScratch ();
+
+#ifdef WIN32
+    _aligned_free ( _pScratch );
+#else
+    if ( iMappingSize != 0 )
+        munmap ( _pScratch, iMappingSize );
+    else
+        free ( _pScratch );
+#endif
+}
+
+static boost :: thread_specific_ptr < TPoWHashScratch > g_pThreadPoWHashScratch ( & FreePoWHashScratch );
+
+TPoWHashScratch & GetThreadPoWHashScratch () {
+    TPoWHashScratch * pScratch = g_pThreadPoWHashScratch.get ();
+    if ( pScratch == nullptr ) {
+        pScratch = AllocatePoWHashScratch ( g_bPoWHashHugePages );
+        g_pThreadPoWHashScratch.reset ( pScratch );
+    } //-if
+    return * pScratch;
+}
+
+
+
+//---Memory-hard stage.---------------------------------------------------
+// Every iteration encrypts the upper half of uint1024CombinedHashes into the memory area with one
+// Salsa20 block and then XORs the written ciphertext back into it, which leaves exactly that keystream
+// block in place. The keystream does not depend on the data, so all of it is generated up front and
+// the loop only does the writes.
+static void MemoryHardStage ( TPoWHashLane & _lane, TPoWHashScratch & _scratch ) {
+    ECRYPT_ctx structECRYPT_ctx;
+    unsigned char * pCombinedHashes = _lane.uint1024CombinedHashes.begin () + 64;
+    uint64_t iWriteIndex;
+    uint32_t i, j;
+
+    ECRYPT_keysetup ( & structECRYPT_ctx, _lane.aHashes [ 1 ].begin (), ECRYPT_MAXKEYSIZE, ECRYPT_MAXIVSIZE );
+    ECRYPT_ivsetup ( & structECRYPT_ctx, _lane.aHashes [ 2 ].begin () );
+    salsa20_keystream_blocks ( & structECRYPT_ctx, _scratch.aKeyStream, I_POW_HASH_MEMORY_HARD_ITERATIONS );
+
+    // aMemoryArea is all zero here, see the end of this function.
+    for ( i = 0; i < I_POW_HASH_MEMORY_HARD_ITERATIONS; i ++ ) {
+        const unsigned char * pKeyStream = & _scratch.aKeyStream [ i * 64 ];
+        unsigned char aCipherText [ 64 ];
+
+        // The original code expanded an unparenthesized "32 * 1024" after the modulo operator, so the
+        // start offset is ( fold % 32 ) * 1024. It is part of consensus and kept as is.
+        iWriteIndex =
+            ( FoldUint64From512Bits ( pCombinedHashes ) % 32 * 1024 +
+              i * I_PRIME_NUMBER_FOR_MEMORY_HARD_HASHING )
+            %
+            ( I_POW_HASH_MEMORY_AREA_SIZE - 8 * ECRYPT_BLOCKLENGTH );
+
+        for ( j = 0; j < 64; j ++ )
+            aCipherText [ j ] = pCombinedHashes [ j ] ^ pKeyStream [ j ];
+        memcpy ( & _scratch.aMemoryArea [ iWriteIndex ], aCipherText, 64 );
+        memcpy ( pCombinedHashes, pKeyStream, 64 );
+        _scratch.aMemoryAreaWriteIndexes [ i ] = ( uint16_t ) iWriteIndex;
+
+    } //-for
+
+    // Folding the whole memory area into the upper half.
+    uint64_t aAccumulator [ 8 ];
+    for ( j = 0; j < 8; j ++ )
+        aAccumulator [ j ] = ReadUint64 ( pCombinedHashes + j * 8 );
+
+    for ( i = 0; i < I_POW_HASH_MEMORY_AREA_SIZE; i += 64 ) {
+        for ( j = 0; j < 8; j ++ )
+            aAccumulator [ j ] ^= ReadUint64 ( & _scratch.aMemoryArea [ i + j * 8 ] );
+
+    } //-for
+
+    memcpy ( pCombinedHashes, aAccumulator, 64 );
+
+    // Zeroing back only what was written, at most half of the area, instead of all of it on every call.
+    for ( i = 0; i < I_POW_HASH_MEMORY_HARD_ITERATIONS; i ++ )
+        memset ( & _scratch.aMemoryArea [ _scratch.aMemoryAreaWriteIndexes [ i ] ], 0, 64 );
+}
+
+//---Pipeline.------------------------------------------------------------
+// The SHA256AndX11 pipeline, with every stage applied to all lanes before the next one, so that the
+// tables and code of one hash function stay hot in cache. It is instantiated once for every value of
+// ( iWeekNumber + nBits ) % I_AMOUNT_OF_POW_PLAN_COMBINATIONS, which fixes both variable hash functions
+// and the encryption function, so all stages are direct calls.
+template < unsigned int I_COMBINATION >
+static void GetPoWHashes_SHA256AndX11 ( const CBlockHeader & _header, uint32_t _iFirstNonce, uint32_t _iAmountOfLanes,
+    uint256 * _pResults, TPoWHashScratch & _scratch ) {
+    TPoWHashLane * pLanes = _scratch.aLanes;
+    uint32_t iLane;
+
+    // blake512 midstate of the 76 bytes in front of the nonce.
+    sph_blake512_context structBlakePrefixContext;
+    sph_blake512_init ( & structBlakePrefixContext );
+    sph_blake512 ( & structBlakePrefixContext, BEGIN ( _header.nVersion ), I_BLOCK_HEADER_SIZE - sizeof ( _header.nNonce ) );
+
+    for ( iLane = 0; iLane < _iAmountOfLanes; iLane ++ ) {
+        sph_blake512_context structBlakeContext = structBlakePrefixContext;
+        uint32_t iNonce = _iFirstNonce + iLane;
+
+        pLanes [ iLane ].SetNull ();
+        sph_blake512 ( & structBlakeContext, & iNonce, sizeof ( iNonce ) );
+        sph_blake512_close ( & structBlakeContext, pLanes [ iLane ].aHashes [ 0 ].begin () );
+    }
+
+    // bmw512
+    for ( iLane = 0; iLane < _iAmountOfLanes; iLane ++ )
+        IntermediateHashFunction < 1 > ( pLanes [ iLane ].aHashes [ 0 ].begin (), 64, nullptr, pLanes [ iLane ].uint512AdditionalHash.begin () );
+
+    for ( iLane = 0; iLane < _iAmountOfLanes; iLane ++ )
+        IntermediateHashFunction < I_COMBINATION % I_AMOUNT_OF_INTERMEDIATE_HASH_FUNCTIONS > ( pLanes [ iLane ].uint512AdditionalHash.begin (), 64, nullptr, pLanes [ iLane ].aHashes [ 1 ].begin () );
+
+    // groestl512
+    for ( iLane = 0; iLane < _iAmountOfLanes; iLane ++ )
+        IntermediateHashFunction < 2 > ( pLanes [ iLane ].aHashes [ 1 ].begin (), 64, nullptr, pLanes [ iLane ].aHashes [ 2 ].begin () );
+
+    // skein512
+    for ( iLane = 0; iLane < _iAmountOfLanes; iLane ++ )
+        IntermediateHashFunction < 5 > ( pLanes [ iLane ].aHashes [ 2 ].begin (), 64, nullptr, pLanes [ iLane ].uint1024CombinedHashes.begin () + 64 );
+
+    // jh512
+    for ( iLane = 0; iLane < _iAmountOfLanes; iLane ++ )
+        IntermediateHashFunction < 3 > ( pLanes [ iLane ].uint1024CombinedHashes.begin () + 64, 64, nullptr, pLanes [ iLane ].uint1024CombinedHashes.begin () );
+
+    for ( iLane = 0; iLane < _iAmountOfLanes; iLane ++ )
+        MemoryHardStage ( pLanes [ iLane ], _scratch );
+
+    // keccak512
+    for ( iLane = 0; iLane < _iAmountOfLanes; iLane ++ )
+        IntermediateHashFunction < 4 > ( pLanes [ iLane ].uint1024CombinedHashes.begin (), 128, nullptr, pLanes [ iLane ].aHashes [ 5 ].begin () );
+
+    // luffa512
+    for ( iLane = 0; iLane < _iAmountOfLanes; iLane ++ )
+        IntermediateHashFunction < 6 > ( pLanes [ iLane ].aHashes [ 5 ].begin (), 64, nullptr, pLanes [ iLane ].aHashes [ 6 ].begin () );
+
+    // cubehash512
+    for ( iLane = 0; iLane < _iAmountOfLanes; iLane ++ )
+        IntermediateHashFunction < 7 > ( pLanes [ iLane ].aHashes [ 6 ].begin (), 64, nullptr, pLanes [ iLane ].aHashes [ 7 ].begin () );
+
+    for ( iLane = 0; iLane < _iAmountOfLanes; iLane ++ ) {
+        TPoWHashLane & lane = pLanes [ iLane ];
+        memcpy ( lane.aHashes [ 6 ].begin (), lane.aHashes [ 7 ].begin (), 64 );
+        IntermediateEncryptionFunction < I_COMBINATION % I_AMOUNT_OF_INTERMEDIATE_ENCRYPTION_FUNCTIONS > ( lane.aHashes [ 6 ].begin (), 64, lane.aHashes [ 0 ].begin (), lane.aHashes [ 7 ].begin () );
+    }
+
+    // shavite512
+    for ( iLane = 0; iLane < _iAmountOfLanes; iLane ++ )
+        IntermediateHashFunction < 8 > ( pLanes [ iLane ].aHashes [ 7 ].begin (), 64, nullptr, pLanes [ iLane ].aHashes [ 8 ].begin () );
+
+    // simd512
+    for ( iLane = 0; iLane < _iAmountOfLanes; iLane ++ )
+        IntermediateHashFunction < 9 > ( pLanes [ iLane ].aHashes [ 8 ].begin (), 64, nullptr, pLanes [ iLane ].uint512AdditionalHash.begin () );
+
+    for ( iLane = 0; iLane < _iAmountOfLanes; iLane ++ )
+        IntermediateHashFunction < ( I_COMBINATION + 10 ) % I_AMOUNT_OF_INTERMEDIATE_HASH_FUNCTIONS > ( pLanes [ iLane ].uint512AdditionalHash.begin (), 64, nullptr, pLanes [ iLane ].aHashes [ 9 ].begin () );
+
+    // echo512
+    for ( iLane = 0; iLane < _iAmountOfLanes; iLane ++ ) {
+        IntermediateHashFunction < 10 > ( pLanes [ iLane ].aHashes [ 9 ].begin (), 64, nullptr, pLanes [ iLane ].aHashes [ 10 ].begin () );
+        _pResults [ iLane ] = pLanes [ iLane ].aHashes [ 10 ].trim256 ();
+    }
+}
+
+
+// Blocks before the switch to SHA256AndX11 are plain X11, which has no week-dependent stages.
+static void GetPoWHashes_X11 ( const CBlockHeader & _header, uint32_t _iFirstNonce, uint32_t _iAmountOfLanes,
+    uint256 * _pResults, TPoWHashScratch & _scratch ) {
+    CBlockHeader header ( _header );
+
+    for ( uint32_t iLane = 0; iLane < _iAmountOfLanes; iLane ++ ) {
+        header.nNonce = _iFirstNonce + iLane;
+        _pResults [ iLane ] = header.GetHash_X11 ( nullptr, 0 );
+    }
+}
+
+static const TPoWHashesFunction aPoWHashesFunctions [ I_AMOUNT_OF_POW_PLAN_COMBINATIONS ] = {
+    & GetPoWHashes_SHA256AndX11 < 0 >,  & GetPoWHashes_SHA256AndX11 < 1 >,  & GetPoWHashes_SHA256AndX11 < 2 >,
+    & GetPoWHashes_SHA256AndX11 < 3 >,  & GetPoWHashes_SHA256AndX11 < 4 >,  & GetPoWHashes_SHA256AndX11 < 5 >,
+    & GetPoWHashes_SHA256AndX11 < 6 >,  & GetPoWHashes_SHA256AndX11 < 7 >,  & GetPoWHashes_SHA256AndX11 < 8 >,
+    & GetPoWHashes_SHA256AndX11 < 9 >,  & GetPoWHashes_SHA256AndX11 < 10 >, & GetPoWHashes_SHA256AndX11 < 11 >,
+    & GetPoWHashes_SHA256AndX11 < 12 >, & GetPoWHashes_SHA256AndX11 < 13 >, & GetPoWHashes_SHA256AndX11 < 14 >,
+    & GetPoWHashes_SHA256AndX11 < 15 >, & GetPoWHashes_SHA256AndX11 < 16 >, & GetPoWHashes_SHA256AndX11 < 17 >,
+    & GetPoWHashes_SHA256AndX11 < 18 >, & GetPoWHashes_SHA256AndX11 < 19 >, & GetPoWHashes_SHA256AndX11 < 20 >,
+    & GetPoWHashes_SHA256AndX11 < 21 >, & GetPoWHashes_SHA256AndX11 < 22 >, & GetPoWHashes_SHA256AndX11 < 23 >,
+    & GetPoWHashes_SHA256AndX11 < 24 >, & GetPoWHashes_SHA256AndX11 < 25 >, & GetPoWHashes_SHA256AndX11 < 26 >,
+    & GetPoWHashes_SHA256AndX11 < 27 >, & GetPoWHashes_SHA256AndX11 < 28 >, & GetPoWHashes_SHA256AndX11 < 29 >,
+    & GetPoWHashes_SHA256AndX11 < 30 >, & GetPoWHashes_SHA256AndX11 < 31 >, & GetPoWHashes_SHA256AndX11 < 32 >,
+    & GetPoWHashes_SHA256AndX11 < 33 >, & GetPoWHashes_SHA256AndX11 < 34 >, & GetPoWHashes_SHA256AndX11 < 35 >,
+    & GetPoWHashes_SHA256AndX11 < 36 >, & GetPoWHashes_SHA256AndX11 < 37 >, & GetPoWHashes_SHA256AndX11 < 38 >,
+    & GetPoWHashes_SHA256AndX11 < 39 >, & GetPoWHashes_SHA256AndX11 < 40 >, & GetPoWHashes_SHA256AndX11 < 41 >
+};
+
+static const char * const aIntermediateHashFunctionNames [ I_AMOUNT_OF_INTERMEDIATE_HASH_FUNCTIONS ] = {
+    "blake512", "bmw512", "groestl512", "jh512", "keccak512", "skein512", "luffa512", "cubehash512",
+    "shavite512", "simd512", "echo512", "streebog512", "whirlpool", "streebog512"
+};
+
+static const char * const aIntermediateEncryptionFunctionNames [ I_AMOUNT_OF_INTERMEDIATE_ENCRYPTION_FUNCTIONS ] = {
+    "kuznechik", "threefish", "camellia"
+};
+
+//---PoW plan.------------------------------------------------------------
+TPoWPlan GetPoWPlan ( uint32_t _iTime, uint32_t _nBits ) {
+    TPoWPlan structPoWPlan;
+
+    structPoWPlan.iGenesisBlockTime = Params().GenesisBlock().nTime;
+    structPoWPlan.nBits = _nBits;
+
+    // Same unsigned arithmetic as CBlockHeader::GetHash ().
+    uint32_t iTimeFromGenesisBlock = _iTime - structPoWPlan.iGenesisBlockTime;
+
+    if ( iTimeFromGenesisBlock < I_TIME_FROM_GENESIS_BLOCK_FOR_SHA256_AND_X11 ) {
+        structPoWPlan.bIsSHA256AndX11 = false;
+        structPoWPlan.iWeekNumber = 0;
+        structPoWPlan.iValidFromTimeFromGenesisBlock = 0;
+        structPoWPlan.iValidUntilTimeFromGenesisBlock = I_TIME_FROM_GENESIS_BLOCK_FOR_SHA256_AND_X11;
+        structPoWPlan.iCombination = 0;
+        structPoWPlan.pfGetPoWHashes = & GetPoWHashes_X11;
+        return structPoWPlan;
+    }
+
+    structPoWPlan.bIsSHA256AndX11 = true;
+    structPoWPlan.iWeekNumber = iTimeFromGenesisBlock / I_ALGORITHM_RECONFIGURATION_TIME_PERIOD_IN_SECONDS * I_ALGORITHM_RECONFIGURATION_TIME_PERIOD_IN_SECONDS;
+    structPoWPlan.iValidFromTimeFromGenesisBlock = std :: max < uint64_t > ( structPoWPlan.iWeekNumber, I_TIME_FROM_GENESIS_BLOCK_FOR_SHA256_AND_X11 );
+    structPoWPlan.iValidUntilTimeFromGenesisBlock = structPoWPlan.iWeekNumber + I_ALGORITHM_RECONFIGURATION_TIME_PERIOD_IN_SECONDS;
+    structPoWPlan.iCombination = ( structPoWPlan.iWeekNumber + _nBits ) % I_AMOUNT_OF_POW_PLAN_COMBINATIONS;
+    structPoWPlan.pfGetPoWHashes = aPoWHashesFunctions [ structPoWPlan.iCombination ];
+
+    return structPoWPlan;
+}
+
+TPoWPlan GetPoWPlan ( const CBlockHeader & _header ) {
+    return GetPoWPlan ( _header.nTime, _header.nBits );
+}
+
+bool TPoWPlan :: IsValidFor ( const CBlockHeader & _header ) const {
+    uint32_t iTimeFromGenesisBlock = _header.nTime - iGenesisBlockTime;
+
+    return _header.nBits == nBits &&
+        iTimeFromGenesisBlock >= iValidFromTimeFromGenesisBlock &&
+        iTimeFromGenesisBlock < iValidUntilTimeFromGenesisBlock;
+}
+
+const char * TPoWPlan :: GetFirstVariableHashFunctionName () const {
+    return aIntermediateHashFunctionNames [ iCombination % I_AMOUNT_OF_INTERMEDIATE_HASH_FUNCTIONS ];
+}
+
+const char * TPoWPlan :: GetEncryptionFunctionName () const {
+    return aIntermediateEncryptionFunctionNames [ iCombination % I_AMOUNT_OF_INTERMEDIATE_ENCRYPTION_FUNCTIONS ];
+}
+
+const char * TPoWPlan :: GetSecondVariableHashFunctionName () const {
+    return aIntermediateHashFunctionNames [ ( iCombination + 10 ) % I_AMOUNT_OF_INTERMEDIATE_HASH_FUNCTIONS ];
+}
+
+void GetPoWHashes ( const TPoWPlan & _plan, const CBlockHeader & _header, uint32_t _iFirstNonce, uint32_t _iAmountOfNonces,
+    uint256 * _pResults, TPoWHashScratch & _scratch ) {
+
+    while ( _iAmountOfNonces > 0 ) {
+        uint32_t iAmountOfLanes = std :: min < uint32_t > ( _iAmountOfNonces, I_POW_HASH_MAX_LANES );
+
+        _plan.pfGetPoWHashes ( _header, _iFirstNonce, iAmountOfLanes, _pResults, _scratch );
+
+        _iFirstNonce += iAmountOfLanes;
+        _iAmountOfNonces -= iAmountOfLanes;
+        _pResults += iAmountOfLanes;
+
+    } //-while
+}
+
+void GetPoWHashes ( const CBlockHeader & _header, uint32_t _iFirstNonce, uint32_t _iAmountOfNonces,
+    uint256 * _pResults, TPoWHashScratch & _scratch ) {
+    GetPoWHashes ( GetPoWPlan ( _header ), _header, _iFirstNonce, _iAmountOfNonces, _pResults, _scratch );
+}
@@ -0,0 +1,116 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_POWHASH_H
+#define BITCOIN_POWHASH_H
+
+#include "primitives/block.h"
+#include "uint256.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+
+// Largest amount of nonces, which GetPoWHashes () evaluates side by side.
+#define I_POW_HASH_MAX_LANES 8
+
+#define I_POW_HASH_MEMORY_AREA_SIZE ( 32 * 1024 )
+// Amount of 64 bytes Salsa20 blocks written into the memory area per hash.
+#define I_POW_HASH_MEMORY_HARD_ITERATIONS ( I_POW_HASH_MEMORY_AREA_SIZE / 64 / 2 )
+
+
+
+/** Intermediate state of one nonce in the SHA256AndX11 pipeline. The layout of aHashes is part of
+ *  consensus, because the encryption stage reads past the 64 bytes of its key and data arguments
+ *  into the neighbouring entries.
+ */
+struct TPoWHashLane {
+    uint512 aHashes [ 11 ];
+    uint512 uint512AdditionalHash;
+    uint1024 uint1024CombinedHashes;
+
+    void SetNull ();
+};
+
+/** Working memory of GetPoWHashes (). Callers allocate it once, with AllocatePoWHashScratch () or
+ *  GetThreadPoWHashScratch (), and pass it to every call, so that nothing is allocated, placed on the
+ *  stack or zeroed as a whole per nonce. Not to be shared between threads.
+ */
+struct TPoWHashScratch {
+    // Hot data first, each array starts on its own cache line when the scratch is cache line aligned.
+    unsigned char aMemoryArea [ I_POW_HASH_MEMORY_AREA_SIZE ];
+    unsigned char aKeyStream [ I_POW_HASH_MEMORY_HARD_ITERATIONS * 64 ];
+    TPoWHashLane aLanes [ I_POW_HASH_MAX_LANES ];
+    // Offsets written by the memory-hard stage of the current lane. Only these are zeroed again after
+    // the stage, which keeps aMemoryArea all zero between hashes, as consensus requires at its start.
+    uint16_t aMemoryAreaWriteIndexes [ I_POW_HASH_MEMORY_HARD_ITERATIONS ];
+    // Size of the mapping when the scratch is on huge pages, 0 otherwise.
+    size_t iHugePagesMappingSize;
+
+    TPoWHashScratch ();
+};
+
+/** Allocates a cache line aligned TPoWHashScratch. With _bHugePages it is placed on huge pages when the
+ *  system has them available, otherwise on normal pages. Release it with FreePoWHashScratch ().
+ */
+TPoWHashScratch * AllocatePoWHashScratch ( bool _bHugePages );
+void FreePoWHashScratch ( TPoWHashScratch * _pScratch );
+
+/** Scratch of the calling thread, allocated with AllocatePoWHashScratch ( g_bPoWHashHugePages ) on first
+ *  use and released when the thread exits. CBlockHeader::GetHash () and the miner threads use it.
+ */
+TPoWHashScratch & GetThreadPoWHashScratch ();
+
+static const bool DEFAULT_POW_HASH_HUGE_PAGES = false;
+// -powhashhugepages.
+extern bool g_bPoWHashHugePages;
+
+typedef void ( * TPoWHashesFunction ) ( const CBlockHeader &, uint32_t, uint32_t, uint256 *, TPoWHashScratch & );
+
+// Distinct ( iWeekNumber + nBits ) values modulo the amounts of intermediate hash functions (14) and
+// encryption functions (3), i.e. distinct SHA256AndX11 pipelines.
+#define I_AMOUNT_OF_POW_PLAN_COMBINATIONS 42
+
+/** Everything about the proof-of-work pipeline of a header that only depends on its reconfiguration
+ *  week and nBits: which variable hash and encryption functions run, resolved into one template
+ *  instantiation of the whole pipeline. Built by GetPoWPlan () and reused for as long as IsValidFor ()
+ *  holds, by the miner for all nonces of a block template and by CBlockHeader::GetHash ().
+ */
+struct TPoWPlan {
+    bool bIsSHA256AndX11;
+    uint32_t iGenesisBlockTime;
+    uint32_t nBits;
+    uint64_t iWeekNumber;
+    // nTime - genesis time range, in which the plan stays the same.
+    uint64_t iValidFromTimeFromGenesisBlock;
+    uint64_t iValidUntilTimeFromGenesisBlock;
+    // ( iWeekNumber + nBits ) % I_AMOUNT_OF_POW_PLAN_COMBINATIONS.
+    unsigned int iCombination;
+    TPoWHashesFunction pfGetPoWHashes;
+
+    bool IsValidFor ( const CBlockHeader & _header ) const;
+
+    const char * GetFirstVariableHashFunctionName () const;
+    const char * GetEncryptionFunctionName () const;
+    const char * GetSecondVariableHashFunctionName () const;
+};
+
+TPoWPlan GetPoWPlan ( uint32_t _iTime, uint32_t _nBits );
+TPoWPlan GetPoWPlan ( const CBlockHeader & _header );
+
+/** Computes _header.GetHash () for the nonces _iFirstNonce .. _iFirstNonce + _iAmountOfNonces - 1
+ *  into _pResults, without touching _header. _plan must be valid for _header. Nonces are processed
+ *  in groups of up to I_POW_HASH_MAX_LANES: the constant 76 bytes header prefix is absorbed once,
+ *  every pipeline stage runs over the whole group before the next one starts, and the Salsa20
+ *  keystream of the memory-hard stage is generated several blocks at a time with SSE2 / AVX2.
+ */
+void GetPoWHashes ( const TPoWPlan & _plan, const CBlockHeader & _header, uint32_t _iFirstNonce, uint32_t _iAmountOfNonces,
+    uint256 * _pResults, TPoWHashScratch & _scratch );
+
+/** Same as above with a plan built for _header. */
+void GetPoWHashes ( const CBlockHeader & _header, uint32_t _iFirstNonce, uint32_t _iAmountOfNonces,
+    uint256 * _pResults, TPoWHashScratch & _scratch );
+
+#endif // BITCOIN_POWHASH_H
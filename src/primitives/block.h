@@ -12,12 +12,17 @@
 #include "serialize.h"
 #include "uint256.h"
 
+#include <atomic>
+
 
 
 #define I_AMOUNT_OF_HASH_FUNCTIONS 2
 
 #define I_MAX_AMOUNT_OF_BLOCKS_IN_MEMORY 1000
 
+// Serialized size of nVersion .. nNonce, which is what the proof-of-work hash covers.
+#define I_BLOCK_HEADER_SIZE 80
+
 //#define I_AMOUNT_OF_BYTES_FOR_MEMORY_HARD_FUNCTION 16 * 1024
 
 
@@ -33,6 +38,9 @@
 //---Utility functions.---------------------------------------------------
 inline uint64_t GetUint64IndexFrom512BitsKey ( const void * _pKey, int pos );
 
+/** Number of full proof-of-work hash evaluations done by CBlockHeader::GetHash() in this process. */
+uint64_t GetAmountOfPoWHashEvaluations ();
+
 
 
 /** Nodes collect new transactions into a block, hash them into a hash tree,
@@ -59,7 +67,24 @@ public:
     uint256 ( CBlockHeader::* aHashFunctions [ I_AMOUNT_OF_HASH_FUNCTIONS ] ) ( void *, uint32_t ) const;
     //void * m_pPreviousBlockIndex = nullptr;
 
-    CBlockHeader()
+private:
+    // memory only
+    // Proof-of-work hash of the header bytes stored in aCachedHeader. GetHash() compares
+    // the current fields against aCachedHeader, so direct writes to nNonce, nTime etc.
+    // invalidate the cache without any explicit bookkeeping.
+    // A header shared between threads is hashed through const methods only, so the memo is
+    // guarded by nCacheState: readers pin a published memo, and a new one is only written
+    // while nobody else uses the memo, otherwise the hash is returned without memoizing it.
+    mutable std::atomic<uint32_t> nCacheState;
+    mutable uint256 hashCached;
+    mutable unsigned char aCachedHeader [ I_BLOCK_HEADER_SIZE ];
+
+    bool PinHashCache() const;
+    void UnpinHashCache() const;
+    void WriteHashCache(const uint256& hash) const;
+
+public:
+    CBlockHeader() : nCacheState(0)
     {
         SetNull();
 
@@ -68,6 +93,13 @@ public:
 
     }
 
+    CBlockHeader(const CBlockHeader& other) : nCacheState(0)
+    {
+        *this = other;
+    }
+
+    CBlockHeader& operator=(const CBlockHeader& other);
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -91,6 +123,7 @@ public:
         nBits = 0;
         nNonce = 0;
         //nHeightOfPreviousBlock = 0;
+        nCacheState.store(0, std::memory_order_relaxed);
     }
 
     bool IsNull() const
@@ -101,6 +134,13 @@ public:
     uint256 GetHash() const;
     uint256 GetGenesisInitializationHash() const;
 
+    /** Drop the memoized proof-of-work hash, forcing the next GetHash() to recompute it. */
+    void ResetHashCache() { nCacheState.store(0, std::memory_order_relaxed); }
+    /** Whether GetHash() would return the memoized hash without computing it. */
+    bool IsHashCached() const;
+    /** Memoize a hash known to belong to the current header fields, e.g. from the block index. */
+    void SetHashCache(const uint256& hash) const;
+
     uint256 GetHash_X11( void * _pPreviousBlockIndex, uint32_t _iTimeFromGenesisBlock ) const;
     uint256 GetHash_SHA256AndX11 ( void * _pPreviousBlockIndex, uint32_t _iTimeFromGenesisBlock ) const;
 
@@ -152,14 +192,8 @@ public:
 
     CBlockHeader GetBlockHeader() const
     {
-        CBlockHeader block;
-        block.nVersion       = nVersion;
-        block.hashPrevBlock  = hashPrevBlock;
-        block.hashMerkleRoot = hashMerkleRoot;
-        block.nTime          = nTime;
-        block.nBits          = nBits;
-        block.nNonce         = nNonce;
-        //block.nHeightOfPreviousBlock        = nHeightOfPreviousBlock;
+        // Slicing copy, so that an already computed proof-of-work hash travels with the header.
+        CBlockHeader block(*this);
         return block;
     }
 
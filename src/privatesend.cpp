@@ -64,12 +64,9 @@ bool CDarksendQueue::CheckSignature(const CPubKey& pubKeyMasternode)
 
 bool CDarksendQueue::Relay(CConnman& connman)
 {
-    std::vector<CNode*> vNodesCopy = connman.CopyNodeVector();
-    BOOST_FOREACH(CNode* pnode, vNodesCopy)
-        if(pnode->nVersion >= MIN_PRIVATESEND_PEER_PROTO_VERSION)
-            connman.PushMessage(pnode, NetMsgType::DSQUEUE, (*this));
-
-    connman.ReleaseNodeVector(vNodesCopy);
+    connman.PushMessageToNodes([](CNode* pnode) {
+        return pnode->nVersion >= MIN_PRIVATESEND_PEER_PROTO_VERSION;
+    }, NetMsgType::DSQUEUE, (*this));
     return true;
 }
 
@@ -8,6 +8,8 @@
 #include "util.h"
 #include "utilstrencodings.h"
 
+#include <unordered_map>
+
 #ifndef WIN32
 # include <arpa/inet.h>
 #endif
@@ -276,3 +278,16 @@ const std::vector<std::string> &getAllNetMessageTypes()
 {
     return allNetMessageTypesVec;
 }
+
+int getNetMessageTypeIndex(const std::string &strCommand)
+{
+    static const std::unordered_map<std::string, int> mapIndexes = [] {
+        std::unordered_map<std::string, int> mapIndexesRet;
+        for (size_t i = 0; i < allNetMessageTypesVec.size(); i++)
+            mapIndexesRet.emplace(allNetMessageTypesVec[i], (int)i);
+        return mapIndexesRet;
+    }();
+
+    auto it = mapIndexes.find(strCommand);
+    return it == mapIndexes.end() ? -1 : it->second;
+}
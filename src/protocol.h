@@ -248,6 +248,8 @@ extern const char *MNVERIFY;
 
 /* Get a vector of all valid message types (see above) */
 const std::vector<std::string> &getAllNetMessageTypes();
+/* Get the position of strCommand in getAllNetMessageTypes(), or -1 if it is not a valid message type */
+int getNetMessageTypeIndex(const std::string &strCommand);
 
 /** nServices flags */
 enum ServiceFlags : uint64_t {
@@ -35,6 +35,7 @@
 #include "masternode-sync.h"
 #include "masternodelist.h"
 #include "miner.h"
+#include "miner-telemetry.h"
 
 #include <iostream>
 //#include <algorithm>
@@ -1629,10 +1630,7 @@ bool BitcoinGUI::eventFilter(QObject *object, QEvent *event)
 
 void BitcoinGUI :: timerEvent ( QTimerEvent * event ) {
     QSettings settings;
-    THashRateCounter structureHashRateCounter;
     float fHashRateSum = 0.0f;
-    int iAmountOfHashRates = 0;
-    int i = 0;
 
 
 
@@ -1657,18 +1655,8 @@ void BitcoinGUI :: timerEvent ( QTimerEvent * event ) {
 
 
     if ( event -> timerId () == iTimerId_HashRateUpdate ) {
-    for ( i = 0; i < g_iAmountOfMiningThreads; i ++ ) {   // I_MAX_GENERATE_THREADS * 2
-        structureHashRateCounter = aHashRateCounters [ i ].load ();
-        //if ( structureHashRateCounter.fHashRate > 0.0f ) {
-            fHashRateSum = fHashRateSum + structureHashRateCounter.fHashRate;
-            iAmountOfHashRates = iAmountOfHashRates + 1;
-        //} //-if
-
-    } //-for
-
-    fHashRateSum = fHashRateSum + Wallet_PoolMiner_GetHashesRate ();
-
-    //fprintf(stdout, "BitcoinGUI.timerEvent () : iAmountOfHashRates : %i.\n", iAmountOfHashRates );
+    // Built-in miner threads, averaged over the last 10 seconds.
+    fHashRateSum = MinerTelemetry_GetHashRate () + Wallet_PoolMiner_GetHashesRate ();
 
     //if ( iAmountOfHashRates > 0 ) {
         //fHashRateSum = fHashRateSum / float ( iAmountOfHashRates );
@@ -0,0 +1,108 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "relaycache.h"
+
+#include <limits>
+
+CRelayMessageCache relayMessageCache;
+
+CRelayMessageCache::CRelayMessageCache(size_t nMaxBytesIn)
+: nMaxBytes(nMaxBytesIn),
+  nBytes(0),
+  listEntries(),
+  mapEntries(),
+  nHits(0),
+  nMisses(0)
+{}
+
+void CRelayMessageCache::EraseEntry(std::map<key_t, std::list<entry_t>::iterator>::iterator it)
+{
+    nBytes -= it->second->second.size() + ENTRY_OVERHEAD;
+    listEntries.erase(it->second);
+    mapEntries.erase(it);
+}
+
+void CRelayMessageCache::SetMaxBytes(size_t nMaxBytesIn)
+{
+    LOCK(cs);
+    nMaxBytes = nMaxBytesIn;
+    while (nBytes > nMaxBytes && !listEntries.empty())
+        EraseEntry(mapEntries.find(listEntries.back().first));
+}
+
+bool CRelayMessageCache::Get(const CInv& inv, int nSendVersion, CSerializedNetMsg& msgRet)
+{
+    LOCK(cs);
+    auto it = mapEntries.find(std::make_pair(inv, nSendVersion));
+    if (it == mapEntries.end()) {
+        nMisses++;
+        return false;
+    }
+    nHits++;
+    listEntries.splice(listEntries.begin(), listEntries, it->second);
+    msgRet = it->second->second;
+    return true;
+}
+
+void CRelayMessageCache::Put(const CInv& inv, int nSendVersion, const CSerializedNetMsg& msg)
+{
+    size_t nEntryBytes = msg.size() + ENTRY_OVERHEAD;
+
+    LOCK(cs);
+    if (nEntryBytes > nMaxBytes)
+        return;
+
+    key_t key = std::make_pair(inv, nSendVersion);
+    auto it = mapEntries.find(key);
+    if (it != mapEntries.end())
+        EraseEntry(it);
+
+    while (nBytes + nEntryBytes > nMaxBytes && !listEntries.empty())
+        EraseEntry(mapEntries.find(listEntries.back().first));
+
+    listEntries.push_front(std::make_pair(key, msg));
+    mapEntries[key] = listEntries.begin();
+    nBytes += nEntryBytes;
+}
+
+void CRelayMessageCache::Erase(const CInv& inv)
+{
+    LOCK(cs);
+    auto it = mapEntries.lower_bound(std::make_pair(inv, std::numeric_limits<int>::min()));
+    while (it != mapEntries.end() && it->first.first.type == inv.type && it->first.first.hash == inv.hash)
+        EraseEntry(it++);
+}
+
+void CRelayMessageCache::Clear()
+{
+    LOCK(cs);
+    listEntries.clear();
+    mapEntries.clear();
+    nBytes = 0;
+}
+
+size_t CRelayMessageCache::size() const
+{
+    LOCK(cs);
+    return listEntries.size();
+}
+
+size_t CRelayMessageCache::GetBytes() const
+{
+    LOCK(cs);
+    return nBytes;
+}
+
+uint64_t CRelayMessageCache::GetHits() const
+{
+    LOCK(cs);
+    return nHits;
+}
+
+uint64_t CRelayMessageCache::GetMisses() const
+{
+    LOCK(cs);
+    return nMisses;
+}
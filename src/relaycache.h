@@ -0,0 +1,66 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RELAYCACHE_H
+#define BITCOIN_RELAYCACHE_H
+
+#include "net.h"
+#include "protocol.h"
+#include "sync.h"
+
+#include <list>
+#include <map>
+
+/** Default for -relaycachesize, in megabytes */
+static const unsigned int DEFAULT_RELAY_CACHE_SIZE = 32;
+
+/**
+ * Wire form of recently served inventory (blocks, masternode broadcasts and pings, governance
+ * objects and votes), so that the same object requested by many peers is serialized once.
+ *
+ * Entries are keyed by the inventory and the send version they were serialized for, and evicted
+ * least recently used first when the accounted memory exceeds the limit. The cache does not know
+ * whether an object still exists: callers check their own maps first, and erase an entry whenever
+ * the object behind an inventory hash changes without the hash changing.
+ */
+class CRelayMessageCache
+{
+private:
+    typedef std::pair<CInv, int> key_t;
+    typedef std::pair<key_t, CSerializedNetMsg> entry_t;
+
+    // rough overhead of an entry besides the message itself
+    static const size_t ENTRY_OVERHEAD = 256;
+
+    mutable CCriticalSection cs;
+    size_t nMaxBytes;
+    size_t nBytes;
+    // most recently used first
+    std::list<entry_t> listEntries;
+    std::map<key_t, std::list<entry_t>::iterator> mapEntries;
+    uint64_t nHits;
+    uint64_t nMisses;
+
+    void EraseEntry(std::map<key_t, std::list<entry_t>::iterator>::iterator it);
+
+public:
+    CRelayMessageCache(size_t nMaxBytesIn = DEFAULT_RELAY_CACHE_SIZE * 1024 * 1024);
+
+    void SetMaxBytes(size_t nMaxBytesIn);
+
+    bool Get(const CInv& inv, int nSendVersion, CSerializedNetMsg& msgRet);
+    void Put(const CInv& inv, int nSendVersion, const CSerializedNetMsg& msg);
+    /** Forget inv for every send version */
+    void Erase(const CInv& inv);
+    void Clear();
+
+    size_t size() const;
+    size_t GetBytes() const;
+    uint64_t GetHits() const;
+    uint64_t GetMisses() const;
+};
+
+extern CRelayMessageCache relayMessageCache;
+
+#endif // BITCOIN_RELAYCACHE_H
@@ -561,17 +561,19 @@ UniValue getblock(const UniValue& params, bool fHelp)
     if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
 
-    if(!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
-
     if (!fVerbose)
     {
+        // The block as it is on disk, without deserializing it
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << block;
+        if (!ReadRawBlockFromDisk(ssBlock, pblockindex, Params().MessageStart()))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
         std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
         return strHex;
     }
 
+    if(!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+
     return blockToJSON(block, pblockindex);
 }
 
@@ -680,6 +682,81 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
     return ret;
 }
 
+static UniValue DBStatsToJSON(const CDBStats& stats)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("profile", stats.strProfile));
+    ret.push_back(Pair("block_cache_size", (uint64_t)stats.nBlockCacheSize));
+    ret.push_back(Pair("write_buffer_size", (uint64_t)stats.nWriteBufferSize));
+    ret.push_back(Pair("block_size", (uint64_t)stats.nBlockSize));
+    ret.push_back(Pair("bloom_bits_per_key", stats.nBloomBitsPerKey));
+    ret.push_back(Pair("max_open_files", stats.nMaxOpenFiles));
+    ret.push_back(Pair("approximate_size", stats.nApproximateSize));
+    UniValue files(UniValue::VARR);
+    for (int nFiles : stats.vFilesAtLevel)
+        files.push_back(nFiles);
+    ret.push_back(Pair("files_at_level", files));
+    ret.push_back(Pair("compactions", stats.nCompactions));
+    ret.push_back(Pair("trivial_moves", stats.nTrivialMoves));
+    ret.push_back(Pair("memtable_flushes", stats.nMemTableFlushes));
+    ret.push_back(Pair("write_stalls", stats.nWriteStalls));
+    ret.push_back(Pair("cache_hits", stats.nCacheHits));
+    ret.push_back(Pair("cache_misses", stats.nCacheMisses));
+    uint64_t nLookups = stats.nCacheHits + stats.nCacheMisses;
+    ret.push_back(Pair("cache_hit_ratio", nLookups ? (double)stats.nCacheHits / nLookups : 0.0));
+    ret.push_back(Pair("stats", stats.strStats));
+    return ret;
+}
+
+UniValue getdbstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getdbstats\n"
+            "\nReturns the settings and counters of the LevelDB databases, to size -dbcache with.\n"
+            "Counters start at zero when the node starts.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"chainstate\": {                (json object) The coin database\n"
+            "    \"profile\": \"name\",           (string) The profile its settings come from\n"
+            "    \"block_cache_size\": n,       (numeric) Capacity of the block cache in bytes\n"
+            "    \"write_buffer_size\": n,      (numeric) Size of a write buffer in bytes, up to two are held\n"
+            "    \"block_size\": n,             (numeric) Size of the table blocks in bytes\n"
+            "    \"bloom_bits_per_key\": n,     (numeric) Bloom filter bits per key, 0 for none\n"
+            "    \"max_open_files\": n,         (numeric) Tables kept open\n"
+            "    \"approximate_size\": n,       (numeric) The estimated size of the database on disk\n"
+            "    \"files_at_level\": [ n, ... ], (array) The number of tables of each level\n"
+            "    \"compactions\": n,            (numeric) Compactions that merged tables\n"
+            "    \"trivial_moves\": n,          (numeric) Compactions that moved a table to the next level\n"
+            "    \"memtable_flushes\": n,       (numeric) Write buffers written to level 0\n"
+            "    \"write_stalls\": n,           (numeric) Writes that waited for a compaction\n"
+            "    \"cache_hits\": n,             (numeric) Block cache lookups that hit\n"
+            "    \"cache_misses\": n,           (numeric) Block cache lookups that missed\n"
+            "    \"cache_hit_ratio\": x.xxx,    (numeric) Hits per lookup\n"
+            "    \"stats\": \"text\"              (string) The leveldb.stats property\n"
+            "  },\n"
+            "  \"blockindex\": { ... }          (json object) The block index database, with the address, spent and timestamp indexes\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+        );
+
+    LOCK(cs_main);
+
+    UniValue ret(UniValue::VOBJ);
+    CDBStats stats;
+    if (pcoinsdbview) {
+        pcoinsdbview->GetDBStats(stats);
+        ret.push_back(Pair("chainstate", DBStatsToJSON(stats)));
+    }
+    if (pblocktree) {
+        pblocktree->GetStats(stats);
+        ret.push_back(Pair("blockindex", DBStatsToJSON(stats)));
+    }
+    return ret;
+}
+
 UniValue gettxout(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 2 || params.size() > 3)
@@ -718,8 +795,6 @@ UniValue gettxout(const UniValue& params, bool fHelp)
             + HelpExampleRpc("gettxout", "\"txid\", 1")
         );
 
-    LOCK(cs_main);
-
     UniValue ret(UniValue::VOBJ);
 
     std::string strHash = params[0].get_str();
@@ -730,26 +805,46 @@ UniValue gettxout(const UniValue& params, bool fHelp)
     if (params.size() > 2)
         fMempool = params[2].get_bool();
 
+    // Coins are read from pcoinsTip without cs_main, so that lookups go on while blocks are connected
     Coin coin;
+    uint256 hashBestBlock;
+    bool fInMempool = false;
     if (fMempool) {
         LOCK(mempool.cs);
-        CCoinsViewMemPool view(pcoinsTip, mempool);
-        if (!view.GetCoin(out, coin) || mempool.isSpent(out)) { // TODO: filtering spent coins should be done by the CCoinsViewMemPool
-            return NullUniValue;
-        }
-    } else {
-        if (!pcoinsTip->GetCoin(out, coin)) {
+        if (mempool.isSpent(out))
             return NullUniValue;
+        CTransaction tx;
+        if (mempool.lookup(out.hash, tx)) {
+            if (out.n >= tx.vout.size())
+                return NullUniValue;
+            coin = Coin(tx.vout[out.n], MEMPOOL_HEIGHT, false);
+            hashBestBlock = pcoinsTip->PeekBestBlock();
+            fInMempool = true;
         }
     }
+    if (!fInMempool && !pcoinsTip->PeekCoin(out, coin, hashBestBlock)) {
+        return NullUniValue;
+    }
 
-    BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
-    CBlockIndex *pindex = it->second;
-    ret.push_back(Pair("bestblock", pindex->GetBlockHash().GetHex()));
+    int nBestHeight = -1;
+    {
+        boost::lock_guard<boost::mutex> lock(cs_blockchange);
+        if (latestblock.hash == hashBestBlock)
+            nBestHeight = latestblock.height;
+    }
+    if (nBestHeight < 0) {
+        // The tip moved since the coin was read, and was not announced yet
+        LOCK(cs_main);
+        BlockMap::iterator it = mapBlockIndex.find(hashBestBlock);
+        if (it == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Best block of the coins not found");
+        nBestHeight = it->second->nHeight;
+    }
+    ret.push_back(Pair("bestblock", hashBestBlock.GetHex()));
     if (coin.nHeight == MEMPOOL_HEIGHT) {
         ret.push_back(Pair("confirmations", 0));
     } else {
-        ret.push_back(Pair("confirmations", (int64_t)(pindex->nHeight - coin.nHeight + 1)));
+        ret.push_back(Pair("confirmations", (int64_t)(nBestHeight - coin.nHeight + 1)));
     }
     ret.push_back(Pair("value", ValueFromAmount(coin.out.nValue)));
     UniValue o(UniValue::VOBJ);
@@ -15,8 +15,10 @@
 #include "init.h"
 #include "validation.h"
 #include "miner.h"
+#include "miner-telemetry.h"
 #include "net.h"
 #include "pow.h"
+#include "powhash.h"
 #include "rpc/server.h"
 #include "spork.h"
 #include "txmempool.h"
@@ -168,6 +170,7 @@ UniValue generate(const UniValue& params, bool fHelp)
     unsigned int nExtraNonce = 0;
     UniValue blockHashes(UniValue::VARR);
     uint256 uint256Hash;
+    TPoWHashScratch& powHashScratch = GetThreadPoWHashScratch();
     while (nHeight < nHeightEnd)
     {
         std::unique_ptr<CBlockTemplate> pblocktemplate(CreateNewBlock(Params(), coinbaseScript->reserveScript));
@@ -178,13 +181,26 @@ UniValue generate(const UniValue& params, bool fHelp)
             LOCK(cs_main);
             IncrementExtraNonce(pblock, chainActive.Tip(), nExtraNonce);
         }        
-        uint256Hash = pblock->GetHash();
-        while (!CheckProofOfWork ( uint256Hash, pblock->nBits, Params().GetConsensus()) ) {
-            // Yes, there is a chance every nonce could fail to satisfy the -regtest
-            // target -- 1 in 2^(2^32). That ain't gonna happen.
-            ++pblock->nNonce;
-            uint256Hash = pblock->GetHash();
+        // Yes, there is a chance every nonce could fail to satisfy the -regtest
+        // target -- 1 in 2^(2^32). That ain't gonna happen.
+        TPoWPlan structPoWPlan = GetPoWPlan(*pblock);
+        arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
+        uint256 hashes[I_POW_HASH_MAX_LANES];
+        bool fFound = false;
+        while (!fFound) {
+            GetPoWHashes(structPoWPlan, *pblock, pblock->nNonce, I_POW_HASH_MAX_LANES, hashes, powHashScratch);
+            for (unsigned int i = 0; i < I_POW_HASH_MAX_LANES && !fFound; i++) {
+                if (UintToArith256(hashes[i]) <= hashTarget) {
+                    pblock->nNonce += i;
+                    uint256Hash = hashes[i];
+                    fFound = true;
+                }
+            }
+            if (!fFound)
+                pblock->nNonce += I_POW_HASH_MAX_LANES;
         }
+        if (!CheckProofOfWork(uint256Hash, pblock->nBits, Params().GetConsensus()))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Block template has invalid nBits");
         if (!ProcessNewBlock(Params(), pblock, true, NULL, NULL))
             throw JSONRPCError(RPC_INTERNAL_ERROR, "ProcessNewBlock, block not accepted");
         ++nHeight;
@@ -309,6 +325,39 @@ UniValue setgenerate_in_pool(const UniValue& params, bool fHelp)
     return NullUniValue;
 }
 
+UniValue getminingtelemetry(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getminingtelemetry\n"
+            "\nReturns a json object containing the counters of the built-in miner threads."
+            "\nResult:\n"
+            "{\n"
+            "  \"threads\": n,              (numeric) The number of miner threads\n"
+            "  \"hashespersec\": {          (json object) The hash rate averaged over\n"
+            "    \"10s\": xxx.xx,           (numeric) the last 10 seconds\n"
+            "    \"60s\": xxx.xx,           (numeric) the last minute\n"
+            "    \"15m\": xxx.xx            (numeric) the last 15 minutes\n"
+            "  },\n"
+            "  \"hashes\": nnn,             (numeric) The number of hashes computed\n"
+            "  \"hashlatencyns\": {         (json object) Upper bounds of the nanoseconds per hash percentiles\n"
+            "    \"p50\": n, \"p90\": n, \"p99\": n\n"
+            "  },\n"
+            "  \"templates\": n,            (numeric) The number of block templates built\n"
+            "  \"templateage\": x.xxx,      (numeric) Seconds since the current block template was built\n"
+            "  \"blocksfound\": n,          (numeric) The number of blocks found\n"
+            "  \"staleblocks\": n,          (numeric) Found blocks, which were not accepted\n"
+            "  \"staleslices\": n,          (numeric) Nonce ranges abandoned for a newer template\n"
+            "  \"perthread\": [ ... ]       (array) The same counters for every thread\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getminingtelemetry", "")
+            + HelpExampleRpc("getminingtelemetry", "")
+        );
+
+    return MinerTelemetry_ToJSON(std::max(g_iAmountOfMiningThreads, 0));
+}
+
 UniValue getmininginfo(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 0)
@@ -476,6 +525,13 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
             "  \"curtime\" : ttt,                  (numeric) current timestamp in seconds since epoch (Jan 1 1970 GMT)\n"
             "  \"bits\" : \"xxx\",                 (string) compressed target of next block\n"
             "  \"height\" : n                      (numeric) The height of the next block\n"
+            "  \"powplan\" : {                     (json object) proof-of-work pipeline of the template, valid while \"bits\" and the week of \"curtime\" stay the same\n"
+            "      \"algorithm\" : \"xxxx\",         (string) \"x11\" or \"sha256andx11\"\n"
+            "      \"week\" : n,                   (numeric) start of the reconfiguration week, in seconds from the genesis block\n"
+            "      \"hashfunction1\" : \"xxxx\",     (string) first variable hash function\n"
+            "      \"encryption\" : \"xxxx\",        (string) encryption function\n"
+            "      \"hashfunction2\" : \"xxxx\"      (string) second variable hash function\n"
+            "  },\n"
             "  \"masternode\" : {                  (json object) required masternode payee that must be included in the next block\n"
             "      \"payee\" : \"xxxx\",             (string) payee address\n"
             "      \"script\" : \"xxxx\",            (string) payee scriptPubKey\n"
@@ -792,6 +848,18 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
     result.push_back(Pair("bits", strprintf("%08x", pblock->nBits)));
     result.push_back(Pair("height", (int64_t)(pindexPrev->nHeight+1)));
 
+    // Same plan as the built-in miner and block validation use for this header.
+    TPoWPlan structPoWPlan = GetPoWPlan(*pblock);
+    UniValue powPlanObj(UniValue::VOBJ);
+    powPlanObj.push_back(Pair("algorithm", structPoWPlan.bIsSHA256AndX11 ? "sha256andx11" : "x11"));
+    if (structPoWPlan.bIsSHA256AndX11) {
+        powPlanObj.push_back(Pair("week", (int64_t)structPoWPlan.iWeekNumber));
+        powPlanObj.push_back(Pair("hashfunction1", structPoWPlan.GetFirstVariableHashFunctionName()));
+        powPlanObj.push_back(Pair("encryption", structPoWPlan.GetEncryptionFunctionName()));
+        powPlanObj.push_back(Pair("hashfunction2", structPoWPlan.GetSecondVariableHashFunctionName()));
+    }
+    result.push_back(Pair("powplan", powPlanObj));
+
     UniValue masternodeObj(UniValue::VOBJ);
     if(pblock->txoutMasternode != CTxOut()) {
         CTxDestination address1;
@@ -9,9 +9,12 @@
 #include "clientversion.h"
 #include "validation.h"
 #include "net.h"
+#include "messagesigner.h"
+#include "msgprecheck.h"
 #include "net_processing.h"
 #include "netbase.h"
 #include "protocol.h"
+#include "relaycache.h"
 #include "sync.h"
 #include "timedata.h"
 #include "ui_interface.h"
@@ -109,6 +112,10 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
             "       \"addr\": n,             (numeric) The total bytes received aggregated by message type\n"
             "       ...\n"
             "    }\n"
+            "    \"timeprocessed_per_msg\": {\n"
+            "       \"addr\": n,             (numeric) The total microseconds spent processing the received messages, aggregated by message type\n"
+            "       ...\n"
+            "    }\n"
             "  }\n"
             "  ,...\n"
             "]\n"
@@ -180,6 +187,13 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
         }
         obj.push_back(Pair("bytesrecv_per_msg", recvPerMsgCmd));
 
+        UniValue processPerMsgCmd(UniValue::VOBJ);
+        BOOST_FOREACH(const mapMsgCmdSize::value_type &i, stats.mapProcessTimePerMsgCmd) {
+            if (i.second > 0)
+                processPerMsgCmd.push_back(Pair(i.first, i.second));
+        }
+        obj.push_back(Pair("timeprocessed_per_msg", processPerMsgCmd));
+
         ret.push_back(obj);
     }
 
@@ -322,6 +336,45 @@ UniValue getaddednodeinfo(const UniValue& params, bool fHelp)
     return ret;
 }
 
+UniValue getnetmsgstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 0)
+        throw runtime_error(
+            "getnetmsgstats\n"
+            "\nReturns statistics about the received network messages since startup, by message type.\n"
+            "Types which were never received are left out.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"addr\": {                  (json object) The message type\n"
+            "    \"count\": n,              (numeric) The number of messages\n"
+            "    \"bytes\": n,              (numeric) The total size of the messages, including the headers\n"
+            "    \"timeprocessed\": n,      (numeric) The total microseconds spent processing them\n"
+            "    \"maxtimeprocessed\": n    (numeric) The longest time spent on one message, in microseconds\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getnetmsgstats", "")
+            + HelpExampleRpc("getnetmsgstats", "")
+        );
+
+    std::vector<CNetMessageStats> vecStats;
+    GetNetMessageStats(vecStats);
+
+    UniValue ret(UniValue::VOBJ);
+    BOOST_FOREACH(const CNetMessageStats& stats, vecStats) {
+        if (stats.nCount == 0)
+            continue;
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("count", stats.nCount));
+        obj.push_back(Pair("bytes", stats.nBytes));
+        obj.push_back(Pair("timeprocessed", stats.nTimeMicros));
+        obj.push_back(Pair("maxtimeprocessed", stats.nMaxTimeMicros));
+        ret.push_back(Pair(stats.strCommand, obj));
+    }
+    return ret;
+}
+
 UniValue getnettotals(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() > 0)
@@ -342,6 +395,21 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
             "    \"serve_historical_blocks\": true|false,  (boolean) True if serving historical blocks\n"
             "    \"bytes_left_in_cycle\": t,               (numeric) Bytes left in current time cycle\n"
             "    \"time_left_in_cycle\": t                 (numeric) Seconds left in current time cycle\n"
+            "  },\n"
+            "  \"relaycache\":\n"
+            "  {\n"
+            "    \"entries\": n,                           (numeric) Serialized messages kept for answering getdata\n"
+            "    \"bytes\": n,                             (numeric) Memory accounted to them\n"
+            "    \"hits\": n,                              (numeric) Requests answered from the cache\n"
+            "    \"misses\": n                             (numeric) Requests that had to serialize the object\n"
+            "  },\n"
+            "  \"msgprecheck\":\n"
+            "  {\n"
+            "    \"queued\": n,                            (numeric) Masternode messages and batched signatures waiting for a precheck thread\n"
+            "    \"checked\": n,                           (numeric) Messages whose signers were recovered ahead of processing\n"
+            "    \"failed\": n,                            (numeric) Messages that could not be decoded or recovered\n"
+            "    \"dropped\": n,                           (numeric) Messages not prechecked because the queue was full\n"
+            "    \"hits\": n                               (numeric) Signature checks answered by a precheck or an earlier verification\n"
             "  }\n"
             "}\n"
             "\nExamples:\n"
@@ -364,6 +432,21 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
     outboundLimit.push_back(Pair("bytes_left_in_cycle", g_connman->GetOutboundTargetBytesLeft()));
     outboundLimit.push_back(Pair("time_left_in_cycle", g_connman->GetMaxOutboundTimeLeftInCycle()));
     obj.push_back(Pair("uploadtarget", outboundLimit));
+
+    UniValue relayCache(UniValue::VOBJ);
+    relayCache.push_back(Pair("entries", (uint64_t)relayMessageCache.size()));
+    relayCache.push_back(Pair("bytes", (uint64_t)relayMessageCache.GetBytes()));
+    relayCache.push_back(Pair("hits", relayMessageCache.GetHits()));
+    relayCache.push_back(Pair("misses", relayMessageCache.GetMisses()));
+    obj.push_back(Pair("relaycache", relayCache));
+
+    UniValue msgPrecheck(UniValue::VOBJ);
+    msgPrecheck.push_back(Pair("queued", (uint64_t)messagePrecheckQueue.size()));
+    msgPrecheck.push_back(Pair("checked", messagePrecheckQueue.nChecked.load()));
+    msgPrecheck.push_back(Pair("failed", messagePrecheckQueue.nFailed.load()));
+    msgPrecheck.push_back(Pair("dropped", messagePrecheckQueue.nDropped.load()));
+    msgPrecheck.push_back(Pair("hits", CHashSigner::GetPrecheckHits()));
+    obj.push_back(Pair("msgprecheck", msgPrecheck));
     return obj;
 }
 
@@ -0,0 +1,355 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "socketevents.h"
+
+#include <algorithm>
+#include <atomic>
+#include <errno.h>
+#include <map>
+
+#ifndef WIN32
+#include <poll.h>
+#endif
+#if defined(__linux__)
+#include <sys/epoll.h>
+#endif
+
+static std::atomic<int> nSocketEventsMode(DEFAULT_SOCKETEVENTS);
+
+bool ParseSocketEventsMode(const std::string& strMode, SocketEventsMode& modeRet)
+{
+    if (strMode == "select") {
+        modeRet = SOCKETEVENTS_SELECT;
+        return true;
+    }
+#ifndef WIN32
+    if (strMode == "poll") {
+        modeRet = SOCKETEVENTS_POLL;
+        return true;
+    }
+#endif
+#if defined(__linux__)
+    if (strMode == "epoll") {
+        modeRet = SOCKETEVENTS_EPOLL;
+        return true;
+    }
+#endif
+    return false;
+}
+
+std::string GetSocketEventsModeName(SocketEventsMode mode)
+{
+    switch (mode) {
+        case SOCKETEVENTS_SELECT: return "select";
+        case SOCKETEVENTS_POLL:   return "poll";
+        case SOCKETEVENTS_EPOLL:  return "epoll";
+    }
+    return "unknown";
+}
+
+std::string GetSupportedSocketEventsModes()
+{
+    std::string strModes;
+#if defined(__linux__)
+    strModes += "epoll, ";
+#endif
+#ifndef WIN32
+    strModes += "poll, ";
+#endif
+    strModes += "select";
+    return strModes;
+}
+
+void SetSocketEventsMode(SocketEventsMode mode)
+{
+    nSocketEventsMode = mode;
+}
+
+SocketEventsMode GetSocketEventsMode()
+{
+    return (SocketEventsMode)nSocketEventsMode.load();
+}
+
+bool IsWatchableSocket(SOCKET hSocket)
+{
+    if (GetSocketEventsMode() == SOCKETEVENTS_SELECT)
+        return IsSelectableSocket(hSocket);
+    return hSocket != INVALID_SOCKET;
+}
+
+namespace {
+
+class CSocketEventsSelect : public CSocketEvents
+{
+private:
+    std::map<SOCKET, unsigned int> mapSockets;
+
+public:
+    SocketEventsMode GetMode() const override { return SOCKETEVENTS_SELECT; }
+
+    bool Add(SOCKET hSocket, unsigned int nEvents) override
+    {
+        if (!IsSelectableSocket(hSocket))
+            return false;
+        mapSockets[hSocket] = nEvents;
+        return true;
+    }
+
+    bool Modify(SOCKET hSocket, unsigned int nEvents) override
+    {
+        return Add(hSocket, nEvents);
+    }
+
+    void Remove(SOCKET hSocket) override
+    {
+        mapSockets.erase(hSocket);
+    }
+
+    bool Wait(int64_t nTimeoutMillis, events_vec_t& vEventsRet) override
+    {
+        vEventsRet.clear();
+
+        fd_set fdsetRecv;
+        fd_set fdsetSend;
+        fd_set fdsetError;
+        FD_ZERO(&fdsetRecv);
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        SOCKET hSocketMax = 0;
+
+        for (const auto& socketpair : mapSockets) {
+            if (socketpair.second & EVENT_RECV)
+                FD_SET(socketpair.first, &fdsetRecv);
+            if (socketpair.second & EVENT_SEND)
+                FD_SET(socketpair.first, &fdsetSend);
+            FD_SET(socketpair.first, &fdsetError);
+            hSocketMax = std::max(hSocketMax, socketpair.first);
+        }
+
+        struct timeval timeout;
+        timeout.tv_sec  = nTimeoutMillis / 1000;
+        timeout.tv_usec = (nTimeoutMillis % 1000) * 1000;
+
+        int nSelect = select(mapSockets.empty() ? 0 : hSocketMax + 1, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        if (nSelect == SOCKET_ERROR)
+            return false;
+        if (nSelect == 0)
+            return true;
+
+        for (const auto& socketpair : mapSockets) {
+            unsigned int nEvents = 0;
+            if (FD_ISSET(socketpair.first, &fdsetRecv))
+                nEvents |= EVENT_RECV;
+            if (FD_ISSET(socketpair.first, &fdsetSend))
+                nEvents |= EVENT_SEND;
+            if (FD_ISSET(socketpair.first, &fdsetError))
+                nEvents |= EVENT_ERROR;
+            if (nEvents)
+                vEventsRet.push_back(std::make_pair(socketpair.first, nEvents));
+        }
+        return true;
+    }
+};
+
+#ifndef WIN32
+class CSocketEventsPoll : public CSocketEvents
+{
+private:
+    std::vector<struct pollfd> vPollFds;
+    // position of every registered socket in vPollFds
+    std::map<SOCKET, size_t> mapPositions;
+
+    static short ToPollEvents(unsigned int nEvents)
+    {
+        short nPollEvents = 0;
+        if (nEvents & EVENT_RECV)
+            nPollEvents |= POLLIN;
+        if (nEvents & EVENT_SEND)
+            nPollEvents |= POLLOUT;
+        return nPollEvents;
+    }
+
+public:
+    SocketEventsMode GetMode() const override { return SOCKETEVENTS_POLL; }
+
+    bool Add(SOCKET hSocket, unsigned int nEvents) override
+    {
+        if (hSocket == INVALID_SOCKET)
+            return false;
+        auto it = mapPositions.find(hSocket);
+        if (it != mapPositions.end()) {
+            vPollFds[it->second].events = ToPollEvents(nEvents);
+            return true;
+        }
+        struct pollfd pfd;
+        pfd.fd = hSocket;
+        pfd.events = ToPollEvents(nEvents);
+        pfd.revents = 0;
+        mapPositions[hSocket] = vPollFds.size();
+        vPollFds.push_back(pfd);
+        return true;
+    }
+
+    bool Modify(SOCKET hSocket, unsigned int nEvents) override
+    {
+        return Add(hSocket, nEvents);
+    }
+
+    void Remove(SOCKET hSocket) override
+    {
+        auto it = mapPositions.find(hSocket);
+        if (it == mapPositions.end())
+            return;
+        // move the last entry into the hole
+        size_t nPos = it->second;
+        mapPositions.erase(it);
+        if (nPos != vPollFds.size() - 1) {
+            vPollFds[nPos] = vPollFds.back();
+            mapPositions[vPollFds[nPos].fd] = nPos;
+        }
+        vPollFds.pop_back();
+    }
+
+    bool Wait(int64_t nTimeoutMillis, events_vec_t& vEventsRet) override
+    {
+        vEventsRet.clear();
+
+        int nRet = poll(vPollFds.data(), vPollFds.size(), nTimeoutMillis);
+        if (nRet == SOCKET_ERROR)
+            return errno == EINTR;
+
+        for (size_t i = 0; i < vPollFds.size() && (int)vEventsRet.size() < nRet; i++) {
+            const struct pollfd& pfd = vPollFds[i];
+            if (!pfd.revents)
+                continue;
+            unsigned int nEvents = 0;
+            if (pfd.revents & POLLIN)
+                nEvents |= EVENT_RECV;
+            if (pfd.revents & POLLOUT)
+                nEvents |= EVENT_SEND;
+            if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))
+                nEvents |= EVENT_ERROR;
+            vEventsRet.push_back(std::make_pair(pfd.fd, nEvents));
+        }
+        return true;
+    }
+};
+#endif // WIN32
+
+#if defined(__linux__)
+class CSocketEventsEpoll : public CSocketEvents
+{
+private:
+    int hEpoll;
+    std::vector<struct epoll_event> vEpollEvents;
+
+    static const size_t MAX_EVENTS_PER_WAIT = 1024;
+
+    bool Control(int nOp, SOCKET hSocket, unsigned int nEvents)
+    {
+        struct epoll_event event;
+        event.events = 0;
+        if (nEvents & EVENT_RECV)
+            event.events |= EPOLLIN;
+        if (nEvents & EVENT_SEND)
+            event.events |= EPOLLOUT;
+        event.data.u64 = 0;
+        event.data.fd = hSocket;
+        return epoll_ctl(hEpoll, nOp, hSocket, &event) == 0;
+    }
+
+public:
+    CSocketEventsEpoll() : hEpoll(epoll_create1(EPOLL_CLOEXEC)), vEpollEvents(MAX_EVENTS_PER_WAIT) {}
+
+    ~CSocketEventsEpoll()
+    {
+        if (hEpoll != -1)
+            close(hEpoll);
+    }
+
+    bool IsValid() const { return hEpoll != -1; }
+
+    SocketEventsMode GetMode() const override { return SOCKETEVENTS_EPOLL; }
+
+    bool Add(SOCKET hSocket, unsigned int nEvents) override
+    {
+        if (hSocket == INVALID_SOCKET)
+            return false;
+        if (Control(EPOLL_CTL_ADD, hSocket, nEvents))
+            return true;
+        // a socket number which is still registered, because it was not removed before it was
+        // closed and the old descriptor is kept open elsewhere
+        return errno == EEXIST && Control(EPOLL_CTL_MOD, hSocket, nEvents);
+    }
+
+    bool Modify(SOCKET hSocket, unsigned int nEvents) override
+    {
+        if (hSocket == INVALID_SOCKET)
+            return false;
+        if (Control(EPOLL_CTL_MOD, hSocket, nEvents))
+            return true;
+        // closed sockets are dropped by the kernel, and the number may have been reused since
+        return errno == ENOENT && Control(EPOLL_CTL_ADD, hSocket, nEvents);
+    }
+
+    void Remove(SOCKET hSocket) override
+    {
+        if (hSocket == INVALID_SOCKET)
+            return;
+        struct epoll_event event;
+        epoll_ctl(hEpoll, EPOLL_CTL_DEL, hSocket, &event);
+    }
+
+    bool Wait(int64_t nTimeoutMillis, events_vec_t& vEventsRet) override
+    {
+        vEventsRet.clear();
+
+        // level triggered, sockets beyond MAX_EVENTS_PER_WAIT are reported by the next call
+        int nRet = epoll_wait(hEpoll, vEpollEvents.data(), vEpollEvents.size(), nTimeoutMillis);
+        if (nRet == -1)
+            return errno == EINTR;
+
+        vEventsRet.reserve(nRet);
+        for (int i = 0; i < nRet; i++) {
+            const struct epoll_event& event = vEpollEvents[i];
+            unsigned int nEvents = 0;
+            if (event.events & EPOLLIN)
+                nEvents |= EVENT_RECV;
+            if (event.events & EPOLLOUT)
+                nEvents |= EVENT_SEND;
+            if (event.events & (EPOLLERR | EPOLLHUP))
+                nEvents |= EVENT_ERROR;
+            vEventsRet.push_back(std::make_pair((SOCKET)event.data.fd, nEvents));
+        }
+        return true;
+    }
+};
+#endif // __linux__
+
+} // anon namespace
+
+std::unique_ptr<CSocketEvents> CreateSocketEvents(SocketEventsMode mode)
+{
+    switch (mode) {
+        case SOCKETEVENTS_SELECT:
+            return std::unique_ptr<CSocketEvents>(new CSocketEventsSelect());
+        case SOCKETEVENTS_POLL:
+#ifndef WIN32
+            return std::unique_ptr<CSocketEvents>(new CSocketEventsPoll());
+#else
+            break;
+#endif
+        case SOCKETEVENTS_EPOLL:
+#if defined(__linux__)
+        {
+            std::unique_ptr<CSocketEventsEpoll> pEpoll(new CSocketEventsEpoll());
+            if (pEpoll->IsValid())
+                return std::unique_ptr<CSocketEvents>(pEpoll.release());
+        }
+#endif
+            break;
+    }
+    return std::unique_ptr<CSocketEvents>();
+}
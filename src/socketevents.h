@@ -0,0 +1,79 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SOCKETEVENTS_H
+#define BITCOIN_SOCKETEVENTS_H
+
+#include "compat.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** Backends of CSocketEvents. */
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT,
+    SOCKETEVENTS_POLL,
+    SOCKETEVENTS_EPOLL,
+};
+
+#if defined(__linux__)
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_EPOLL;
+#elif !defined(WIN32)
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_POLL;
+#else
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_SELECT;
+#endif
+
+/** Parse the value of -socketevents, false if it is unknown or not available on this platform */
+bool ParseSocketEventsMode(const std::string& strMode, SocketEventsMode& modeRet);
+std::string GetSocketEventsModeName(SocketEventsMode mode);
+/** Comma separated names of the modes available on this platform, for the help message */
+std::string GetSupportedSocketEventsModes();
+
+/** Backend CConnman uses, set once during startup before any socket is created */
+void SetSocketEventsMode(SocketEventsMode mode);
+SocketEventsMode GetSocketEventsMode();
+
+/** Whether the socket can be watched by the backend in use: select() is limited to FD_SETSIZE */
+bool IsWatchableSocket(SOCKET hSocket);
+
+/**
+ * Readiness notification for a set of sockets. A socket is registered once with the events it
+ * should be watched for, and only registered again when these change, so that a wait does not
+ * have to pass all the sockets to the kernel.
+ *
+ * Errors and hang-ups are reported as EVENT_ERROR for every registered socket.
+ * Not thread safe, CConnman uses it from the socket handler thread only.
+ */
+class CSocketEvents
+{
+public:
+    static const unsigned int EVENT_RECV = 1;
+    static const unsigned int EVENT_SEND = 2;
+    static const unsigned int EVENT_ERROR = 4;
+
+    typedef std::vector<std::pair<SOCKET, unsigned int> > events_vec_t;
+
+    virtual ~CSocketEvents() {}
+
+    virtual SocketEventsMode GetMode() const = 0;
+    std::string GetName() const { return GetSocketEventsModeName(GetMode()); }
+
+    /** Watch hSocket for nEvents (EVENT_RECV and/or EVENT_SEND, or none to only watch for errors) */
+    virtual bool Add(SOCKET hSocket, unsigned int nEvents) = 0;
+    virtual bool Modify(SOCKET hSocket, unsigned int nEvents) = 0;
+    /** Stop watching hSocket, must be called before it is closed, but it is harmless after */
+    virtual void Remove(SOCKET hSocket) = 0;
+
+    /** Wait up to nTimeoutMillis for events of the registered sockets. vEventsRet receives the
+     *  sockets that are ready and what they are ready for. False on an error of the wait itself. */
+    virtual bool Wait(int64_t nTimeoutMillis, events_vec_t& vEventsRet) = 0;
+};
+
+/** Create a backend of the given mode, NULL if it is not available on this platform */
+std::unique_ptr<CSocketEvents> CreateSocketEvents(SocketEventsMode mode);
+
+#endif // BITCOIN_SOCKETEVENTS_H
@@ -304,7 +304,12 @@ public:
     }
 
     void GetAndClear(CSerializeData &data) {
-        data.insert(data.end(), begin(), end());
+        if (data.empty() && nReadPos == 0) {
+            // nothing to append to, hand the buffer over instead of copying it
+            data.swap(vch);
+        } else {
+            data.insert(data.end(), begin(), end());
+        }
         clear();
     }
 
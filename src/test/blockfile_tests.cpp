@@ -0,0 +1,197 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilemap.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "validation.h"
+
+#include "test/test_binarium.h"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+CBlock MakeUnminedBlock()
+{
+    CBlock block;
+    block.nVersion = 1;
+    block.hashPrevBlock = Params().GenesisBlock().GetHash();
+    block.nTime = Params().GenesisBlock().nTime + 150;
+    block.nBits = 0x1d00ffff;
+    block.nNonce = 1;
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << 1 << OP_0;
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 50 * COIN;
+    block.vtx.push_back(CTransaction(tx));
+    return block;
+}
+
+void FlipByte(const CDiskBlockPos& pos, unsigned int nOffset)
+{
+    FILE* file = OpenBlockFile(CDiskBlockPos(pos.nFile, pos.nPos + nOffset));
+    BOOST_REQUIRE(file);
+    int c = fgetc(file);
+    BOOST_REQUIRE(c != EOF);
+    fseek(file, -1, SEEK_CUR);
+    fputc(c ^ 1, file);
+    fclose(file);
+}
+
+} // anon namespace
+
+BOOST_FIXTURE_TEST_SUITE(blockfile_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(blockfile_genesis_checksum)
+{
+    const CBlockIndex* pindexGenesis = chainActive.Genesis();
+    BOOST_REQUIRE(pindexGenesis);
+    BOOST_CHECK(pindexGenesis->nStatus & BLOCK_HAVE_CHECKSUM);
+
+    uint64_t nEvaluations = GetAmountOfPoWHashEvaluations();
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, pindexGenesis, Params().GetConsensus()));
+    BOOST_CHECK(block.GetHash() == Params().GenesisBlock().GetHash());
+    BOOST_CHECK_EQUAL(GetAmountOfPoWHashEvaluations(), nEvaluations);
+}
+
+BOOST_AUTO_TEST_CASE(blockfile_checksummed_reads)
+{
+    CBlock blockWritten = MakeUnminedBlock();
+    uint256 hash = blockWritten.GetHash();
+    CDiskBlockPos pos(1, 0);
+    BOOST_REQUIRE(WriteBlockToDisk(blockWritten, pos, Params().MessageStart()));
+    BOOST_CHECK_EQUAL(pos.nPos, 8U);
+
+    CBlockIndex index;
+    index.phashBlock = &hash;
+    index.nFile = pos.nFile;
+    index.nDataPos = pos.nPos;
+    index.nStatus = BLOCK_HAVE_DATA | BLOCK_HAVE_CHECKSUM;
+
+    // the hash of the index is trusted, nothing is hashed again
+    uint64_t nEvaluations = GetAmountOfPoWHashEvaluations();
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, &index, Params().GetConsensus()));
+    BOOST_CHECK(block.IsHashCached());
+    BOOST_CHECK(block.GetHash() == hash);
+    BOOST_CHECK(block.vtx[0].GetHash() == blockWritten.vtx[0].GetHash());
+    BOOST_CHECK_EQUAL(GetAmountOfPoWHashEvaluations(), nEvaluations);
+
+    // records without the flag and paranoid reads check the proof of work, which this block has not
+    index.nStatus = BLOCK_HAVE_DATA;
+    BOOST_CHECK(!ReadBlockFromDisk(block, &index, Params().GetConsensus()));
+    index.nStatus = BLOCK_HAVE_DATA | BLOCK_HAVE_CHECKSUM;
+    fParanoidBlockReads = true;
+    BOOST_CHECK(!ReadBlockFromDisk(block, &index, Params().GetConsensus()));
+    fParanoidBlockReads = DEFAULT_PARANOID_BLOCK_READS;
+    BOOST_CHECK(ReadBlockFromDisk(block, &index, Params().GetConsensus()));
+
+    // the checksum is bound to the hash of the index
+    uint256 hashOther = uint256S("01");
+    index.phashBlock = &hashOther;
+    BOOST_CHECK(!ReadBlockFromDisk(block, &index, Params().GetConsensus()));
+    index.phashBlock = &hash;
+
+    // a corrupted transaction is caught without hashing anything
+    unsigned int nSize = ::GetSerializeSize(blockWritten, SER_DISK, CLIENT_VERSION);
+    FlipByte(pos, nSize - 5);
+    BOOST_CHECK(!ReadBlockFromDisk(block, &index, Params().GetConsensus()));
+    FlipByte(pos, nSize - 5);
+    BOOST_CHECK(ReadBlockFromDisk(block, &index, Params().GetConsensus()));
+
+    // and so is a corrupted checksum
+    FlipByte(pos, nSize);
+    BOOST_CHECK(!ReadBlockFromDisk(block, &index, Params().GetConsensus()));
+}
+
+BOOST_AUTO_TEST_CASE(blockfile_raw_reads)
+{
+    CBlock blockWritten = MakeUnminedBlock();
+    uint256 hash = blockWritten.GetHash();
+    CDiskBlockPos pos(1, 0);
+    BOOST_REQUIRE(WriteBlockToDisk(blockWritten, pos, Params().MessageStart()));
+
+    CBlockIndex index;
+    index.phashBlock = &hash;
+    index.nFile = pos.nFile;
+    index.nDataPos = pos.nPos;
+    index.nStatus = BLOCK_HAVE_DATA | BLOCK_HAVE_CHECKSUM;
+
+    // the bytes on disk are the network serialization of the block, without the checksum
+    CDataStream ssExpected(SER_NETWORK, PROTOCOL_VERSION);
+    ssExpected << blockWritten;
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK(ReadRawBlockFromDisk(ssBlock, &index, Params().MessageStart()));
+    BOOST_CHECK(ssBlock.str() == ssExpected.str());
+
+    // records without a checksum are checked against their header
+    index.nStatus = BLOCK_HAVE_DATA;
+    BOOST_CHECK(ReadRawBlockFromDisk(ssBlock, &index, Params().MessageStart()));
+    BOOST_CHECK(ssBlock.str() == ssExpected.str());
+    uint256 hashOther = uint256S("01");
+    index.phashBlock = &hashOther;
+    BOOST_CHECK(!ReadRawBlockFromDisk(ssBlock, &index, Params().MessageStart()));
+    index.phashBlock = &hash;
+
+    // a block appended after the file was mapped is read too
+    CDiskBlockPos posNext(1, boost::filesystem::file_size(GetBlockPosFilename(pos, "blk")));
+    blockWritten.nNonce++;
+    uint256 hashNext = blockWritten.GetHash();
+    BOOST_REQUIRE(WriteBlockToDisk(blockWritten, posNext, Params().MessageStart()));
+    BOOST_CHECK(posNext.nPos > pos.nPos);
+    CBlockIndex indexNext;
+    indexNext.phashBlock = &hashNext;
+    indexNext.nFile = posNext.nFile;
+    indexNext.nDataPos = posNext.nPos;
+    indexNext.nStatus = BLOCK_HAVE_DATA | BLOCK_HAVE_CHECKSUM;
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, &indexNext, Params().GetConsensus()));
+    BOOST_CHECK(block.GetHash() == hashNext);
+
+    // wrong network magic
+    CMessageHeader::MessageStartChars messageStart;
+    memcpy(messageStart, Params().MessageStart(), sizeof(messageStart));
+    messageStart[0] ^= 1;
+    BOOST_CHECK(!ReadRawBlockFromDisk(ssBlock, &index, messageStart));
+}
+
+BOOST_AUTO_TEST_CASE(blockfile_map_cache)
+{
+    CBlockFileMapCache cache(2);
+    std::vector<unsigned char> vch(64);
+    for (int nFile = 1; nFile <= 3; nFile++) {
+        CDiskBlockPos pos(nFile, 0);
+        BOOST_REQUIRE(WriteBlockToDisk(MakeUnminedBlock(), pos, Params().MessageStart()));
+    }
+
+    BOOST_CHECK(cache.Read(CDiskBlockPos(1, 0), vch.data(), 4));
+    BOOST_CHECK(std::equal(vch.begin(), vch.begin() + 4, Params().MessageStart()));
+    BOOST_CHECK(cache.Read(CDiskBlockPos(2, 8), vch.data(), vch.size()));
+    BOOST_CHECK(cache.Read(CDiskBlockPos(1, 8), vch.data(), vch.size()));
+    BOOST_CHECK_EQUAL(cache.GetMaps(), 2U);
+
+    // the least recently used file is unmapped
+    BOOST_CHECK(cache.Read(CDiskBlockPos(3, 8), vch.data(), vch.size()));
+    BOOST_CHECK_EQUAL(cache.size(), 2U);
+    BOOST_CHECK(cache.Read(CDiskBlockPos(1, 8), vch.data(), vch.size()));
+    BOOST_CHECK_EQUAL(cache.GetMaps(), 3U);
+    BOOST_CHECK(cache.Read(CDiskBlockPos(2, 8), vch.data(), vch.size()));
+    BOOST_CHECK_EQUAL(cache.GetMaps(), 4U);
+
+    // past the end of a file, or a missing file
+    size_t nFileSize = boost::filesystem::file_size(GetBlockPosFilename(CDiskBlockPos(2, 0), "blk"));
+    BOOST_CHECK(!cache.Read(CDiskBlockPos(2, nFileSize - 8), vch.data(), vch.size()));
+    BOOST_CHECK(!cache.Read(CDiskBlockPos(4, 0), vch.data(), vch.size()));
+
+    cache.Unmap(2);
+    BOOST_CHECK_EQUAL(cache.size(), 1U);
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.size(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
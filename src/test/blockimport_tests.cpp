@@ -0,0 +1,170 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockimport.h"
+
+#include "chainparams.h"
+#include "consensus/consensus.h"
+#include "consensus/validation.h"
+#include "txdb.h"
+#include "validation.h"
+
+#include "test/test_binarium.h"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+CBlock MakeUnminedBlock(uint32_t nNonce)
+{
+    CBlock block;
+    block.nVersion = 1;
+    block.hashPrevBlock = Params().GenesisBlock().GetHash();
+    block.nTime = Params().GenesisBlock().nTime + 150;
+    block.nBits = 0x1d00ffff;
+    block.nNonce = nNonce;
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << nNonce << OP_0;
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 50 * COIN;
+    block.vtx.push_back(CTransaction(tx));
+    return block;
+}
+
+// Append a block to a block file, the way WriteBlockToDisk writes it
+CDiskBlockPos AppendBlock(int nFile, const CBlock& block)
+{
+    CDiskBlockPos pos(nFile, 0);
+    boost::filesystem::path path = GetBlockPosFilename(pos, "blk");
+    if (boost::filesystem::exists(path))
+        pos.nPos = boost::filesystem::file_size(path);
+    BOOST_REQUIRE(WriteBlockToDisk(block, pos, Params().MessageStart()));
+    return pos;
+}
+
+void AppendBytes(int nFile, const CDataStream& ss)
+{
+    CDiskBlockPos pos(nFile, boost::filesystem::file_size(GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk")));
+    CAutoFile file(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(!file.IsNull());
+    file.write(&ss[0], ss.size());
+}
+
+} // anon namespace
+
+BOOST_FIXTURE_TEST_SUITE(blockimport_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(blockimport_records)
+{
+    std::vector<CBlock> vBlocks;
+    std::vector<CDiskBlockPos> vPos;
+    for (uint32_t i = 0; i < 3; i++)
+        vBlocks.push_back(MakeUnminedBlock(i));
+
+    vPos.push_back(AppendBlock(1, vBlocks[0]));
+
+    // garbage, then a record without a checksum as older versions and -loadblock files have them
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << std::string("garbage") << FLATDATA(Params().MessageStart()) << (unsigned int)1;
+    ss << FLATDATA(Params().MessageStart()) << (unsigned int)::GetSerializeSize(vBlocks[1], SER_DISK, CLIENT_VERSION);
+    AppendBytes(1, ss);
+    vPos.push_back(CDiskBlockPos(1, boost::filesystem::file_size(GetBlockPosFilename(CDiskBlockPos(1, 0), "blk"))));
+    ss.clear();
+    ss << vBlocks[1];
+    AppendBytes(1, ss);
+
+    vPos.push_back(AppendBlock(1, vBlocks[2]));
+
+    // and a truncated record at the end
+    ss.clear();
+    ss << FLATDATA(Params().MessageStart()) << (unsigned int)1000 << vBlocks[0];
+    AppendBytes(1, ss);
+
+    for (int nWorkers = 0; nWorkers <= 3; nWorkers += 3) {
+        CBlockImporter importer(OpenBlockFile(CDiskBlockPos(1, 0), true), Params().MessageStart(), MaxBlockSize(true), nWorkers);
+        std::shared_ptr<CImportedBlock> pimported;
+        for (size_t i = 0; i < vBlocks.size(); i++) {
+            BOOST_REQUIRE(importer.Next(pimported));
+            BOOST_CHECK(pimported->fDecoded);
+            BOOST_CHECK_EQUAL(pimported->nPos, vPos[i].nPos);
+            BOOST_CHECK(pimported->block.IsHashCached());
+            BOOST_CHECK(pimported->block.GetHash() == vBlocks[i].GetHash());
+            BOOST_CHECK(pimported->block.vtx[0].GetHash() == vBlocks[i].vtx[0].GetHash());
+            BOOST_CHECK_EQUAL(pimported->fChecksum, i != 1);
+        }
+        BOOST_CHECK(!importer.Next(pimported));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(blockimport_rescan_failed_record)
+{
+    std::vector<CBlock> vBlocks;
+    for (uint32_t i = 0; i < 3; i++)
+        vBlocks.push_back(MakeUnminedBlock(i));
+    CDiskBlockPos pos0 = AppendBlock(2, vBlocks[0]);
+
+    // a record whose block fails to decode, with a record inside it that is only found by
+    // scanning again from the byte after its magic
+    CDataStream ssInner(SER_DISK, CLIENT_VERSION);
+    ssInner << FLATDATA(Params().MessageStart()) << (unsigned int)::GetSerializeSize(vBlocks[1], SER_DISK, CLIENT_VERSION) << vBlocks[1];
+    CDataStream ssBad(SER_DISK, CLIENT_VERSION);
+    ssBad << CBlockHeader() << (unsigned char)0xfe << (unsigned int)0x7fffffff;
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << FLATDATA(Params().MessageStart()) << (unsigned int)(ssBad.size() + ssInner.size());
+    uint64_t nPosBad = boost::filesystem::file_size(GetBlockPosFilename(CDiskBlockPos(2, 0), "blk")) + ss.size();
+    uint64_t nPosInner = nPosBad + ssBad.size() + 8;
+    ss.write(&ssBad[0], ssBad.size());
+    ss.write(&ssInner[0], ssInner.size());
+    AppendBytes(2, ss);
+
+    CDiskBlockPos pos2 = AppendBlock(2, vBlocks[2]);
+
+    for (int nWorkers = 0; nWorkers <= 3; nWorkers += 3) {
+        CBlockImporter importer(OpenBlockFile(CDiskBlockPos(2, 0), true), Params().MessageStart(), MaxBlockSize(true), nWorkers);
+        std::shared_ptr<CImportedBlock> pimported;
+        BOOST_REQUIRE(importer.Next(pimported));
+        BOOST_CHECK(pimported->fDecoded && pimported->nPos == pos0.nPos);
+        BOOST_REQUIRE(importer.Next(pimported));
+        BOOST_CHECK(!pimported->fDecoded);
+        BOOST_CHECK_EQUAL(pimported->nPos, nPosBad);
+        BOOST_REQUIRE(importer.Next(pimported));
+        BOOST_CHECK(pimported->fDecoded && pimported->nPos == nPosInner);
+        BOOST_CHECK(pimported->block.GetHash() == vBlocks[1].GetHash());
+        BOOST_REQUIRE(importer.Next(pimported));
+        BOOST_CHECK(pimported->fDecoded && pimported->nPos == pos2.nPos);
+        BOOST_CHECK(!importer.Next(pimported));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(blockimport_reindex)
+{
+    const int nPoWCheckThreadsSaved = nPoWCheckThreads;
+    nPoWCheckThreads = 3;
+    uint256 hashGenesis = chainActive.Genesis()->GetBlockHash();
+
+    UnloadBlockIndex();
+    delete pcoinsTip;
+    delete pcoinsdbview;
+    delete pblocktree;
+    pblocktree = new CBlockTreeDB(1 << 20, true);
+    pcoinsdbview = new CCoinsViewDB(1 << 23, true);
+    pcoinsTip = new CCoinsViewCache(pcoinsdbview, true);
+
+    // the genesis block is found where InitBlockIndex() wrote it, with its checksum
+    CDiskBlockPos pos(0, 0);
+    BOOST_CHECK(LoadExternalBlockFile(Params(), OpenBlockFile(pos, true), &pos));
+    CValidationState state;
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    BOOST_REQUIRE(chainActive.Tip());
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == hashGenesis);
+    BOOST_CHECK_EQUAL(chainActive.Tip()->nFile, 0);
+    BOOST_CHECK_EQUAL(chainActive.Tip()->nDataPos, 8U);
+    BOOST_CHECK(chainActive.Tip()->nStatus & BLOCK_HAVE_CHECKSUM);
+
+    nPoWCheckThreads = nPoWCheckThreadsSaved;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,10 +2,13 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "chainparams.h"
 #include "clientversion.h"
 #include "consensus/validation.h"
+#include "pow.h"
 #include "validation.h" // For CheckBlock
 #include "primitives/block.h"
+#include "streams.h"
 #include "test/test_binarium.h"
 #include "utiltime.h"
 
@@ -14,6 +17,7 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
 
 
 BOOST_FIXTURE_TEST_SUITE(CheckBlock_tests, BasicTestingSetup)
@@ -63,4 +67,101 @@ BOOST_AUTO_TEST_CASE(May15)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(header_hash_cache)
+{
+    CBlockHeader header;
+    header.nVersion = 0x20000000;
+    header.hashPrevBlock = Params().GenesisBlock().GetHash();
+    header.nTime = Params().GenesisBlock().nTime + 3528000 + 60;
+    header.nBits = Params().GenesisBlock().nBits;
+    header.nNonce = 1;
+
+    uint64_t nEvaluations = GetAmountOfPoWHashEvaluations();
+    uint256 hash = header.GetHash();
+    BOOST_CHECK_EQUAL(GetAmountOfPoWHashEvaluations(), nEvaluations + 1);
+
+    // Repeated calls and copies reuse the memoized hash.
+    BOOST_CHECK(header.GetHash() == hash);
+    CBlock block(header);
+    BOOST_CHECK(block.GetHash() == hash);
+    BOOST_CHECK(block.GetBlockHeader().GetHash() == hash);
+    BOOST_CHECK_EQUAL(GetAmountOfPoWHashEvaluations(), nEvaluations + 1);
+
+    // Changing any header field invalidates it.
+    header.nNonce++;
+    uint256 hashNext = header.GetHash();
+    BOOST_CHECK(hashNext != hash);
+    BOOST_CHECK_EQUAL(GetAmountOfPoWHashEvaluations(), nEvaluations + 2);
+    header.nNonce--;
+    BOOST_CHECK(header.GetHash() == hash);
+
+    // Deserializing over a hashed header does too, and the cache is not part of the encoding.
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << block;
+    BOOST_CHECK_EQUAL(stream.size(), 80U + 1U);
+    block.nNonce++;
+    block.GetHash();
+    stream >> block;
+    BOOST_CHECK(block.GetHash() == hash);
+
+    // A freshly computed hash matches the memoized one.
+    header.ResetHashCache();
+    BOOST_CHECK(header.GetHash() == hash);
+
+    // Threads hashing a shared header all get the same hash, from the memo or not.
+    header.ResetHashCache();
+    std::vector<uint256> vHashes(4);
+    boost::thread_group threadGroup;
+    for (size_t i = 0; i < vHashes.size(); i++) {
+        threadGroup.create_thread([&header, &vHashes, i] {
+            for (int j = 0; j < 3; j++)
+                vHashes[i] = header.GetHash();
+        });
+    }
+    threadGroup.join_all();
+    for (const uint256& hashThread : vHashes)
+        BOOST_CHECK(hashThread == hash);
+    BOOST_CHECK(header.IsHashCached());
+}
+
+BOOST_AUTO_TEST_CASE(header_batch_pow_check)
+{
+    // The largest target, which practically every hash meets.
+    Consensus::Params consensusParams = Params().GetConsensus();
+    consensusParams.powLimit = uint256S("ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+
+    std::vector<CBlockHeader> headers(40);
+    for (unsigned int i = 0; i < headers.size(); i++) {
+        headers[i].nVersion = 0x20000000;
+        headers[i].hashPrevBlock = Params().GenesisBlock().GetHash();
+        headers[i].nTime = Params().GenesisBlock().nTime + 3528000 + 60 * i;
+        headers[i].nBits = 0x2100ffff;
+        headers[i].nNonce = i;
+    }
+
+    const int nPoWCheckThreadsSaved = nPoWCheckThreads;
+    nPoWCheckThreads = 3;
+    boost::thread_group threadGroup;
+    for (int i = 0; i < nPoWCheckThreads - 1; i++)
+        threadGroup.create_thread(&ThreadPoWCheck);
+
+    uint64_t nEvaluations = GetAmountOfPoWHashEvaluations();
+    BOOST_CHECK(CheckBlockHeadersProofOfWork(headers, consensusParams));
+    BOOST_CHECK_EQUAL(GetAmountOfPoWHashEvaluations(), nEvaluations + headers.size());
+    for (const CBlockHeader& header : headers) {
+        BOOST_CHECK(header.IsHashCached());
+        BOOST_CHECK(CheckProofOfWork(header.GetHash(), header.nBits, consensusParams));
+    }
+    BOOST_CHECK_EQUAL(GetAmountOfPoWHashEvaluations(), nEvaluations + headers.size());
+
+    // Cached headers are not hashed again, a failing one fails the batch.
+    headers[17].nBits = 0x03000001;
+    BOOST_CHECK(!CheckBlockHeadersProofOfWork(headers, consensusParams));
+    BOOST_CHECK_EQUAL(GetAmountOfPoWHashEvaluations(), nEvaluations + headers.size() + 1);
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    nPoWCheckThreads = nPoWCheckThreadsSaved;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
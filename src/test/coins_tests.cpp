@@ -860,4 +860,89 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+// Random inserts and erases on a sharded CCoinsMap, which keeps its size so that the tombstones
+// are cleaned up in place, compared with a std::map.
+BOOST_AUTO_TEST_CASE(ccoins_map_sharded)
+{
+    CCoinsMap map(2);
+    std::map<COutPoint, CAmount> mapExpected;
+    std::vector<COutPoint> vOutPoints;
+    for (int i = 0; i < 2000; i++)
+        vOutPoints.push_back(COutPoint(GetRandHash(), i));
+
+    for (int i = 0; i < 40000; i++) {
+        const COutPoint& outpoint = vOutPoints[insecure_rand() % vOutPoints.size()];
+        if (insecure_rand() % 2) {
+            CCoinsCacheEntry entry;
+            entry.coin.out.nValue = i;
+            bool fInserted = map.emplace(outpoint, std::move(entry)).second;
+            BOOST_CHECK_EQUAL(fInserted, mapExpected.emplace(outpoint, i).second);
+        } else {
+            CCoinsMap::iterator it = map.find(outpoint);
+            BOOST_CHECK_EQUAL(it != map.end(), mapExpected.erase(outpoint) == 1);
+            if (it != map.end())
+                map.erase(it);
+        }
+        if (i % 10000 == 0) {
+            // erasing while iterating leaves the other entries in place
+            for (CCoinsMap::iterator it = map.begin(); it != map.end(); ) {
+                if (insecure_rand() % 2) {
+                    mapExpected.erase(it->first);
+                    map.erase(it++);
+                } else {
+                    it++;
+                }
+            }
+        }
+    }
+
+    BOOST_CHECK_EQUAL(map.size(), mapExpected.size());
+    size_t nCount = 0;
+    for (const CCoinsMap::value_type& entry : map) {
+        BOOST_CHECK_EQUAL(entry.second.coin.out.nValue, mapExpected[entry.first]);
+        nCount++;
+    }
+    BOOST_CHECK_EQUAL(nCount, mapExpected.size());
+    for (const COutPoint& outpoint : vOutPoints)
+        BOOST_CHECK_EQUAL(map.find(outpoint) != map.end(), mapExpected.count(outpoint) == 1);
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_peek)
+{
+    CCoinsViewTest base;
+    CCoinsViewCache cache(&base, true);
+    COutPoint outpoint(GetRandHash(), 0);
+    uint256 hashBlock = GetRandHash();
+    Coin coin;
+    uint256 hashBlockRet;
+
+    BOOST_CHECK(!cache.PeekCoin(outpoint, coin, hashBlockRet));
+    BOOST_CHECK(hashBlockRet.IsNull());
+
+    Coin coinNew;
+    coinNew.out.nValue = 5 * COIN;
+    coinNew.nHeight = 7;
+    cache.AddCoin(outpoint, std::move(coinNew), false);
+    cache.SetBestBlock(hashBlock);
+    BOOST_CHECK(cache.PeekCoin(outpoint, coin, hashBlockRet));
+    BOOST_CHECK_EQUAL(coin.out.nValue, 5 * COIN);
+    BOOST_CHECK(coin.nHeight == 7);
+    BOOST_CHECK(hashBlockRet == hashBlock);
+    BOOST_CHECK(cache.PeekBestBlock() == hashBlock);
+
+    // peeking at the base does not fill the cache
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    BOOST_CHECK(cache.PeekCoin(outpoint, coin, hashBlockRet));
+    BOOST_CHECK_EQUAL(coin.out.nValue, 5 * COIN);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+
+    cache.SpendCoin(outpoint);
+    BOOST_CHECK(!cache.PeekCoin(outpoint, coin, hashBlockRet));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
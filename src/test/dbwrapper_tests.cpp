@@ -322,6 +322,38 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
     }
 }
 
-
+BOOST_AUTO_TEST_CASE(dbwrapper_profile_stats)
+{
+    path ph = temp_directory_path() / unique_path();
+    CDBWrapper dbw(ph, (1 << 20), true, false, false, DBPROFILE_BLOCKINDEX);
+
+    CDBStats stats;
+    dbw.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats.strProfile, "blockindex");
+    BOOST_CHECK_EQUAL(stats.nBlockCacheSize, (1U << 20) * 30 / 100);
+    BOOST_CHECK_EQUAL(stats.nWriteBufferSize, (1U << 20) * 70 / 200);
+    BOOST_CHECK_EQUAL(stats.nBlockSize, 16U * 1024);
+    BOOST_CHECK_EQUAL(stats.nMaxOpenFiles, 32);
+    BOOST_CHECK_EQUAL(stats.nCompactions + stats.nMemTableFlushes + stats.nCacheHits + stats.nCacheMisses, 0U);
+
+    // several write buffers worth of values, compacted into tables
+    std::vector<unsigned char> value(1024);
+    for (uint32_t i = 0; i < 2048; i++)
+        BOOST_CHECK(dbw.Write(std::make_pair('k', i), value));
+    dbw.CompactRange(std::make_pair('k', (uint32_t)0), std::make_pair('k', (uint32_t)2048));
+
+    // the first read of a block misses the cache, the second hits it
+    BOOST_CHECK(dbw.Read(std::make_pair('k', (uint32_t)1000), value));
+    BOOST_CHECK(dbw.Read(std::make_pair('k', (uint32_t)1000), value));
+
+    dbw.GetStats(stats);
+    BOOST_CHECK(stats.nMemTableFlushes > 0);
+    BOOST_CHECK(stats.nCompactions + stats.nTrivialMoves > 0);
+    BOOST_CHECK(stats.nCacheMisses > 0);
+    BOOST_CHECK(stats.nCacheHits > 0);
+    BOOST_CHECK(stats.nApproximateSize > 0);
+    BOOST_CHECK(!stats.vFilesAtLevel.empty());
+    BOOST_CHECK(!stats.strStats.empty());
+}
 
 BOOST_AUTO_TEST_SUITE_END()
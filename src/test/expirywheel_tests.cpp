@@ -0,0 +1,73 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "expirywheel.h"
+
+#include "test/test_binarium.h"
+
+#include <algorithm>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(expirywheel_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(expirywheel_advance)
+{
+    CExpiryWheel<int> wheel(8);
+
+    wheel.Schedule(3, 1);
+    wheel.Schedule(5, 2);
+    wheel.Schedule(5, 3);
+    // same slot as tick 3, one turn later
+    wheel.Schedule(11, 4);
+    BOOST_CHECK(wheel.size() == 4);
+
+    BOOST_CHECK(wheel.Advance(2).empty());
+
+    std::vector<int> vExpired = wheel.Advance(3);
+    BOOST_CHECK(vExpired == std::vector<int>({1}));
+
+    vExpired = wheel.Advance(10);
+    std::sort(vExpired.begin(), vExpired.end());
+    BOOST_CHECK(vExpired == std::vector<int>({2, 3}));
+    BOOST_CHECK(wheel.size() == 1);
+
+    // jumping over more than a full turn still finds everything that is due
+    wheel.Schedule(25, 5);
+    wheel.Schedule(100, 6);
+    vExpired = wheel.Advance(50);
+    std::sort(vExpired.begin(), vExpired.end());
+    BOOST_CHECK(vExpired == std::vector<int>({4, 5}));
+    BOOST_CHECK(wheel.Advance(99).empty());
+    BOOST_CHECK(wheel.Advance(100) == std::vector<int>({6}));
+    BOOST_CHECK(wheel.empty());
+}
+
+BOOST_AUTO_TEST_CASE(expirywheel_past_ticks)
+{
+    CExpiryWheel<int> wheel(8);
+    BOOST_CHECK(wheel.Advance(20).empty());
+
+    // what is already due is returned by the next advance, even at the same tick
+    wheel.Schedule(15, 1);
+    wheel.Schedule(20, 2);
+    std::vector<int> vExpired = wheel.Advance(20);
+    std::sort(vExpired.begin(), vExpired.end());
+    BOOST_CHECK(vExpired == std::vector<int>({1, 2}));
+
+    // going back (reorg, mock time) does not return what is not due yet at the new tick
+    wheel.Schedule(18, 3);
+    wheel.Schedule(21, 4);
+    BOOST_CHECK(wheel.Advance(16).empty());
+    BOOST_CHECK(wheel.size() == 2);
+    BOOST_CHECK(wheel.Advance(18) == std::vector<int>({3}));
+    BOOST_CHECK(wheel.Advance(21) == std::vector<int>({4}));
+
+    wheel.Schedule(30, 5);
+    wheel.clear();
+    BOOST_CHECK(wheel.empty());
+    BOOST_CHECK(wheel.Advance(40).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,200 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "flat-database.h"
+
+#include "test/test_binarium.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+class CFlatDBTestObject
+{
+public:
+    std::map<int, std::string> mapRequired;
+    std::vector<int> vecOptional;
+    bool fDone;
+    // the optional section is written in a format it is not read in
+    bool fUnreadableOptional;
+
+    CFlatDBTestObject() : fDone(false), fUnreadableOptional(false) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(mapRequired);
+        READWRITE(vecOptional);
+    }
+
+    static std::vector<CFlatDBSection> GetSnapshotSections()
+    {
+        return { CFlatDBSection("required", true), CFlatDBSection("optional", false) };
+    }
+
+    void WriteSnapshotSections(std::vector<CDataStream>& vSections)
+    {
+        vSections[0] << mapRequired;
+        if (fUnreadableOptional)
+            vSections[1] << (unsigned char)0xff;
+        else
+            vSections[1] << vecOptional;
+    }
+
+    void ReadSnapshotSection(size_t nSection, CDataStream& s)
+    {
+        if (nSection == 0) {
+            s >> mapRequired;
+        } else {
+            std::vector<int> vecOptionalIn;
+            s >> vecOptionalIn;
+            vecOptional.swap(vecOptionalIn);
+        }
+    }
+
+    void ReadSnapshotDone() { fDone = true; }
+
+    void Clear()
+    {
+        mapRequired.clear();
+        vecOptional.clear();
+    }
+
+    void CheckAndRemove() {}
+
+    std::string ToString() const { return strprintf("required: %d, optional: %d", mapRequired.size(), vecOptional.size()); }
+};
+
+CFlatDBTestObject MakeTestObject()
+{
+    CFlatDBTestObject obj;
+    for (int i = 0; i < 100; i++)
+        obj.mapRequired[i] = strprintf("required-value-%d", i);
+    for (int i = 0; i < 1000; i++)
+        obj.vecOptional.push_back(i);
+    return obj;
+}
+
+std::vector<char> ReadFile(const boost::filesystem::path& path)
+{
+    std::vector<char> vch(boost::filesystem::file_size(path));
+    FILE* file = fopen(path.string().c_str(), "rb");
+    BOOST_REQUIRE(file && fread(vch.data(), 1, vch.size(), file) == vch.size());
+    fclose(file);
+    return vch;
+}
+
+void WriteFile(const boost::filesystem::path& path, const std::vector<char>& vch)
+{
+    FILE* file = fopen(path.string().c_str(), "wb");
+    BOOST_REQUIRE(file && fwrite(vch.data(), 1, vch.size(), file) == vch.size());
+    fclose(file);
+}
+
+} // anon namespace
+
+BOOST_FIXTURE_TEST_SUITE(flatdb_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(flatdb_snapshot_roundtrip)
+{
+    CFlatDB<CFlatDBTestObject> flatdb("flatdbtest.dat", "magicFlatDBTest");
+    CFlatDBTestObject obj = MakeTestObject();
+    BOOST_CHECK(flatdb.Dump(obj));
+
+    std::vector<char> vch = ReadFile(GetDataDir() / "flatdbtest.dat");
+    BOOST_CHECK(std::equal(FLATDB_SNAPSHOT_MAGIC, FLATDB_SNAPSHOT_MAGIC + 4, (const unsigned char*)vch.data()));
+    BOOST_CHECK(!boost::filesystem::exists(GetDataDir() / "flatdbtest.dat.new"));
+
+    CFlatDBTestObject objLoaded;
+    BOOST_CHECK(flatdb.Load(objLoaded));
+    BOOST_CHECK(objLoaded.fDone);
+    BOOST_CHECK(objLoaded.mapRequired == obj.mapRequired);
+    BOOST_CHECK(objLoaded.vecOptional == obj.vecOptional);
+
+    // a different magic message is not loaded
+    CFlatDB<CFlatDBTestObject> flatdbOther("flatdbtest.dat", "magicFlatDBOther");
+    CFlatDBTestObject objOther;
+    BOOST_CHECK(!flatdbOther.Load(objOther));
+    BOOST_CHECK(objOther.mapRequired.empty());
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_legacy_format)
+{
+    CFlatDBTestObject obj = MakeTestObject();
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << std::string("magicFlatDBTest");
+    ss << FLATDATA(Params().MessageStart());
+    ss << obj;
+    uint256 hash = Hash(ss.begin(), ss.end());
+    ss << hash;
+    WriteFile(GetDataDir() / "flatdblegacy.dat", std::vector<char>(ss.begin(), ss.end()));
+
+    CFlatDB<CFlatDBTestObject> flatdb("flatdblegacy.dat", "magicFlatDBTest");
+    CFlatDBTestObject objLoaded;
+    BOOST_CHECK(flatdb.Load(objLoaded));
+    BOOST_CHECK(objLoaded.mapRequired == obj.mapRequired);
+    BOOST_CHECK(objLoaded.vecOptional == obj.vecOptional);
+
+    // and is replaced by a snapshot on the next dump
+    BOOST_CHECK(flatdb.Dump(objLoaded));
+    std::vector<char> vch = ReadFile(GetDataDir() / "flatdblegacy.dat");
+    BOOST_CHECK(std::equal(FLATDB_SNAPSHOT_MAGIC, FLATDB_SNAPSHOT_MAGIC + 4, (const unsigned char*)vch.data()));
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_corrupted_sections)
+{
+    CFlatDB<CFlatDBTestObject> flatdb("flatdbcorrupt.dat", "magicFlatDBTest");
+    CFlatDBTestObject obj = MakeTestObject();
+    BOOST_CHECK(flatdb.Dump(obj));
+    const boost::filesystem::path path = GetDataDir() / "flatdbcorrupt.dat";
+    const std::vector<char> vch = ReadFile(path);
+
+    // the optional section is the last one, without it the rest still loads
+    std::vector<char> vchCorrupted(vch);
+    vchCorrupted.back() ^= 1;
+    WriteFile(path, vchCorrupted);
+    CFlatDBTestObject objLoaded;
+    BOOST_CHECK(flatdb.Load(objLoaded));
+    BOOST_CHECK(objLoaded.mapRequired == obj.mapRequired);
+    BOOST_CHECK(objLoaded.vecOptional.empty());
+
+    // a corrupted required section fails the load
+    const std::string strValue = "required-value-50";
+    vchCorrupted = vch;
+    auto it = std::search(vchCorrupted.begin(), vchCorrupted.end(), strValue.begin(), strValue.end());
+    BOOST_REQUIRE(it != vchCorrupted.end());
+    *it ^= 1;
+    WriteFile(path, vchCorrupted);
+    CFlatDBTestObject objFailed;
+    BOOST_CHECK(!flatdb.Load(objFailed));
+    BOOST_CHECK(objFailed.mapRequired.empty());
+    BOOST_CHECK(!objFailed.fDone);
+
+    // a truncated file is recreated
+    vchCorrupted = vch;
+    vchCorrupted.resize(vch.size() / 2);
+    WriteFile(path, vchCorrupted);
+    CFlatDBTestObject objTruncated;
+    BOOST_CHECK(flatdb.Load(objTruncated));
+    BOOST_CHECK(objTruncated.mapRequired.empty());
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_unreadable_sections)
+{
+    CFlatDB<CFlatDBTestObject> flatdb("flatdbformat.dat", "magicFlatDBTest");
+    CFlatDBTestObject obj = MakeTestObject();
+    obj.fUnreadableOptional = true;
+    BOOST_CHECK(flatdb.Dump(obj));
+
+    // an optional section that doesn't deserialize is left out like a corrupted one
+    CFlatDBTestObject objLoaded;
+    BOOST_CHECK(flatdb.Load(objLoaded));
+    BOOST_CHECK(objLoaded.fDone);
+    BOOST_CHECK(objLoaded.mapRequired == obj.mapRequired);
+    BOOST_CHECK(objLoaded.vecOptional.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
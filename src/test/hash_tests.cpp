@@ -2,10 +2,13 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "crypto/common.h"
 #include "hash.h"
+#include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_binarium.h"
 
+#include <limits>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -66,14 +69,31 @@ BOOST_AUTO_TEST_CASE(siphash)
 
     BOOST_CHECK_EQUAL(SipHashUint256(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL, uint256S("1f1e1d1c1b1a191817161514131211100f0e0d0c0b0a09080706050403020100")), 0x7127512f72f27cceull);
 
+    // Same data written one byte at a time and in unaligned chunks
+    static const uint64_t siphash_testvec[] = {
+        0x726fdb47dd0e0e31ull, 0x93f5f5799a932462ull, 0x3f2acc7f57c29bdbull, 0xb8ad50c6f649af94ull,
+        0x7127512f72f27cceull, 0x0e3ea96b5304a7d0ull, 0xe612a3cb9ecba951ull
+    };
+    unsigned char data[48];
+    for (unsigned char i = 0; i < sizeof(data); i++)
+        data[i] = i;
+    CSipHasher hasher2(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL);
+    for (unsigned int i = 0; i <= sizeof(data); i++) {
+        if (i % 8 == 0)
+            BOOST_CHECK_EQUAL(hasher2.Finalize(), siphash_testvec[i / 8]);
+        if (i < sizeof(data))
+            hasher2.Write(&data[i], 1);
+    }
+    CSipHasher hasher3(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL);
+    hasher3.Write(data, 3).Write(data + 3, 21).Write(data + 24, 20).Write(data + 44, 4);
+    BOOST_CHECK_EQUAL(hasher3.Finalize(), siphash_testvec[6]);
+
     // Check consistency between CSipHasher and SipHashUint256[Extra].
-    // TODO reenable when backporting Bitcoin #10321
-    /*FastRandomContext ctx;
     for (int i = 0; i < 16; ++i) {
-        uint64_t k1 = ctx.rand64();
-        uint64_t k2 = ctx.rand64();
+        uint64_t k1 = GetRand(std::numeric_limits<uint64_t>::max());
+        uint64_t k2 = GetRand(std::numeric_limits<uint64_t>::max());
         uint256 x = GetRandHash();
-        uint32_t n = ctx.rand32();
+        uint32_t n = insecure_rand();
         uint8_t nb[4];
         WriteLE32(nb, n);
         CSipHasher sip256(k1, k2);
@@ -82,7 +102,7 @@ BOOST_AUTO_TEST_CASE(siphash)
         sip288.Write(nb, 4);
         BOOST_CHECK_EQUAL(SipHashUint256(k1, k2, x), sip256.Finalize());
         BOOST_CHECK_EQUAL(SipHashUint256Extra(k1, k2, x, n), sip288.Finalize());
-    }*/
+    }
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,81 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternode-scorecache.h"
+#include "masternode.h"
+
+#include "test/test_binarium.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternode_scorecache_tests, BasicTestingSetup)
+
+static void AddMasternodes(std::map<COutPoint, CMasternode>& mapMasternodes, int nFrom, int nTo)
+{
+    for (int i = nFrom; i < nTo; i++) {
+        CMasternode mn;
+        mn.vin.prevout = COutPoint(ArithToUint256(arith_uint256(i + 1)), i % 3);
+        mn.nCollateralMinConfBlockHash = ArithToUint256(arith_uint256(1000 + i));
+        mapMasternodes[mn.vin.prevout] = mn;
+    }
+}
+
+static void CheckScores(const CMasternodeScoreCache::score_pair_vec_t& vecScores, std::map<COutPoint, CMasternode>& mapMasternodes, const uint256& blockHash)
+{
+    BOOST_CHECK_EQUAL(vecScores.size(), mapMasternodes.size());
+    for (size_t i = 0; i < vecScores.size(); i++) {
+        BOOST_CHECK(vecScores[i].first == vecScores[i].second->CalculateScore(blockHash));
+        BOOST_CHECK(&mapMasternodes[vecScores[i].second->vin.prevout] == vecScores[i].second);
+        if (i > 0)
+            BOOST_CHECK(vecScores[i - 1].first > vecScores[i].first);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(scorecache_matches_calculatescore)
+{
+    std::map<COutPoint, CMasternode> mapMasternodes;
+    AddMasternodes(mapMasternodes, 0, 50);
+
+    CMasternodeScoreCache cache(2);
+    uint256 blockHash1 = ArithToUint256(arith_uint256(7));
+    uint256 blockHash2 = ArithToUint256(arith_uint256(8));
+    uint256 blockHash3 = ArithToUint256(arith_uint256(9));
+
+    CMasternodeScoreCache::score_pair_vec_ptr pvecScores1 = cache.Get(blockHash1, mapMasternodes);
+    CheckScores(*pvecScores1, mapMasternodes, blockHash1);
+    BOOST_CHECK(cache.Get(blockHash1, mapMasternodes) == pvecScores1);
+    BOOST_CHECK_EQUAL(cache.GetHits(), 1U);
+    BOOST_CHECK_EQUAL(cache.GetMisses(), 1U);
+
+    CheckScores(*cache.Get(blockHash2, mapMasternodes), mapMasternodes, blockHash2);
+    // blockHash1 was used last, so blockHash2 is evicted
+    cache.Get(blockHash1, mapMasternodes);
+    CheckScores(*cache.Get(blockHash3, mapMasternodes), mapMasternodes, blockHash3);
+    BOOST_CHECK_EQUAL(cache.size(), 2U);
+    BOOST_CHECK(cache.Get(blockHash1, mapMasternodes) == pvecScores1);
+    uint64_t nMisses = cache.GetMisses();
+    cache.Get(blockHash2, mapMasternodes);
+    BOOST_CHECK_EQUAL(cache.GetMisses(), nMisses + 1);
+}
+
+BOOST_AUTO_TEST_CASE(scorecache_clear_on_membership_change)
+{
+    std::map<COutPoint, CMasternode> mapMasternodes;
+    AddMasternodes(mapMasternodes, 0, 20);
+
+    CMasternodeScoreCache cache;
+    uint256 blockHash = ArithToUint256(arith_uint256(42));
+    CheckScores(*cache.Get(blockHash, mapMasternodes), mapMasternodes, blockHash);
+
+    AddMasternodes(mapMasternodes, 20, 30);
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.size(), 0U);
+    CheckScores(*cache.Get(blockHash, mapMasternodes), mapMasternodes, blockHash);
+
+    mapMasternodes.erase(mapMasternodes.begin());
+    cache.Clear();
+    CheckScores(*cache.Get(blockHash, mapMasternodes), mapMasternodes, blockHash);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,182 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "chainparams.h"
+#include "masternode-payments.h"
+#include "masternode-sync.h"
+#include "masternodeman.h"
+#include "timedata.h"
+#include "validation.h"
+
+#include "test/test_binarium.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternodeman_tests, TestingSetup)
+
+// The linear scan GetNextMasternodeInQueueForPayment() did before the payment queue, over a copy
+// of the masternodes, looking every collateral up again.
+static bool GetNextMasternodeLinearScan(int nBlockHeight, bool fFilterSigTime, int& nCountRet, masternode_info_t& mnInfoRet)
+{
+    mnInfoRet = masternode_info_t();
+    std::map<COutPoint, CMasternode> mapMasternodes = mnodeman.GetFullMasternodeMap();
+    int nMnCount = mnodeman.CountMasternodes();
+
+    std::vector<std::pair<int, CMasternode*> > vecMasternodeLastPaid;
+    for (auto& mnpair : mapMasternodes) {
+        if (!mnpair.second.IsValidForPayment()) continue;
+        if (mnpair.second.nProtocolVersion < mnpayments.GetMinMasternodePaymentsProto()) continue;
+        if (mnpayments.IsScheduled(mnpair.second, nBlockHeight)) continue;
+        if (fFilterSigTime && mnpair.second.sigTime + (nMnCount*2.6*60) > GetAdjustedTime()) continue;
+        if (GetUTXOConfirmations(mnpair.first) < nMnCount) continue;
+        vecMasternodeLastPaid.push_back(std::make_pair(mnpair.second.GetLastPaidBlock(), &mnpair.second));
+    }
+
+    nCountRet = (int)vecMasternodeLastPaid.size();
+    if (fFilterSigTime && nCountRet < nMnCount/3)
+        return GetNextMasternodeLinearScan(nBlockHeight, false, nCountRet, mnInfoRet);
+
+    // the map is ordered by collateral, so a stable sort orders ties like the queue does
+    std::stable_sort(vecMasternodeLastPaid.begin(), vecMasternodeLastPaid.end(),
+        [](const std::pair<int, CMasternode*>& a, const std::pair<int, CMasternode*>& b) { return a.first < b.first; });
+
+    uint256 blockHash;
+    if (!GetBlockHash(blockHash, nBlockHeight - 101))
+        return false;
+    int nTenthNetwork = nMnCount/10;
+    int nCountTenth = 0;
+    arith_uint256 nHighest = 0;
+    CMasternode* pBestMasternode = NULL;
+    for (auto& s : vecMasternodeLastPaid) {
+        arith_uint256 nScore = s.second->CalculateScore(blockHash);
+        if (nScore > nHighest) {
+            nHighest = nScore;
+            pBestMasternode = s.second;
+        }
+        if (++nCountTenth >= nTenthNetwork) break;
+    }
+    if (pBestMasternode)
+        mnInfoRet = pBestMasternode->GetInfo();
+    return mnInfoRet.fInfoValid;
+}
+
+// Returns the count without the sigTime filter
+static int CheckNextMasternode()
+{
+    int nHeight = chainActive.Height() + 1;
+    int nCountRet = 0;
+    for (int i = 0; i < 2; i++) {
+        bool fFilterSigTime = i == 0;
+        int nCount, nCountExpected;
+        masternode_info_t mnInfo, mnInfoExpected;
+        bool fFound = mnodeman.GetNextMasternodeInQueueForPayment(nHeight, fFilterSigTime, nCount, mnInfo);
+        bool fFoundExpected = GetNextMasternodeLinearScan(nHeight, fFilterSigTime, nCountExpected, mnInfoExpected);
+        BOOST_CHECK_EQUAL(fFound, fFoundExpected);
+        BOOST_CHECK_EQUAL(nCount, nCountExpected);
+        BOOST_CHECK(mnInfo.vin.prevout == mnInfoExpected.vin.prevout);
+        nCountRet = nCount;
+    }
+    return nCountRet;
+}
+
+// Appends nBlocks block index entries without block data to pindexPrev, each with its own hash.
+static CBlockIndex* ExtendChain(std::vector<CBlockIndex*>& vpindex, std::vector<uint256*>& vhash, CBlockIndex* pindexPrev, int nBlocks, uint32_t nBranch)
+{
+    for (int i = 0; i < nBlocks; i++) {
+        CBlockIndex* pindex = new CBlockIndex();
+        pindex->pprev = pindexPrev;
+        pindex->nHeight = pindexPrev->nHeight + 1;
+        vhash.push_back(new uint256(ArithToUint256(arith_uint256(pindex->nHeight) | (arith_uint256(nBranch) << 32))));
+        pindex->phashBlock = vhash.back();
+        pindex->BuildSkip();
+        vpindex.push_back(pindex);
+        pindexPrev = pindex;
+    }
+    return pindexPrev;
+}
+
+BOOST_AUTO_TEST_CASE(next_masternode_matches_linear_scan)
+{
+    LOCK(cs_main);
+    while (!masternodeSync.IsWinnersListSynced())
+        masternodeSync.SwitchToNextAsset(*connman);
+
+    std::vector<CBlockIndex*> vpindex;
+    std::vector<uint256*> vhash;
+    CBlockIndex* pindexGenesis = chainActive.Tip();
+    CBlockIndex* pindexFork = ExtendChain(vpindex, vhash, pindexGenesis, 100, 1);
+    chainActive.SetTip(ExtendChain(vpindex, vhash, pindexFork, 50, 1));
+
+    // collaterals 5 blocks apart, so that the youngest ones have less confirmations than there
+    // are masternodes, and payments and sigTimes which leave some masternodes out of the count
+    const int nMasternodes = 30;
+    std::vector<COutPoint> vCollaterals;
+    for (int i = 0; i < nMasternodes; i++) {
+        CMasternode mn;
+        mn.vin.prevout = COutPoint(ArithToUint256(arith_uint256(i + 1)), i % 2);
+        mn.nActiveState = CMasternode::MASTERNODE_ENABLED;
+        mn.nProtocolVersion = PROTOCOL_VERSION;
+        mn.sigTime = GetAdjustedTime() - (i % 7 == 0 ? 0 : 365 * 24 * 60 * 60);
+        mn.nBlockLastPaid = (i * 37) % 120;
+        BOOST_CHECK(mnodeman.Add(mn));
+        pcoinsTip->AddCoin(mn.vin.prevout, Coin(CTxOut(1000 * COIN, CScript() << OP_TRUE), 1 + 5 * i, false), false);
+        vCollaterals.push_back(mn.vin.prevout);
+    }
+    int nCount = CheckNextMasternode();
+
+    // a new block spends a collateral that is counted but is not among the candidates, i.e. one
+    // of the last paid ones
+    CBlock block;
+    block.nTime = chainActive.Tip()->nTime + 120;
+    CMutableTransaction txCoinbase;
+    txCoinbase.vin.resize(1);
+    txCoinbase.vin[0].prevout.SetNull();
+    txCoinbase.vout.push_back(CTxOut(COIN, CScript() << OP_TRUE));
+    block.vtx.push_back(txCoinbase);
+    CMutableTransaction txSpend;
+    txSpend.vin.push_back(CTxIn(vCollaterals[3]));
+    txSpend.vout.push_back(CTxOut(1000 * COIN, CScript() << OP_TRUE));
+    block.vtx.push_back(txSpend);
+    block.hashPrevBlock = chainActive.Tip()->GetBlockHash();
+    uint256 hashBlock = block.GetHash();
+    CDiskBlockPos pos(1, 0);
+    BOOST_CHECK(WriteBlockToDisk(block, pos, Params().MessageStart()));
+
+    CBlockIndex* pindexSpend = new CBlockIndex(block);
+    pindexSpend->pprev = chainActive.Tip();
+    pindexSpend->nHeight = chainActive.Height() + 1;
+    pindexSpend->phashBlock = &hashBlock;
+    pindexSpend->nFile = pos.nFile;
+    pindexSpend->nDataPos = pos.nPos;
+    pindexSpend->nStatus = BLOCK_HAVE_DATA | BLOCK_HAVE_CHECKSUM;
+    pindexSpend->BuildSkip();
+    vpindex.push_back(pindexSpend);
+    pcoinsTip->SpendCoin(vCollaterals[3]);
+    chainActive.SetTip(pindexSpend);
+    BOOST_CHECK_EQUAL(CheckNextMasternode(), nCount - 1);
+
+    // a reorg brings the collateral back, confirmed later, and moves the youngest collaterals
+    chainActive.SetTip(ExtendChain(vpindex, vhash, pindexFork, 60, 2));
+    pcoinsTip->AddCoin(vCollaterals[3], Coin(CTxOut(1000 * COIN, CScript() << OP_TRUE), 140, false), true);
+    for (int i = 20; i < nMasternodes; i++) {
+        pcoinsTip->AddCoin(vCollaterals[i], Coin(CTxOut(1000 * COIN, CScript() << OP_TRUE), 101 + 2 * (i - 20), false), true);
+    }
+    CheckNextMasternode();
+
+    // too many blocks to read on top
+    chainActive.SetTip(ExtendChain(vpindex, vhash, chainActive.Tip(), 20, 2));
+    pcoinsTip->SpendCoin(vCollaterals[5]);
+    CheckNextMasternode();
+
+    chainActive.SetTip(pindexGenesis);
+    mnodeman.Clear();
+    masternodeSync.Reset();
+    for (CBlockIndex* pindex : vpindex)
+        delete pindex;
+    for (uint256* phash : vhash)
+        delete phash;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,174 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternode.h"
+#include "messagesigner.h"
+#include "msgprecheck.h"
+#include "net_processing.h"
+#include "protocol.h"
+#include "utiltime.h"
+
+#include "test/test_binarium.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(msgprecheck_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(precheck_message_signature)
+{
+    CKey key, keyOther;
+    key.MakeNewKey(true);
+    keyOther.MakeNewKey(true);
+    const std::string strMessage = "masternode ping";
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(CMessageSigner::SignMessage(strMessage, vchSig, key));
+
+    CHashSigner::ClearPrecheckCache();
+    uint64_t nHits = CHashSigner::GetPrecheckHits();
+    std::string strError;
+    BOOST_CHECK(CMessageSigner::VerifyMessage(key.GetPubKey(), vchSig, strMessage, strError));
+    BOOST_CHECK_EQUAL(CHashSigner::GetPrecheckHits(), nHits);
+
+    BOOST_CHECK(CMessageSigner::PrecheckMessage(vchSig, strMessage));
+    BOOST_CHECK(CMessageSigner::VerifyMessage(key.GetPubKey(), vchSig, strMessage, strError));
+    BOOST_CHECK_EQUAL(CHashSigner::GetPrecheckHits(), nHits + 1);
+
+    // a prechecked signature is still bound to its key and message
+    BOOST_CHECK(!CMessageSigner::VerifyMessage(keyOther.GetPubKey(), vchSig, strMessage, strError));
+    BOOST_CHECK(!CMessageSigner::VerifyMessage(key.GetPubKey(), vchSig, strMessage + " ", strError));
+
+    std::vector<unsigned char> vchSigBad(vchSig);
+    // r = 0 cannot be recovered
+    std::fill(vchSigBad.begin() + 1, vchSigBad.begin() + 33, 0);
+    BOOST_CHECK(!CMessageSigner::PrecheckMessage(vchSigBad, strMessage));
+    BOOST_CHECK(!CMessageSigner::VerifyMessage(key.GetPubKey(), vchSigBad, strMessage, strError));
+
+    CHashSigner::ClearPrecheckCache();
+}
+
+BOOST_AUTO_TEST_CASE(precheck_queue)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CMasternodePing mnp;
+    mnp.vin = CTxIn(COutPoint(uint256S("01"), 0));
+    BOOST_CHECK(mnp.Sign(key, key.GetPubKey()));
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << mnp;
+
+    CHashSigner::ClearPrecheckCache();
+    RegisterNodeSignals(GetNodeSignals());
+
+    // nothing is queued without a thread to run it
+    messagePrecheckQueue.Push(NetMsgType::MNPING, ss, PROTOCOL_VERSION);
+    BOOST_CHECK_EQUAL(messagePrecheckQueue.size(), 0U);
+
+    boost::thread_group threadGroup;
+    threadGroup.create_thread(&ThreadMessagePrecheck);
+    uint64_t nChecked = messagePrecheckQueue.nChecked;
+    uint64_t nFailed = messagePrecheckQueue.nFailed;
+    for (int i = 0; i < 1000 && messagePrecheckQueue.nChecked == nChecked; i++) {
+        messagePrecheckQueue.Push(NetMsgType::MNPING, ss, PROTOCOL_VERSION);
+        MilliSleep(5);
+    }
+    BOOST_CHECK(messagePrecheckQueue.nChecked > nChecked);
+
+    uint64_t nHits = CHashSigner::GetPrecheckHits();
+    int nDos = 0;
+    CPubKey pubKey = key.GetPubKey();
+    BOOST_CHECK(mnp.CheckSignature(pubKey, nDos));
+    BOOST_CHECK_EQUAL(CHashSigner::GetPrecheckHits(), nHits + 1);
+
+    // commands without a precheck are not queued, truncated messages only fail
+    messagePrecheckQueue.Push(NetMsgType::PING, ss, PROTOCOL_VERSION);
+    CDataStream ssShort(ss.begin(), ss.begin() + 10, SER_NETWORK, PROTOCOL_VERSION);
+    messagePrecheckQueue.Push(NetMsgType::MNPING, ssShort, PROTOCOL_VERSION);
+    for (int i = 0; i < 1000 && messagePrecheckQueue.nFailed == nFailed; i++)
+        MilliSleep(5);
+    BOOST_CHECK_EQUAL(messagePrecheckQueue.nFailed, nFailed + 1);
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    UnregisterNodeSignals(GetNodeSignals());
+    CHashSigner::ClearPrecheckCache();
+}
+
+BOOST_AUTO_TEST_CASE(verified_signature_cache)
+{
+    CKey key, keyOther;
+    key.MakeNewKey(true);
+    keyOther.MakeNewKey(true);
+    uint256 hash = CMessageSigner::GetMessageHash("governance vote");
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(CHashSigner::SignHash(hash, key, vchSig));
+
+    CHashSigner::ClearPrecheckCache();
+    uint64_t nHits = CHashSigner::GetPrecheckHits();
+    std::string strError;
+    BOOST_CHECK(CHashSigner::VerifyHash(hash, key.GetPubKey(), vchSig, strError));
+    BOOST_CHECK(CHashSigner::VerifyHash(hash, key.GetPubKey(), vchSig, strError));
+    BOOST_CHECK_EQUAL(CHashSigner::GetPrecheckHits(), nHits + 1);
+
+    // only valid signatures are remembered, and only for their key
+    BOOST_CHECK(!CHashSigner::VerifyHash(hash, keyOther.GetPubKey(), vchSig, strError));
+    BOOST_CHECK(!CHashSigner::VerifyHash(hash, keyOther.GetPubKey(), vchSig, strError));
+    BOOST_CHECK(!CHashSigner::VerifyHash(uint256(), key.GetPubKey(), vchSig, strError));
+    BOOST_CHECK_EQUAL(CHashSigner::GetPrecheckHits(), nHits + 1);
+
+    CHashSigner::ClearPrecheckCache();
+}
+
+static std::vector<CHashSignatureCheck> MakeSignatureChecks(int nChecks)
+{
+    std::vector<CHashSignatureCheck> vChecks;
+    for (int i = 0; i < nChecks; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        uint256 hash = CMessageSigner::GetMessageHash(std::to_string(i));
+        std::vector<unsigned char> vchSig;
+        key.SignCompact(hash, vchSig);
+        vChecks.emplace_back(hash, key.GetPubKey(), vchSig);
+    }
+    // a bad signature and a signature by another key
+    vChecks[1].vchSig[10] ^= 1;
+    vChecks[2].pubkey = vChecks[3].pubkey;
+    return vChecks;
+}
+
+BOOST_AUTO_TEST_CASE(verify_batch)
+{
+    CHashSigner::ClearPrecheckCache();
+
+    // without threads the batch is verified before returning
+    std::vector<bool> vResults;
+    messagePrecheckQueue.VerifyBatch(MakeSignatureChecks(20), [&vResults](const std::vector<bool>& vResultsIn) { vResults = vResultsIn; });
+    BOOST_CHECK_EQUAL(vResults.size(), 20U);
+    for (size_t i = 0; i < vResults.size(); i++)
+        BOOST_CHECK_EQUAL(vResults[i], i != 1 && i != 2);
+
+    boost::thread_group threadGroup;
+    for (int i = 0; i < 3; i++)
+        threadGroup.create_thread(&ThreadMessagePrecheck);
+    while (messagePrecheckQueue.GetThreadCount() < 3)
+        MilliSleep(1);
+
+    vResults = messagePrecheckQueue.VerifyBatchWait(MakeSignatureChecks(200));
+    BOOST_CHECK_EQUAL(vResults.size(), 200U);
+    for (size_t i = 0; i < vResults.size(); i++)
+        BOOST_CHECK_EQUAL(vResults[i], i != 1 && i != 2);
+    BOOST_CHECK(messagePrecheckQueue.VerifyBatchWait(std::vector<CHashSignatureCheck>()).empty());
+
+    // checks that are still queued when the threads stop are finished by the last one
+    std::atomic<bool> fDone(false);
+    messagePrecheckQueue.VerifyBatch(MakeSignatureChecks(200), [&fDone](const std::vector<bool>& vResultsIn) { fDone = true; });
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    BOOST_CHECK(fDone);
+    BOOST_CHECK_EQUAL(messagePrecheckQueue.size(), 0U);
+
+    CHashSigner::ClearPrecheckCache();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
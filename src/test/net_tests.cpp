@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 #include "addrman.h"
+#include "arith_uint256.h"
 #include "test/test_binarium.h"
 #include <string>
 #include <boost/test/unit_test.hpp>
@@ -174,4 +175,98 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+BOOST_AUTO_TEST_CASE(net_message_type_index)
+{
+    const std::vector<std::string>& allMessages = getAllNetMessageTypes();
+    for (size_t i = 0; i < allMessages.size(); i++)
+        BOOST_CHECK_EQUAL(getNetMessageTypeIndex(allMessages[i]), (int)i);
+    BOOST_CHECK_EQUAL(getNetMessageTypeIndex(""), -1);
+    BOOST_CHECK_EQUAL(getNetMessageTypeIndex("unknowncmd"), -1);
+    BOOST_CHECK_EQUAL(getNetMessageTypeIndex(std::string(NetMsgType::MNANNOUNCE) + "x"), -1);
+}
+
+BOOST_AUTO_TEST_CASE(cnode_process_time_per_msg)
+{
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = 0xa0b0c001;
+    CAddress addr = CAddress(CService(ipv4Addr, 7777), NODE_NETWORK);
+    CNode node(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, "", false);
+
+    node.AddProcessTimePerMsgCmd(NetMsgType::MNPING, 5);
+    node.AddProcessTimePerMsgCmd(NetMsgType::MNPING, 7);
+    node.AddProcessTimePerMsgCmd("unknowncmd", 3);
+
+    CNodeStats stats;
+    node.copyStats(stats);
+    BOOST_CHECK_EQUAL(stats.mapProcessTimePerMsgCmd[NetMsgType::MNPING], 12U);
+    BOOST_CHECK_EQUAL(stats.mapProcessTimePerMsgCmd[NET_MESSAGE_COMMAND_OTHER], 3U);
+    BOOST_CHECK(stats.mapProcessTimePerMsgCmd.count("unknowncmd") == 0);
+}
+
+BOOST_AUTO_TEST_CASE(push_message_shared_payload)
+{
+#ifndef WIN32
+    int fds[2];
+    BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = 0xa0b0c001;
+    CAddress addr = CAddress(CService(ipv4Addr, 7777), NODE_NETWORK);
+    CNode node(0, NODE_NETWORK, 0, fds[0], addr, "", false);
+    CConnman connman;
+
+    std::vector<CInv> vInv;
+    for (int i = 0; i < 10; i++)
+        vInv.push_back(CInv(MSG_TX, ArithToUint256(arith_uint256(i))));
+    CSerializedNetMsg msg = connman.MakeMessage(PROTOCOL_VERSION, NetMsgType::INV, vInv);
+
+    // the header describes the payload, which is the plain serialization
+    CDataStream ssPayload(SER_NETWORK, PROTOCOL_VERSION);
+    ssPayload << vInv;
+    BOOST_CHECK(CSerializeData(msg.payload->begin(), msg.payload->end()) == CSerializeData(ssPayload.begin(), ssPayload.end()));
+    BOOST_CHECK_EQUAL(msg.header->size(), (size_t)CMessageHeader::HEADER_SIZE);
+    CMessageHeader hdr(Params().MessageStart());
+    CDataStream(msg.header->begin(), msg.header->end(), SER_NETWORK, PROTOCOL_VERSION) >> hdr;
+    BOOST_CHECK(hdr.IsValid(Params().MessageStart()));
+    BOOST_CHECK_EQUAL(hdr.GetCommand(), NetMsgType::INV);
+    BOOST_CHECK_EQUAL(hdr.nMessageSize, ssPayload.size());
+    uint256 hash = Hash(ssPayload.begin(), ssPayload.end());
+    BOOST_CHECK(memcmp(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE) == 0);
+
+    // small messages go out right away, the same buffers every time
+    for (int i = 0; i < 3; i++)
+        connman.PushMessage(&node, msg);
+    BOOST_CHECK(node.vSendMsg.empty());
+    BOOST_CHECK_EQUAL(node.nSendSize, 0U);
+    std::vector<char> vExpected;
+    for (int i = 0; i < 3; i++) {
+        vExpected.insert(vExpected.end(), msg.header->begin(), msg.header->end());
+        vExpected.insert(vExpected.end(), msg.payload->begin(), msg.payload->end());
+    }
+    std::vector<char> vReceived(vExpected.size());
+    BOOST_CHECK_EQUAL(recv(fds[1], vReceived.data(), vReceived.size(), MSG_DONTWAIT), (ssize_t)vExpected.size());
+    BOOST_CHECK(vReceived == vExpected);
+
+    // a message larger than the socket buffer stays queued by reference
+    std::vector<unsigned char> vData(8 * 1024 * 1024, 0x5a);
+    CSerializedNetMsg msgLarge = connman.MakeMessage(PROTOCOL_VERSION, NetMsgType::BLOCK, vData);
+    connman.PushMessage(&node, msgLarge);
+    connman.PushMessage(&node, msg);
+    BOOST_CHECK_EQUAL(msgLarge.payload.use_count(), 2);
+    BOOST_CHECK(node.nSendSize > 0);
+    BOOST_CHECK(node.nSendSize < msgLarge.size() + msg.size());
+    BOOST_CHECK(node.nSendBytes > vExpected.size() + msgLarge.header->size());
+    vReceived.resize(vExpected.size() + msgLarge.size());
+    size_t nReceived = 0;
+    while (nReceived < msgLarge.header->size()) {
+        ssize_t nBytes = recv(fds[1], vReceived.data() + nReceived, vReceived.size() - nReceived, MSG_DONTWAIT);
+        BOOST_REQUIRE(nBytes > 0);
+        nReceived += nBytes;
+    }
+    BOOST_CHECK(std::equal(msgLarge.header->begin(), msgLarge.header->end(), vReceived.begin()));
+
+    node.CloseSocketDisconnect();
+    close(fds[1]);
+#endif
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,282 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "chainparams.h"
+#include "powhash.h"
+#include "primitives/block.h"
+#include "uint256.h"
+#include "utilstrencodings.h"
+#include "test/test_binarium.h"
+#include "crypto/encryption/salsa20/ecrypt-sync.h"
+#include "crypto/encryption/salsa20/salsa20_blocks.h"
+#include "crypto/encryption/gost2015_kuznechik/libgost15/libgost15.h"
+#include "crypto/encryption/three_fish/libskein_skein.h"
+#include "crypto/hashing/streebog/stribog.h"
+#include "crypto/hashing/streebog/test_data.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(powhash_tests, BasicTestingSetup)
+
+// Hashes of PoWTestHeader(0) .. PoWTestHeader(43), computed with the original one nonce at a time
+// implementation of CBlockHeader::GetHash_SHA256AndX11(). (week + nBits) % 42 takes every value
+// between them, so each pair of variable hash function and encryption function is covered.
+static const char* const vPoWTestHashes[] = {
+    "f586f0b35d7d1c219e39eda9059c725ce9678dd5c432d09d812085a005ed0f1e",
+    "197a23c48a6d9f662fc38e0775e68291e637bd0d37ab29c9f96e7526a2a2867b",
+    "b4186d59ff8756fee6e303a365298bf8ab0fb616346a1f2123b60fac53f67ea8",
+    "d41e52b999468e88f57b4b58f328ebff31233d9e7cd9c55891a76dbdc41ae3c2",
+    "4f1d326d854ffdacc245a9a2eca939be26db667a84cf9a830fb09c3ddc134266",
+    "0b8f0d17e00e961081dd18c139345e1bc76f54e87e532115a13265065c33bffa",
+    "219bc42c56bb9c28c018b4c9bc10ceb3a117507564718a9984415bcaa1142aa7",
+    "69c3d6033aa1af74b20b1eba374561bd05cb9ac0d6cd717d2cd0d7377e2bbce4",
+    "4190b87283af1f546bfd11262d92fb870d9e56f5301d157199273c94318ffab8",
+    "ff0e9bdd22eb9fade7092bd46a9fb76132a7b0ee979ebe2c5052ce4ddab6720d",
+    "b20381b239c67215ca1a07f6f7d92deb77e78fa6fd0856ede1f5858055f149d5",
+    "7e52c03e13079c9185672eff9c217681774b9cdc8ecc28e60eabe8826f68dece",
+    "11771df88245c7e34ae74fde2b7e90fee58a65a102ef0d33d8988b3c7f9a4c6a",
+    "6bcea587bfea8dcd6cc657deee7472ccc31050a3cfe7a849f905231206e65a1e",
+    "c09c5f95332e944a3dac755b336b4a7bc714add8139852e1bad2bb15f312a24d",
+    "eb210ec8e457ca47e6119f1972b0769c3cdf09952ca1a1a0c401f7db1a3f62eb",
+    "45b1861584a5c17afaee5384dda187f94cd6cb88937c9608849d34b5e9fa145c",
+    "c2347bfce742ef9df7c546bb005ccffb730a84642126fa5af0743e7ee9d394a8",
+    "018a1733cc627f7618d647483c1ae0fef993ccc370f15c46ba72356e045ec199",
+    "f9f411c4e6c9802a4cc35317f1645c495bce3da3d31c3cc5cfb0d308e5a9aabf",
+    "24e9f28ce5a58187142601b12dc58aa0d36095773f8b7a585550f275e8902eb2",
+    "494ee8d8ff85dca64dcd749ce8ebfe5e20725f982775ad2525b857a893238f2b",
+    "6776c6ba32b227b8530629dba641856e59a674063bdb0c71426f45a6c631308b",
+    "3ab4cb5aa3dc3a5c798148529469cb738695e96427bae8cc9767c9a3b480f75d",
+    "a013e8f103d9edf138f277133d8e1ae6cd406387d7d8c989f49724ea863d763f",
+    "9a5b608a9c2a07378cf799a4b79350f18757ee345faec4eeab57ed041e56947a",
+    "9f84f0f4b03fd7896b81346ec11f814d237b9564bad5e9f150cf08d9efd6eb86",
+    "d60fdc2a275d64f7f8b92501ea11d02040ec147eca0a6a8f0983b70b103089b3",
+    "7adefd11c116749e991ad406016f58206cf1e29e7f806e036db05451b36d3251",
+    "316ecdd82f9a10f3f291528af0f28da9115bbdd15a812784fde1850cc03be030",
+    "800f531007300a8abe54d711fb18d6767721fff3af5676b73217ca2fc38d741e",
+    "23812340ec5c87eca273f7c2230175241b21cde59cdbcc2d8554740d0768a264",
+    "7fffce2dab70cfcdaec1a0502e27dd4c8b6c6053ba2fe242184c1a061f26ea1f",
+    "05a8a5693c12fe42474ec89516b6f2d36d9a8fd4d88456eb195552f03174bbfc",
+    "df08dc9a6d3d882dc11ff477b72e5d40d33c403f2c5ce553f39d344efbe9c4df",
+    "5cd269c9e5a3b437c4f8c59916adc86ac57c256558e52773e4336353efae4ad7",
+    "b3a1389b120a223b44e163f96991154127f06342b38dcd9d067c91ee2a0434d3",
+    "e2eac410f048ed39bd83714fa22992a3b40359783a6bb9f544b630249fde0f8d",
+    "dbc2d6ff51f15a9e2c18b35da25baed5b71af9de9b8acd7fb42487a851b2e34c",
+    "5f2ec34e1efe648b9dc44c4c87dbcdeefdbbc0b685b5a446962f1e67a6a61a91",
+    "fbc09600fa1d5978952ffadf27dae90c6ca6934880c38c6e09488d5b5a198e12",
+    "da5af8fa65c929386bf18a9b438b28ddd1a311b9fcd5ee792952ff295d180a1b",
+    "c076ebe8a9dab07f205875d9acb9653a28858346bdb544644bfd91b773cadda9",
+    "6870e138014323c7ee1b4fed3bf9de54ba34259b345c6a6eb36372a87c15f440",
+};
+
+static CBlockHeader PoWTestHeader(int i)
+{
+    const CBlock& genesis = Params().GenesisBlock();
+    CBlockHeader header;
+    header.nVersion = 0x20000000 + i;
+    header.hashPrevBlock = genesis.GetHash();
+    header.hashMerkleRoot = ArithToUint256(arith_uint256(i * 7919 + 1));
+    header.nTime = genesis.nTime + 3528000 + 604800 * (i % 5) + i * 61;
+    header.nBits = 0x1b0fffff - i;
+    header.nNonce = 12345u * i;
+    return header;
+}
+
+BOOST_AUTO_TEST_CASE(powhash_known_answers)
+{
+    std::unique_ptr<TPoWHashScratch> pScratch(new TPoWHashScratch);
+
+    for (unsigned int i = 0; i < ARRAYLEN(vPoWTestHashes); i++) {
+        CBlockHeader header = PoWTestHeader(i);
+        uint256 hash;
+        GetPoWHashes(header, header.nNonce, 1, &hash, *pScratch);
+        BOOST_CHECK_EQUAL(hash.ToString(), vPoWTestHashes[i]);
+        BOOST_CHECK_EQUAL(header.GetHash().ToString(), vPoWTestHashes[i]);
+    }
+
+    // Before the SHA256AndX11 switch GetPoWHashes() falls back to X11.
+    CBlockHeader header;
+    header.nTime = Params().GenesisBlock().nTime + 1000;
+    header.nBits = Params().GenesisBlock().nBits;
+    header.nNonce = 7;
+    uint256 hash;
+    GetPoWHashes(header, header.nNonce, 1, &hash, *pScratch);
+    BOOST_CHECK_EQUAL(hash.ToString(), "c5d23f3eac987d22fbc249081a214e330b3d16a25604b225f4b8f5e615f1dd19");
+}
+
+BOOST_AUTO_TEST_CASE(powhash_batch_matches_single)
+{
+    std::unique_ptr<TPoWHashScratch> pScratch(new TPoWHashScratch);
+
+    // 11 nonces make one full group of lanes and a partial one, starting right below
+    // the nonce wrap-around.
+    const uint32_t nFirstNonce = 0xfffffffa;
+    const uint32_t nNonces = I_POW_HASH_MAX_LANES + 3;
+    for (int i = 0; i < 6; i++) {
+        CBlockHeader header = PoWTestHeader(i * 7);
+        std::vector<uint256> vHashes(nNonces);
+        GetPoWHashes(header, nFirstNonce, nNonces, vHashes.data(), *pScratch);
+        for (uint32_t n = 0; n < nNonces; n++) {
+            header.nNonce = nFirstNonce + n;
+            BOOST_CHECK(vHashes[n] == header.GetHash());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(powhash_scratch_reuse)
+{
+    // Huge pages fall back to normal pages when the system has none reserved.
+    for (int nHugePages = 0; nHugePages < 2; nHugePages++) {
+        TPoWHashScratch* pScratch = AllocatePoWHashScratch(nHugePages != 0);
+        BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(pScratch) % 64, 0U);
+
+        // The memory area is only zeroed on allocation, every hash has to leave it zero.
+        for (int nRound = 0; nRound < 2; nRound++) {
+            for (unsigned int i = 0; i < ARRAYLEN(vPoWTestHashes); i++) {
+                CBlockHeader header = PoWTestHeader(i);
+                uint256 hash;
+                GetPoWHashes(header, header.nNonce, 1, &hash, *pScratch);
+                BOOST_CHECK_EQUAL(hash.ToString(), vPoWTestHashes[i]);
+            }
+        }
+        BOOST_CHECK(std::count(pScratch->aMemoryArea, pScratch->aMemoryArea + I_POW_HASH_MEMORY_AREA_SIZE, 0) == I_POW_HASH_MEMORY_AREA_SIZE);
+
+        FreePoWHashScratch(pScratch);
+    }
+
+    BOOST_CHECK(&GetThreadPoWHashScratch() == &GetThreadPoWHashScratch());
+}
+
+BOOST_AUTO_TEST_CASE(powplan_validity)
+{
+    const uint32_t nGenesisTime = Params().GenesisBlock().nTime;
+
+    CBlockHeader header = PoWTestHeader(3);
+    TPoWPlan plan = GetPoWPlan(header);
+    BOOST_CHECK(plan.bIsSHA256AndX11);
+    BOOST_CHECK_EQUAL(plan.iWeekNumber, (header.nTime - nGenesisTime) / 604800 * 604800);
+    BOOST_CHECK_EQUAL(plan.iCombination, (plan.iWeekNumber + header.nBits) % I_AMOUNT_OF_POW_PLAN_COMBINATIONS);
+    BOOST_CHECK(plan.IsValidFor(header));
+
+    // Other nonces and times within the same week keep the plan.
+    header.nNonce++;
+    header.nTime = nGenesisTime + plan.iWeekNumber + 604800 - 1;
+    BOOST_CHECK(plan.IsValidFor(header));
+    uint256 hash;
+    std::unique_ptr<TPoWHashScratch> pScratch(new TPoWHashScratch);
+    GetPoWHashes(plan, header, header.nNonce, 1, &hash, *pScratch);
+    BOOST_CHECK(hash == header.GetHash());
+
+    // The next week or another nBits do not.
+    header.nTime++;
+    BOOST_CHECK(!plan.IsValidFor(header));
+    header.nTime--;
+    header.nBits++;
+    BOOST_CHECK(!plan.IsValidFor(header));
+
+    // The X11 plan ends where SHA256AndX11 starts.
+    header.nTime = nGenesisTime + 3528000 - 1;
+    TPoWPlan planX11 = GetPoWPlan(header);
+    BOOST_CHECK(!planX11.bIsSHA256AndX11);
+    BOOST_CHECK(planX11.IsValidFor(header));
+    header.nTime++;
+    BOOST_CHECK(!planX11.IsValidFor(header));
+    BOOST_CHECK(GetPoWPlan(header).bIsSHA256AndX11);
+}
+
+BOOST_AUTO_TEST_CASE(salsa20_multi_block_keystream)
+{
+    unsigned char key[32], iv[8];
+    for (int i = 0; i < 32; i++)
+        key[i] = i * 11 + 3;
+    for (int i = 0; i < 8; i++)
+        iv[i] = 255 - i;
+
+    for (unsigned int nBlocks = 0; nBlocks <= 21; nBlocks++) {
+        ECRYPT_ctx ctxBytes, ctxBlocks, ctxPortable;
+        ECRYPT_keysetup(&ctxBytes, key, ECRYPT_MAXKEYSIZE, ECRYPT_MAXIVSIZE);
+        ECRYPT_ivsetup(&ctxBytes, iv);
+        // Start near the 32 bit boundary of the block counter.
+        ctxBytes.input[8] = 0xfffffffe;
+        ctxBlocks = ctxBytes;
+        ctxPortable = ctxBytes;
+
+        std::vector<unsigned char> vBytes(nBlocks * 64 + 64), vBlocks(nBlocks * 64 + 64), vPortable(nBlocks * 64 + 64);
+        ECRYPT_keystream_bytes(&ctxBytes, vBytes.data(), nBlocks * 64);
+        salsa20_keystream_blocks(&ctxBlocks, vBlocks.data(), nBlocks);
+        salsa20_keystream_blocks_portable(&ctxPortable, vPortable.data(), nBlocks);
+        BOOST_CHECK(vBlocks == vBytes);
+        BOOST_CHECK(vPortable == vBytes);
+
+        // The counter is advanced in the same way, so the streams continue identically.
+        ECRYPT_keystream_bytes(&ctxBytes, vBytes.data(), 64);
+        salsa20_keystream_blocks(&ctxBlocks, vBlocks.data(), 1);
+        BOOST_CHECK(std::equal(vBytes.begin(), vBytes.begin() + 64, vBlocks.begin()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(kuznechik_vectorised_matches_table)
+{
+    unsigned char key[32], memory[BlockLengthInBytes * 2];
+    unsigned char roundKeys[BlockLengthInBytes * NumberOfRounds];
+    for (int i = 0; i < 32; i++)
+        key[i] = i * 7 + 1;
+    scheduleEncryptionRoundKeysForGost15(roundKeys, key, memory);
+
+    for (int n = 0; n < 64; n++) {
+        unsigned char block[BlockLengthInBytes], blockVectorised[BlockLengthInBytes];
+        for (int i = 0; i < BlockLengthInBytes; i++)
+            block[i] = blockVectorised[i] = n * 31 + i * 13;
+        encryptBlockWithGost15(roundKeys, block);
+        encryptBlockWithGost15Vectorised(roundKeys, blockVectorised);
+        BOOST_CHECK(std::equal(block, block + BlockLengthInBytes, blockVectorised));
+
+        // Raw memory as round keys, like the proof-of-work does.
+        for (int i = 0; i < BlockLengthInBytes; i++)
+            block[i] = blockVectorised[i] = n + i;
+        encryptBlockWithGost15(&roundKeys[n], block);
+        encryptBlockWithGost15Vectorised(&roundKeys[n], blockVectorised);
+        BOOST_CHECK(std::equal(block, block + BlockLengthInBytes, blockVectorised));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(threefish512_key_schedule)
+{
+    char key[64], tweak[16], plaintext[64], expected[64], ciphertext[64];
+    for (int n = 0; n < 16; n++) {
+        for (int i = 0; i < 64; i++) {
+            key[i] = n * 5 + i * 3;
+            plaintext[i] = n * 17 + i;
+        }
+        for (int i = 0; i < 16; i++)
+            tweak[i] = n > 7 ? i : 0;
+        libskein_threefish_encrypt(expected, key, tweak, plaintext, 64, 512);
+
+        libskein_threefish512_key_schedule schedule;
+        libskein_threefish512_schedule_key(&schedule, key, tweak);
+        libskein_threefish512_encrypt_block(&schedule, ciphertext, plaintext);
+        BOOST_CHECK(std::equal(ciphertext, ciphertext + 64, expected));
+
+        // In place.
+        libskein_threefish512_encrypt_block(&schedule, plaintext, plaintext);
+        BOOST_CHECK(std::equal(plaintext, plaintext + 64, expected));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(streebog_known_answers)
+{
+    for (int i = 0; i < TEST_VECTORS; i++) {
+        unsigned char hash512[64], hash256[32];
+        hash_512(Message[i], MessageLength[i], hash512);
+        hash_256(Message[i], MessageLength[i], hash256);
+        BOOST_CHECK(std::equal(hash512, hash512 + 64, Hash_512[i]));
+        BOOST_CHECK(std::equal(hash256, hash256 + 32, Hash_256[i]));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,91 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "relaycache.h"
+
+#include "arith_uint256.h"
+
+#include "test/test_binarium.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(relaycache_tests, BasicTestingSetup)
+
+static CSerializedNetMsg MakeTestMessage(CConnman& connman, size_t nSize)
+{
+    std::vector<unsigned char> vData(nSize, 0x42);
+    return connman.MakeMessage(PROTOCOL_VERSION, NetMsgType::BLOCK, vData);
+}
+
+BOOST_AUTO_TEST_CASE(relaycache_get_put_erase)
+{
+    CConnman connman;
+    CRelayMessageCache cache;
+    CInv inv1(MSG_BLOCK, ArithToUint256(arith_uint256(1)));
+    CInv inv2(MSG_MASTERNODE_ANNOUNCE, ArithToUint256(arith_uint256(1)));
+
+    CSerializedNetMsg msg = MakeTestMessage(connman, 1000);
+    CSerializedNetMsg msgRet;
+    BOOST_CHECK(!cache.Get(inv1, PROTOCOL_VERSION, msgRet));
+    cache.Put(inv1, PROTOCOL_VERSION, msg);
+    BOOST_CHECK(cache.Get(inv1, PROTOCOL_VERSION, msgRet));
+    // the buffers are shared, not copied
+    BOOST_CHECK(msgRet.payload == msg.payload);
+    BOOST_CHECK(msgRet.header == msg.header);
+    BOOST_CHECK(!cache.Get(inv1, PROTOCOL_VERSION - 1, msgRet));
+    // same hash, other type
+    BOOST_CHECK(!cache.Get(inv2, PROTOCOL_VERSION, msgRet));
+    BOOST_CHECK_EQUAL(cache.GetHits(), 1U);
+    BOOST_CHECK_EQUAL(cache.GetMisses(), 3U);
+
+    cache.Put(inv1, PROTOCOL_VERSION - 1, msg);
+    cache.Put(inv2, PROTOCOL_VERSION, msg);
+    BOOST_CHECK_EQUAL(cache.size(), 3U);
+    cache.Erase(inv1);
+    BOOST_CHECK_EQUAL(cache.size(), 1U);
+    BOOST_CHECK(!cache.Get(inv1, PROTOCOL_VERSION, msgRet));
+    BOOST_CHECK(!cache.Get(inv1, PROTOCOL_VERSION - 1, msgRet));
+    BOOST_CHECK(cache.Get(inv2, PROTOCOL_VERSION, msgRet));
+
+    // replacing an entry does not count it twice
+    size_t nBytes = cache.GetBytes();
+    cache.Put(inv2, PROTOCOL_VERSION, msg);
+    BOOST_CHECK_EQUAL(cache.GetBytes(), nBytes);
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.size(), 0U);
+    BOOST_CHECK_EQUAL(cache.GetBytes(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(relaycache_memory_bound)
+{
+    CConnman connman;
+    CRelayMessageCache cache(100000);
+
+    std::vector<CInv> vInv;
+    for (int i = 0; i < 20; i++) {
+        vInv.push_back(CInv(MSG_BLOCK, ArithToUint256(arith_uint256(i + 1))));
+        cache.Put(vInv.back(), PROTOCOL_VERSION, MakeTestMessage(connman, 10000));
+        BOOST_CHECK(cache.GetBytes() <= 100000);
+        // keep the first one in use
+        CSerializedNetMsg msgRet;
+        BOOST_CHECK(cache.Get(vInv[0], PROTOCOL_VERSION, msgRet));
+    }
+    BOOST_CHECK(cache.size() < 10);
+    CSerializedNetMsg msgRet;
+    BOOST_CHECK(cache.Get(vInv[19], PROTOCOL_VERSION, msgRet));
+    BOOST_CHECK(!cache.Get(vInv[1], PROTOCOL_VERSION, msgRet));
+
+    // larger than the whole cache
+    cache.Put(CInv(MSG_BLOCK, ArithToUint256(arith_uint256(100))), PROTOCOL_VERSION, MakeTestMessage(connman, 200000));
+    BOOST_CHECK(!cache.Get(CInv(MSG_BLOCK, ArithToUint256(arith_uint256(100))), PROTOCOL_VERSION, msgRet));
+    BOOST_CHECK(cache.Get(vInv[0], PROTOCOL_VERSION, msgRet));
+
+    cache.SetMaxBytes(20000);
+    BOOST_CHECK(cache.GetBytes() <= 20000);
+    BOOST_CHECK_EQUAL(cache.size(), 1U);
+    BOOST_CHECK(cache.Get(vInv[0], PROTOCOL_VERSION, msgRet));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,186 @@
+// Copyright (c) 2018-2019 The Binarium Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "socketevents.h"
+
+#include "netbase.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include "test/test_binarium.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(socketevents_tests, BasicTestingSetup)
+
+static std::vector<SocketEventsMode> GetAvailableModes()
+{
+    std::vector<SocketEventsMode> vModes;
+    for (SocketEventsMode mode : {SOCKETEVENTS_SELECT, SOCKETEVENTS_POLL, SOCKETEVENTS_EPOLL}) {
+        if (CreateSocketEvents(mode))
+            vModes.push_back(mode);
+    }
+    return vModes;
+}
+
+/** Loopback connections, vServer[i] is the accepted end of vClient[i] */
+struct LoopbackPeers
+{
+    std::vector<SOCKET> vClient;
+    std::vector<SOCKET> vServer;
+
+    explicit LoopbackPeers(size_t nPeers)
+    {
+        SOCKET hListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        BOOST_REQUIRE(hListen != INVALID_SOCKET);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        BOOST_REQUIRE(bind(hListen, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+        BOOST_REQUIRE(listen(hListen, SOMAXCONN) == 0);
+        socklen_t len = sizeof(addr);
+        BOOST_REQUIRE(getsockname(hListen, (struct sockaddr*)&addr, &len) == 0);
+
+        for (size_t i = 0; i < nPeers; i++) {
+            SOCKET hClient = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            BOOST_REQUIRE(hClient != INVALID_SOCKET);
+            BOOST_REQUIRE(connect(hClient, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+            SOCKET hServer = accept(hListen, NULL, NULL);
+            BOOST_REQUIRE(hServer != INVALID_SOCKET);
+            BOOST_REQUIRE(SetSocketNonBlocking(hServer, true));
+            vClient.push_back(hClient);
+            vServer.push_back(hServer);
+        }
+        CloseSocket(hListen);
+    }
+
+    ~LoopbackPeers()
+    {
+        for (SOCKET& hSocket : vClient)
+            CloseSocket(hSocket);
+        for (SOCKET& hSocket : vServer)
+            CloseSocket(hSocket);
+    }
+};
+
+/** Wait until every socket of setExpected was reported with nEvents, false on timeout */
+static bool WaitForAll(CSocketEvents& socketEvents, std::set<SOCKET> setExpected, unsigned int nEvents, std::map<SOCKET, unsigned int>& mapSeenRet)
+{
+    CSocketEvents::events_vec_t vEvents;
+    int64_t nTimeEnd = GetTimeMillis() + 10000;
+    while (!setExpected.empty() && GetTimeMillis() < nTimeEnd) {
+        if (!socketEvents.Wait(100, vEvents))
+            return false;
+        for (const auto& eventpair : vEvents) {
+            mapSeenRet[eventpair.first] |= eventpair.second;
+            if (eventpair.second & nEvents)
+                setExpected.erase(eventpair.first);
+        }
+    }
+    return setExpected.empty();
+}
+
+static void StressSocketEvents(SocketEventsMode mode, size_t nPeers)
+{
+    std::unique_ptr<CSocketEvents> socketEvents = CreateSocketEvents(mode);
+    BOOST_REQUIRE(socketEvents);
+    BOOST_CHECK(socketEvents->GetMode() == mode);
+
+    LoopbackPeers peers(nPeers);
+    std::set<SOCKET> setServer(peers.vServer.begin(), peers.vServer.end());
+
+    // nothing was sent yet
+    for (SOCKET hSocket : peers.vServer)
+        BOOST_REQUIRE(socketEvents->Add(hSocket, CSocketEvents::EVENT_RECV));
+    CSocketEvents::events_vec_t vEvents;
+    BOOST_CHECK(socketEvents->Wait(10, vEvents));
+    BOOST_CHECK(vEvents.empty());
+
+    // every peer sends its index, every one of them must be reported and read exactly once
+    for (size_t i = 0; i < nPeers; i++) {
+        uint32_t nIndex = i;
+        BOOST_REQUIRE(send(peers.vClient[i], (const char*)&nIndex, sizeof(nIndex), MSG_NOSIGNAL) == sizeof(nIndex));
+    }
+    std::map<SOCKET, unsigned int> mapSeen;
+    BOOST_CHECK(WaitForAll(*socketEvents, setServer, CSocketEvents::EVENT_RECV, mapSeen));
+    BOOST_CHECK_EQUAL(mapSeen.size(), nPeers);
+    for (size_t i = 0; i < nPeers; i++) {
+        uint32_t nIndex = 0;
+        BOOST_CHECK(recv(peers.vServer[i], (char*)&nIndex, sizeof(nIndex), MSG_DONTWAIT) == sizeof(nIndex));
+        BOOST_CHECK_EQUAL(nIndex, i);
+    }
+    BOOST_CHECK(socketEvents->Wait(10, vEvents));
+    BOOST_CHECK(vEvents.empty());
+
+    // waiting for send instead, all of them are writable
+    for (SOCKET hSocket : peers.vServer)
+        BOOST_REQUIRE(socketEvents->Modify(hSocket, CSocketEvents::EVENT_SEND));
+    mapSeen.clear();
+    BOOST_CHECK(WaitForAll(*socketEvents, setServer, CSocketEvents::EVENT_SEND, mapSeen));
+    BOOST_CHECK_EQUAL(mapSeen.size(), nPeers);
+
+    // back to receiving, the clients of the even peers hang up
+    std::set<SOCKET> setClosed;
+    for (size_t i = 0; i < nPeers; i++) {
+        BOOST_REQUIRE(socketEvents->Modify(peers.vServer[i], CSocketEvents::EVENT_RECV));
+        if (i % 2 == 0) {
+            CloseSocket(peers.vClient[i]);
+            setClosed.insert(peers.vServer[i]);
+        }
+    }
+    mapSeen.clear();
+    BOOST_CHECK(WaitForAll(*socketEvents, setClosed, CSocketEvents::EVENT_RECV | CSocketEvents::EVENT_ERROR, mapSeen));
+    BOOST_CHECK_EQUAL(mapSeen.size(), setClosed.size());
+    for (SOCKET hSocket : setClosed) {
+        char ch;
+        BOOST_CHECK_EQUAL(recv(hSocket, &ch, 1, MSG_DONTWAIT), 0);
+    }
+
+    // removed sockets are not reported anymore
+    for (SOCKET hSocket : setClosed)
+        socketEvents->Remove(hSocket);
+    BOOST_CHECK(socketEvents->Wait(10, vEvents));
+    BOOST_CHECK(vEvents.empty());
+
+    // the remaining ones still work after the registrations were shuffled around
+    std::set<SOCKET> setOpen;
+    for (size_t i = 1; i < nPeers; i += 2) {
+        BOOST_REQUIRE(send(peers.vClient[i], "x", 1, MSG_NOSIGNAL) == 1);
+        setOpen.insert(peers.vServer[i]);
+    }
+    mapSeen.clear();
+    BOOST_CHECK(WaitForAll(*socketEvents, setOpen, CSocketEvents::EVENT_RECV, mapSeen));
+    BOOST_CHECK_EQUAL(mapSeen.size(), setOpen.size());
+}
+
+BOOST_AUTO_TEST_CASE(socketevents_modes)
+{
+    SocketEventsMode mode;
+    BOOST_CHECK(ParseSocketEventsMode("select", mode) && mode == SOCKETEVENTS_SELECT);
+    BOOST_CHECK(!ParseSocketEventsMode("kqueue", mode));
+    BOOST_CHECK(ParseSocketEventsMode(GetSocketEventsModeName(DEFAULT_SOCKETEVENTS), mode) && mode == DEFAULT_SOCKETEVENTS);
+    BOOST_CHECK(CreateSocketEvents(DEFAULT_SOCKETEVENTS));
+
+    std::vector<SocketEventsMode> vModes = GetAvailableModes();
+    for (SocketEventsMode modeAvailable : vModes)
+        BOOST_CHECK(ParseSocketEventsMode(GetSocketEventsModeName(modeAvailable), mode) && mode == modeAvailable);
+}
+
+BOOST_AUTO_TEST_CASE(socketevents_loopback_stress)
+{
+    // select() is limited to FD_SETSIZE, the others get as many peers as the limit allows
+    const size_t nMaxPeers = 1000;
+    size_t nFD = RaiseFileDescriptorLimit(2 * nMaxPeers + 100);
+    size_t nPeers = nFD > 100 ? std::min(nMaxPeers, (nFD - 100) / 2) : 0;
+    BOOST_REQUIRE(nPeers > 0);
+
+    for (SocketEventsMode mode : GetAvailableModes()) {
+        BOOST_TEST_MESSAGE("socketevents_loopback_stress " << GetSocketEventsModeName(mode));
+        StressSocketEvents(mode, mode == SOCKETEVENTS_SELECT ? std::min<size_t>(nPeers, FD_SETSIZE / 4) : nPeers);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -14,6 +14,8 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+
 #include <boost/thread.hpp>
 
 using namespace std;
@@ -57,7 +59,7 @@ struct CoinEntry {
 
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true) 
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true, DBPROFILE_CHAINSTATE)
 {
 }
 
@@ -78,21 +80,32 @@ uint256 CCoinsViewDB::GetBestBlock() const {
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     CDBBatch batch(db);
-    size_t count = 0;
+    size_t count = mapCoins.size();
     size_t changed = 0;
+    // LevelDB inserts the batch into its memtable key by key, and each insert of keys in order
+    // starts next to the previous one. Entries are erased as soon as they are not needed any
+    // more, erasing keeps the iterators to the others valid.
+    std::vector<CCoinsMap::iterator> vDirty;
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
-            CoinEntry entry(&it->first);
-            if (it->second.coin.IsSpent())
-                batch.Erase(entry);
-            else
-                batch.Write(entry, it->second.coin);
-            changed++;
+            vDirty.push_back(it++);
+        } else {
+            CCoinsMap::iterator itOld = it++;
+            mapCoins.erase(itOld);
         }
-        count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
     }
+    std::sort(vDirty.begin(), vDirty.end(), [](const CCoinsMap::iterator& a, const CCoinsMap::iterator& b) { return a->first < b->first; });
+    for (const CCoinsMap::iterator& it : vDirty) {
+        CoinEntry entry(&it->first);
+        if (it->second.coin.IsSpent())
+            batch.Erase(entry);
+        else
+            batch.Write(entry, it->second.coin);
+        changed++;
+        mapCoins.erase(it);
+    }
+    std::vector<CCoinsMap::iterator>().swap(vDirty);
+    mapCoins.clear();
     if (!hashBlock.IsNull())
         batch.Write(DB_BEST_BLOCK, hashBlock);
 
@@ -106,7 +119,12 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
+void CCoinsViewDB::GetDBStats(CDBStats& stats) const
+{
+    db.GetStats(stats);
+}
+
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, false, DBPROFILE_BLOCKINDEX) {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
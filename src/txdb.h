@@ -83,6 +83,8 @@ public:
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
+    //! Settings and counters of the LevelDB database
+    void GetDBStats(CDBStats& stats) const;
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -8,12 +8,15 @@
 
 #include "alert.h"
 #include "arith_uint256.h"
+#include "blockfilemap.h"
+#include "blockimport.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
+#include "crypto/common.h"
 #include "hash.h"
 #include "init.h"
 #include "policy/policy.h"
@@ -67,6 +70,7 @@ CBlockIndex *pindexBestHeader = NULL;
 CWaitableCriticalSection csBestBlock;
 CConditionVariable cvBlockChange;
 int nScriptCheckThreads = 0;
+int nPoWCheckThreads = 0;
 bool fImporting = false;
 bool fReindex = false;
 bool fTxIndex = true;
@@ -80,6 +84,7 @@ bool fRequireStandard = true;
 unsigned int nBytesPerSigOp = DEFAULT_BYTES_PER_SIGOP;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
+bool fParanoidBlockReads = DEFAULT_PARANOID_BLOCK_READS;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
 bool fAlerts = DEFAULT_ALERTS;
@@ -1154,6 +1159,19 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, const Consensus::P
 // CBlock and CBlockIndex
 //
 
+// Fixed SipHash keys, the checksum only has to catch corruption of data we wrote ourselves
+static const uint64_t BLOCK_CHECKSUM_K0 = 0x626c6f636b636865ULL;
+static const uint64_t BLOCK_CHECKSUM_K1 = 0x636b73756d76310aULL;
+
+uint64_t GetBlockChecksum(const uint256& hashBlock, const CDataStream& ssBlock)
+{
+    CSipHasher hasher(BLOCK_CHECKSUM_K0, BLOCK_CHECKSUM_K1);
+    hasher.Write(hashBlock.begin(), hashBlock.size());
+    if (!ssBlock.empty())
+        hasher.Write((const unsigned char*)&ssBlock[0], ssBlock.size());
+    return hasher.Finalize();
+}
+
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
@@ -1161,8 +1179,11 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHea
     if (fileout.IsNull())
         return error("WriteBlockToDisk: OpenBlockFile failed");
 
+    CDataStream ssBlock(SER_DISK, CLIENT_VERSION);
+    ssBlock << block;
+
     // Write index header
-    unsigned int nSize = fileout.GetSerializeSize(block);
+    unsigned int nSize = ssBlock.size();
     fileout << FLATDATA(messageStart) << nSize;
 
     // Write block
@@ -1170,7 +1191,57 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHea
     if (fileOutPos < 0)
         return error("WriteBlockToDisk: ftell failed");
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
+    fileout.write(&ssBlock[0], ssBlock.size());
+
+    // Write checksum, the block hash is usually cached from validation at this point
+    fileout << GetBlockChecksum(block.GetHash(), ssBlock);
+
+    return true;
+}
+
+bool ReadRawBlockFromDisk(CDataStream& ssBlock, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart)
+{
+    ssBlock.clear();
+
+    CDiskBlockPos pos = pindex->GetBlockPos();
+    if (pos.nPos < 8)
+        return error("%s: Invalid position %s", __func__, pos.ToString());
+
+    // Check the index header
+    unsigned char aIndexHeader[8];
+    if (!blockFileMapCache.Read(CDiskBlockPos(pos.nFile, pos.nPos - 8), aIndexHeader, sizeof(aIndexHeader)))
+        return error("%s: Cannot read block file at %s", __func__, pos.ToString());
+    if (memcmp(aIndexHeader, messageStart, MESSAGE_START_SIZE) != 0)
+        return error("%s: Block magic mismatch at %s", __func__, pos.ToString());
+    unsigned int nSize = ReadLE32(aIndexHeader + 4);
+    if (nSize < I_BLOCK_HEADER_SIZE || nSize > MAX_SIZE)
+        return error("%s: Invalid block size %u at %s", __func__, nSize, pos.ToString());
+
+    // Read the block with its checksum
+    bool fChecksum = pindex->nStatus & BLOCK_HAVE_CHECKSUM;
+    ssBlock.resize(nSize + (fChecksum ? BLOCK_CHECKSUM_SIZE : 0));
+    if (!blockFileMapCache.Read(pos, (unsigned char*)&ssBlock[0], ssBlock.size()))
+        return error("%s: Cannot read block file at %s", __func__, pos.ToString());
+
+    if (fChecksum) {
+        // A matching checksum proves these are the bytes we wrote for the hash of the index
+        uint64_t nChecksum = ReadLE64((const unsigned char*)&ssBlock[nSize]);
+        ssBlock.resize(nSize);
+        if (nChecksum != GetBlockChecksum(pindex->GetBlockHash(), ssBlock))
+            return error("%s: Checksum mismatch for block %s at %s", __func__, pindex->GetBlockHash().ToString(), pos.ToString());
+    } else {
+        // Older records only have their header to check
+        CBlockHeader header;
+        try {
+            CDataStream ssHeader(ssBlock.begin(), ssBlock.begin() + I_BLOCK_HEADER_SIZE, SER_DISK, CLIENT_VERSION);
+            ssHeader >> header;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s at %s", __func__, e.what(), pos.ToString());
+        }
+        if (header.GetHash() != pindex->GetBlockHash())
+            return error("%s: GetHash() doesn't match index for %s at %s", __func__, pindex->ToString(), pos.ToString());
+    }
 
     return true;
 }
@@ -1201,6 +1272,22 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
 
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
+    if ((pindex->nStatus & BLOCK_HAVE_CHECKSUM) && !fParanoidBlockReads) {
+        // The hash of the index is proven by the checksum, no need to recompute the proof of work
+        block.SetNull();
+        CDataStream ssBlock(SER_DISK, CLIENT_VERSION);
+        if (!ReadRawBlockFromDisk(ssBlock, pindex, Params().MessageStart()))
+            return false;
+        try {
+            ssBlock >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s at %s", __func__, e.what(), pindex->GetBlockPos().ToString());
+        }
+        block.SetHashCache(pindex->GetBlockHash());
+        return true;
+    }
+
     if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), consensusParams))
         return false;
     if (block.GetHash() != pindex->GetBlockHash())
@@ -1883,6 +1970,43 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+// One memory-hard hash is far more work than a script check, hence the smaller batches.
+static CCheckQueue<CBlockHeaderPoWCheck> powcheckqueue(16);
+// CCheckQueueControl expects the queue to be idle, so batches are checked one at a time.
+static CCriticalSection cs_powcheckqueue;
+
+void ThreadPoWCheck() {
+    RenameThread("binarium-powchk");
+    powcheckqueue.Thread();
+}
+
+bool CBlockHeaderPoWCheck::operator()() {
+    return CheckProofOfWork(pheader->GetHash(), pheader->nBits, *pconsensusParams);
+}
+
+bool CheckBlockHeadersProofOfWork(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams)
+{
+    std::vector<CBlockHeaderPoWCheck> vChecks;
+    vChecks.reserve(headers.size());
+    for (const CBlockHeader& header : headers) {
+        if (!header.IsHashCached())
+            vChecks.push_back(CBlockHeaderPoWCheck(header, consensusParams));
+    }
+
+    if (nPoWCheckThreads == 0 || vChecks.size() <= 1) {
+        for (CBlockHeaderPoWCheck& check : vChecks) {
+            if (!check())
+                return false;
+        }
+        return true;
+    }
+
+    LOCK(cs_powcheckqueue);
+    CCheckQueueControl<CBlockHeaderPoWCheck> control(&powcheckqueue);
+    control.Add(vChecks);
+    return control.Wait();
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -3488,11 +3612,15 @@ static bool AcceptBlock(const CBlock& block, CValidationState& state, const CCha
         CDiskBlockPos blockPos;
         if (dbp != NULL)
             blockPos = *dbp;
-        if (!FindBlockPos(state, blockPos, nBlockSize+8, nHeight, block.GetBlockTime(), dbp != NULL))
+        // blocks imported from external files (-reindex, -loadblock) keep their records as they are
+        unsigned int nRecordSize = nBlockSize + 8 + (dbp == NULL ? BLOCK_CHECKSUM_SIZE : 0);
+        if (!FindBlockPos(state, blockPos, nRecordSize, nHeight, block.GetBlockTime(), dbp != NULL))
             return error("AcceptBlock(): FindBlockPos failed");
-        if (dbp == NULL)
+        if (dbp == NULL) {
             if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart()))
                 AbortNode(state, "Failed to write block");
+            pindex->nStatus |= BLOCK_HAVE_CHECKSUM;
+        }
         if (!ReceivedBlockTransactions(block, state, pindex, blockPos))
             return error("AcceptBlock(): ReceivedBlockTransactions failed");
     } catch (const std::runtime_error& e) {
@@ -3593,6 +3721,7 @@ void PruneOneBlockFile(const int fileNumber)
         if (pindex->nFile == fileNumber) {
             pindex->nStatus &= ~BLOCK_HAVE_DATA;
             pindex->nStatus &= ~BLOCK_HAVE_UNDO;
+            pindex->nStatus &= ~BLOCK_HAVE_CHECKSUM;
             pindex->nFile = 0;
             pindex->nDataPos = 0;
             pindex->nUndoPos = 0;
@@ -3622,6 +3751,7 @@ void UnlinkPrunedFiles(std::set<int>& setFilesToPrune)
 {
     for (set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        blockFileMapCache.Unmap(*it);
         boost::filesystem::remove(GetBlockPosFilename(pos, "blk"));
         boost::filesystem::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -3972,6 +4102,7 @@ void UnloadBlockIndex()
     nBlockSequenceId = 1;
     setDirtyBlockIndex.clear();
     setDirtyFileInfo.clear();
+    blockFileMapCache.Clear();
     versionbitscache.Clear();
     for (int b = 0; b < VERSIONBITS_NUM_BITS; b++) {
         warningcache[b].clear();
@@ -4025,11 +4156,12 @@ bool InitBlockIndex(const CChainParams& chainparams)
             unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
             CDiskBlockPos blockPos;
             CValidationState state;
-            if (!FindBlockPos(state, blockPos, nBlockSize+8, 0, block.GetBlockTime()))
+            if (!FindBlockPos(state, blockPos, nBlockSize+8+BLOCK_CHECKSUM_SIZE, 0, block.GetBlockTime()))
                 return error("%s: FindBlockPos failed", __func__);
             if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart()))
                 return error("%s: writing genesis block to disk failed", __func__);
             CBlockIndex *pindex = AddToBlockIndex(block);
+            pindex->nStatus |= BLOCK_HAVE_CHECKSUM;
             if (!ReceivedBlockTransactions(block, state, pindex, blockPos))
                 return error("%s: genesis block not accepted", __func__);
             // Force a chainstate write so that when we VerifyDB in a moment, it doesn't check stale data
@@ -4042,59 +4174,61 @@ bool InitBlockIndex(const CChainParams& chainparams)
     return true;
 }
 
+/** AcceptBlock for a block of a block file, that stays where it is when dbp is set */
+static bool AcceptImportedBlock(const CImportedBlock& imported, CValidationState& state, const CChainParams& chainparams, const CDiskBlockPos* dbp)
+{
+    CBlockIndex* pindex = NULL;
+    if (!AcceptBlock(imported.block, state, chainparams, &pindex, true, dbp, NULL))
+        return false;
+    // Records written with their checksum keep the reads that trust it after a reindex
+    if (dbp && imported.fChecksum && pindex && pindex->GetBlockPos() == *dbp) {
+        pindex->nStatus |= BLOCK_HAVE_CHECKSUM;
+        setDirtyBlockIndex.insert(pindex);
+    }
+    return true;
+}
+
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
+    // Map of disk positions for blocks with unknown parent (only used for reindex), with the block
+    // itself while they take less than MAX_UNKNOWN_PARENT_BYTES, so that they are not read again
+    typedef std::multimap<uint256, std::pair<CDiskBlockPos, std::shared_ptr<CImportedBlock> > > UnknownParentMap;
+    static UnknownParentMap mapBlocksUnknownParent;
+    static uint64_t nUnknownParentBytes = 0;
+    static const uint64_t MAX_UNKNOWN_PARENT_BYTES = 32 * 1024 * 1024;
     int64_t nStart = GetTimeMillis();
 
     int nLoaded = 0;
     try {
-        unsigned int nMaxBlockSize = MaxBlockSize(true);
+        // Deserialization and hashing run on the proof-of-work check threads count.
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2*nMaxBlockSize, nMaxBlockSize+8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
+        CBlockImporter importer(fileIn, chainparams.MessageStart(), MaxBlockSize(true), nPoWCheckThreads);
+        std::shared_ptr<CImportedBlock> pimported;
+        while (importer.Next(pimported)) {
             boost::this_thread::interruption_point();
 
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
             try {
-                // locate a header
-                unsigned char buf[MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, chainparams.MessageStart(), MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > nMaxBlockSize)
+                if (!pimported->fDecoded) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, pimported->strError);
                     continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
+                }
+                const CBlock& block = pimported->block;
                 if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock block;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
+                    dbp->nPos = pimported->nPos;
 
                 // detect out of order blocks, and store them for later
                 uint256 hash = block.GetHash();
                 if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
                     LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
                             block.hashPrevBlock.ToString());
-                    if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+                    if (dbp) {
+                        std::shared_ptr<CImportedBlock> pkept;
+                        if (nUnknownParentBytes + pimported->nSize <= MAX_UNKNOWN_PARENT_BYTES) {
+                            pkept = pimported;
+                            nUnknownParentBytes += pimported->nSize;
+                        }
+                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, std::make_pair(*dbp, pkept)));
+                    }
                     continue;
                 }
 
@@ -4102,7 +4236,7 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
                 if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
                     LOCK(cs_main);
                     CValidationState state;
-                    if (AcceptBlock(block, state, chainparams, NULL, true, dbp, NULL))
+                    if (AcceptImportedBlock(*pimported, state, chainparams, dbp))
                         nLoaded++;
                     if (state.IsError())
                         break;
@@ -4126,19 +4260,27 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
                 while (!queue.empty()) {
                     uint256 head = queue.front();
                     queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+                    std::pair<UnknownParentMap::iterator, UnknownParentMap::iterator> range = mapBlocksUnknownParent.equal_range(head);
                     while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        if (ReadBlockFromDisk(block, it->second, chainparams.GetConsensus()))
+                        UnknownParentMap::iterator it = range.first;
+                        std::shared_ptr<CImportedBlock> pchild = it->second.second;
+                        if (pchild) {
+                            nUnknownParentBytes -= pchild->nSize;
+                        } else {
+                            // not kept, read it again
+                            pchild = std::make_shared<CImportedBlock>();
+                            pchild->fDecoded = ReadBlockFromDisk(pchild->block, it->second.first, chainparams.GetConsensus());
+                        }
+                        if (pchild->fDecoded)
                         {
-                            LogPrint("reindex", "%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
+                            LogPrint("reindex", "%s: Processing out of order child %s of %s\n", __func__, pchild->block.GetHash().ToString(),
                                     head.ToString());
                             LOCK(cs_main);
                             CValidationState dummy;
-                            if (AcceptBlock(block, dummy, chainparams, NULL, true, &it->second, NULL))
+                            if (AcceptImportedBlock(*pchild, dummy, chainparams, &it->second.first))
                             {
                                 nLoaded++;
-                                queue.push_back(block.GetHash());
+                                queue.push_back(pchild->block.GetHash());
                             }
                         }
                         range.first++;
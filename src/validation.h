@@ -41,6 +41,7 @@ class CChainParams;
 class CCoinsViewDB;
 class CInv;
 class CConnman;
+class CDataStream;
 class CScriptCheck;
 class CTxMemPool;
 class CValidationInterface;
@@ -79,6 +80,10 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of proof-of-work checking threads allowed */
+static const int MAX_POWCHECK_THREADS = 16;
+/** -parpow default (number of proof-of-work checking threads, 0 = auto) */
+static const int DEFAULT_POWCHECK_THREADS = 0;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -116,6 +121,7 @@ static const bool DEFAULT_RELAYPRIORITY = true;
 static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static const unsigned int DEFAULT_BYTES_PER_SIGOP = 20;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
+static const bool DEFAULT_PARANOID_BLOCK_READS = false;
 static const bool DEFAULT_TXINDEX = true;
 static const bool DEFAULT_ADDRESSINDEX = false;
 static const bool DEFAULT_TIMESTAMPINDEX = false;
@@ -147,12 +153,15 @@ extern CConditionVariable cvBlockChange;
 extern bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
+extern int nPoWCheckThreads;
 extern bool fTxIndex;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern unsigned int nBytesPerSigOp;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+/** Check the proof of work of blocks read from disk even when their checksum matches */
+extern bool fParanoidBlockReads;
 extern size_t nCoinCacheUsage;
 extern CFeeRate minRelayTxFee;
 extern bool fAlerts;
@@ -185,6 +194,9 @@ extern uint64_t nPruneTarget;
 /** Block files containing a block-height within MIN_BLOCKS_TO_KEEP of chainActive.Tip() will not be pruned. */
 static const unsigned int MIN_BLOCKS_TO_KEEP = 288;
 
+/** Size of the checksum following each block written to blk*.dat */
+static const unsigned int BLOCK_CHECKSUM_SIZE = 8;
+
 static const signed int DEFAULT_CHECKBLOCKS = 6;
 static const unsigned int DEFAULT_CHECKLEVEL = 3;
 
@@ -228,6 +240,16 @@ bool ProcessNewBlock(const CChainParams& chainparams, const CBlock* pblock, bool
  */
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex=NULL);
 
+/**
+ * Hash a batch of block headers, such as a whole headers message, on the proof-of-work check
+ * threads (-parpow) and check their proof of work. The hashes end up in the headers' hash caches,
+ * so that the serial checks under cs_main do not compute them again. Headers with a cached hash
+ * are skipped. Must be called without cs_main held.
+ *
+ * @return false if any proof of work is invalid; headers after it may then be left unhashed
+ */
+bool CheckBlockHeadersProofOfWork(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams);
+
 /** Check whether enough disk space is available for an incoming block */
 bool CheckDiskSpace(uint64_t nAdditionalBytes = 0);
 /** Open a block file (blk?????.dat) */
@@ -246,6 +268,8 @@ bool LoadBlockIndex();
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the proof-of-work checking thread */
+void ThreadPoWCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core.
@@ -425,6 +449,29 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing the proof-of-work check of one block header, see
+ * CheckBlockHeadersProofOfWork().
+ */
+class CBlockHeaderPoWCheck
+{
+private:
+    const CBlockHeader *pheader;
+    const Consensus::Params *pconsensusParams;
+
+public:
+    CBlockHeaderPoWCheck(): pheader(NULL), pconsensusParams(NULL) {}
+    CBlockHeaderPoWCheck(const CBlockHeader& headerIn, const Consensus::Params& consensusParamsIn) :
+        pheader(&headerIn), pconsensusParams(&consensusParamsIn) { }
+
+    bool operator()();
+
+    void swap(CBlockHeaderPoWCheck &check) {
+        std::swap(pheader, check.pheader);
+        std::swap(pconsensusParams, check.pconsensusParams);
+    }
+};
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 bool GetAddressIndex(uint160 addressHash, int type,
@@ -435,6 +482,9 @@ bool GetAddressUnspent(uint160 addressHash, int type,
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
+uint64_t GetBlockChecksum(const uint256& hashBlock, const CDataStream& ssBlock);
+/** Read the serialized block of pindex as it is on disk, checked against its checksum or the hash of its header */
+bool ReadRawBlockFromDisk(CDataStream& ssBlock, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
 
@@ -9,6 +9,8 @@
 #include <boost/signals2/signal.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <string>
+
 class CBlock;
 struct CBlockLocator;
 class CBlockIndex;
@@ -42,6 +44,7 @@ protected:
     virtual void BlockChecked(const CBlock&, const CValidationState&) {}
     virtual void GetScriptForMining(boost::shared_ptr<CReserveScript>&) {};
     virtual void ResetRequestCount(const uint256 &hash) {};
+    virtual void MiningTelemetry(const std::string &strTelemetry) {};
     friend void ::RegisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
@@ -74,6 +77,8 @@ struct CMainSignals {
     boost::signals2::signal<void (boost::shared_ptr<CReserveScript>&)> ScriptForMining;
     /** Notifies listeners that a block has been successfully mined */
     boost::signals2::signal<void (const uint256 &)> BlockFound;
+    /** Notifies listeners of the built-in miner statistics, as JSON, every few seconds while mining */
+    boost::signals2::signal<void (const std::string &)> MiningTelemetry;
 };
 
 CMainSignals& GetMainSignals();
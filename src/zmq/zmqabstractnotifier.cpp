@@ -25,3 +25,8 @@ bool CZMQAbstractNotifier::NotifyTransactionLock(const CTransaction &/*transacti
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyMiningTelemetry(const std::string &/*strTelemetry*/)
+{
+    return true;
+}
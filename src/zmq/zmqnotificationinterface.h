@@ -5,6 +5,7 @@
 #ifndef BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
+#include "sync.h"
 #include "validationinterface.h"
 #include <string>
 #include <map>
@@ -27,11 +28,15 @@ protected:
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock);
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload);
     void NotifyTransactionLock(const CTransaction &tx);
+    void MiningTelemetry(const std::string &strTelemetry);
 
 private:
     CZMQNotificationInterface();
 
     void *pcontext;
+    // The notifications come from the validation thread, InstantSend and the miner, and zmq
+    // sockets, shared between notifiers of the same address, are not thread-safe
+    CCriticalSection cs_notifiers;
     std::list<CZMQAbstractNotifier*> notifiers;
 };
 
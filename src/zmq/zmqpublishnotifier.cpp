@@ -16,6 +16,7 @@ static const char *MSG_HASHTXLOCK = "hashtxlock";
 static const char *MSG_RAWBLOCK   = "rawblock";
 static const char *MSG_RAWTX      = "rawtx";
 static const char *MSG_RAWTXLOCK = "rawtxlock";
+static const char *MSG_MININGTELEMETRY = "miningtelemetry";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -211,3 +212,9 @@ bool CZMQPublishRawTransactionLockNotifier::NotifyTransactionLock(const CTransac
     ss << transaction;
     return SendMessage(MSG_RAWTXLOCK, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishMiningTelemetryNotifier::NotifyMiningTelemetry(const std::string &strTelemetry)
+{
+    LogPrint("zmq", "zmq: Publish miningtelemetry\n");
+    return SendMessage(MSG_MININGTELEMETRY, strTelemetry.data(), strTelemetry.size());
+}
@@ -64,4 +64,10 @@ public:
     bool NotifyTransactionLock(const CTransaction &transaction);
 };
 
+class CZMQPublishMiningTelemetryNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyMiningTelemetry(const std::string &strTelemetry);
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H